@@ -86,6 +86,7 @@ usage() {
 	echo "  --disable-utils           Disable compilation of utils."
 	echo "  --disable-check-alloc     Disables memory allocator error handling."
 	echo "  --disable-counter-hash    Disables hash tables for counter/string lookups."
+	echo "  --enable-swiss-hash       Use SIMD Swiss tables for counter/string lookups."
 	echo "  --disable-vfs             Disables MZX's built-in virtual filesystem."
 	echo "  --enable-extram           Enable board memory compression and storage hacks."
 	echo "  --enable-meter            Enable load/save meter display."
@@ -205,6 +206,7 @@ EGL="false"
 GLES="false"
 CHECK_ALLOC="true"
 COUNTER_HASH="true"
+SWISS_HASH="false"
 DEBYTECODE="false"
 TRACE_LOGGING="false"
 STDIO_REDIRECT="false"
@@ -461,6 +463,9 @@ while [ "$1" != "" ]; do
 	[ "$1" = "--enable-counter-hash" ]  && COUNTER_HASH="true"
 	[ "$1" = "--disable-counter-hash" ] && COUNTER_HASH="false"
 
+	[ "$1" = "--enable-swiss-hash" ]  && SWISS_HASH="true"
+	[ "$1" = "--disable-swiss-hash" ] && SWISS_HASH="false"
+
 	[ "$1" = "--enable-vfs" ]  && VFS="true"
 	[ "$1" = "--disable-vfs" ] && VFS="false"
 
@@ -1896,6 +1901,11 @@ if [ "$COUNTER_HASH" = "true" ]; then
 	echo "Hash table counter/string lookups enabled."
 	echo "#define CONFIG_COUNTER_HASH_TABLES" >> src/config.h
 	echo "BUILD_COUNTER_HASH_TABLES=1" >> platform.inc
+
+	if [ "$SWISS_HASH" = "true" ]; then
+		echo "Using Swiss tables for counter/string lookups."
+		echo "#define CONFIG_COUNTER_SWISS_TABLES" >> src/config.h
+	fi
 else
 	echo "Hash table counter/string lookups disabled (using binary search)."
 fi
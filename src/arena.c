@@ -0,0 +1,273 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Arena allocator for counter and string lists. Small allocations are carved
+ * out of large blocks in order and are never freed individually. Pool
+ * allocations (string values) are rounded up to a size class and returned to
+ * a free list for that class when freed or resized, and allocations too large
+ * for any class are made separately and kept in a list. Clearing the arena
+ * frees every block and large allocation at once, regardless of how many
+ * objects were allocated from them.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "util.h"
+
+#define ARENA_ALIGN 8
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_MAX_CLASS_SIZE \
+ ((size_t)1 << (ARENA_MIN_CLASS_SHIFT + ARENA_NUM_CLASSES - 1))
+
+#define ARENA_ROUND(x) (((x) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena_block
+{
+  struct arena_block *next;
+  size_t size;
+};
+
+struct arena_large
+{
+  struct arena_large *prev;
+  struct arena_large *next;
+  size_t size;
+};
+
+#define ARENA_BLOCK_HEADER ARENA_ROUND(sizeof(struct arena_block))
+#define ARENA_LARGE_HEADER ARENA_ROUND(sizeof(struct arena_large))
+
+static int arena_class(size_t size)
+{
+  int class_id = 0;
+  size = (size - 1) >> ARENA_MIN_CLASS_SHIFT;
+  while(size)
+  {
+    size >>= 1;
+    class_id++;
+  }
+  return class_id;
+}
+
+static size_t arena_class_size(int class_id)
+{
+  return (size_t)1 << (class_id + ARENA_MIN_CLASS_SHIFT);
+}
+
+/**
+ * Allocate memory that will only be freed when the arena is cleared. The
+ * returned memory is aligned to 8 bytes.
+ */
+void *arena_alloc(struct arena *a, size_t size)
+{
+  void *ptr;
+
+  size = ARENA_ROUND(size ? size : 1);
+
+  if(!a->blocks || a->block_pos + size > a->block_size)
+  {
+    size_t block_size = MAX(ARENA_BLOCK_SIZE, ARENA_BLOCK_HEADER + size);
+    struct arena_block *block = (struct arena_block *)cmalloc(block_size);
+    if(!block)
+      return NULL;
+
+    block->next = a->blocks;
+    block->size = block_size;
+    a->blocks = block;
+    a->block_pos = ARENA_BLOCK_HEADER;
+    a->block_size = block_size;
+    a->total_size += block_size;
+  }
+
+  ptr = (char *)a->blocks + a->block_pos;
+  a->block_pos += size;
+  return ptr;
+}
+
+static struct arena_large *arena_large_header(void *ptr)
+{
+  return (struct arena_large *)((char *)ptr - ARENA_LARGE_HEADER);
+}
+
+static void arena_large_link(struct arena *a, struct arena_large *l)
+{
+  l->prev = NULL;
+  l->next = a->large;
+  if(a->large)
+    a->large->prev = l;
+  a->large = l;
+}
+
+static void arena_large_unlink(struct arena *a, struct arena_large *l)
+{
+  if(l->prev)
+    l->prev->next = l->next;
+  else
+    a->large = l->next;
+
+  if(l->next)
+    l->next->prev = l->prev;
+}
+
+/**
+ * Allocate memory that can be freed or resized before the arena is cleared.
+ * The size of the allocation must be provided again when it is freed or
+ * resized.
+ */
+void *arena_pool_alloc(struct arena *a, size_t size)
+{
+  struct arena_large *l;
+  void *ptr;
+  int class_id;
+
+  if(!size)
+    size = 1;
+
+  if(size > ARENA_MAX_CLASS_SIZE)
+  {
+    l = (struct arena_large *)cmalloc(ARENA_LARGE_HEADER + size);
+    if(!l)
+      return NULL;
+
+    l->size = size;
+    arena_large_link(a, l);
+    a->total_size += ARENA_LARGE_HEADER + size;
+    return (char *)l + ARENA_LARGE_HEADER;
+  }
+
+  class_id = arena_class(size);
+  ptr = a->free_lists[class_id];
+  if(ptr)
+  {
+    a->free_lists[class_id] = *(void **)ptr;
+    return ptr;
+  }
+  return arena_alloc(a, arena_class_size(class_id));
+}
+
+/**
+ * Resize a pool allocation. Allocations that stay within the same size class
+ * are not moved. Returns NULL on failure, in which case the original
+ * allocation is left alone.
+ */
+void *arena_pool_realloc(struct arena *a, void *ptr, size_t old_size,
+ size_t new_size)
+{
+  void *new_ptr;
+
+  if(!ptr)
+    return arena_pool_alloc(a, new_size);
+
+  if(!old_size)
+    old_size = 1;
+  if(!new_size)
+    new_size = 1;
+
+  if(old_size > ARENA_MAX_CLASS_SIZE && new_size > ARENA_MAX_CLASS_SIZE)
+  {
+    struct arena_large *l = arena_large_header(ptr);
+    struct arena_large *prev = l->prev;
+    struct arena_large *next = l->next;
+    size_t prev_size = l->size;
+
+    l = (struct arena_large *)crealloc(l, ARENA_LARGE_HEADER + new_size);
+    if(!l)
+      return NULL;
+
+    if(prev)
+      prev->next = l;
+    else
+      a->large = l;
+
+    if(next)
+      next->prev = l;
+
+    l->size = new_size;
+    a->total_size += new_size - prev_size;
+    return (char *)l + ARENA_LARGE_HEADER;
+  }
+
+  if(old_size <= ARENA_MAX_CLASS_SIZE && new_size <= ARENA_MAX_CLASS_SIZE &&
+   arena_class(old_size) == arena_class(new_size))
+    return ptr;
+
+  new_ptr = arena_pool_alloc(a, new_size);
+  if(!new_ptr)
+    return NULL;
+
+  memcpy(new_ptr, ptr, MIN(old_size, new_size));
+  arena_pool_free(a, ptr, old_size);
+  return new_ptr;
+}
+
+/**
+ * Return a pool allocation to the arena.
+ */
+void arena_pool_free(struct arena *a, void *ptr, size_t size)
+{
+  int class_id;
+
+  if(!ptr)
+    return;
+
+  if(!size)
+    size = 1;
+
+  if(size > ARENA_MAX_CLASS_SIZE)
+  {
+    struct arena_large *l = arena_large_header(ptr);
+    arena_large_unlink(a, l);
+    a->total_size -= ARENA_LARGE_HEADER + l->size;
+    free(l);
+    return;
+  }
+
+  class_id = arena_class(size);
+  *(void **)ptr = a->free_lists[class_id];
+  a->free_lists[class_id] = ptr;
+}
+
+/**
+ * Free everything allocated from an arena. The arena can be reused after.
+ */
+void arena_clear(struct arena *a)
+{
+  struct arena_block *block = a->blocks;
+  struct arena_large *l = a->large;
+
+  while(block)
+  {
+    struct arena_block *next = block->next;
+    free(block);
+    block = next;
+  }
+
+  while(l)
+  {
+    struct arena_large *next = l->next;
+    free(l);
+    l = next;
+  }
+
+  memset(a, 0, sizeof(struct arena));
+}
@@ -0,0 +1,60 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include "compat.h"
+
+__M_BEGIN_DECLS
+
+#include <stddef.h>
+
+// Pool allocations are rounded up to a power of two from 16 to 4096 bytes.
+// Anything larger is allocated separately (but still freed with the arena).
+#define ARENA_MIN_CLASS_SHIFT 4
+#define ARENA_NUM_CLASSES 9
+
+struct arena_block;
+struct arena_large;
+
+/**
+ * Allocator for objects that all share the lifetime of a list, such as the
+ * counter and string lists. A zero-initialized arena is empty and valid.
+ */
+struct arena
+{
+  struct arena_block *blocks;
+  struct arena_large *large;
+  void *free_lists[ARENA_NUM_CLASSES];
+  size_t block_pos;
+  size_t block_size;
+  size_t total_size;
+};
+
+void *arena_alloc(struct arena *a, size_t size);
+void *arena_pool_alloc(struct arena *a, size_t size);
+void *arena_pool_realloc(struct arena *a, void *ptr, size_t old_size,
+ size_t new_size);
+void arena_pool_free(struct arena *a, void *ptr, size_t size);
+void arena_clear(struct arena *a);
+
+__M_END_DECLS
+
+#endif /* __ARENA_H */
@@ -23,6 +23,7 @@
 // Code to handle module playing, sample playing, and PC speaker
 // sfx emulation.
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
@@ -30,6 +31,7 @@
 #include <sys/stat.h>
 
 #include "audio.h"
+#include "audio_offline.h"
 #include "audio_pcs.h"
 #include "audio_struct.h"
 #include "ext.h"
@@ -201,6 +203,7 @@ void initialize_audio_stream(struct audio_stream *a_src,
  struct audio_stream_spec *a_spec, unsigned int volume, boolean repeat)
 {
   // TODO should probably just memcpy into a spec in the audio_stream instead.
+  a_src->name = a_spec->name ? a_spec->name : "unknown";
   a_src->mix_data = a_spec->mix_data;
   a_src->set_volume = a_spec->set_volume;
   a_src->set_repeat = a_spec->set_repeat;
@@ -234,6 +237,132 @@ void initialize_audio_stream(struct audio_stream *a_src,
   UNLOCK();
 }
 
+static void audio_histogram_add(struct audio_histogram *h, uint64_t ns)
+{
+  uint64_t us = ns / 1000;
+  unsigned bucket = 0;
+
+  while(bucket < AUDIO_STATS_BUCKETS - 1 && (us >> (bucket + 1)))
+    bucket++;
+
+  if(us > UINT32_MAX)
+    us = UINT32_MAX;
+
+  h->count++;
+  h->total_us += us;
+  h->max_us = MAX(h->max_us, (uint32_t)us);
+  h->buckets[bucket]++;
+}
+
+/**
+ * Record the timing of a mixer callback. An underrun is counted when the
+ * mixer can't provide all of the requested frames, or when waiting for the
+ * lock and mixing took longer than the duration of the rendered audio.
+ * Must be called with the audio lock held.
+ */
+static void audio_callback_stats_update(uint64_t start_ns, uint64_t locked_ns,
+ size_t frames, size_t requested_frames)
+{
+  struct audio_callback_stats *stats = &audio.callback_stats;
+  uint64_t end_ns;
+  uint64_t period_ns;
+
+  stats->callbacks++;
+  if(frames < requested_frames)
+    stats->underruns++;
+
+  if(!audio.callback_stats_enabled)
+    return;
+
+  end_ns = get_ticks_ns();
+  audio_histogram_add(&stats->lock_wait, locked_ns - start_ns);
+  audio_histogram_add(&stats->duration, end_ns - locked_ns);
+
+  if(audio.last_callback_ns)
+    audio_histogram_add(&stats->interval, start_ns - audio.last_callback_ns);
+  audio.last_callback_ns = start_ns;
+
+  period_ns = (uint64_t)requested_frames * 1000000000 /
+   MAX(audio.output_frequency, 1);
+  if(frames >= requested_frames && end_ns - start_ns > period_ns)
+    stats->underruns++;
+}
+
+static void audio_histogram_print(const char *name, struct audio_histogram *h)
+{
+  unsigned i;
+
+  if(!h->count)
+    return;
+
+  info("--MIXER--   %s: avg %" PRIu64 "us, max %" PRIu32 "us\n", name,
+   h->total_us / h->count, h->max_us);
+
+  for(i = 0; i < AUDIO_STATS_BUCKETS; i++)
+  {
+    if(!h->buckets[i])
+      continue;
+
+    if(i < AUDIO_STATS_BUCKETS - 1)
+    {
+      info("--MIXER--     <%8luus: %" PRIu32 "\n",
+       2ul << i, h->buckets[i]);
+    }
+    else
+      info("--MIXER--     >=%7luus: %" PRIu32 "\n", 1ul << i, h->buckets[i]);
+  }
+}
+
+static void audio_callback_stats_print(void)
+{
+  struct audio_callback_stats *stats = &audio.callback_stats;
+
+  info("--MIXER-- %" PRIu32 " callbacks, %" PRIu32 " underruns "
+   "(%u frames @ %u Hz)\n", stats->callbacks, stats->underruns,
+   audio.buffer_frames, (unsigned)audio.output_frequency);
+
+  audio_histogram_print("callback duration", &stats->duration);
+  audio_histogram_print("callback interval", &stats->interval);
+  audio_histogram_print("lock wait", &stats->lock_wait);
+}
+
+static void audio_profile_engine(struct audio_stream *a_src,
+ size_t frames, uint64_t render_ns)
+{
+  struct audio_engine_stats *stats = audio.engine_stats;
+  unsigned i;
+
+  for(i = 0; i < audio.num_engine_stats; i++)
+    if(stats[i].name == a_src->name || !strcmp(stats[i].name, a_src->name))
+      break;
+
+  if(i >= audio.num_engine_stats)
+  {
+    if(i >= AUDIO_MAX_ENGINE_STATS)
+      return;
+
+    stats[i].name = a_src->name;
+    stats[i].frames = 0;
+    stats[i].render_ns = 0;
+    audio.num_engine_stats++;
+  }
+  stats[i].frames += frames;
+  stats[i].render_ns += render_ns;
+}
+
+static boolean audio_mix_stream(struct audio_stream *a_src,
+ int32_t *buffer, size_t frames, unsigned channels)
+{
+  if(audio.profile_engines)
+  {
+    uint64_t start = get_ticks_ns();
+    boolean ret = a_src->mix_data(a_src, buffer, frames, channels);
+    audio_profile_engine(a_src, frames, get_ticks_ns() - start);
+    return ret;
+  }
+  return a_src->mix_data(a_src, buffer, frames, channels);
+}
+
 static void clip_buffer_u8(uint8_t *dest, int32_t *src, size_t samples)
 {
   int32_t cur_sample;
@@ -288,6 +417,56 @@ static void clip_buffer_s16(int16_t *dest, int32_t *src, size_t samples)
   }
 }
 
+/**
+ * Convert the float mix bus to the output format. The integer mix buffer is
+ * added to the float bus here, so float streams are only converted to an
+ * integer format once, at output. Written so the compiler can vectorize it.
+ */
+static inline float clip_float_sample(float f_sample, int32_t i_sample)
+{
+  float cur_sample = f_sample * 32768.0f + (float)i_sample;
+  if(cur_sample > 32767.0f)
+    cur_sample = 32767.0f;
+
+  if(cur_sample < -32768.0f)
+    cur_sample = -32768.0f;
+
+  return cur_sample;
+}
+
+static void clip_float_buffer_u8(uint8_t * RESTRICT dest,
+ const float * RESTRICT src, const int32_t * RESTRICT src_int, size_t samples)
+{
+  size_t i;
+
+  for(i = 0; i < samples; i++)
+  {
+    int32_t cur_sample = (int32_t)clip_float_sample(src[i], src_int[i]);
+    dest[i] = (uint8_t)(cur_sample >> 8) + 128;
+  }
+}
+
+static void clip_float_buffer_s8(int8_t * RESTRICT dest,
+ const float * RESTRICT src, const int32_t * RESTRICT src_int, size_t samples)
+{
+  size_t i;
+
+  for(i = 0; i < samples; i++)
+  {
+    int32_t cur_sample = (int32_t)clip_float_sample(src[i], src_int[i]);
+    dest[i] = cur_sample >> 8;
+  }
+}
+
+static void clip_float_buffer_s16(int16_t * RESTRICT dest,
+ const float * RESTRICT src, const int32_t * RESTRICT src_int, size_t samples)
+{
+  size_t i;
+
+  for(i = 0; i < samples; i++)
+    dest[i] = (int16_t)clip_float_sample(src[i], src_int[i]);
+}
+
 /**
  * Render `frames` number of audio frames with the software mixer. The
  * output buffer must be able to hold a number of bytes equal to the
@@ -302,11 +481,20 @@ size_t audio_mixer_render_frames(void *stream, unsigned frames,
  unsigned channels, unsigned format)
 {
   struct audio_stream *current_astream;
+  unsigned requested_frames = frames;
+  uint64_t start_ns = 0;
+  uint64_t locked_ns = 0;
   size_t frames_chn;
   boolean destroy_flag;
 
+  if(audio.callback_stats_enabled)
+    start_ns = get_ticks_ns();
+
   LOCK();
 
+  if(audio.callback_stats_enabled)
+    locked_ns = get_ticks_ns();
+
   current_astream = audio.stream_list_base;
 
   if(current_astream && audio.mix_buffer && frames && channels)
@@ -327,6 +515,8 @@ size_t audio_mixer_render_frames(void *stream, unsigned frames,
     }
 
     memset(audio.mix_buffer, 0, frames_chn * sizeof(int32_t));
+    if(audio.mix_buffer_float)
+      memset(audio.mix_buffer_float, 0, frames_chn * sizeof(float));
 
     while(current_astream != NULL)
     {
@@ -334,7 +524,7 @@ size_t audio_mixer_render_frames(void *stream, unsigned frames,
 
       if(current_astream->mix_data)
       {
-        destroy_flag = current_astream->mix_data(current_astream,
+        destroy_flag = audio_mix_stream(current_astream,
          audio.mix_buffer, frames, channels);
 
         if(destroy_flag)
@@ -344,34 +534,92 @@ size_t audio_mixer_render_frames(void *stream, unsigned frames,
       current_astream = next_astream;
     }
 
-    switch(format)
+    if(audio.mix_buffer_float)
     {
-      case SAMPLE_U8:
-        clip_buffer_u8((uint8_t *)stream, audio.mix_buffer, frames_chn);
-        break;
+      switch(format)
+      {
+        case SAMPLE_U8:
+          clip_float_buffer_u8((uint8_t *)stream, audio.mix_buffer_float,
+           audio.mix_buffer, frames_chn);
+          break;
+
+        case SAMPLE_S8:
+          clip_float_buffer_s8((int8_t *)stream, audio.mix_buffer_float,
+           audio.mix_buffer, frames_chn);
+          break;
+
+        case SAMPLE_S16:
+          clip_float_buffer_s16((int16_t *)stream, audio.mix_buffer_float,
+           audio.mix_buffer, frames_chn);
+          break;
+
+        default:
+          warn("clip_buffer unimplemented for sample format %d!\n", format);
+      }
+    }
+    else
+    {
+      switch(format)
+      {
+        case SAMPLE_U8:
+          clip_buffer_u8((uint8_t *)stream, audio.mix_buffer, frames_chn);
+          break;
 
-      case SAMPLE_S8:
-        clip_buffer_s8((int8_t *)stream, audio.mix_buffer, frames_chn);
-        break;
+        case SAMPLE_S8:
+          clip_buffer_s8((int8_t *)stream, audio.mix_buffer, frames_chn);
+          break;
 
-      case SAMPLE_S16:
-        clip_buffer_s16((int16_t *)stream, audio.mix_buffer, frames_chn);
-        break;
+        case SAMPLE_S16:
+          clip_buffer_s16((int16_t *)stream, audio.mix_buffer, frames_chn);
+          break;
 
-      default:
-        warn("clip_buffer unimplemented for sample format %d!\n", format);
+        default:
+          warn("clip_buffer unimplemented for sample format %d!\n", format);
+      }
     }
   }
 
+  if(audio.callback_in_driver)
+    audio.driver_lock_wait_ns += locked_ns - start_ns;
+  else
+    audio_callback_stats_update(start_ns, locked_ns, frames, requested_frames);
+
   UNLOCK();
 
   return frames;
 }
 
+/**
+ * Drivers that render a device callback with multiple calls to
+ * audio_mixer_render_frames, or that do extra work in the callback, should
+ * wrap the callback with these so it's recorded as a single callback.
+ * `requested_frames` is the number of frames the device asked for.
+ */
+void audio_callback_stats_begin(void)
+{
+  audio.callback_in_driver = true;
+  audio.driver_lock_wait_ns = 0;
+  audio.driver_callback_ns = 0;
+  if(audio.callback_stats_enabled)
+    audio.driver_callback_ns = get_ticks_ns();
+}
+
+void audio_callback_stats_end(size_t frames, size_t requested_frames)
+{
+  uint64_t start_ns = audio.driver_callback_ns;
+
+  LOCK();
+  audio_callback_stats_update(start_ns, start_ns + audio.driver_lock_wait_ns,
+   frames, requested_frames);
+  audio.callback_in_driver = false;
+  UNLOCK();
+}
+
 /**
  * This function initializes audio.output_frequency, audio.mix_buffer,
- * and audio.buffer_frames for software mixing. This function may reconfigure
- * the provided values of any of these fields.
+ * audio.mix_buffer_float (if enabled), and audio.buffer_frames for software
+ * mixing. This function may reconfigure the provided values of any of these
+ * fields.
  *
  * This should be called when initializing a sound driver but before unpausing
  * audio, and any time the sample rate, number of buffer frames, or the number
@@ -407,7 +655,22 @@ boolean audio_mixer_init(unsigned rate, unsigned frames, unsigned channels)
 
   if(!audio.mix_buffer || audio.buffer_bytes != sz)
   {
-    int32_t *buffer = (int32_t *)crealloc(audio.mix_buffer, sz);
+    int32_t *buffer;
+
+    // The float mix bus (if enabled) has the same number of samples.
+    if(audio.float_mix)
+    {
+      float *float_buffer = (float *)crealloc(audio.mix_buffer_float,
+       sz / sizeof(int32_t) * sizeof(float));
+      if(!float_buffer)
+      {
+        debug("--MIXER-- failed float buffer alloc of size %zu\n", sz);
+        goto err_unlock;
+      }
+      audio.mix_buffer_float = float_buffer;
+    }
+
+    buffer = (int32_t *)crealloc(audio.mix_buffer, sz);
     if(!buffer)
     {
       debug("--MIXER-- failed buffer alloc of size %zu\n", sz);
@@ -442,7 +705,9 @@ err:
 void audio_mixer_free(void)
 {
   free(audio.mix_buffer);
+  free(audio.mix_buffer_float);
   audio.mix_buffer = NULL;
+  audio.mix_buffer_float = NULL;
   audio.buffer_bytes = 0;
   audio.buffer_frames = 0;
   audio.buffer_channels = 0;
@@ -459,10 +724,15 @@ void init_audio(struct config_info *conf)
 
   audio.output_frequency = 44100; // Dummy value.
   audio.global_resample_mode = conf->resample_mode;
+  audio.float_mix = conf->audio_float_mix;
 
   audio.max_simultaneous_samples = -1;
   audio.max_simultaneous_samples_config = conf->max_simultaneous_samples;
 
+  audio.callback_stats_enabled = conf->audio_stats;
+  audio.last_callback_ns = 0;
+  memset(&audio.callback_stats, 0, sizeof(struct audio_callback_stats));
+
   init_wav(conf);
 
 #ifdef CONFIG_VORBIS
@@ -500,16 +770,21 @@ void init_audio(struct config_info *conf)
 
   audio_set_pcs_volume(conf->pc_speaker_volume);
 
-  init_audio_platform(conf);
+  if(!audio_offline_init(conf))
+    init_audio_platform(conf);
 }
 
 void quit_audio(void)
 {
   // Signal the audio thread to stop and wait for it to release the lock.
-  quit_audio_platform();
+  if(!audio_offline_quit())
+    quit_audio_platform();
 
   LOCK();
 
+  if(audio.callback_stats_enabled)
+    audio_callback_stats_print();
+
   audio_garbage_collect();
   audio_mixer_free();
   audio_ext_free_registry();
@@ -940,6 +1215,18 @@ int audio_get_module_loop_end(void)
 
 #endif
 
+/**
+ * Get a copy of the current mixer callback statistics. Timing histograms are
+ * only collected when the config option "audio_stats" is enabled.
+ */
+boolean audio_get_callback_stats(struct audio_callback_stats *dest)
+{
+  LOCK();
+  memcpy(dest, &audio.callback_stats, sizeof(struct audio_callback_stats));
+  UNLOCK();
+  return audio.callback_stats_enabled;
+}
+
 void audio_set_music_on(int val)
 {
   LOCK();
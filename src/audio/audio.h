@@ -27,10 +27,34 @@
 
 __M_BEGIN_DECLS
 
-#ifdef CONFIG_AUDIO
-
 #include <stdint.h>
 
+#define AUDIO_STATS_BUCKETS 20
+
+/**
+ * Histogram of a mixer callback timing in microseconds. Bucket 0 counts
+ * values below 2us; every other bucket N counts values in [2^N, 2^(N+1)).
+ * The final bucket also counts everything larger than that.
+ */
+struct audio_histogram
+{
+  uint32_t count;
+  uint32_t max_us;
+  uint64_t total_us;
+  uint32_t buckets[AUDIO_STATS_BUCKETS];
+};
+
+struct audio_callback_stats
+{
+  uint32_t callbacks;
+  uint32_t underruns;
+  struct audio_histogram duration;
+  struct audio_histogram interval;
+  struct audio_histogram lock_wait;
+};
+
+#ifdef CONFIG_AUDIO
+
 // Default period for .SAM files.
 #define SAM_DEFAULT_PERIOD 428
 
@@ -75,6 +99,8 @@ void audio_set_pcs_volume(int volume);
 
 int audio_legacy_translate(const char *path, char *newpath, size_t buffer_len);
 
+CORE_LIBSPEC boolean audio_get_callback_stats(struct audio_callback_stats *dest);
+
 // Internal functions
 int audio_get_real_frequency(int period);
 void destruct_audio_stream(struct audio_stream *a_src);
@@ -83,6 +109,8 @@ void initialize_audio_stream(struct audio_stream *a_src,
 
 size_t audio_mixer_render_frames(void *stream, unsigned frames,
  unsigned channels, unsigned format);
+void audio_callback_stats_begin(void);
+void audio_callback_stats_end(size_t frames, size_t requested_frames);
 boolean audio_mixer_init(unsigned rate, unsigned frames, unsigned channels);
 void audio_mixer_free(void);
 
@@ -132,6 +160,9 @@ static inline void audio_set_pcs_volume(int volume) {}
 static inline int audio_legacy_translate(const char *path,
  char *newpath, size_t buffer_len) { return -1; }
 
+static inline boolean audio_get_callback_stats(struct audio_callback_stats *dest)
+ { return false; }
+
 #endif // CONFIG_AUDIO
 
 __M_END_DECLS
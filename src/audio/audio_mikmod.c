@@ -318,6 +318,7 @@ static struct audio_stream *construct_mikmod_stream(vfile *vf,
   mm_set_resample_mode();
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name         = "mikmod";
   a_spec.mix_data     = mm_mix_data;
   a_spec.set_volume   = mm_set_volume;
   a_spec.set_repeat   = mm_set_repeat;
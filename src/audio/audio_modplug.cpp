@@ -254,6 +254,7 @@ static struct audio_stream *construct_modplug_stream(vfile *vf,
   mp_stream->module_data = open_file;
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name         = "modplug";
   a_spec.mix_data     = mp_mix_data;
   a_spec.set_volume   = mp_set_volume;
   a_spec.set_repeat   = mp_set_repeat;
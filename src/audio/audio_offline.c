@@ -0,0 +1,275 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Offline audio driver. Instead of handing the mixer to an audio device
+ * callback, this pulls frames from the mixer as fast as possible and
+ * writes them to a WAV file and/or a running CRC-32. Each time the game loop
+ * updates events, one buffer of frames is rendered, or more if needed to
+ * keep up with real time. When the game loop runs faster than one buffer
+ * per update (e.g. headless at speed 1), the output only depends on the
+ * sequence of game cycles and not on wall clock time.
+ *
+ * This is mostly useful for mixer benchmarks and golden output tests on
+ * machines without audio hardware. Mixer throughput (overall and per
+ * audio engine) is reported when audio is shut down.
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "audio.h"
+#include "audio_offline.h"
+#include "audio_struct.h"
+
+#include "../configure.h"
+#include "../platform.h"
+#include "../util.h"
+#include "../io/vio.h"
+
+#define WAV_HEADER_SIZE 44
+
+struct audio_offline
+{
+  boolean active;
+  vfile *wav;
+  int16_t *buffer;
+  unsigned channels;
+  uint64_t last_update_ns;
+  struct audio_offline_stats stats;
+};
+
+static struct audio_offline offline;
+
+static void wav_write_header(vfile *vf, unsigned rate, unsigned channels,
+ uint64_t frames)
+{
+  uint64_t data_size = frames * channels * sizeof(int16_t);
+  if(data_size > 0xFFFFFFFFu - (WAV_HEADER_SIZE - 8))
+    data_size = 0xFFFFFFFFu - (WAV_HEADER_SIZE - 8);
+
+  vfwrite("RIFF", 4, 1, vf);
+  vfputd(data_size + WAV_HEADER_SIZE - 8, vf);
+  vfwrite("WAVEfmt ", 8, 1, vf);
+  vfputd(16, vf);                                   // fmt chunk size
+  vfputw(1, vf);                                    // PCM
+  vfputw(channels, vf);
+  vfputd(rate, vf);
+  vfputd(rate * channels * sizeof(int16_t), vf);    // byte rate
+  vfputw(channels * sizeof(int16_t), vf);           // block align
+  vfputw(16, vf);                                   // bits per sample
+  vfwrite("data", 4, 1, vf);
+  vfputd(data_size, vf);
+}
+
+static double frames_per_second(uint64_t frames, uint64_t ns)
+{
+  return ns ? (double)frames * 1000000000.0 / (double)ns : 0.0;
+}
+
+/**
+ * Enable the offline driver if requested by the config. Returns `false` if
+ * the offline driver is disabled or could not be initialized, in which case
+ * the platform audio driver should be initialized instead.
+ */
+boolean audio_offline_init(struct config_info *conf)
+{
+  unsigned channels;
+
+  if(!conf->audio_offline)
+    return false;
+
+  memset(&offline, 0, sizeof(struct audio_offline));
+  offline.stats.checksum = crc32(0L, Z_NULL, 0);
+
+  channels = conf->audio_output_channels ? conf->audio_output_channels : 2;
+  if(!audio_mixer_init(conf->audio_sample_rate, conf->audio_buffer_samples,
+   channels))
+  {
+    warn("--OFFLINE-- failed to initialize mixer\n");
+    return false;
+  }
+
+  offline.channels = audio.buffer_channels;
+  offline.buffer = (int16_t *)cmalloc(audio.buffer_frames *
+   offline.channels * sizeof(int16_t));
+
+  if(conf->audio_offline_file[0])
+  {
+    offline.wav = vfopen_unsafe_ext(conf->audio_offline_file, "wb",
+     V_LARGE_BUFFER);
+    if(offline.wav)
+    {
+      wav_write_header(offline.wav, audio.output_frequency,
+       offline.channels, 0);
+    }
+    else
+      warn("--OFFLINE-- failed to open '%s'\n", conf->audio_offline_file);
+  }
+
+  audio.profile_engines = true;
+  audio.num_engine_stats = 0;
+  offline.active = true;
+
+  info("--OFFLINE-- rendering %u Hz, %u channel(s), %u frames per update\n",
+   (unsigned)audio.output_frequency, offline.channels, audio.buffer_frames);
+  return true;
+}
+
+/**
+ * Render and consume up to `frames` frames of audio as fast as possible.
+ * Returns the number of frames rendered.
+ */
+size_t audio_offline_render(size_t frames)
+{
+  size_t total = 0;
+
+  if(!offline.active)
+    return 0;
+
+  while(total < frames)
+  {
+    size_t request = MIN(frames - total, audio.buffer_frames);
+    size_t samples;
+    uint64_t start;
+    uint64_t end;
+
+    // The mixer doesn't touch the output when no streams are playing.
+    memset(offline.buffer, 0, request * offline.channels * sizeof(int16_t));
+
+    start = get_ticks_ns();
+    request = audio_mixer_render_frames(offline.buffer, request,
+     offline.channels, SAMPLE_S16);
+    end = get_ticks_ns();
+
+    if(!request)
+      break;
+
+    samples = request * offline.channels;
+
+#if PLATFORM_BYTE_ORDER == PLATFORM_BIG_ENDIAN
+    {
+      // Output and checksum little endian data regardless of platform.
+      size_t i;
+      for(i = 0; i < samples; i++)
+      {
+        uint16_t s = (uint16_t)offline.buffer[i];
+        offline.buffer[i] = (int16_t)((s >> 8) | (s << 8));
+      }
+    }
+#endif
+
+    offline.stats.checksum = crc32(offline.stats.checksum,
+     (const Bytef *)offline.buffer, samples * sizeof(int16_t));
+
+    if(offline.wav)
+      vfwrite(offline.buffer, sizeof(int16_t), samples, offline.wav);
+
+    offline.stats.frames += request;
+    offline.stats.render_ns += end - start;
+    total += request;
+  }
+  return total;
+}
+
+/**
+ * Render at least one buffer worth of frames. Called once per game loop
+ * update. Games that wait on audio (WAIT PLAY etc.) rely on it playing no
+ * slower than real time, so render extra buffers for slow game speeds.
+ */
+void audio_offline_update(void)
+{
+  size_t frames = audio.buffer_frames;
+  uint64_t now;
+
+  if(!offline.active)
+    return;
+
+  now = get_ticks_ns();
+  if(offline.last_update_ns)
+  {
+    uint64_t elapsed = (now - offline.last_update_ns) *
+     audio.output_frequency / 1000000000;
+
+    if(elapsed > frames)
+    {
+      elapsed += audio.buffer_frames - 1;
+      frames = elapsed - (elapsed % audio.buffer_frames);
+    }
+  }
+  offline.last_update_ns = now;
+
+  audio_offline_render(frames);
+}
+
+/**
+ * Get the current frame count, total render time, and CRC-32 of all audio
+ * data rendered by the offline driver. Returns `false` if the offline driver
+ * isn't active.
+ */
+boolean audio_offline_get_stats(struct audio_offline_stats *stats)
+{
+  if(!offline.active)
+    return false;
+
+  memcpy(stats, &offline.stats, sizeof(struct audio_offline_stats));
+  return true;
+}
+
+/**
+ * Shut down the offline driver and report mixer throughput. Returns `false`
+ * if the offline driver isn't active, in which case the platform audio
+ * driver should be shut down instead.
+ */
+boolean audio_offline_quit(void)
+{
+  unsigned i;
+
+  if(!offline.active)
+    return false;
+
+  if(offline.wav)
+  {
+    vrewind(offline.wav);
+    wav_write_header(offline.wav, audio.output_frequency, offline.channels,
+     offline.stats.frames);
+    vfclose(offline.wav);
+  }
+
+  info("--OFFLINE-- %" PRIu64 " frames in %.3f ms (%.0f frames/sec), "
+   "CRC-32 %08" PRIx32 "\n", offline.stats.frames,
+   offline.stats.render_ns / 1000000.0,
+   frames_per_second(offline.stats.frames, offline.stats.render_ns),
+   offline.stats.checksum);
+
+  for(i = 0; i < audio.num_engine_stats; i++)
+  {
+    struct audio_engine_stats *e = &audio.engine_stats[i];
+    info("--OFFLINE--   %-8s %" PRIu64 " frames in %.3f ms (%.0f frames/sec)\n",
+     e->name, e->frames, e->render_ns / 1000000.0,
+     frames_per_second(e->frames, e->render_ns));
+  }
+
+  audio.profile_engines = false;
+  free(offline.buffer);
+  memset(&offline, 0, sizeof(struct audio_offline));
+  return true;
+}
@@ -0,0 +1,60 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __AUDIO_OFFLINE_H
+#define __AUDIO_OFFLINE_H
+
+#include "../compat.h"
+
+__M_BEGIN_DECLS
+
+#include <stdint.h>
+
+struct config_info;
+
+struct audio_offline_stats
+{
+  uint64_t frames;
+  uint64_t render_ns;
+  uint32_t checksum;
+};
+
+#if defined(CONFIG_AUDIO) && !defined(CONFIG_NDS)
+
+boolean audio_offline_init(struct config_info *conf);
+boolean audio_offline_quit(void);
+void audio_offline_update(void);
+size_t audio_offline_render(size_t frames);
+boolean audio_offline_get_stats(struct audio_offline_stats *stats);
+
+#else
+
+static inline boolean audio_offline_init(struct config_info *conf)
+ { return false; }
+static inline boolean audio_offline_quit(void) { return false; }
+static inline void audio_offline_update(void) {}
+static inline size_t audio_offline_render(size_t frames) { return 0; }
+static inline boolean audio_offline_get_stats(struct audio_offline_stats *stats)
+ { return false; }
+
+#endif
+
+__M_END_DECLS
+
+#endif /* __AUDIO_OFFLINE_H */
@@ -73,23 +73,43 @@ static boolean omp_mix_data(struct audio_stream *a_src, int32_t *buffer,
   struct openmpt_stream *omp_stream = (struct openmpt_stream *)a_src;
   struct sampled_stream *s = (struct sampled_stream *)a_src;
 
-  int16_t *read_buffer;
+  uint8_t *read_buffer;
   size_t read_wanted;
+  size_t read_frames;
   boolean r_val = false;
   uint32_t read_len;
 
-  read_buffer = (int16_t *)sampled_get_buffer(&omp_stream->s, &read_wanted);
+  read_buffer = (uint8_t *)sampled_get_buffer(&omp_stream->s, &read_wanted);
+  read_frames = read_wanted / s->bytes_per_frame;
+
+  if(s->use_float)
+  {
+    if(s->channels >= 2)
+    {
+      read_frames = openmpt_module_read_interleaved_float_stereo(
+       omp_stream->module_data, s->frequency, read_frames,
+       (float *)read_buffer);
+    }
+    else
+    {
+      read_frames = openmpt_module_read_float_mono(omp_stream->module_data,
+       s->frequency, read_frames, (float *)read_buffer);
+    }
+  }
+  else
 
   if(s->channels >= 2)
   {
-    read_len = openmpt_module_read_interleaved_stereo(omp_stream->module_data,
-     s->frequency, read_wanted / 4, read_buffer) * 4;
+    read_frames = openmpt_module_read_interleaved_stereo(
+     omp_stream->module_data, s->frequency, read_frames,
+     (int16_t *)read_buffer);
   }
   else
   {
-    read_len = openmpt_module_read_mono(omp_stream->module_data,
-     s->frequency, read_wanted / 2, read_buffer) * 2;
+    read_frames = openmpt_module_read_mono(omp_stream->module_data,
+     s->frequency, read_frames, (int16_t *)read_buffer);
   }
+  read_len = read_frames * s->bytes_per_frame;
 
   if(read_len < read_wanted && !a_src->repeat)
   {
@@ -292,6 +312,7 @@ static struct audio_stream *construct_openmpt_stream(vfile *vf,
   openmpt_module_set_repeat_count(omp_stream->module_data, -1);
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name         = "openmpt";
   a_spec.mix_data     = omp_mix_data;
   a_spec.set_volume   = omp_set_volume;
   a_spec.set_repeat   = omp_set_repeat;
@@ -305,6 +326,7 @@ static struct audio_stream *construct_openmpt_stream(vfile *vf,
   memset(&s_spec, 0, sizeof(struct sampled_stream_spec));
   s_spec.set_frequency = omp_set_frequency;
   s_spec.get_frequency = omp_get_frequency;
+  s_spec.use_float     = true;
 
   initialize_sampled_stream((struct sampled_stream *)omp_stream, &s_spec,
    frequency, chn, false);
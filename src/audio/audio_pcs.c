@@ -173,6 +173,7 @@ static struct audio_stream *construct_pc_speaker_stream(void)
   pcs_stream = ccalloc(1, sizeof(struct pc_speaker_stream));
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name       = "pcs";
   a_spec.mix_data   = pcs_mix_data;
   a_spec.set_volume = pcs_set_volume;
   a_spec.destruct   = pcs_destruct;
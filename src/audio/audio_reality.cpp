@@ -268,6 +268,7 @@ static struct audio_stream *construct_rad_stream(vfile *vf,
   rad_stream->sample_update_max = OPL_FREQUENCY / rate;
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name         = "rad";
   a_spec.mix_data     = rad_mix_data;
   a_spec.set_volume   = rad_set_volume;
   a_spec.set_repeat   = rad_set_repeat;
@@ -38,6 +38,7 @@ static void sdl_audio_callback(void *userdata, Uint8 *stream, int len)
 {
   // TODO: 8-bit?
   size_t frames;
+  size_t out;
   switch(audio_settings.channels)
   {
     case 0:
@@ -51,7 +52,11 @@ static void sdl_audio_callback(void *userdata, Uint8 *stream, int len)
       frames = (unsigned)len / (audio_settings.channels * sizeof(int16_t));
       break;
   }
-  audio_mixer_render_frames(stream, frames, audio_settings.channels, SAMPLE_S16);
+
+  audio_callback_stats_begin();
+  out = audio_mixer_render_frames(stream, frames, audio_settings.channels,
+   SAMPLE_S16);
+  audio_callback_stats_end(out, frames);
 }
 
 void init_audio_platform(struct config_info *conf)
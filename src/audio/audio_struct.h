@@ -27,6 +27,8 @@ __M_BEGIN_DECLS
 
 #include <stdint.h>
 
+#include "audio.h"
+
 #include "../configure.h"
 #include "../platform.h"
 
@@ -65,6 +67,7 @@ struct audio_stream
 {
   struct audio_stream *next;
   struct audio_stream *previous;
+  const char *name;
   unsigned int volume;
   boolean is_spot_sample;
   boolean repeat;
@@ -88,6 +91,7 @@ struct audio_stream
 
 struct audio_stream_spec
 {
+  const char *name;
   boolean   (* mix_data)(struct audio_stream *a_src, int32_t * RESTRICT buffer,
                          size_t dest_frames, unsigned int dest_channels);
   void      (* set_volume)(struct audio_stream *a_src, unsigned int volume);
@@ -106,15 +110,30 @@ struct audio_stream_spec
   void      (* destruct)(struct audio_stream *a_src);
 };
 
+#define AUDIO_MAX_ENGINE_STATS 8
+
+/**
+ * Per-engine mixer timing, collected only while `audio.profile_engines`
+ * is enabled (e.g. by the offline driver).
+ */
+struct audio_engine_stats
+{
+  const char *name;
+  uint64_t frames;
+  uint64_t render_ns;
+};
+
 struct audio
 {
   int32_t *mix_buffer;
+  float *mix_buffer_float;
   size_t buffer_bytes;
   unsigned buffer_frames;
   unsigned buffer_channels;
 
   size_t output_frequency;
   unsigned int global_resample_mode;
+  boolean float_mix;
   int max_simultaneous_samples;
   int max_simultaneous_samples_config;
 
@@ -133,6 +152,17 @@ struct audio
   platform_mutex audio_debug_mutex;
 #endif
 
+  boolean callback_stats_enabled;
+  boolean callback_in_driver;
+  uint64_t last_callback_ns;
+  uint64_t driver_callback_ns;
+  uint64_t driver_lock_wait_ns;
+  struct audio_callback_stats callback_stats;
+
+  boolean profile_engines;
+  unsigned num_engine_stats;
+  struct audio_engine_stats engine_stats[AUDIO_MAX_ENGINE_STATS];
+
   boolean music_on;
   boolean pcs_on;
   unsigned int music_volume;
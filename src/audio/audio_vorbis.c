@@ -138,6 +138,15 @@ static size_t audio_vorbis_handle_read(void * RESTRICT dest,
    bytes_to_read >> 1) * channels * sizeof(int16_t);
 }
 
+#define VORBIS_FLOAT_SAMPLES
+
+static size_t audio_vorbis_handle_read_float(float * RESTRICT dest,
+ size_t bytes_to_read, unsigned channels, audio_vorbis_handle *f)
+{
+  return stb_vorbis_get_samples_float_interleaved(*f, channels, dest,
+   bytes_to_read / sizeof(float)) * channels * sizeof(float);
+}
+
 #else /* libvorbis/tremor */
 
 // ov_read() documentation states the 'bigendianp' argument..
@@ -249,6 +258,32 @@ static size_t audio_vorbis_handle_read(void * RESTRICT dest,
    ENDIAN_PACKING, sizeof(int16_t), 1, &current_bitstream);
 #endif
 }
+
+#ifndef CONFIG_TREMOR
+#define VORBIS_FLOAT_SAMPLES
+
+static size_t audio_vorbis_handle_read_float(float * RESTRICT dest,
+ size_t bytes_to_read, unsigned channels, audio_vorbis_handle *f)
+{
+  int current_bitstream;
+  float **pcm;
+  long frames;
+  long i;
+  unsigned j;
+
+  // ov_read_float returns non-interleaved data, so it needs to be copied.
+  frames = ov_read_float(f, &pcm, bytes_to_read / (channels * sizeof(float)),
+   &current_bitstream);
+  if(frames <= 0)
+    return 0;
+
+  for(i = 0; i < frames; i++)
+    for(j = 0; j < channels; j++)
+      *(dest++) = pcm[j][i];
+
+  return frames * channels * sizeof(float);
+}
+#endif // !CONFIG_TREMOR
 #endif /* libvorbis/tremor */
 
 struct vorbis_stream
@@ -261,6 +296,23 @@ struct vorbis_stream
   uint32_t loop_end;
 };
 
+static size_t vorbis_read(struct vorbis_stream *v_stream, void * RESTRICT dest,
+ size_t bytes_to_read)
+{
+  unsigned channels = v_stream->s.channels;
+
+#ifdef VORBIS_FLOAT_SAMPLES
+  if(v_stream->s.use_float)
+  {
+    return audio_vorbis_handle_read_float((float *)dest, bytes_to_read,
+     channels, &(v_stream->handle));
+  }
+#endif
+
+  return audio_vorbis_handle_read(dest, bytes_to_read, channels,
+   &(v_stream->handle));
+}
+
 static boolean vorbis_mix_data(struct audio_stream *a_src,
  int32_t * RESTRICT buffer, size_t frames, unsigned int channels)
 {
@@ -268,7 +320,7 @@ static boolean vorbis_mix_data(struct audio_stream *a_src,
   struct vorbis_stream *v_stream = (struct vorbis_stream *)a_src;
   char *read_buffer;
   size_t read_wanted;
-  size_t read_channels = v_stream->s.channels;
+  size_t bytes_per_frame = v_stream->s.bytes_per_frame;
   uint32_t pos = 0;
 
   read_buffer = (char *)sampled_get_buffer(&v_stream->s, &read_wanted);
@@ -280,13 +332,12 @@ static boolean vorbis_mix_data(struct audio_stream *a_src,
     if(a_src->repeat && v_stream->loop_end)
       pos = (uint32_t)audio_vorbis_handle_tell(&v_stream->handle);
 
-    read_len = audio_vorbis_handle_read(read_buffer, read_wanted,
-     read_channels, &(v_stream->handle));
+    read_len = vorbis_read(v_stream, read_buffer, read_wanted);
 
     if(a_src->repeat && (pos < v_stream->loop_end) &&
-     (pos + read_len / read_channels / sizeof(int16_t) >= v_stream->loop_end))
+     (pos + read_len / bytes_per_frame >= v_stream->loop_end))
     {
-      read_len = (v_stream->loop_end - pos) * read_channels * sizeof(int16_t);
+      read_len = (v_stream->loop_end - pos) * bytes_per_frame;
       audio_vorbis_handle_seek(&(v_stream->handle), v_stream->loop_start);
     }
 
@@ -299,10 +350,7 @@ static boolean vorbis_mix_data(struct audio_stream *a_src,
         audio_vorbis_handle_rewind(&(v_stream->handle));
 
         if(read_wanted)
-        {
-          read_len = audio_vorbis_handle_read(read_buffer, read_wanted,
-           read_channels, &(v_stream->handle));
-        }
+          read_len = vorbis_read(v_stream, read_buffer, read_wanted);
       }
       else
       {
@@ -466,6 +514,7 @@ static struct audio_stream *construct_vorbis_stream(vfile *vf,
   get_loopstart_loopend(v_stream);
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name           = "vorbis";
   a_spec.mix_data       = vorbis_mix_data;
   a_spec.set_volume     = vorbis_set_volume;
   a_spec.set_repeat     = vorbis_set_repeat;
@@ -481,6 +530,9 @@ static struct audio_stream *construct_vorbis_stream(vfile *vf,
   memset(&s_spec, 0, sizeof(struct sampled_stream_spec));
   s_spec.set_frequency = vorbis_set_frequency;
   s_spec.get_frequency = vorbis_get_frequency;
+#ifdef VORBIS_FLOAT_SAMPLES
+  s_spec.use_float     = true;
+#endif
 
   initialize_sampled_stream((struct sampled_stream *)v_stream, &s_spec,
    frequency, info.channels, true);
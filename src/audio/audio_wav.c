@@ -662,6 +662,7 @@ struct audio_stream *construct_wav_stream_direct(struct wav_info *w_info,
     w_stream->bytes_per_sample *= 2;
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name           = "wav";
   a_spec.mix_data       = wav_mix_data;
   a_spec.set_volume     = wav_set_volume;
   a_spec.set_repeat     = wav_set_repeat;
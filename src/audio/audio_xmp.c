@@ -330,6 +330,7 @@ static struct audio_stream *construct_xmp_stream(vfile *vf,
   }
 
   memset(&a_spec, 0, sizeof(struct audio_stream_spec));
+  a_spec.name         = "xmp";
   a_spec.mix_data     = audio_xmp_mix_data;
   a_spec.set_volume   = audio_xmp_set_volume;
   a_spec.set_repeat   = audio_xmp_set_repeat;
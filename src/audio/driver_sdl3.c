@@ -36,7 +36,12 @@ static void sdl_audio_callback(void *userdata, SDL_AudioStream *stream,
 {
   size_t framesize = SDL_AUDIO_FRAMESIZE(audio_settings);
   size_t frames = MAX(0, required_bytes) / framesize;
+  size_t requested_frames = frames;
 
+  if(!frames)
+    return;
+
+  audio_callback_stats_begin();
   while(frames > 0)
   {
     size_t out = audio_mixer_render_frames(userdata, frames,
@@ -45,7 +50,10 @@ static void sdl_audio_callback(void *userdata, SDL_AudioStream *stream,
     assert(out <= frames);
     SDL_PutAudioStreamData(audio_stream, userdata, out * framesize);
     frames -= out;
+    if(!out)
+      break;
   }
+  audio_callback_stats_end(requested_frames - frames, requested_frames);
 }
 
 void init_audio_platform(struct config_info *conf)
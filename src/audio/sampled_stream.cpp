@@ -74,8 +74,39 @@ enum mixer_volume
 };
 
 /* Cubic resampling needs one prologue sample and three epilogue samples. */
-#define PROLOGUE_LENGTH (1 * STEREO * sizeof(int16_t))
-#define EPILOGUE_LENGTH (3 * STEREO * sizeof(int16_t))
+#define PROLOGUE_FRAMES 1
+#define EPILOGUE_FRAMES 3
+
+/**
+ * Sampled streams may provide either int16_t samples, which are mixed into
+ * the int32_t mix buffer, or float samples in the range [-1, 1], which are
+ * mixed into the float mix bus. The mixer functions below are shared by both
+ * and use this to select the intermediate type for each source type.
+ */
+template<typename T>
+struct mix_traits {};
+
+template<>
+struct mix_traits<int16_t>
+{
+  typedef int32_t mix_type;
+};
+
+template<>
+struct mix_traits<float>
+{
+  typedef float mix_type;
+};
+
+static size_t prologue_length(const struct sampled_stream *s_src)
+{
+  return PROLOGUE_FRAMES * STEREO * s_src->bytes_per_sample;
+}
+
+static size_t epilogue_length(const struct sampled_stream *s_src)
+{
+  return EPILOGUE_FRAMES * STEREO * s_src->bytes_per_sample;
+}
 
 template<mixer_volume VOLUME>
 static int32_t volume_function(int32_t sample, int volume)
@@ -91,24 +122,45 @@ static int32_t volume_function(int32_t sample, int volume)
   return sample;
 }
 
+template<mixer_volume VOLUME>
+static float volume_function(float sample, int volume)
+{
+  if(VOLUME)
+    return sample * (volume * (1.0f / 256.0f));
+
+  return sample;
+}
+
+static inline int32_t downmix(int32_t mix)
+{
+  return mix >> 1;
+}
+
+static inline float downmix(float mix)
+{
+  return mix * 0.5f;
+}
+
 template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
- mixer_volume VOLUME>
+ mixer_volume VOLUME, typename DEST, typename SRC>
 static void flat_mix_loop(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume)
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume)
 {
+  typedef typename mix_traits<SRC>::mix_type MIX_TYPE;
+
   //size_t chn = DEST_CHANNELS > STEREO ? s_src->dest_channels : (size_t)DEST_CHANNELS;
   for(size_t i = 0; i < dest_frames; i++)
   {
     if(SRC_CHANNELS == DEST_CHANNELS && DEST_CHANNELS <= STEREO)
     {
       for(size_t j = 0; j < DEST_CHANNELS; j++)
-        *(dest++) += volume_function<VOLUME>(*(src++), volume);
+        *(dest++) += volume_function<VOLUME>((MIX_TYPE)*(src++), volume);
     }
     else
 
     if(DEST_CHANNELS == STEREO && SRC_CHANNELS == MONO)
     {
-      int32_t smpl = volume_function<VOLUME>(*(src++), volume);
+      MIX_TYPE smpl = volume_function<VOLUME>((MIX_TYPE)*(src++), volume);
       *(dest++) += smpl;
       *(dest++) += smpl;
     }
@@ -116,10 +168,10 @@ static void flat_mix_loop(struct sampled_stream *s_src,
 
     if(DEST_CHANNELS == MONO && SRC_CHANNELS == STEREO)
     {
-      int32_t mix = 0;
-      mix += volume_function<VOLUME>(*(src++), volume);
-      mix += volume_function<VOLUME>(*(src++), volume);
-      *(dest++) += mix >> 1;
+      MIX_TYPE mix = 0;
+      mix += volume_function<VOLUME>((MIX_TYPE)*(src++), volume);
+      mix += volume_function<VOLUME>((MIX_TYPE)*(src++), volume);
+      *(dest++) += downmix(mix);
     }
     //else TODO: surround not implemented
   }
@@ -131,6 +183,10 @@ static void flat_mix_loop(struct sampled_stream *s_src,
  * parameters. This is pointless but fortunately doesn't hurt C++11 builds.
  */
 typedef int32_t (*mix_function)(const int16_t *src_offset, ssize_t frac_index);
+typedef float (*mix_function_float)(const float *src_offset,
+ ssize_t frac_index);
+
+static const float FP_SCALE = 1.0f / (1 << FP_SHIFT);
 
 template<mixer_channels SRC_CHANNELS>
 int32_t nearest_mix(const int16_t *src_offset, ssize_t frac_index)
@@ -138,6 +194,12 @@ int32_t nearest_mix(const int16_t *src_offset, ssize_t frac_index)
   return src_offset[0];
 }
 
+template<mixer_channels SRC_CHANNELS>
+float nearest_mix(const float *src_offset, ssize_t frac_index)
+{
+  return src_offset[0];
+}
+
 // TODO: linear and cubic need external s_chn for surround.
 template<mixer_channels SRC_CHANNELS>
 int32_t linear_mix(const int16_t *src_offset, ssize_t frac_index)
@@ -148,6 +210,15 @@ int32_t linear_mix(const int16_t *src_offset, ssize_t frac_index)
   return left + ((right - left) * frac_index >> FP_SHIFT);
 }
 
+template<mixer_channels SRC_CHANNELS>
+float linear_mix(const float *src_offset, ssize_t frac_index)
+{
+  int chn = static_cast<int>(SRC_CHANNELS);
+  float left = src_offset[0];
+  float right = src_offset[chn];
+  return left + (right - left) * (frac_index * FP_SCALE);
+}
+
 template<mixer_channels SRC_CHANNELS>
 int32_t cubic_mix(const int16_t *src_offset, ssize_t frac_index)
 {
@@ -175,11 +246,55 @@ int32_t cubic_mix(const int16_t *src_offset, ssize_t frac_index)
   return (a >> FP_SHIFT);
 }
 
+template<mixer_channels SRC_CHANNELS>
+float cubic_mix(const float *src_offset, ssize_t frac_index)
+{
+  // Same Hermite spline as above, minus the fixed point.
+  int chn = static_cast<int>(SRC_CHANNELS);
+  float t = frac_index * FP_SCALE;
+  float s0 = src_offset[-chn];
+  float s1 = src_offset[0];
+  float s2 = src_offset[chn];
+  float s3 = src_offset[chn * 2];
+
+  float a = ((3.0f * (s1 - s2)) - s0 + s3) * 0.5f;
+  float b = (2.0f * s2) + s0 - (((5.0f * s1) + s3) * 0.5f);
+  float c = (s2 - s0) * 0.5f;
+
+  return ((a * t + b) * t + c) * t + s1;
+}
+
+/**
+ * Wrap the resample function in a class so the loop below can be shared by
+ * both source types without losing the ability to inline the resampler.
+ */
+template<mix_function MIX>
+struct mix_int16
+{
+  typedef int32_t mix_type;
+  static inline int32_t mix(const int16_t *src_offset, ssize_t frac_index)
+  {
+    return MIX(src_offset, frac_index);
+  }
+};
+
+template<mix_function_float MIX>
+struct mix_float
+{
+  typedef float mix_type;
+  static inline float mix(const float *src_offset, ssize_t frac_index)
+  {
+    return MIX(src_offset, frac_index);
+  }
+};
+
 template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
- mixer_volume VOLUME, mix_function MIX>
-static void resample_mix_loop(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume)
+ mixer_volume VOLUME, class MIXER, typename DEST, typename SRC>
+static void resample_mix_loop_impl(struct sampled_stream *s_src,
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume)
 {
+  typedef typename MIXER::mix_type MIX_TYPE;
+
   //size_t d_chn = DEST_CHANNELS > STEREO ? s_src->dest_channels : (size_t)DEST_CHANNELS;
   size_t s_chn = SRC_CHANNELS > STEREO ? s_src->channels : (size_t)SRC_CHANNELS;
   int64_t sample_index = s_src->sample_index;
@@ -194,7 +309,7 @@ static void resample_mix_loop(struct sampled_stream *s_src,
     {
       for(size_t j = 0; j < DEST_CHANNELS; j++)
       {
-        int32_t mix = MIX(src + int_index + j, frac_index);
+        MIX_TYPE mix = MIXER::mix(src + int_index + j, frac_index);
         *(dest++) += volume_function<VOLUME>(mix, volume);
       }
     }
@@ -202,8 +317,8 @@ static void resample_mix_loop(struct sampled_stream *s_src,
 
     if(DEST_CHANNELS == STEREO && SRC_CHANNELS == MONO)
     {
-      int32_t mix = MIX(src + int_index, frac_index);
-      int32_t smpl = volume_function<VOLUME>(mix, volume);
+      MIX_TYPE mix = MIXER::mix(src + int_index, frac_index);
+      MIX_TYPE smpl = volume_function<VOLUME>(mix, volume);
       *(dest++) += smpl;
       *(dest++) += smpl;
     }
@@ -211,22 +326,41 @@ static void resample_mix_loop(struct sampled_stream *s_src,
 
     if(DEST_CHANNELS == MONO && SRC_CHANNELS == STEREO)
     {
-      int32_t mix = 0;
+      MIX_TYPE mix = 0;
       for(size_t chn = 0; chn < SRC_CHANNELS; chn++)
       {
-        int32_t smpl = MIX(src + int_index + chn, frac_index);
+        MIX_TYPE smpl = MIXER::mix(src + int_index + chn, frac_index);
         mix += volume_function<VOLUME>(smpl, volume);
       }
-      *(dest++) += mix >> 1;
+      *(dest++) += downmix(mix);
     }
     //else TODO: surround not implemented
   }
   s_src->sample_index = sample_index;
 }
 
-template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS, mixer_volume VOLUME>
+template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
+ mixer_volume VOLUME, mix_function MIX>
+static void resample_mix_loop(struct sampled_stream *s_src,
+ int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume)
+{
+  resample_mix_loop_impl<DEST_CHANNELS, SRC_CHANNELS, VOLUME, mix_int16<MIX> >(
+   s_src, dest, dest_frames, src, volume);
+}
+
+template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
+ mixer_volume VOLUME, mix_function_float MIX>
+static void resample_mix_loop(struct sampled_stream *s_src,
+ float * RESTRICT dest, size_t dest_frames, const float *src, int volume)
+{
+  resample_mix_loop_impl<DEST_CHANNELS, SRC_CHANNELS, VOLUME, mix_float<MIX> >(
+   s_src, dest, dest_frames, src, volume);
+}
+
+template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
+ mixer_volume VOLUME, typename DEST, typename SRC>
 static void mixer_function(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume,
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume,
  int resample_mode)
 {
   switch((mixer_resample)resample_mode)
@@ -253,9 +387,10 @@ static void mixer_function(struct sampled_stream *s_src,
   }
 }
 
-template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS>
+template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
+ typename DEST, typename SRC>
 static void mixer_function(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume,
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume,
  int resample_mode, mixer_volume volume_mode)
 {
   switch(volume_mode)
@@ -272,9 +407,9 @@ static void mixer_function(struct sampled_stream *s_src,
   }
 }
 
-template<mixer_channels DEST_CHANNELS>
+template<mixer_channels DEST_CHANNELS, typename DEST, typename SRC>
 static void mixer_function(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume,
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume,
  int resample_mode, mixer_channels src_channels, mixer_volume volume_mode)
 {
   switch(src_channels)
@@ -296,8 +431,9 @@ static void mixer_function(struct sampled_stream *s_src,
   }
 }
 
+template<typename DEST, typename SRC>
 static void mixer_function(struct sampled_stream *s_src,
- int32_t * RESTRICT dest, size_t dest_frames, const int16_t *src, int volume,
+ DEST * RESTRICT dest, size_t dest_frames, const SRC *src, int volume,
  int resample_mode, mixer_channels dest_channels, mixer_channels src_channels,
  mixer_volume volume_mode)
 {
@@ -322,7 +458,8 @@ static void mixer_function(struct sampled_stream *s_src,
 
 void *sampled_get_buffer(struct sampled_stream *s_src, size_t *needed)
 {
-  size_t total = s_src->data_window_length + PROLOGUE_LENGTH + EPILOGUE_LENGTH;
+  size_t total = s_src->data_window_length +
+   prologue_length(s_src) + epilogue_length(s_src);
   *needed = (total > s_src->stream_offset) ? total - s_src->stream_offset : 0;
   return ((uint8_t *)s_src->output_data) + s_src->stream_offset;
 }
@@ -343,7 +480,8 @@ void sampled_set_buffer(struct sampled_stream *s_src)
    (size_t)(ceil((double)audio.buffer_frames *
    frequency / audio.output_frequency) * s_src->bytes_per_frame);
 
-  allocated_data_length = data_window_length + PROLOGUE_LENGTH + EPILOGUE_LENGTH;
+  allocated_data_length = data_window_length +
+   prologue_length(s_src) + epilogue_length(s_src);
 
   if(allocated_data_length < s_src->bytes_per_frame)
     allocated_data_length = s_src->bytes_per_frame;
@@ -357,15 +495,20 @@ void sampled_set_buffer(struct sampled_stream *s_src)
   s_src->data_window_length = data_window_length;
   s_src->allocated_data_length = allocated_data_length;
 
-  s_src->output_data =
-   (int16_t *)crealloc(s_src->output_data, allocated_data_length);
+  s_src->output_data = crealloc(s_src->output_data, allocated_data_length);
 }
 
+/**
+ * Mix the current window of the stream's sample buffer into the destination
+ * buffer, then relocate the unused data to the start of the sample buffer.
+ * Streams using float samples are mixed into the float mix bus instead of
+ * the provided buffer (see initialize_sampled_stream).
+ */
 void sampled_mix_data(struct sampled_stream *s_src,
  int32_t * RESTRICT dest_buffer, size_t dest_frames, unsigned int dest_channels)
 {
   uint8_t *output_data = (uint8_t *)s_src->output_data;
-  int16_t *src_buffer = (int16_t *)(output_data + PROLOGUE_LENGTH);
+  uint8_t *src_buffer = output_data + prologue_length(s_src);
   int volume = ((struct audio_stream *)s_src)->volume;
   int resample_mode = audio.global_resample_mode + 1;
   enum mixer_volume   volume_mode  = DYNAMIC;
@@ -374,6 +517,7 @@ void sampled_mix_data(struct sampled_stream *s_src,
   size_t new_index;
   size_t new_index_bytes;
   size_t leftover_bytes = 0;
+  size_t extra_bytes;
 
   // MZX currently only supports mono and stereo output.
   assert(dest_channels == 1 || dest_channels == 2);
@@ -390,8 +534,18 @@ void sampled_mix_data(struct sampled_stream *s_src,
     out_channels = MONO;
 
   s_src->dest_channels = dest_channels;
-  mixer_function(s_src, dest_buffer, dest_frames, src_buffer, volume,
-   resample_mode, out_channels, src_channels, volume_mode);
+  if(s_src->use_float)
+  {
+    mixer_function(s_src, audio.mix_buffer_float, dest_frames,
+     (const float *)src_buffer, volume, resample_mode, out_channels,
+     src_channels, volume_mode);
+  }
+  else
+  {
+    mixer_function(s_src, dest_buffer, dest_frames,
+     (const int16_t *)src_buffer, volume, resample_mode, out_channels,
+     src_channels, volume_mode);
+  }
 
   /* Relocate the leftovers--plus the extra prologue and epilogue samples for
    * the resamplers--back to the start of the buffer. */
@@ -401,14 +555,15 @@ void sampled_mix_data(struct sampled_stream *s_src,
     new_index_bytes = s_src->data_window_length;
 
   leftover_bytes = s_src->data_window_length - new_index_bytes;
+  extra_bytes = prologue_length(s_src) + epilogue_length(s_src);
 
   /* Note new_index_bytes doesn't count the prologue, so both the source and
    * the dest include it implicitly. */
   memmove(output_data,
    output_data + new_index_bytes,
-   leftover_bytes + PROLOGUE_LENGTH + EPILOGUE_LENGTH);
+   leftover_bytes + extra_bytes);
 
-  s_src->stream_offset = leftover_bytes + PROLOGUE_LENGTH + EPILOGUE_LENGTH;
+  s_src->stream_offset = leftover_bytes + extra_bytes;
   s_src->sample_index &= FP_AND;
 }
 
@@ -428,11 +583,13 @@ void initialize_sampled_stream(struct sampled_stream *s_src,
   s_src->channels = channels;
   s_src->output_data = NULL;
   s_src->use_volume = use_volume;
-  s_src->bytes_per_frame = channels * sizeof(int16_t);
-  s_src->stream_offset = PROLOGUE_LENGTH;
+  s_src->use_float = s_spec->use_float && audio.mix_buffer_float;
+  s_src->bytes_per_sample = s_src->use_float ? sizeof(float) : sizeof(int16_t);
+  s_src->bytes_per_frame = channels * s_src->bytes_per_sample;
+  s_src->stream_offset = prologue_length(s_src);
   s_src->sample_index = 0;
 
   s_src->set_frequency(s_src, frequency);
 
-  memset(s_src->output_data, 0, PROLOGUE_LENGTH);
+  memset(s_src->output_data, 0, prologue_length(s_src));
 }
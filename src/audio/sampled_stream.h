@@ -32,14 +32,16 @@ struct sampled_stream
 {
   struct audio_stream a;
   size_t frequency;
-  int16_t *output_data;
+  void *output_data;
   size_t data_window_length;
   size_t allocated_data_length;
   size_t stream_offset;
   size_t channels;
   size_t dest_channels;
   unsigned bytes_per_frame;
+  unsigned bytes_per_sample;
   boolean use_volume;
+  boolean use_float;
   int64_t frequency_delta;
   int64_t sample_index;
   void      (* set_frequency)(struct sampled_stream *s_src, uint32_t frequency);
@@ -48,6 +50,8 @@ struct sampled_stream
 
 struct sampled_stream_spec
 {
+  // Request float samples; only honored if the float mix bus is enabled.
+  boolean use_float;
   void      (* set_frequency)(struct sampled_stream *s_src, uint32_t frequency);
   uint32_t  (* get_frequency)(struct sampled_stream *s_src);
 };
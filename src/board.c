@@ -23,6 +23,7 @@
 #include <string.h>
 
 #include "board.h"
+#include "board_prefetch.h"
 #include "const.h"
 #include "error.h"
 #include "legacy_board.h"
@@ -321,6 +322,8 @@ void default_board_settings(struct world *mzx_world, struct board *cur_board)
   cur_board->freeze_time_dur_v1 = 0;
   cur_board->slow_time_dur_v1 = 0;
   cur_board->wind_dur_v1 = 0;
+  cur_board->deferred = NULL;
+  cur_board->retrieved = 0;
 
 #if defined(DEBUG) || defined(CONFIG_EXTRAM)
   cur_board->is_extram = false;
@@ -424,10 +427,12 @@ __editor_maybe_static void board_set_palette_path(struct board *cur_board,
 static int load_board_info(struct world *mzx_world, struct board *cur_board,
  struct zip_archive *zp, int savegame, int *file_version)
 {
-  char *buffer;
+  char *buffer = NULL;
   size_t actual_size;
   struct memfile mf;
   struct memfile prop;
+  unsigned int method;
+  boolean is_stream = false;
   int info_file_version;
   int last_ident = -1;
   int ident;
@@ -437,11 +442,22 @@ static int load_board_info(struct world *mzx_world, struct board *cur_board,
   if(zip_get_next_uncompressed_size(zp, &actual_size) != ZIP_SUCCESS)
     return -1;
 
-  buffer = cmalloc(actual_size);
+  zip_get_next_method(zp, &method);
+
+  // If this is an uncompressed memory zip, we can read the memory directly.
+  if(zp->is_memory && method == ZIP_M_NONE &&
+   zip_read_open_mem_stream(zp, &mf) == ZIP_SUCCESS)
+  {
+    is_stream = true;
+  }
+  else
+  {
+    buffer = cmalloc(actual_size);
 
-  zip_read_file(zp, buffer, actual_size, &actual_size);
+    zip_read_file(zp, buffer, actual_size, &actual_size);
 
-  mfopen(buffer, actual_size, &mf);
+    mfopen(buffer, actual_size, &mf);
+  }
 
   while(next_prop(&prop, &ident, &size, &mf))
   {
@@ -760,10 +776,16 @@ static int load_board_info(struct world *mzx_world, struct board *cur_board,
   cur_board->viewport_height = CLAMP(cur_board->viewport_height, 1, 25 - cur_board->viewport_y);
   cur_board->viewport_height = CLAMP(cur_board->viewport_height, 1, cur_board->board_height);
 
+  if(is_stream)
+    zip_read_close_stream(zp);
+
   free(buffer);
   return 0;
 
 err_free:
+  if(is_stream)
+    zip_read_close_stream(zp);
+
   free(buffer);
   return 1;
 }
@@ -1253,6 +1275,219 @@ struct board *load_board_allocate(struct world *mzx_world,
   return cur_board;
 }
 
+/**
+ * Load only the board info of a board and remember where the rest of its
+ * files are in the archive. The rest of the board will be loaded from the
+ * archive by retrieve_board_deferred the first time the board is retrieved,
+ * so the archive must stay open until the board is cleared.
+ */
+struct board *load_board_allocate_deferred(struct world *mzx_world,
+ struct zip_archive *zp, int savegame, int file_version, unsigned int board_id)
+{
+  struct board *cur_board = cmalloc(sizeof(struct board));
+  struct board_deferred *deferred;
+  unsigned int file_id;
+  unsigned int board_id_read;
+  size_t pos = zp->pos;
+
+  default_board_settings(mzx_world, cur_board);
+
+  if(zip_get_next_mzx_file_id(zp, &file_id, &board_id_read, NULL) ||
+   file_id != FILE_ID_BOARD_INFO ||
+   load_board_info(mzx_world, cur_board, zp, savegame, &file_version))
+  {
+    // Let the regular loader handle (and report) any errors.
+    free(cur_board->input_string);
+    free(cur_board->charset_path);
+    free(cur_board->palette_path);
+
+    zp->pos = pos;
+    load_board_direct(mzx_world, cur_board, zp, savegame, file_version,
+     board_id);
+    return cur_board;
+  }
+
+  while(ZIP_SUCCESS ==
+   zip_get_next_mzx_file_id(zp, &file_id, &board_id_read, NULL))
+  {
+    if(board_id_read != board_id)
+      break;
+
+    zip_skip_file(zp);
+  }
+
+  cur_board->level_id = NULL;
+  cur_board->level_param = NULL;
+  cur_board->level_color = NULL;
+  cur_board->level_under_id = NULL;
+  cur_board->level_under_param = NULL;
+  cur_board->level_under_color = NULL;
+  cur_board->overlay = NULL;
+  cur_board->overlay_color = NULL;
+  cur_board->num_robots_active = 0;
+  cur_board->robot_list = NULL;
+  cur_board->robot_list_name_sorted = NULL;
+  cur_board->scroll_list = NULL;
+  cur_board->sensor_list = NULL;
+
+  deferred = cmalloc(sizeof(struct board_deferred));
+  deferred->mzx_world = mzx_world;
+  deferred->zp = zp;
+  deferred->pos = pos;
+  deferred->board_id = board_id;
+  deferred->file_version = file_version;
+  deferred->savegame = savegame;
+
+  cur_board->deferred = deferred;
+  return cur_board;
+}
+
+/**
+ * Load the rest of a deferred board from its archive. If free_data is set,
+ * forget about the rest of the board instead so it can be cleared. Only the
+ * board contents are loaded, since the board info may have been modified.
+ */
+void retrieve_board_deferred(struct board *cur_board, boolean free_data)
+{
+  struct board_deferred *deferred = cur_board->deferred;
+  struct board *tmp;
+
+  if(!deferred)
+    return;
+
+  if(!free_data)
+    board_prefetch_claim(deferred->mzx_world->board_prefetch, cur_board);
+
+  cur_board->deferred = NULL;
+
+  if(free_data)
+  {
+    cur_board->num_robots = 0;
+    cur_board->num_scrolls = 0;
+    cur_board->num_sensors = 0;
+    free(deferred);
+    return;
+  }
+
+  tmp = cmalloc(sizeof(struct board));
+  deferred->zp->pos = deferred->pos;
+  load_board_direct(deferred->mzx_world, tmp, deferred->zp,
+   deferred->savegame, deferred->file_version, deferred->board_id);
+
+  cur_board->board_width = tmp->board_width;
+  cur_board->board_height = tmp->board_height;
+  cur_board->overlay_mode = tmp->overlay_mode;
+  cur_board->level_id = tmp->level_id;
+  cur_board->level_param = tmp->level_param;
+  cur_board->level_color = tmp->level_color;
+  cur_board->level_under_id = tmp->level_under_id;
+  cur_board->level_under_param = tmp->level_under_param;
+  cur_board->level_under_color = tmp->level_under_color;
+  cur_board->overlay = tmp->overlay;
+  cur_board->overlay_color = tmp->overlay_color;
+
+  cur_board->num_robots = tmp->num_robots;
+  cur_board->num_robots_active = tmp->num_robots_active;
+  cur_board->num_robots_allocated = tmp->num_robots_allocated;
+  cur_board->robot_list = tmp->robot_list;
+  cur_board->robot_list_name_sorted = tmp->robot_list_name_sorted;
+  cur_board->num_scrolls = tmp->num_scrolls;
+  cur_board->num_scrolls_allocated = tmp->num_scrolls_allocated;
+  cur_board->scroll_list = tmp->scroll_list;
+  cur_board->num_sensors = tmp->num_sensors;
+  cur_board->num_sensors_allocated = tmp->num_sensors_allocated;
+  cur_board->sensor_list = tmp->sensor_list;
+
+  free(tmp->input_string);
+  free(tmp->charset_path);
+  free(tmp->palette_path);
+  free(tmp);
+  free(deferred);
+}
+
+/**
+ * Deferred boards can be saved by copying their files from the archive they
+ * would be loaded from, as long as the file formats match.
+ */
+boolean can_save_board_deferred(struct board *cur_board, int savegame,
+ int file_version)
+{
+  struct board_deferred *deferred = cur_board->deferred;
+
+  // Robots in world files are also valid in saves, but not the reverse.
+  return deferred && deferred->file_version == file_version &&
+   (savegame || !deferred->savegame);
+}
+
+/**
+ * Save the board info of a board and copy the rest of its files from another
+ * archive, starting from the board info at src->pos. This is only valid if
+ * the rest of the board hasn't changed since these files were written.
+ */
+int save_board_copy(struct world *mzx_world, struct board *cur_board,
+ struct zip_archive *zp, int savegame, int file_version, int board_id,
+ struct zip_archive *src)
+{
+  struct zip_file_header *fh;
+  struct memfile mf;
+  unsigned int src_board_id;
+  unsigned int file_id;
+  unsigned int board_id_read;
+  char name[16];
+
+  if(src->pos >= src->num_files)
+    return -1;
+
+  src_board_id = src->files[src->pos]->mzx_board_id;
+  sprintf(name, "b%2.2X", (unsigned char)board_id);
+
+  if(save_board_info(cur_board, zp, savegame, file_version, mzx_world->version,
+   name))
+    return -1;
+
+  // Copy everything after the board info, renaming it for the new board ID.
+  src->pos++;
+  while(ZIP_SUCCESS ==
+   zip_get_next_mzx_file_id(src, &file_id, &board_id_read, NULL))
+  {
+    if(board_id_read != src_board_id)
+      break;
+
+    fh = src->files[src->pos];
+    if(file_id != FILE_ID_NONE && fh->file_name_length < sizeof(name) &&
+     zip_get_next_raw_file(src, &mf) == ZIP_SUCCESS)
+    {
+      snprintf(name + 3, sizeof(name) - 3, "%s", fh->file_name + 3);
+
+      // Board data is stored uncompressed in snapshots, but should normally
+      // be compressed.
+      if(file_id >= FILE_ID_BOARD_BID && file_id <= FILE_ID_BOARD_OCO &&
+       fh->method == ZIP_M_NONE && !zp->store_only)
+      {
+        if(zip_write_file(zp, name, mf.start, fh->uncompressed_size,
+         ZIP_M_DEFLATE))
+          return -1;
+      }
+      else
+
+      if(zip_write_raw_file(zp, name, fh, mf.start))
+        return -1;
+    }
+    zip_skip_file(src);
+  }
+  return 0;
+}
+
+int save_board_deferred(struct world *mzx_world, struct board *cur_board,
+ struct zip_archive *zp, int savegame, int file_version, int board_id)
+{
+  struct board_deferred *deferred = cur_board->deferred;
+
+  deferred->zp->pos = deferred->pos;
+  return save_board_copy(mzx_world, cur_board, zp, savegame, file_version,
+   board_id, deferred->zp);
+}
+
 struct board *duplicate_board(struct world *mzx_world,
  struct board *src_board)
 {
@@ -1276,6 +1511,7 @@ struct board *duplicate_board(struct world *mzx_world,
 
   dest_board = cmalloc(sizeof(struct board));
   memcpy(dest_board, src_board, sizeof(struct board));
+  dest_board->deferred = NULL;
 
   // Level data
   dest_board->level_id = cmalloc(size);
@@ -1407,13 +1643,24 @@ struct board *duplicate_board(struct world *mzx_world,
 void clear_board(struct board *cur_board)
 {
   int i;
-  int num_robots_active = cur_board->num_robots_active;
-  int num_scrolls = cur_board->num_scrolls;
-  int num_sensors = cur_board->num_sensors;
-  struct robot **robot_list = cur_board->robot_list;
-  struct robot **robot_name_list = cur_board->robot_list_name_sorted;
-  struct scroll **scroll_list = cur_board->scroll_list;
-  struct sensor **sensor_list = cur_board->sensor_list;
+  int num_robots_active;
+  int num_scrolls;
+  int num_sensors;
+  struct robot **robot_list;
+  struct robot **robot_name_list;
+  struct scroll **scroll_list;
+  struct sensor **sensor_list;
+
+  // Deferred boards don't have anything else loaded yet.
+  retrieve_board_deferred(cur_board, true);
+
+  num_robots_active = cur_board->num_robots_active;
+  num_scrolls = cur_board->num_scrolls;
+  num_sensors = cur_board->num_sensors;
+  robot_list = cur_board->robot_list;
+  robot_name_list = cur_board->robot_list_name_sorted;
+  scroll_list = cur_board->scroll_list;
+  sensor_list = cur_board->sensor_list;
 
   free(cur_board->level_id);
   free(cur_board->level_param);
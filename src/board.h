@@ -34,6 +34,18 @@ CORE_LIBSPEC int save_board(struct world *mzx_world, struct board *cur_board,
 CORE_LIBSPEC struct board *load_board_allocate(struct world *mzx_world,
  struct zip_archive *zp, int savegame, int file_version, unsigned int board_id);
 
+struct board *load_board_allocate_deferred(struct world *mzx_world,
+ struct zip_archive *zp, int savegame, int file_version, unsigned int board_id);
+CORE_LIBSPEC void retrieve_board_deferred(struct board *cur_board,
+ boolean free_data);
+boolean can_save_board_deferred(struct board *cur_board, int savegame,
+ int file_version);
+int save_board_deferred(struct world *mzx_world, struct board *cur_board,
+ struct zip_archive *zp, int savegame, int file_version, int board_id);
+int save_board_copy(struct world *mzx_world, struct board *cur_board,
+ struct zip_archive *zp, int savegame, int file_version, int board_id,
+ struct zip_archive *src);
+
 CORE_LIBSPEC void board_set_input_string(struct board *cur_board,
  const char *input, size_t len);
 CORE_LIBSPEC void clear_board(struct board *cur_board);
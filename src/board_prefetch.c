@@ -0,0 +1,704 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Background prefetching of deferred boards (see world_lazy_load) and boards
+ * compressed in extra RAM (see extmem.c). Every time the current board
+ * changes, the main thread guesses which boards are likely to be entered
+ * next: the board exits, the targets of entrances on the board, the targets
+ * of TELEPORT and BOARD commands in the board's robots, and the boards that
+ * were visited recently. A worker thread decompresses these boards ahead of
+ * time, up to a memory limit.
+ *
+ * The worker never touches any boards or the archive itself. Deferred boards
+ * are decompressed from their compressed files in the archive (which is in
+ * memory and never modified); extra RAM boards are decompressed from a copy
+ * of their blocks made by the main thread. When one of these boards is
+ * retrieved, the main thread claims the decompressed data and hands it to
+ * the archive or to extra RAM, so the board is then loaded normally (and
+ * validated) on the main thread without any inflating.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "board_prefetch.h"
+#include "const.h"
+#include "data.h"
+#include "extmem.h"
+#include "platform.h"
+#include "robot.h"
+#include "util.h"
+#include "world_struct.h"
+#include "io/memfile.h"
+#include "io/zip.h"
+
+#ifndef PLATFORM_NO_THREADING
+
+#define MAX_PREFETCH_BOARDS 16
+#define PREFETCH_HISTORY 4
+
+enum prefetch_state
+{
+  PREFETCH_EMPTY,
+  PREFETCH_QUEUED,
+  PREFETCH_RUNNING,
+  PREFETCH_DONE
+};
+
+struct prefetch_file
+{
+  const struct zip_file_header *fh;
+  const void *src;
+  void *dest;
+  size_t pos;
+};
+
+struct prefetch_entry
+{
+  struct board *board;
+  struct prefetch_file *files;
+  struct extram_board_copy *copy;
+  size_t num_files;
+  size_t size;
+  unsigned int board_id;
+  unsigned int priority;
+  enum prefetch_state state;
+  boolean wanted;
+};
+
+struct board_prefetch
+{
+  platform_thread thread;
+  platform_mutex lock;
+  platform_cond cond;
+  struct zip_archive *zp;
+  struct prefetch_entry entries[MAX_PREFETCH_BOARDS];
+  size_t memory_used;
+  size_t max_memory;
+  int history[PREFETCH_HISTORY];
+  boolean stop;
+};
+
+struct prefetch_candidates
+{
+  int board_ids[MAX_PREFETCH_BOARDS];
+  int num_boards;
+};
+
+static struct prefetch_entry *next_queued_entry(struct board_prefetch *bp)
+{
+  struct prefetch_entry *next = NULL;
+  int i;
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+  {
+    struct prefetch_entry *e = &bp->entries[i];
+    if(e->state == PREFETCH_QUEUED && (!next || e->priority < next->priority))
+      next = e;
+  }
+  return next;
+}
+
+static THREAD_RES board_prefetch_worker(void *priv)
+{
+  struct board_prefetch *bp = (struct board_prefetch *)priv;
+
+  platform_mutex_lock(&bp->lock);
+  while(!bp->stop)
+  {
+    struct prefetch_entry *e = next_queued_entry(bp);
+    size_t i;
+
+    if(!e)
+    {
+      platform_cond_wait(&bp->cond, &bp->lock);
+      continue;
+    }
+    e->state = PREFETCH_RUNNING;
+    platform_mutex_unlock(&bp->lock);
+
+    // Running entries belong to this thread until they're done.
+    if(e->copy)
+      extram_unpack_board_copy(e->copy);
+
+    for(i = 0; i < e->num_files; i++)
+    {
+      struct prefetch_file *pf = &e->files[i];
+      void *dest = malloc(pf->fh->uncompressed_size);
+
+      if(dest && zip_decompress_raw_file(pf->fh, pf->src, dest) != ZIP_SUCCESS)
+      {
+        free(dest);
+        dest = NULL;
+      }
+      pf->dest = dest;
+    }
+
+    platform_mutex_lock(&bp->lock);
+    e->state = PREFETCH_DONE;
+    platform_cond_broadcast(&bp->cond);
+  }
+  platform_mutex_unlock(&bp->lock);
+
+  THREAD_RETURN;
+}
+
+static void free_entry(struct board_prefetch *bp, struct prefetch_entry *e)
+{
+  size_t i;
+
+  for(i = 0; i < e->num_files; i++)
+    free(e->files[i].dest);
+
+  free(e->files);
+  extram_free_board_copy(e->copy);
+  bp->memory_used -= e->size;
+  memset(e, 0, sizeof(struct prefetch_entry));
+}
+
+/**
+ * Find the entry for a board. Deferred boards must still be waiting for the
+ * same files; extra RAM boards must still have the blocks that were copied.
+ */
+static struct prefetch_entry *find_entry(struct board_prefetch *bp,
+ struct board *cur_board)
+{
+  int i;
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+  {
+    struct prefetch_entry *e = &bp->entries[i];
+    if(e->state == PREFETCH_EMPTY || e->board != cur_board)
+      continue;
+
+    if(cur_board->deferred)
+    {
+      if(!e->copy && e->board_id == cur_board->deferred->board_id)
+        return e;
+    }
+    else
+
+    if(e->copy && extram_board_copy_is_current(cur_board, e->copy))
+      return e;
+  }
+  return NULL;
+}
+
+/**
+ * Free a finished entry that is no longer wanted to make room for another.
+ */
+static boolean evict_entry(struct board_prefetch *bp)
+{
+  int i;
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+  {
+    struct prefetch_entry *e = &bp->entries[i];
+    if(e->state == PREFETCH_DONE && !e->wanted)
+    {
+      free_entry(bp, e);
+      return true;
+    }
+  }
+  return false;
+}
+
+static struct prefetch_entry *empty_entry(struct board_prefetch *bp)
+{
+  int i;
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+    if(bp->entries[i].state == PREFETCH_EMPTY)
+      return &bp->entries[i];
+
+  if(evict_entry(bp))
+    return empty_entry(bp);
+
+  return NULL;
+}
+
+/**
+ * Add an entry for the worker, making room for it if possible. Takes
+ * ownership of `files` and `copy`.
+ */
+static void add_entry(struct board_prefetch *bp, struct board *cur_board,
+ unsigned int board_id, struct prefetch_file *files, size_t num_files,
+ struct extram_board_copy *copy, size_t size, unsigned int priority)
+{
+  struct prefetch_entry *e = NULL;
+
+  while(size && bp->memory_used + size > bp->max_memory)
+    if(!evict_entry(bp))
+      break;
+
+  if(size && bp->memory_used + size <= bp->max_memory)
+    e = empty_entry(bp);
+
+  if(!e)
+  {
+    free(files);
+    extram_free_board_copy(copy);
+    return;
+  }
+
+  e->board = cur_board;
+  e->files = files;
+  e->copy = copy;
+  e->num_files = num_files;
+  e->size = size;
+  e->board_id = board_id;
+  e->priority = priority;
+  e->state = PREFETCH_QUEUED;
+  e->wanted = true;
+  bp->memory_used += size;
+}
+
+/**
+ * Queue the compressed files of a deferred board for the worker. Stored
+ * files are already read directly from the archive, so only compressed
+ * files are prefetched.
+ */
+static void queue_deferred_board(struct board_prefetch *bp,
+ struct board *cur_board, unsigned int priority)
+{
+  struct board_deferred *deferred = cur_board->deferred;
+  struct zip_archive *zp = bp->zp;
+  struct prefetch_file *files;
+  struct memfile mf;
+  size_t num_files = 0;
+  size_t size = 0;
+  size_t pos = zp->pos;
+  size_t i;
+
+  for(i = deferred->pos + 1; i < zp->num_files; i++)
+    if(zp->files[i]->mzx_board_id != deferred->board_id)
+      break;
+
+  if(i == deferred->pos + 1)
+    return;
+
+  files = (struct prefetch_file *)cmalloc((i - deferred->pos - 1) *
+   sizeof(struct prefetch_file));
+
+  for(i = deferred->pos + 1; i < zp->num_files; i++)
+  {
+    struct zip_file_header *fh = zp->files[i];
+    if(fh->mzx_board_id != deferred->board_id)
+      break;
+
+    if(fh->method != ZIP_M_DEFLATE || fh->decompressed ||
+     !fh->uncompressed_size || fh->compressed_size > UINT32_MAX)
+      continue;
+
+    // The sizes come from the archive, so check them against the memory
+    // limit here; the worker allocates whatever was queued.
+    if(fh->uncompressed_size > bp->max_memory - size)
+    {
+      free(files);
+      zp->pos = pos;
+      return;
+    }
+
+    zp->pos = i;
+    if(zip_get_next_raw_file(zp, &mf) != ZIP_SUCCESS)
+      continue;
+
+    files[num_files].fh = fh;
+    files[num_files].src = mf.start;
+    files[num_files].dest = NULL;
+    files[num_files].pos = i;
+    size += fh->uncompressed_size;
+    num_files++;
+  }
+  zp->pos = pos;
+
+  add_entry(bp, cur_board, deferred->board_id, files, num_files, NULL,
+   size, priority);
+}
+
+/**
+ * Queue a copy of the extra RAM blocks of a board for the worker.
+ */
+static void queue_extram_board(struct board_prefetch *bp,
+ struct board *cur_board, unsigned int board_id, unsigned int priority)
+{
+  struct extram_board_copy *copy;
+  size_t size = 0;
+
+  // Don't bother copying boards that can't fit anyway.
+  if(bp->max_memory < (size_t)cur_board->board_width *
+   cur_board->board_height * 6)
+    return;
+
+  copy = extram_copy_board(cur_board, &size);
+  if(copy)
+    add_entry(bp, cur_board, board_id, NULL, 0, copy, size, priority);
+}
+
+static boolean can_prefetch_board(struct board_prefetch *bp,
+ struct board *cur_board)
+{
+  if(cur_board->deferred)
+    return bp->zp != NULL;
+
+#ifdef CONFIG_EXTRAM
+  return cur_board->is_extram;
+#else
+  return false;
+#endif
+}
+
+static void add_candidate(struct board_prefetch *bp,
+ struct prefetch_candidates *c, struct world *mzx_world, int board_id)
+{
+  struct board *cur_board;
+  int i;
+
+  if(c->num_boards >= MAX_PREFETCH_BOARDS || board_id < 0 ||
+   board_id >= mzx_world->num_boards ||
+   board_id == mzx_world->current_board_id)
+    return;
+
+  cur_board = mzx_world->board_list[board_id];
+  if(!cur_board || !can_prefetch_board(bp, cur_board))
+    return;
+
+  for(i = 0; i < c->num_boards; i++)
+    if(c->board_ids[i] == board_id)
+      return;
+
+  c->board_ids[c->num_boards++] = board_id;
+}
+
+/**
+ * Add the board named by a string parameter in robot bytecode. Strings that
+ * need to be interpolated can't be predicted and are ignored.
+ */
+static void add_candidate_param(struct board_prefetch *bp,
+ struct prefetch_candidates *c, struct world *mzx_world, char *param,
+ char *end)
+{
+  unsigned int len = (unsigned char)param[0];
+
+  if(!len || param + len >= end || param[len] || strchr(param + 1, '&'))
+    return;
+
+  add_candidate(bp, c, mzx_world, find_board(mzx_world, param + 1));
+}
+
+static void add_robot_candidates(struct board_prefetch *bp,
+ struct prefetch_candidates *c, struct world *mzx_world,
+ struct robot *cur_robot)
+{
+  char *program = cur_robot->program_bytecode;
+  int length = cur_robot->program_bytecode_length;
+  int pos = 1;
+
+  if(!program)
+    return;
+
+  while(pos < length && program[pos] && c->num_boards < MAX_PREFETCH_BOARDS)
+  {
+    int cmd_length = (unsigned char)program[pos];
+    char *cmd_ptr = program + pos + 1;
+    char *end = cmd_ptr + cmd_length;
+
+    if(pos + cmd_length + 2 > length)
+      break;
+
+    switch(cmd_ptr[0])
+    {
+      case ROBOTIC_CMD_TELEPORT:
+        add_candidate_param(bp, c, mzx_world, cmd_ptr + 1, end);
+        break;
+
+      case ROBOTIC_CMD_BOARD:
+        add_candidate_param(bp, c, mzx_world, next_param_pos(cmd_ptr + 1),
+         end);
+        break;
+    }
+    pos += cmd_length + 2;
+  }
+}
+
+/**
+ * Check if any board other than the current board can be prefetched. This is
+ * much cheaper than searching the current board for candidates, and most
+ * worlds have nothing left to prefetch once their boards have been loaded.
+ */
+static boolean any_candidates(struct board_prefetch *bp,
+ struct world *mzx_world)
+{
+  int i;
+
+  for(i = 0; i < mzx_world->num_boards; i++)
+  {
+    struct board *cur_board = mzx_world->board_list[i];
+    if(cur_board && i != mzx_world->current_board_id &&
+     can_prefetch_board(bp, cur_board))
+      return true;
+  }
+  return false;
+}
+
+static void get_candidates(struct board_prefetch *bp,
+ struct prefetch_candidates *c, struct world *mzx_world)
+{
+  struct board *cur_board = mzx_world->current_board;
+  int board_size = cur_board->board_width * cur_board->board_height;
+  int i;
+
+  c->num_boards = 0;
+
+  if(!any_candidates(bp, mzx_world))
+    return;
+
+  for(i = 0; i < 4; i++)
+    add_candidate(bp, c, mzx_world, cur_board->board_dir[i]);
+
+  for(i = 0; i < board_size && c->num_boards < MAX_PREFETCH_BOARDS; i++)
+  {
+    int id = (unsigned char)cur_board->level_id[i];
+    int param = (unsigned char)cur_board->level_param[i];
+
+    if(id == PLAYER)
+    {
+      id = (unsigned char)cur_board->level_under_id[i];
+      param = (unsigned char)cur_board->level_under_param[i];
+    }
+
+    if(id < 128 && (flags[id] & A_ENTRANCE))
+      add_candidate(bp, c, mzx_world, param);
+  }
+
+  for(i = 1; i <= cur_board->num_robots; i++)
+    if(cur_board->robot_list[i])
+      add_robot_candidates(bp, c, mzx_world, cur_board->robot_list[i]);
+
+  for(i = 0; i < PREFETCH_HISTORY; i++)
+    add_candidate(bp, c, mzx_world, bp->history[i]);
+}
+
+/**
+ * Start the prefetch worker for a world. Deferred boards are prefetched from
+ * the world archive `zp` (if any, and only if it's in memory). Returns NULL
+ * if prefetching is disabled or isn't possible.
+ */
+struct board_prefetch *board_prefetch_init(struct zip_archive *zp,
+ size_t max_memory)
+{
+  struct board_prefetch *bp;
+  int i;
+
+  if(zp && !zp->is_memory)
+    zp = NULL;
+
+#ifndef CONFIG_EXTRAM
+  // Without extra RAM, only deferred boards can be prefetched.
+  if(!zp)
+    return NULL;
+#endif
+
+  if(!max_memory)
+    return NULL;
+
+  bp = (struct board_prefetch *)ccalloc(1, sizeof(struct board_prefetch));
+  bp->zp = zp;
+  bp->max_memory = max_memory;
+
+  for(i = 0; i < PREFETCH_HISTORY; i++)
+    bp->history[i] = NO_BOARD;
+
+  if(!platform_mutex_init(&bp->lock))
+    goto err_free;
+
+  if(!platform_cond_init(&bp->cond))
+    goto err_destroy_mutex;
+
+  if(!platform_thread_create(&bp->thread, board_prefetch_worker, bp))
+    goto err_destroy_cond;
+
+  return bp;
+
+err_destroy_cond:
+  platform_cond_destroy(&bp->cond);
+err_destroy_mutex:
+  platform_mutex_destroy(&bp->lock);
+err_free:
+  free(bp);
+  return NULL;
+}
+
+/**
+ * Predict the next boards after a board change and queue them. Finished
+ * boards that are no longer predicted are kept until their memory is needed.
+ */
+void board_prefetch_update(struct board_prefetch *bp,
+ struct world *mzx_world)
+{
+  struct prefetch_candidates c;
+  int current = mzx_world->current_board_id;
+  int i;
+
+  if(!bp || !mzx_world->current_board)
+    return;
+
+  if(bp->history[0] != current)
+  {
+    memmove(bp->history + 1, bp->history,
+     (PREFETCH_HISTORY - 1) * sizeof(int));
+    bp->history[0] = current;
+  }
+
+  get_candidates(bp, &c, mzx_world);
+
+  platform_mutex_lock(&bp->lock);
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+  {
+    struct prefetch_entry *e = &bp->entries[i];
+    e->wanted = false;
+    e->priority = MAX_PREFETCH_BOARDS;
+  }
+
+  for(i = 0; i < c.num_boards; i++)
+  {
+    struct board *cur_board = mzx_world->board_list[c.board_ids[i]];
+    struct prefetch_entry *e = find_entry(bp, cur_board);
+    if(e)
+    {
+      e->wanted = true;
+      e->priority = i;
+    }
+  }
+
+  // Queued boards that weren't predicted again aren't worth starting.
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+  {
+    struct prefetch_entry *e = &bp->entries[i];
+    if(e->state == PREFETCH_QUEUED && !e->wanted)
+      free_entry(bp, e);
+  }
+
+  for(i = 0; i < c.num_boards; i++)
+  {
+    struct board *cur_board = mzx_world->board_list[c.board_ids[i]];
+    if(find_entry(bp, cur_board))
+      continue;
+
+    if(cur_board->deferred)
+    {
+      queue_deferred_board(bp, cur_board, i);
+    }
+    else
+      queue_extram_board(bp, cur_board, c.board_ids[i], i);
+  }
+
+  platform_cond_broadcast(&bp->cond);
+  platform_mutex_unlock(&bp->lock);
+}
+
+/**
+ * Hand any prefetched data of a board over to the archive (for deferred
+ * boards) or to extra RAM. This should be called right before the board is
+ * retrieved. If the board is being decompressed right now, wait for it to
+ * finish.
+ */
+void board_prefetch_claim(struct board_prefetch *bp, struct board *cur_board)
+{
+  struct prefetch_entry *e;
+  size_t i;
+
+  if(!bp || !cur_board)
+    return;
+
+  platform_mutex_lock(&bp->lock);
+  e = find_entry(bp, cur_board);
+  if(e)
+  {
+    while(e->state == PREFETCH_RUNNING)
+      platform_cond_wait(&bp->cond, &bp->lock);
+
+    if(e->state == PREFETCH_DONE)
+    {
+      for(i = 0; i < e->num_files; i++)
+      {
+        struct prefetch_file *pf = &e->files[i];
+        if(pf->dest)
+          zip_set_decompressed_file(bp->zp, pf->pos, pf->dest);
+
+        pf->dest = NULL;
+      }
+
+      if(e->copy)
+      {
+        extram_set_board_copy(cur_board, e->copy);
+        e->copy = NULL;
+      }
+    }
+    free_entry(bp, e);
+  }
+  platform_mutex_unlock(&bp->lock);
+}
+
+/**
+ * Stop the worker and free all prefetched data. This must be called before
+ * the archive is closed.
+ */
+void board_prefetch_free(struct board_prefetch *bp)
+{
+  int i;
+
+  if(!bp)
+    return;
+
+  platform_mutex_lock(&bp->lock);
+  bp->stop = true;
+  platform_cond_broadcast(&bp->cond);
+  platform_mutex_unlock(&bp->lock);
+
+  platform_thread_join(&bp->thread);
+
+  for(i = 0; i < MAX_PREFETCH_BOARDS; i++)
+    free_entry(bp, &bp->entries[i]);
+
+  platform_cond_destroy(&bp->cond);
+  platform_mutex_destroy(&bp->lock);
+  free(bp);
+}
+
+#else /* PLATFORM_NO_THREADING */
+
+struct board_prefetch *board_prefetch_init(struct zip_archive *zp,
+ size_t max_memory)
+{
+  return NULL;
+}
+
+void board_prefetch_update(struct board_prefetch *bp,
+ struct world *mzx_world) {}
+
+void board_prefetch_claim(struct board_prefetch *bp,
+ struct board *cur_board) {}
+
+void board_prefetch_free(struct board_prefetch *bp) {}
+
+#endif /* PLATFORM_NO_THREADING */
@@ -0,0 +1,43 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __BOARD_PREFETCH_H
+#define __BOARD_PREFETCH_H
+
+#include "compat.h"
+
+__M_BEGIN_DECLS
+
+#include <stddef.h>
+
+struct board;
+struct world;
+struct zip_archive;
+struct board_prefetch;
+
+struct board_prefetch *board_prefetch_init(struct zip_archive *zp,
+ size_t max_memory);
+void board_prefetch_update(struct board_prefetch *bp,
+ struct world *mzx_world);
+void board_prefetch_claim(struct board_prefetch *bp, struct board *cur_board);
+void board_prefetch_free(struct board_prefetch *bp);
+
+__M_END_DECLS
+
+#endif /* __BOARD_PREFETCH_H */
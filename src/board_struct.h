@@ -26,6 +26,26 @@ __M_BEGIN_DECLS
 
 #include "robot_struct.h"
 
+struct world;
+struct zip_archive;
+
+// Flags for board->retrieved. Each copy of the world that boards can be copied
+// from has its own flag (see world_incremental_save and world_snapshots).
+#define BOARD_RETRIEVED_SAVE      (1 << 0)
+#define BOARD_RETRIEVED_SNAPSHOT  (1 << 1)
+#define BOARD_RETRIEVED_ALL       (BOARD_RETRIEVED_SAVE | BOARD_RETRIEVED_SNAPSHOT)
+
+// Where the rest of a board that has only had its board info loaded is.
+struct board_deferred
+{
+  struct world *mzx_world;
+  struct zip_archive *zp;
+  size_t pos;
+  unsigned int board_id;
+  int file_version;
+  int savegame;
+};
+
 struct board
 {
   char board_name[32];
@@ -107,6 +127,20 @@ struct board
   int num_sensors;
   int num_sensors_allocated;
   struct sensor **sensor_list;
+
+  // If set, only the board info of this board has been loaded so far. The
+  // rest of the board will be loaded when it is retrieved (see extmem.h).
+  struct board_deferred *deferred;
+
+  // Set when the board is retrieved (see extmem.h). This doesn't mean the
+  // board was actually changed, only that it could have been: outside of the
+  // editor, a board other than the current board has to be retrieved before
+  // anything can modify it. Boards that haven't been retrieved since the
+  // world was last loaded or saved are unchanged in that file, so they can be
+  // copied from it (see world_incremental_save). The same applies to the last
+  // snapshot taken or restored. The current board is always saved in full.
+  uint8_t retrieved;
+
 #if defined(DEBUG) || defined(CONFIG_EXTRAM)
   boolean is_extram;
 #endif
@@ -0,0 +1,23 @@
+#define PLATFORM "linux-amd64"
+#define VERSION "2.93b-GIT"
+#define VERSION_DATE " (20261019)"
+#define VERSION_HEAD "948480b"
+#define CONFDIR "./"
+#define CONFFILE "config.txt"
+#define SHAREDIR "."
+#define LICENSEDIR "."
+#define CONFIG_EDITOR
+#define CONFIG_HELPSYS
+#define CONFIG_UTILS
+#define CONFIG_RENDER_SOFT
+#define CONFIG_ENABLE_SCREENSHOTS
+#define CONFIG_AUDIO_MOD_SYSTEM
+#define CONFIG_XMP
+#define CONFIG_REALITY
+#define CONFIG_AUDIO
+#define CONFIG_PNG
+#define CONFIG_PTHREAD
+#define CONFIG_MODULAR
+#define CONFIG_CHECK_ALLOC
+#define CONFIG_COUNTER_HASH_TABLES
+#define CONFIG_VFS
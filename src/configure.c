@@ -33,6 +33,7 @@
 #include "event.h"
 #include "rasm.h"
 #include "util.h"
+#include "world_compress.h"
 #include "io/fsafeopen.h"
 #include "io/path.h"
 #include "io/vio.h"
@@ -230,6 +231,34 @@
 #define VFS_MAX_CACHE_FILE_SIZE_DEFAULT (VFS_MAX_CACHE_SIZE_DEFAULT >> 2)
 #endif
 
+#ifndef WORLD_LOAD_THREADS_DEFAULT
+#define WORLD_LOAD_THREADS_DEFAULT 4
+#endif
+
+#ifndef WORLD_SAVE_THREADS_DEFAULT
+#define WORLD_SAVE_THREADS_DEFAULT 4
+#endif
+
+#ifndef WORLD_LAZY_LOAD_DEFAULT
+#define WORLD_LAZY_LOAD_DEFAULT false
+#endif
+
+#ifndef WORLD_PREFETCH_MEMORY_DEFAULT
+#define WORLD_PREFETCH_MEMORY_DEFAULT (1 << 22)
+#endif
+
+#ifndef WORLD_INCREMENTAL_SAVE_DEFAULT
+#define WORLD_INCREMENTAL_SAVE_DEFAULT true
+#endif
+
+#ifndef WORLD_SNAPSHOTS_DEFAULT
+#define WORLD_SNAPSHOTS_DEFAULT 8
+#endif
+
+#ifndef MZM_CACHE_MEMORY_DEFAULT
+#define MZM_CACHE_MEMORY_DEFAULT (1 << 22)
+#endif
+
 #ifndef AUTO_DECRYPT_WORLDS
 #define AUTO_DECRYPT_WORLDS true
 #endif
@@ -299,6 +328,10 @@ static const struct config_info user_conf_default =
   AUDIO_SAMPLE_RATE,            // audio_sample_rate
   AUDIO_BUFFER_SAMPLES,         // audio_buffer_samples
   AUDIO_OUTPUT_CHANNELS,        // audio_output_channels
+  false,                        // audio_offline
+  "",                           // audio_offline_file
+  false,                        // audio_stats
+  false,                        // audio_float_mix
   0,                            // oversampling_on
   RESAMPLE_MODE_DEFAULT,        // resample_mode
   MOD_RESAMPLE_MODE_DEFAULT,    // module_resample_mode
@@ -335,6 +368,13 @@ static const struct config_info user_conf_default =
   SAVE_SLOTS_DEFAULT,           // save_slots
   "%w.",                        // save_slots_name
   ".sav",                       // save_slots_ext
+  WORLD_LOAD_THREADS_DEFAULT,   // world_load_threads
+  WORLD_SAVE_THREADS_DEFAULT,   // world_save_threads
+  WORLD_LAZY_LOAD_DEFAULT,      // world_lazy_load
+  WORLD_PREFETCH_MEMORY_DEFAULT, // world_prefetch_memory
+  WORLD_INCREMENTAL_SAVE_DEFAULT, // world_incremental_save
+  WORLD_SNAPSHOTS_DEFAULT,      // world_snapshots
+  MZM_CACHE_MEMORY_DEFAULT,     // mzm_cache_memory
 
   // Editor options
   false,                        // test_mode
@@ -679,6 +719,30 @@ static void config_set_audio_channels(struct config_info *conf, char *name,
     conf->audio_output_channels = result;
 }
 
+static void config_set_audio_offline(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  config_boolean(&conf->audio_offline, value);
+}
+
+static void config_set_audio_offline_file(struct config_info *conf,
+ char *name, char *value, char *extended_data)
+{
+  config_string(conf->audio_offline_file, value);
+}
+
+static void config_set_audio_stats(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  config_boolean(&conf->audio_stats, value);
+}
+
+static void config_set_audio_float_mix(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  config_boolean(&conf->audio_float_mix, value);
+}
+
 static void config_set_resolution(struct config_info *conf, char *name,
  char *value, char *extended_data)
 {
@@ -832,6 +896,62 @@ static void config_save_slots_ext(struct config_info *conf, char *name,
   config_string(conf->save_slots_ext, value);
 }
 
+static void config_world_load_threads(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  int result;
+  if(config_int(&result, value, 0, MAX_WORLD_LOAD_THREADS))
+    conf->world_load_threads = result;
+}
+
+static void config_world_save_threads(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  int result;
+  if(config_int(&result, value, 0, MAX_WORLD_SAVE_THREADS))
+    conf->world_save_threads = result;
+}
+
+static void config_world_lazy_load(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  boolean result;
+  if(config_boolean(&result, value))
+    conf->world_lazy_load = result;
+}
+
+static void config_world_prefetch_memory(struct config_info *conf,
+ char *name, char *value, char *extended_data)
+{
+  long long result;
+  if(config_long_long(&result, value, 0, LLONG_MAX))
+    conf->world_prefetch_memory = result;
+}
+
+static void config_world_incremental_save(struct config_info *conf,
+ char *name, char *value, char *extended_data)
+{
+  boolean result;
+  if(config_boolean(&result, value))
+    conf->world_incremental_save = result;
+}
+
+static void config_world_snapshots(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  int result;
+  if(config_int(&result, value, 0, MAX_WORLD_SNAPSHOTS))
+    conf->world_snapshots = result;
+}
+
+static void config_mzm_cache_memory(struct config_info *conf, char *name,
+ char *value, char *extended_data)
+{
+  long long result;
+  if(config_long_long(&result, value, 0, LLONG_MAX))
+    conf->mzm_cache_memory = result;
+}
+
 static void config_enable_oversampling(struct config_info *conf, char *name,
  char *value, char *extended_data)
 {
@@ -1257,8 +1377,12 @@ static const struct config_entry config_options[] =
   { "allow_screenshots", config_set_allow_screenshots, false },
   { "audio_buffer", config_set_audio_buffer, false },
   { "audio_buffer_samples", config_set_audio_buffer, false },
+  { "audio_float_mix", config_set_audio_float_mix, false },
+  { "audio_offline", config_set_audio_offline, false },
+  { "audio_offline_file", config_set_audio_offline_file, false },
   { "audio_output_channels", config_set_audio_channels, false },
   { "audio_sample_rate", config_set_audio_freq, false },
+  { "audio_stats", config_set_audio_stats, false },
   { "auto_decrypt_worlds", config_set_auto_decrypt_worlds, false },
   { "dialog_cursor_hints", config_set_dialog_cursor_hints, false },
   { "disable_screensaver", config_disable_screensaver, false },
@@ -1298,6 +1422,7 @@ static const struct config_entry config_options[] =
   { "module_resample_mode", config_mod_resample_mode, false },
   { "music_on", config_set_music, false },
   { "music_volume", config_set_mod_volume, false },
+  { "mzm_cache_memory", config_mzm_cache_memory, false },
   { "mzx_speed", config_set_mzx_speed, true },
 #ifdef CONFIG_NETWORK
   { "network_address_family", config_set_network_address_family, false },
@@ -1340,7 +1465,13 @@ static const struct config_entry config_options[] =
   { "vfs_max_cache_size", config_set_vfs_max_cache_size, false },
   { "video_output", config_set_video_output, false },
   { "video_ratio", config_set_video_ratio, false },
-  { "window_resolution", config_window_resolution, false }
+  { "window_resolution", config_window_resolution, false },
+  { "world_incremental_save", config_world_incremental_save, false },
+  { "world_lazy_load", config_world_lazy_load, false },
+  { "world_load_threads", config_world_load_threads, false },
+  { "world_prefetch_memory", config_world_prefetch_memory, false },
+  { "world_save_threads", config_world_save_threads, false },
+  { "world_snapshots", config_world_snapshots, false }
 };
 
 static const struct config_entry *find_option(char *name,
@@ -34,6 +34,9 @@ enum config_type
   NUM_CONFIG_TYPES
 };
 
+#define MAX_WORLD_LOAD_THREADS 16
+#define MAX_WORLD_SNAPSHOTS 64
+
 enum force_bpp_special
 {
   BPP_AUTO = 0
@@ -139,6 +142,10 @@ struct config_info
   int audio_sample_rate;
   int audio_buffer_samples;
   int audio_output_channels;
+  boolean audio_offline;
+  char audio_offline_file[256];
+  boolean audio_stats;
+  boolean audio_float_mix;
   boolean oversampling_on;
   enum resample_mode resample_mode;
   enum resample_mode module_resample_mode;
@@ -175,6 +182,13 @@ struct config_info
   boolean save_slots;
   char save_slots_name[256];
   char save_slots_ext[256];
+  int world_load_threads;
+  int world_save_threads;
+  boolean world_lazy_load;
+  int64_t world_prefetch_memory;
+  boolean world_incremental_save;
+  int world_snapshots;
+  int64_t mzm_cache_memory;
 
   // Editor options
   boolean test_mode;
@@ -29,6 +29,7 @@
 #include <limits.h>
 #include <time.h>
 
+#include "arena.h"
 #include "board.h"
 #include "configure.h"
 #include "counter.h"
@@ -60,9 +61,16 @@
  * all counter names.
  */
 
-#ifdef CONFIG_COUNTER_HASH_TABLES
+#if defined(CONFIG_COUNTER_SWISS_TABLES)
+#include "swisstable.h"
+SWISS_SET_INIT(COUNTER, struct counter *, name, name_length)
+SWISS_SET_INIT(COUNTER_FAMILY, struct counter_family *, name, name_length)
+SWISS_SET_INIT(COUNTER_ARRAY, struct counter_array *, name, name_length)
+#elif defined(CONFIG_COUNTER_HASH_TABLES)
 #include "hashtable.h"
 HASH_SET_INIT(COUNTER, struct counter *, name, name_length)
+HASH_SET_INIT(COUNTER_FAMILY, struct counter_family *, name, name_length)
+HASH_SET_INIT(COUNTER_ARRAY, struct counter_array *, name, name_length)
 #endif
 
 #ifndef M_PI
@@ -3009,7 +3017,8 @@ int set_counter_special(struct world *mzx_world, char *char_value,
         else
 
         if(err == -FSAFE_SUCCESS)
-          mzx_world->input_file = vfopen_unsafe(translated_path, "rb");
+          mzx_world->input_file = vfopen_unsafe_ext(translated_path, "rb",
+           V_LARGE_BUFFER);
 
         if(mzx_world->input_file || mzx_world->input_is_dir)
           strcpy(mzx_world->input_file_name, translated_path);
@@ -3025,7 +3034,8 @@ int set_counter_special(struct world *mzx_world, char *char_value,
 
       if(char_value[0])
       {
-        mzx_world->output_file = fsafeopen(char_value, "wb");
+        mzx_world->output_file = fsafeopen_ext(char_value, "wb",
+         V_LARGE_BUFFER);
         if(mzx_world->output_file)
         {
           strcpy(mzx_world->output_file_name, char_value);
@@ -3041,7 +3051,8 @@ int set_counter_special(struct world *mzx_world, char *char_value,
 
       if(char_value[0])
       {
-        mzx_world->output_file = fsafeopen(char_value, "ab");
+        mzx_world->output_file = fsafeopen_ext(char_value, "ab",
+         V_LARGE_BUFFER);
         if(mzx_world->output_file)
         {
           strcpy(mzx_world->output_file_name, char_value);
@@ -3057,7 +3068,8 @@ int set_counter_special(struct world *mzx_world, char *char_value,
 
       if(char_value[0])
       {
-        mzx_world->output_file = fsafeopen(char_value, "r+b");
+        mzx_world->output_file = fsafeopen_ext(char_value, "r+b",
+         V_LARGE_BUFFER);
         if(mzx_world->output_file)
         {
           strcpy(mzx_world->output_file_name, char_value);
@@ -3568,6 +3580,524 @@ static struct counter *find_counter(struct counter_list *counter_list,
 #endif
 }
 
+#ifdef CONFIG_COUNTER_HASH_TABLES
+
+// Highest number a counter name can end with and still be in a family.
+#define COUNTER_FAMILY_MAX_INDEX  65535
+#define COUNTER_FAMILY_MAX_DIGITS 5
+#define COUNTER_FAMILY_MIN_SIZE   32
+// Families can always grow to this size. Past it, a family only grows if at
+// least 1/COUNTER_FAMILY_DENSITY of the new size would be in use.
+#define COUNTER_FAMILY_FREE_SIZE  256
+#define COUNTER_FAMILY_DENSITY    4
+#define MIN_FAMILY_ALLOCATE       8
+
+/**
+ * Split a counter name into a family prefix and a member number. The name
+ * must end in a number without leading zeroes, so every member of a family
+ * has exactly one name. Returns the prefix length or 0 if the name can't be
+ * stored in a family.
+ */
+static size_t get_counter_family_index(const char *name, size_t name_length,
+ unsigned int *index)
+{
+  size_t pos = name_length;
+  unsigned int value = 0;
+  unsigned int mult = 1;
+
+  while(pos > 0 && name[pos - 1] >= '0' && name[pos - 1] <= '9')
+  {
+    if(name_length - pos >= COUNTER_FAMILY_MAX_DIGITS)
+      return 0;
+
+    pos--;
+    value += (name[pos] - '0') * mult;
+    mult *= 10;
+  }
+
+  if(pos == 0 || pos == name_length || name_length >= ROBOT_MAX_TR ||
+   value > COUNTER_FAMILY_MAX_INDEX)
+    return 0;
+
+  // No leading zeroes (but "0" by itself is fine).
+  if(name[pos] == '0' && name_length - pos > 1)
+    return 0;
+
+  *index = value;
+  return pos;
+}
+
+static boolean family_has_member(struct counter_family *family,
+ unsigned int index)
+{
+  return index < family->size &&
+   (family->present[index / 32] & (1u << (index % 32)));
+}
+
+/**
+ * Find the value of a counter stored in a family. If the counter is found,
+ * its family is also stored to family (if provided).
+ */
+static int32_t *find_family_counter(struct counter_list *counter_list,
+ const char *name, size_t name_length, struct counter_family **family)
+{
+  struct counter_family *current;
+  size_t prefix_length;
+  unsigned int index;
+
+  if(!counter_list->family_table)
+    return NULL;
+
+  prefix_length = get_counter_family_index(name, name_length, &index);
+  if(!prefix_length)
+    return NULL;
+
+  HASH_FIND(COUNTER_FAMILY, counter_list->family_table, name, prefix_length,
+   current);
+
+  if(!current || !family_has_member(current, index))
+    return NULL;
+
+  if(family)
+    *family = current;
+
+  return &(current->values[index]);
+}
+
+/**
+ * Get the size a family needs to be to contain a given member, or 0 if the
+ * family would be too sparse to be worth storing this way.
+ */
+static uint32_t get_counter_family_size(uint32_t size, uint32_t count,
+ unsigned int index)
+{
+  uint32_t new_size = MAX(size, COUNTER_FAMILY_MIN_SIZE);
+
+  if(index < size)
+    return size;
+
+  while(new_size <= index)
+    new_size *= 2;
+
+  if(new_size > COUNTER_FAMILY_FREE_SIZE &&
+   new_size / COUNTER_FAMILY_DENSITY > count + 1)
+    return 0;
+
+  return new_size;
+}
+
+static boolean resize_counter_family(struct counter_family *family,
+ uint32_t size)
+{
+  int32_t *values;
+  uint32_t *present;
+
+  values = (int32_t *)crealloc(family->values, size * sizeof(int32_t));
+  if(!values)
+    return false;
+  family->values = values;
+
+  present = (uint32_t *)crealloc(family->present, size / 8);
+  if(!present)
+    return false;
+  family->present = present;
+
+  memset(family->present + family->size / 32, 0,
+   (size - family->size) / 8);
+  family->size = size;
+  return true;
+}
+
+static struct counter_family *new_counter_family(
+ struct counter_list *counter_list, const char *name, size_t prefix_length)
+{
+  struct counter_family *family;
+  unsigned int count = counter_list->num_families;
+  unsigned int allocated = counter_list->num_families_allocated;
+
+  if(count == allocated)
+  {
+    struct counter_family **families;
+
+    allocated = allocated ? allocated * 2 : MIN_FAMILY_ALLOCATE;
+    families = (struct counter_family **)crealloc(counter_list->families,
+     allocated * sizeof(struct counter_family *));
+    if(!families)
+      return NULL;
+
+    counter_list->families = families;
+    counter_list->num_families_allocated = allocated;
+  }
+
+  family = (struct counter_family *)cmalloc(MAX(sizeof(struct counter_family),
+   offsetof(struct counter_family, name) + prefix_length + 1));
+  if(!family)
+    return NULL;
+
+  memcpy(family->name, name, prefix_length);
+  family->name[prefix_length] = 0;
+  family->name_length = prefix_length;
+  family->values = NULL;
+  family->present = NULL;
+  family->size = 0;
+  family->count = 0;
+
+  counter_list->families[count] = family;
+  counter_list->num_families = count + 1;
+  HASH_ADD(COUNTER_FAMILY, counter_list->family_table, family);
+  return family;
+}
+
+static void free_counter_family(struct counter_family *family)
+{
+  free(family->values);
+  free(family->present);
+  free(family);
+}
+
+/**
+ * Try to add a new counter to a family (creating the family if needed).
+ * Returns false if the counter should be added to the counter list instead.
+ */
+static boolean add_family_counter(struct counter_list *counter_list,
+ const char *name, size_t name_length, int value)
+{
+  struct counter_family *family = NULL;
+  size_t prefix_length;
+  unsigned int index;
+  uint32_t size;
+
+  prefix_length = get_counter_family_index(name, name_length, &index);
+  if(!prefix_length)
+    return false;
+
+  HASH_FIND(COUNTER_FAMILY, counter_list->family_table, name, prefix_length,
+   family);
+
+  // Members are saved with the family's prefix, so a counter can only join a
+  // family if its prefix has the same case. Lookups still ignore case.
+  if(family && memcmp(family->name, name, prefix_length))
+    return false;
+
+  // Check the size first so a new family isn't allocated for nothing.
+  if(family)
+    size = get_counter_family_size(family->size, family->count, index);
+  else
+    size = get_counter_family_size(0, 0, index);
+
+  if(!size)
+    return false;
+
+  if(!family)
+  {
+    family = new_counter_family(counter_list, name, prefix_length);
+    if(!family)
+      return false;
+  }
+
+  if(size > family->size && !resize_counter_family(family, size))
+    return false;
+
+  family->values[index] = value;
+  if(!family_has_member(family, index))
+  {
+    family->present[index / 32] |= 1u << (index % 32);
+    family->count++;
+    counter_list->num_family_counters++;
+  }
+  return true;
+}
+
+#endif /* CONFIG_COUNTER_HASH_TABLES */
+
+/**
+ * Find the storage for a counter's value. If this is a counter in the counter
+ * list, the counter is also stored to cdest so its gateway can be used;
+ * otherwise, it's stored in a family (which never has a gateway).
+ */
+static int32_t *find_counter_value(struct counter_list *counter_list,
+ const char *name, int *next, struct counter **cdest)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  int32_t *value = find_family_counter(counter_list, name, strlen(name), NULL);
+  if(value)
+  {
+    *cdest = NULL;
+    return value;
+  }
+#endif
+
+  *cdest = find_counter(counter_list, name, next);
+  return *cdest ? &((*cdest)->value) : NULL;
+}
+
+// Counter arrays can use up to 64MB each.
+#define MAX_COUNTER_ARRAY_SIZE (1 << 24)
+#define MIN_ARRAY_ALLOCATE 8
+
+/**
+ * A counter name referring to a counter array: either "name[]", which is the
+ * size of the array, or "name[index]", which is an element of the array.
+ */
+struct counter_array_ref
+{
+  struct counter_array *array;
+  const char *name;
+  size_t name_length;
+  boolean is_size;
+  // Element index, or -1 if the index is invalid or out of bounds.
+  int index;
+};
+
+static struct counter_array *find_counter_array(
+ struct counter_list *counter_list, const char *name, size_t name_length)
+{
+  struct counter_array *array;
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  HASH_FIND(COUNTER_ARRAY, counter_list->array_table, name, name_length,
+   array);
+  return array;
+
+#else
+  unsigned int i;
+
+  // Games shouldn't need many arrays, so a linear search is fine here.
+  for(i = 0; i < counter_list->num_arrays; i++)
+  {
+    array = counter_list->arrays[i];
+    if(array->name_length == name_length &&
+     !memcasecmp(array->name, name, name_length))
+      return array;
+  }
+  return NULL;
+#endif
+}
+
+static struct counter_array *new_counter_array(
+ struct counter_list *counter_list, const char *name, size_t name_length)
+{
+  struct counter_array *array;
+  unsigned int count = counter_list->num_arrays;
+  unsigned int allocated = counter_list->num_arrays_allocated;
+
+  if(count == allocated)
+  {
+    struct counter_array **arrays;
+
+    allocated = allocated ? allocated * 2 : MIN_ARRAY_ALLOCATE;
+    arrays = (struct counter_array **)crealloc(counter_list->arrays,
+     allocated * sizeof(struct counter_array *));
+    if(!arrays)
+      return NULL;
+
+    counter_list->arrays = arrays;
+    counter_list->num_arrays_allocated = allocated;
+  }
+
+  array = (struct counter_array *)cmalloc(MAX(sizeof(struct counter_array),
+   offsetof(struct counter_array, name) + name_length + 1));
+  if(!array)
+    return NULL;
+
+  memcpy(array->name, name, name_length);
+  array->name[name_length] = 0;
+  array->name_length = name_length;
+  array->values = NULL;
+  array->size = 0;
+
+  counter_list->arrays[count] = array;
+  counter_list->num_arrays = count + 1;
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  HASH_ADD(COUNTER_ARRAY, counter_list->array_table, array);
+#endif
+  return array;
+}
+
+static void delete_counter_array(struct counter_list *counter_list,
+ struct counter_array *array)
+{
+  unsigned int i;
+
+  for(i = 0; i < counter_list->num_arrays; i++)
+  {
+    if(counter_list->arrays[i] == array)
+    {
+      counter_list->arrays[i] =
+       counter_list->arrays[--counter_list->num_arrays];
+      break;
+    }
+  }
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  HASH_DELETE(COUNTER_ARRAY, counter_list->array_table, array);
+#endif
+  free(array->values);
+  free(array);
+}
+
+/**
+ * Declare or resize a counter array. New elements are set to 0. If the new
+ * size is 0 or less, the array is deleted. Returns the array or NULL.
+ */
+static struct counter_array *resize_counter_array(
+ struct counter_list *counter_list, struct counter_array *array,
+ const char *name, size_t name_length, int size)
+{
+  int32_t *values;
+
+  if(size <= 0)
+  {
+    if(array)
+      delete_counter_array(counter_list, array);
+    return NULL;
+  }
+
+  if(size > MAX_COUNTER_ARRAY_SIZE)
+    size = MAX_COUNTER_ARRAY_SIZE;
+
+  if(!array)
+  {
+    array = new_counter_array(counter_list, name, name_length);
+    if(!array)
+      return NULL;
+  }
+
+  values = (int32_t *)crealloc(array->values, size * sizeof(int32_t));
+  if(!values)
+    return array;
+
+  if((uint32_t)size > array->size)
+    memset(values + array->size, 0, (size - array->size) * sizeof(int32_t));
+
+  array->values = values;
+  array->size = size;
+  return array;
+}
+
+/**
+ * Check if a counter name refers to a counter array. "name[]" always does,
+ * since setting it declares the array; "name[index]" only does if the array
+ * exists. Otherwise, these are normal counter names, as they are in worlds
+ * older than 2.94.
+ */
+static boolean find_counter_array_ref(struct world *mzx_world,
+ const char *name, struct counter_array_ref *ref)
+{
+  size_t length;
+  size_t open;
+  char *end;
+  long index;
+
+  if(mzx_world->version < V294)
+    return false;
+
+  length = strlen(name);
+  if(length < 3 || name[length - 1] != ']')
+    return false;
+
+  open = length - 2;
+  while(open > 0 && name[open] != '[')
+    open--;
+
+  // Array names can't be empty.
+  if(open == 0)
+    return false;
+
+  ref->array = find_counter_array(&(mzx_world->counter_list), name, open);
+  ref->name = name;
+  ref->name_length = open;
+  ref->is_size = (open + 2 == length);
+  ref->index = -1;
+
+  if(ref->is_size)
+    return true;
+
+  if(!ref->array)
+    return false;
+
+  // The index must be a plain decimal number (strtol would also allow leading
+  // whitespace and signs).
+  if(!isdigit((unsigned char)name[open + 1]))
+    return true;
+
+  index = strtol(name + open + 1, &end, 10);
+  if(end == name + length - 1 && index >= 0 && index < (long)ref->array->size)
+    ref->index = index;
+
+  return true;
+}
+
+static int read_counter_array_ref(struct counter_array_ref *ref)
+{
+  if(ref->is_size)
+    return ref->array ? (int)ref->array->size : 0;
+
+  if(ref->index >= 0)
+    return ref->array->values[ref->index];
+
+  return 0;
+}
+
+static void write_counter_array_ref(struct counter_list *counter_list,
+ struct counter_array_ref *ref, int value)
+{
+  if(ref->is_size)
+  {
+    resize_counter_array(counter_list, ref->array, ref->name, ref->name_length,
+     value);
+  }
+  else
+
+  if(ref->index >= 0)
+    ref->array->values[ref->index] = value;
+}
+
+/**
+ * Get an element of a counter array directly (i.e. without building a
+ * "name[index]" counter name). Returns false if the array doesn't exist.
+ * Indices outside of the array read as 0.
+ */
+boolean get_counter_array_element(struct world *mzx_world, const char *name,
+ size_t name_length, int index, int *value)
+{
+  struct counter_array *array;
+
+  if(mzx_world->version < V294)
+    return false;
+
+  array = find_counter_array(&(mzx_world->counter_list), name, name_length);
+  if(!array)
+    return false;
+
+  if(index >= 0 && (uint32_t)index < array->size)
+    *value = array->values[index];
+  else
+    *value = 0;
+
+  return true;
+}
+
+/**
+ * Declare a counter array of a given size while loading a save file and get
+ * its values to be filled in. Any existing array with this name is resized.
+ */
+int32_t *load_counter_array(struct counter_list *counter_list,
+ const char *name, size_t name_length, size_t size)
+{
+  struct counter_array *array;
+
+  if(!size || size > MAX_COUNTER_ARRAY_SIZE)
+    return NULL;
+
+  array = find_counter_array(counter_list, name, name_length);
+  array = resize_counter_array(counter_list, array, name, name_length, size);
+  if(!array || array->size != size)
+    return NULL;
+
+  return array->values;
+}
+
 static int hurt_player(struct world *mzx_world, int value)
 {
   // Must not be invincible
@@ -3750,10 +4280,11 @@ static size_t get_counter_alloc_size(int name_length)
    offsetof(struct counter, name) + name_length + 1);
 }
 
-static struct counter *allocate_new_counter(const char *name, size_t name_length,
- int value)
+static struct counter *allocate_new_counter(struct counter_list *counter_list,
+ const char *name, size_t name_length, int value)
 {
-  struct counter *dest = (struct counter *)cmalloc(get_counter_alloc_size(name_length));
+  struct counter *dest = (struct counter *)arena_alloc(&(counter_list->arena),
+   get_counter_alloc_size(name_length));
   if(!dest)
     return NULL;
 
@@ -3761,19 +4292,18 @@ static struct counter *allocate_new_counter(const char *name, size_t name_length
   dest->name[name_length] = 0;
 
   dest->gateway_write = NO_GATEWAY;
+  dest->from_family = false;
   dest->name_length = name_length;
   dest->value = value;
   return dest;
 }
 
-static void add_counter(struct counter_list *counter_list, const char *name,
- int value, unsigned int position)
+static boolean insert_counter(struct counter_list *counter_list,
+ struct counter *dest, unsigned int position)
 {
   unsigned int count = counter_list->num_counters;
   unsigned int allocated = counter_list->num_counters_allocated;
   struct counter **base = counter_list->counters;
-  struct counter *dest;
-  unsigned int name_length = strlen(name);
 
   // Need a reallocation?
   if(count == allocated)
@@ -3782,7 +4312,7 @@ static void add_counter(struct counter_list *counter_list, const char *name,
     {
       // Gracefully fail if this tries to go over 2b...
       if(allocated >= (size_t)(INT32_MAX))
-        return;
+        return false;
 
       allocated *= 2;
     }
@@ -3791,7 +4321,7 @@ static void add_counter(struct counter_list *counter_list, const char *name,
 
     base = (struct counter **)crealloc(base, sizeof(struct counter *) * allocated);
     if(!base)
-      return;
+      return false;
 
     counter_list->counters = base;
     counter_list->num_counters_allocated = allocated;
@@ -3806,15 +4336,136 @@ static void add_counter(struct counter_list *counter_list, const char *name,
      (count - position) * sizeof(struct counter *));
   }
 
-  dest = allocate_new_counter(name, name_length, value);
-  if(!dest)
-    return;
-
   counter_list->counters[position] = dest;
   counter_list->num_counters = count + 1;
 
+#ifndef CONFIG_COUNTER_HASH_TABLES
+  // Without the hash table new counters are inserted in order. Otherwise,
+  // they're appended and sort_counter_list will sort them later.
+  counter_list->num_counters_sorted = count + 1;
+#endif
+
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_ADD(COUNTER, counter_list->hash_table, dest);
+#endif
+  return true;
+}
+
+static void add_counter(struct counter_list *counter_list, const char *name,
+ int value, unsigned int position)
+{
+  size_t name_length = strlen(name);
+  struct counter *dest;
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  if(add_family_counter(counter_list, name, name_length, value))
+    return;
+#endif
+
+  dest = allocate_new_counter(counter_list, name, name_length, value);
+  if(dest)
+    insert_counter(counter_list, dest, position);
+}
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+
+/**
+ * Move the members of a family into the counter list as normal counters and
+ * destroy the family. These counters are allocated from the arena pool so
+ * collapse_counter_families can free them when it moves them back.
+ */
+static void dissolve_counter_family(struct counter_list *counter_list,
+ struct counter_family *family)
+{
+  char name_buffer[ROBOT_MAX_TR];
+  struct counter *dest;
+  size_t name_length;
+  unsigned int i;
+
+  for(i = 0; i < family->size; i++)
+  {
+    if(family_has_member(family, i))
+    {
+      name_length = snprintf(name_buffer, sizeof(name_buffer), "%s%u",
+       family->name, i);
+
+      dest = (struct counter *)arena_pool_alloc(&(counter_list->arena),
+       get_counter_alloc_size(name_length));
+      if(!dest)
+        continue;
+
+      memcpy(dest->name, name_buffer, name_length + 1);
+      dest->gateway_write = NO_GATEWAY;
+      dest->from_family = true;
+      dest->name_length = name_length;
+      dest->value = family->values[i];
+
+      if(!insert_counter(counter_list, dest, counter_list->num_counters))
+        arena_pool_free(&(counter_list->arena), dest,
+         get_counter_alloc_size(name_length));
+    }
+  }
+
+  counter_list->num_family_counters -= family->count;
+  HASH_DELETE(COUNTER_FAMILY, counter_list->family_table, family);
+  free_counter_family(family);
+}
+
+#endif /* CONFIG_COUNTER_HASH_TABLES */
+
+/**
+ * Convert every counter stored in a family into a normal counter so the
+ * entire counter list can be used directly (e.g. by the debugger). Call
+ * collapse_counter_families afterward to put them back in their families;
+ * any pointers to these counters are invalid after that.
+ */
+void expand_counter_families(struct counter_list *counter_list)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  unsigned int i;
+
+  for(i = 0; i < counter_list->num_families; i++)
+    dissolve_counter_family(counter_list, counter_list->families[i]);
+
+  counter_list->num_families = 0;
+#endif
+}
+
+/**
+ * Move the counters expand_counter_families took out of their families back
+ * into families. Other counters in the counter list are left alone, since
+ * get_counter_pointer may have returned pointers to them.
+ */
+void collapse_counter_families(struct counter_list *counter_list)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  unsigned int num_sorted = 0;
+  unsigned int count = 0;
+  unsigned int i;
+
+  for(i = 0; i < counter_list->num_counters; i++)
+  {
+    struct counter *src = counter_list->counters[i];
+
+    if(src->from_family &&
+     add_family_counter(counter_list, src->name, src->name_length, src->value))
+    {
+      HASH_DELETE(COUNTER, counter_list->hash_table, src);
+      arena_pool_free(&(counter_list->arena), src,
+       get_counter_alloc_size(src->name_length));
+      continue;
+    }
+
+    // Removing counters doesn't change the order of the rest of the list.
+    if(i < counter_list->num_counters_sorted)
+      num_sorted++;
+
+    src->from_family = false;
+    counter_list->counters[count++] = src;
+  }
+
+  counter_list->num_counters = count;
+  counter_list->num_counters_sorted = num_sorted;
 #endif
 }
 
@@ -3822,9 +4473,17 @@ void set_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int next = 0;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref, value);
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && (mzx_world->version >= fdest->minimum_version))
@@ -3840,18 +4499,18 @@ void set_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
+    if(vdest)
     {
       // See if there's a gateway
-      if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+      if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
       {
         gateway_write_function gateway_write = gateways[cdest->gateway_write];
         value = gateway_write(mzx_world, cdest, name, value, id, false);
       }
 
-      cdest->value = value;
+      *vdest = value;
     }
     else
     {
@@ -3866,20 +4525,21 @@ void new_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   struct counter *cdest;
+  int32_t *vdest;
   int next;
 
-  cdest = find_counter(counter_list, name, &next);
+  vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-  if(cdest)
+  if(vdest)
   {
     // See if there's a gateway
-    if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+    if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
     {
       gateway_write_function gateway_write = gateways[cdest->gateway_write];
       value = gateway_write(mzx_world, cdest, name, value, id, false);
     }
 
-    cdest->value = value;
+    *vdest = value;
   }
 
   else
@@ -3892,9 +4552,16 @@ int get_counter(struct world *mzx_world, const char *name, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int next;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    return read_counter_array_ref(&ref);
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read &&
@@ -3907,10 +4574,10 @@ int get_counter(struct world *mzx_world, const char *name, int id)
       return 0;
   }
 
-  cdest = find_counter(counter_list, name, &next);
+  vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-  if(cdest)
-    return cdest->value;
+  if(vdest)
+    return *vdest;
 
   return 0;
 }
@@ -3920,6 +4587,7 @@ int get_counter(struct world *mzx_world, const char *name, int id)
  * work with function counters or other special counters; use get_string or
  * get_string_safe (editor) instead. The pointer this function returns is
  * guaranteed to be stable for the duration of the gameplay session.
+ * Counters stored in families don't have a pointer; use get_counter instead.
  *
  * @param mzx_world   World data.
  * @param name        Name of counter to look up.
@@ -3932,6 +4600,12 @@ const struct counter *get_counter_pointer(struct world *mzx_world,
   struct counter_list *counter_list = &(mzx_world->counter_list);
   int next;
 
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  // Counters stored in families don't have a counter struct.
+  if(find_family_counter(counter_list, name, strlen(name), NULL))
+    return NULL;
+#endif
+
   return find_counter(counter_list, name, &next);
 }
 
@@ -3939,10 +4613,19 @@ void inc_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int current_value;
   int next = 0;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref,
+     read_counter_array_ref(&ref) + value);
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read && fdest->function_write &&
@@ -3955,19 +4638,19 @@ void inc_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
+    if(vdest)
     {
-      value += cdest->value;
+      value += *vdest;
 
-      if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+      if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
       {
         gateway_write_function gateway_write = gateways[cdest->gateway_write];
         value = gateway_write(mzx_world, cdest, name, value, id, false);
       }
 
-      cdest->value = value;
+      *vdest = value;
     }
     else
     {
@@ -3980,10 +4663,19 @@ void dec_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int current_value;
   int next = 0;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref,
+     read_counter_array_ref(&ref) - value);
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read && fdest->function_write &&
@@ -3996,19 +4688,19 @@ void dec_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
+    if(vdest)
     {
-      value = cdest->value - value;
+      value = *vdest - value;
 
-      if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+      if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
       {
         gateway_write_function gateway_write = gateways[cdest->gateway_write];
         value = gateway_write(mzx_world, cdest, name, value, id, true);
       }
 
-      cdest->value = value;
+      *vdest = value;
     }
     else
     {
@@ -4021,10 +4713,19 @@ void mul_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int current_value;
   int next;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref,
+     read_counter_array_ref(&ref) * value);
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read && fdest->function_write &&
@@ -4037,18 +4738,18 @@ void mul_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
+    if(vdest)
     {
-      value *= cdest->value;
-      if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+      value *= *vdest;
+      if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
       {
         gateway_write_function gateway_write = gateways[cdest->gateway_write];
         value = gateway_write(mzx_world, cdest, name, value, id, false);
       }
 
-      cdest->value = value;
+      *vdest = value;
     }
   }
 }
@@ -4057,13 +4758,22 @@ void div_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int current_value;
   int next;
 
   if(value == 0)
     return;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref,
+     safe_divide_32(read_counter_array_ref(&ref), value));
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read && fdest->function_write &&
@@ -4076,19 +4786,19 @@ void div_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
+    if(vdest)
     {
-      value = safe_divide_32(cdest->value, value);
+      value = safe_divide_32(*vdest, value);
 
-      if(cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
+      if(cdest && cdest->gateway_write && cdest->gateway_write < NUM_GATEWAYS)
       {
         gateway_write_function gateway_write = gateways[cdest->gateway_write];
         value = gateway_write(mzx_world, cdest, name, value, id, false);
       }
 
-      cdest->value = value;
+      *vdest = value;
     }
   }
 }
@@ -4097,13 +4807,22 @@ void mod_counter(struct world *mzx_world, const char *name, int value, int id)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   const struct function_counter *fdest;
+  struct counter_array_ref ref;
   struct counter *cdest;
+  int32_t *vdest;
   int current_value;
   int next;
 
   if(value == 0)
     return;
 
+  if(find_counter_array_ref(mzx_world, name, &ref))
+  {
+    write_counter_array_ref(counter_list, &ref,
+     safe_modulo_32(read_counter_array_ref(&ref), value));
+    return;
+  }
+
   fdest = find_function_counter(name);
 
   if(fdest && fdest->function_read && fdest->function_write &&
@@ -4117,26 +4836,108 @@ void mod_counter(struct world *mzx_world, const char *name, int value, int id)
   }
   else
   {
-    cdest = find_counter(counter_list, name, &next);
+    vdest = find_counter_value(counter_list, name, &next, &cdest);
 
-    if(cdest)
-      cdest->value = safe_modulo_32(cdest->value, value);
+    if(vdest)
+      *vdest = safe_modulo_32(*vdest, value);
   }
 }
 
+// Make room for a number of counters about to be added by load_new_counter.
+void load_counter_list_reserve(struct counter_list *counter_list,
+ size_t count)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  HASH_RESERVE(COUNTER, counter_list->hash_table, count);
+#endif
+}
+
 // Create a new counter from loading a save file. This skips find_counter.
-void load_new_counter(struct counter_list *counter_list, int index,
+// The counter is added to the end of the counter list, which must already
+// have enough space allocated, unless it can be stored in a family.
+void load_new_counter(struct counter_list *counter_list,
  const char *name, int name_length, int value)
 {
-  struct counter *dest = allocate_new_counter(name, name_length, value);
+  unsigned int index = counter_list->num_counters;
+  struct counter *dest;
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  if(add_family_counter(counter_list, name, name_length, value))
+    return;
+#endif
+
+  dest = allocate_new_counter(counter_list, name, name_length, value);
+  if(!dest)
+    return;
 
   counter_list->counters[index] = dest;
+  counter_list->num_counters = index + 1;
+  if(index < counter_list->num_counters_sorted)
+    counter_list->num_counters_sorted = index;
 
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_ADD(COUNTER, counter_list->hash_table, dest);
 #endif
 }
 
+/**
+ * Get the total number of counters, including counters stored in families.
+ */
+size_t get_total_counters(struct counter_list *counter_list)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  return counter_list->num_counters + counter_list->num_family_counters;
+#else
+  return counter_list->num_counters;
+#endif
+}
+
+/**
+ * Get the next counter in the counter list. The members of each family are
+ * returned first, followed by the counters in the counter list in list order.
+ * Loading counters in this order puts every family member back in a family
+ * even if a counter in the list would have blocked it (e.g. a counter with
+ * the same prefix in a different case). Returns false when there are no
+ * more counters.
+ */
+boolean next_counter(struct counter_list *counter_list,
+ struct counter_iter *iter)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  while(iter->family_pos < counter_list->num_families)
+  {
+    struct counter_family *family = counter_list->families[iter->family_pos];
+
+    while(iter->family_index < family->size)
+    {
+      unsigned int i = iter->family_index++;
+      if(family_has_member(family, i))
+      {
+        iter->name_length = snprintf(iter->name_buffer,
+         sizeof(iter->name_buffer), "%s%u", family->name, i);
+        iter->name = iter->name_buffer;
+        iter->value = family->values[i];
+        return true;
+      }
+    }
+
+    iter->family_pos++;
+    iter->family_index = 0;
+  }
+#endif
+
+  if(iter->pos < counter_list->num_counters)
+  {
+    struct counter *src = counter_list->counters[iter->pos++];
+    iter->name = src->name;
+    iter->name_length = src->name_length;
+    iter->value = src->value;
+    return true;
+  }
+
+  return false;
+}
+
 static int counter_sort_fcn(const void *a, const void *b)
 {
   return strcasecmp(
@@ -4144,28 +4945,103 @@ static int counter_sort_fcn(const void *a, const void *b)
    (*(const struct counter **)b)->name);
 }
 
+/**
+ * Sort the counter list by name. Only counters added since the last sort need
+ * to be sorted; they are merged into the rest of the list.
+ */
 void sort_counter_list(struct counter_list *counter_list)
 {
-  qsort(counter_list->counters, (size_t)counter_list->num_counters,
-   sizeof(struct counter *), counter_sort_fcn);
+  counter_list->num_counters_sorted = sort_list_tail(
+   (void **)counter_list->counters, counter_list->num_counters_sorted,
+   counter_list->num_counters, counter_sort_fcn);
+}
+
+/**
+ * Find the counters with names starting with a given prefix (ignoring case).
+ * The counter list will be sorted if necessary. Returns the number of matching
+ * counters; the first matching counter's position is stored in first.
+ */
+size_t find_counter_prefix(struct counter_list *counter_list,
+ const char *prefix, size_t *first)
+{
+  struct counter **counters;
+  size_t prefix_length = strlen(prefix);
+  size_t bottom = 0;
+  size_t top;
+  size_t start;
+
+  sort_counter_list(counter_list);
+  counters = counter_list->counters;
+
+  // Lower bound: the first counter that doesn't sort before the prefix.
+  top = counter_list->num_counters;
+  while(bottom < top)
+  {
+    size_t middle = bottom + (top - bottom) / 2;
+    if(strncasecmp(counters[middle]->name, prefix, prefix_length) < 0)
+      bottom = middle + 1;
+    else
+      top = middle;
+  }
+  start = bottom;
+
+  // Upper bound: the first counter that sorts after the prefix.
+  top = counter_list->num_counters;
+  while(bottom < top)
+  {
+    size_t middle = bottom + (top - bottom) / 2;
+    if(strncasecmp(counters[middle]->name, prefix, prefix_length) <= 0)
+      bottom = middle + 1;
+    else
+      top = middle;
+  }
+
+  *first = start;
+  return bottom - start;
 }
 
 void clear_counter_list(struct counter_list *counter_list)
 {
-  size_t i;
+  unsigned int i;
 
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_CLEAR(COUNTER, counter_list->hash_table);
   counter_list->hash_table = NULL;
+
+  HASH_CLEAR(COUNTER_FAMILY, counter_list->family_table);
+  counter_list->family_table = NULL;
+
+  for(i = 0; i < counter_list->num_families; i++)
+    free_counter_family(counter_list->families[i]);
+
+  free(counter_list->families);
+  counter_list->families = NULL;
+  counter_list->num_families = 0;
+  counter_list->num_families_allocated = 0;
+  counter_list->num_family_counters = 0;
+
+  HASH_CLEAR(COUNTER_ARRAY, counter_list->array_table);
+  counter_list->array_table = NULL;
 #endif
 
-  for(i = 0; i < counter_list->num_counters; i++)
-    free(counter_list->counters[i]);
+  for(i = 0; i < counter_list->num_arrays; i++)
+  {
+    free(counter_list->arrays[i]->values);
+    free(counter_list->arrays[i]);
+  }
+
+  free(counter_list->arrays);
+  counter_list->arrays = NULL;
+  counter_list->num_arrays = 0;
+  counter_list->num_arrays_allocated = 0;
 
+  // The counters themselves are all freed with the arena.
+  arena_clear(&(counter_list->arena));
   free(counter_list->counters);
 
   counter_list->num_counters = 0;
   counter_list->num_counters_allocated = 0;
+  counter_list->num_counters_sorted = 0;
   counter_list->counters = NULL;
 }
 
@@ -4174,6 +5050,12 @@ void clear_counter_list(struct counter_list *counter_list)
 void counter_list_size(struct counter_list *counter_list,
  size_t *list_size, size_t *table_size, size_t *counters_size)
 {
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  size_t family_table_size;
+  size_t array_table_size;
+#endif
+  unsigned int i;
+
   if(list_size)
     *list_size = counter_list->num_counters_allocated * sizeof(struct counter *);
 
@@ -4182,24 +5064,38 @@ void counter_list_size(struct counter_list *counter_list,
     *table_size = 0;
 #ifdef CONFIG_COUNTER_HASH_TABLES
     HASH_MEMORY_USAGE(COUNTER, counter_list->hash_table, *table_size);
+    HASH_MEMORY_USAGE(COUNTER_FAMILY, counter_list->family_table,
+     family_table_size);
+    HASH_MEMORY_USAGE(COUNTER_ARRAY, counter_list->array_table,
+     array_table_size);
+    *table_size += family_table_size + array_table_size;
 #endif
   }
 
   if(counters_size)
   {
-    size_t total = 0;
-    size_t i;
+    *counters_size = counter_list->arena.total_size;
+#ifdef CONFIG_COUNTER_HASH_TABLES
+    *counters_size +=
+     counter_list->num_families_allocated * sizeof(struct counter_family *);
 
-    if(counter_list->counters)
+    for(i = 0; i < counter_list->num_families; i++)
     {
-      for(i = 0; i < counter_list->num_counters; i++)
-      {
-        struct counter *c = counter_list->counters[i];
-        if(c)
-          total += get_counter_alloc_size(c->name_length);
-      }
+      struct counter_family *family = counter_list->families[i];
+      *counters_size += sizeof(struct counter_family) + family->name_length +
+       family->size * sizeof(int32_t) + family->size / 8;
+    }
+#endif
+
+    *counters_size +=
+     counter_list->num_arrays_allocated * sizeof(struct counter_array *);
+
+    for(i = 0; i < counter_list->num_arrays; i++)
+    {
+      struct counter_array *array = counter_list->arrays[i];
+      *counters_size += sizeof(struct counter_array) + array->name_length +
+       array->size * sizeof(int32_t);
     }
-    *counters_size = total;
   }
 }
 
@@ -25,6 +25,7 @@
 
 __M_BEGIN_DECLS
 
+#include "const.h"
 #include "counter_struct.h"
 #include "world_struct.h"
 
@@ -32,6 +33,22 @@ __M_BEGIN_DECLS
 #define SAVE_ROBOT_DISASM_EXTRAS  true
 #define SAVE_ROBOT_DISASM_BASE    10
 
+/**
+ * Iterator for every counter in the counter list, including counters stored
+ * in families. Zero-initialize before the first call to next_counter. The
+ * name is only valid until the next call.
+ */
+struct counter_iter
+{
+  size_t pos;
+  size_t family_pos;
+  size_t family_index;
+  const char *name;
+  size_t name_length;
+  int value;
+  char name_buffer[ROBOT_MAX_TR];
+};
+
 CORE_LIBSPEC void counter_fsg(void);
 CORE_LIBSPEC int match_function_counter(const char *dest, const char *src);
 CORE_LIBSPEC int get_counter(struct world *mzx_world, const char *name, int id);
@@ -41,7 +58,16 @@ CORE_LIBSPEC void set_counter(struct world *mzx_world, const char *name,
  int value, int id);
 CORE_LIBSPEC void new_counter(struct world *mzx_world, const char *name,
  int value, int id);
+CORE_LIBSPEC boolean get_counter_array_element(struct world *mzx_world,
+ const char *name, size_t name_length, int index, int *value);
+CORE_LIBSPEC size_t get_total_counters(struct counter_list *counter_list);
+CORE_LIBSPEC boolean next_counter(struct counter_list *counter_list,
+ struct counter_iter *iter);
+CORE_LIBSPEC void expand_counter_families(struct counter_list *counter_list);
+CORE_LIBSPEC void collapse_counter_families(struct counter_list *counter_list);
 CORE_LIBSPEC void sort_counter_list(struct counter_list *counter_list);
+CORE_LIBSPEC size_t find_counter_prefix(struct counter_list *counter_list,
+ const char *prefix, size_t *first);
 CORE_LIBSPEC void counter_list_size(struct counter_list *counter_list,
  size_t *list_size, size_t *table_size, size_t *counters_size);
 
@@ -55,8 +81,12 @@ void mod_counter(struct world *mzx_world, const char *name, int value, int id);
 int set_counter_special(struct world *mzx_world, char *char_value,
  int value, int id);
 
-void load_new_counter(struct counter_list *counter_list, int index,
+void load_counter_list_reserve(struct counter_list *counter_list,
+ size_t count);
+void load_new_counter(struct counter_list *counter_list,
  const char *name, int name_length, int value);
+int32_t *load_counter_array(struct counter_list *counter_list,
+ const char *name, size_t name_length, size_t size);
 
 void clear_counter_list(struct counter_list *counter_list);
 
@@ -27,6 +27,8 @@ __M_BEGIN_DECLS
 
 #include <inttypes.h>
 
+#include "arena.h"
+
 struct counter
 {
   int32_t value;
@@ -35,7 +37,8 @@ struct counter
 #endif
   uint16_t name_length;
   uint8_t gateway_write;
-  uint8_t unused;
+  // Set for counters moved out of a family by expand_counter_families.
+  uint8_t from_family;
 
   /**
    * This struct will be allocated with extra space to contain the entire
@@ -45,14 +48,81 @@ struct counter
   char name[1];
 };
 
+#ifdef CONFIG_COUNTER_HASH_TABLES
+
+/**
+ * Counters with names ending in a number (e.g. "map_x12_y34") are stored as
+ * members of a family shared by every counter with the same prefix (e.g.
+ * "map_x12_y") instead of individually. Each member's value is stored at the
+ * position of its number; the present bitmap marks which members exist.
+ */
+struct counter_family
+{
+  int32_t *values;
+  uint32_t *present;
+  uint32_t size;
+  uint32_t count;
+  uint32_t hash;
+  uint16_t name_length;
+  uint16_t unused;
+
+  /**
+   * This struct will be allocated with extra space to contain the entire
+   * prefix, null-terminated. This field MUST be at least 4-aligned and
+   * it must be the last field (any extra padding after it will be used).
+   */
+  char name[1];
+};
+
+#endif
+
+/**
+ * Counter arrays are declared and resized by setting "name[]" to the number
+ * of elements. Elements are accessed with "name[index]" (2.94+).
+ */
+struct counter_array
+{
+  int32_t *values;
+  uint32_t size;
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  uint32_t hash;
+#endif
+  uint16_t name_length;
+  uint16_t unused;
+
+  /**
+   * This struct will be allocated with extra space to contain the entire
+   * array name, null-terminated. This field MUST be at least 4-aligned and
+   * it must be the last field (any extra padding after it will be used).
+   */
+  char name[1];
+};
+
 struct counter_list
 {
   unsigned int num_counters;
   unsigned int num_counters_allocated;
+  // Number of counters at the start of the list known to be in name order.
+  unsigned int num_counters_sorted;
   struct counter **counters;
 #ifdef CONFIG_COUNTER_HASH_TABLES
   void *hash_table;
+
+  // Counters stored in families aren't in the counters list or hash table.
+  unsigned int num_families;
+  unsigned int num_families_allocated;
+  unsigned int num_family_counters;
+  struct counter_family **families;
+  void *family_table;
 #endif
+
+  unsigned int num_arrays;
+  unsigned int num_arrays_allocated;
+  struct counter_array **arrays;
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  void *array_table;
+#endif
+  struct arena arena;
 };
 
 // Like counters, string names are allocated as part of the struct.
@@ -95,8 +165,12 @@ struct string
   uint32_t hash;
 #endif
 
+  // Value of the string when read as a counter. This is only valid if
+  // numeric_valid is set and is invalidated whenever the string is modified.
+  int32_t numeric_value;
+
   uint16_t name_length;
-  uint8_t unused;
+  uint8_t numeric_valid;
   uint8_t unused2;
 
   /**
@@ -111,10 +185,13 @@ struct string_list
 {
   unsigned int num_strings;
   unsigned int num_strings_allocated;
+  // Number of strings at the start of the list known to be in name order.
+  unsigned int num_strings_sorted;
   struct string **strings;
 #ifdef CONFIG_COUNTER_HASH_TABLES
   void *hash_table;
 #endif
+  struct arena arena;
 };
 
 // Special counter returns for opening files
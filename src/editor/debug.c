@@ -275,6 +275,17 @@ enum virtual_var
   VIR_RAM_EXTRAM_DELTA,
   VIR_RAM_VIRTUAL_FILESYSTEM,
   VIR_RAM_VIRTUAL_FILESYSTEM_CACHED_ONLY,
+  VIR_RAM_VIRTUAL_FILESYSTEM_HITS,
+  VIR_RAM_VIRTUAL_FILESYSTEM_MISSES,
+  VIR_RAM_VIRTUAL_FILESYSTEM_EVICTIONS,
+  VIR_AUDIO_CALLBACKS,
+  VIR_AUDIO_UNDERRUNS,
+  VIR_AUDIO_DURATION_AVG,
+  VIR_AUDIO_DURATION_MAX,
+  VIR_AUDIO_INTERVAL_AVG,
+  VIR_AUDIO_INTERVAL_MAX,
+  VIR_AUDIO_LOCK_WAIT_AVG,
+  VIR_AUDIO_LOCK_WAIT_MAX,
 };
 
 static const char * const virtual_var_names[] =
@@ -303,6 +314,17 @@ static const char * const virtual_var_names[] =
   "ExtRAM compression delta*",
   "Virtual filesystem (total)*",
   "Virtual filesystem (cached only)*",
+  "Virtual filesystem cache hits*",
+  "Virtual filesystem cache misses*",
+  "Virtual filesystem cache evictions*",
+  "Callbacks*",
+  "Underruns*",
+  "Callback duration avg (us)*",
+  "Callback duration max (us)*",
+  "Callback interval avg (us)*",
+  "Callback interval max (us)*",
+  "Lock wait avg (us)*",
+  "Lock wait max (us)*",
 };
 
 // We'll read off of these when we construct the tree
@@ -378,6 +400,21 @@ static const enum virtual_var world_ram_var_list[] =
 #endif
   VIR_RAM_VIRTUAL_FILESYSTEM,
   VIR_RAM_VIRTUAL_FILESYSTEM_CACHED_ONLY,
+  VIR_RAM_VIRTUAL_FILESYSTEM_HITS,
+  VIR_RAM_VIRTUAL_FILESYSTEM_MISSES,
+  VIR_RAM_VIRTUAL_FILESYSTEM_EVICTIONS,
+};
+
+static const enum virtual_var world_audio_var_list[] =
+{
+  VIR_AUDIO_CALLBACKS,
+  VIR_AUDIO_UNDERRUNS,
+  VIR_AUDIO_DURATION_AVG,
+  VIR_AUDIO_DURATION_MAX,
+  VIR_AUDIO_INTERVAL_AVG,
+  VIR_AUDIO_INTERVAL_MAX,
+  VIR_AUDIO_LOCK_WAIT_AVG,
+  VIR_AUDIO_LOCK_WAIT_MAX,
 };
 
 static const char *board_var_list[] =
@@ -466,6 +503,7 @@ static const char *scroll_text_var = "Scroll text*";
 static const int num_universal_vars = ARRAY_SIZE(universal_var_list);
 static const int num_world_vars = ARRAY_SIZE(world_var_list);
 static const int num_world_ram_vars = ARRAY_SIZE(world_ram_var_list);
+static const int num_world_audio_vars = ARRAY_SIZE(world_audio_var_list);
 static const int num_board_vars = ARRAY_SIZE(board_var_list);
 static const int num_robot_vars = ARRAY_SIZE(robot_var_list);
 static const int num_sprite_parent_vars = ARRAY_SIZE(sprite_parent_var_list);
@@ -532,9 +570,18 @@ struct debug_ram_data
   size_t extram_compressed_size;
   size_t virtual_filesystem_size;
   size_t virtual_filesystem_cached_size;
+  size_t virtual_filesystem_hits;
+  size_t virtual_filesystem_misses;
+  size_t virtual_filesystem_evictions;
 };
 
 static struct debug_ram_data ram_data;
+static struct audio_callback_stats audio_stats;
+
+static int64_t histogram_avg(const struct audio_histogram *h)
+{
+  return h->count ? (int64_t)(h->total_us / h->count) : 0;
+}
 
 static void robot_ram_usage(struct robot *robot, struct debug_ram_data *ram_data)
 {
@@ -597,6 +644,11 @@ static void update_ram_usage_data(struct world *mzx_world,
   for(i = 0; i < mzx_world->num_boards; i++)
   {
     struct board *b = mzx_world->board_list[i];
+
+    // Deferred boards haven't been loaded yet.
+    if(b->deferred)
+      continue;
+
     // Board data.
     ram_data.board_data_size += b->board_width * b->board_height * 6;
     if(b->overlay_mode)
@@ -658,6 +710,8 @@ static void update_ram_usage_data(struct world *mzx_world,
 
   ram_data.virtual_filesystem_size = vio_filesystem_total_memory_usage();
   ram_data.virtual_filesystem_cached_size = vio_filesystem_total_cached_usage();
+  vio_filesystem_cache_stats(&ram_data.virtual_filesystem_hits,
+   &ram_data.virtual_filesystem_misses, &ram_data.virtual_filesystem_evictions);
 }
 
 #define match_counter(_name) (strlen(_name) == len && !strcasecmp(name, _name))
@@ -975,6 +1029,39 @@ static void get_var_value(struct world *mzx_world, struct debug_var *v,
         case VIR_RAM_VIRTUAL_FILESYSTEM_CACHED_ONLY:
           value = ram_data.virtual_filesystem_cached_size;
           break;
+        case VIR_RAM_VIRTUAL_FILESYSTEM_HITS:
+          value = ram_data.virtual_filesystem_hits;
+          break;
+        case VIR_RAM_VIRTUAL_FILESYSTEM_MISSES:
+          value = ram_data.virtual_filesystem_misses;
+          break;
+        case VIR_RAM_VIRTUAL_FILESYSTEM_EVICTIONS:
+          value = ram_data.virtual_filesystem_evictions;
+          break;
+        case VIR_AUDIO_CALLBACKS:
+          value = audio_stats.callbacks;
+          break;
+        case VIR_AUDIO_UNDERRUNS:
+          value = audio_stats.underruns;
+          break;
+        case VIR_AUDIO_DURATION_AVG:
+          value = histogram_avg(&audio_stats.duration);
+          break;
+        case VIR_AUDIO_DURATION_MAX:
+          value = audio_stats.duration.max_us;
+          break;
+        case VIR_AUDIO_INTERVAL_AVG:
+          value = histogram_avg(&audio_stats.interval);
+          break;
+        case VIR_AUDIO_INTERVAL_MAX:
+          value = audio_stats.interval.max_us;
+          break;
+        case VIR_AUDIO_LOCK_WAIT_AVG:
+          value = histogram_avg(&audio_stats.lock_wait);
+          break;
+        case VIR_AUDIO_LOCK_WAIT_MAX:
+          value = audio_stats.lock_wait.max_us;
+          break;
       }
       *long_value = value;
       break;
@@ -1122,7 +1209,7 @@ static void write_var(struct world *mzx_world, struct debug_var *v, int int_val,
       temp.value = char_val;
 
       memcpy(buffer, v->data.string->name, v->data.string->name_length + 1);
-      set_string(mzx_world, buffer, &temp, 0);
+      set_string(mzx_world, buffer, &temp, NULL, 0);
       break;
     }
 
@@ -1919,19 +2006,6 @@ static boolean search_debug(struct world *mzx_world, struct debug_node *node,
 static const char rolodex_letters[NUM_ROLODEX + 1] =
  "#ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 
-static int get_rolodex_position(struct world *mzx_world, int first)
-{
-  first = tolower(first);
-
-  if(first < 'a')
-    return 0;
-
-  if(first > 'z')
-    return 0;
-
-  return (first - 'a') + 1;
-}
-
 static struct debug_node *create_rolodex_nodes(struct debug_node *parent,
  size_t counts[NUM_ROLODEX], const char *name_prefix)
 {
@@ -1958,52 +2032,73 @@ static struct debug_node *create_rolodex_nodes(struct debug_node *parent,
   return nodes;
 }
 
+/**
+ * Find the range of the sorted counter or string list for each rolodex node.
+ * Everything starting with a letter is found with a prefix search; the '#'
+ * node gets everything before 'A' and after 'Z'.
+ */
+static void get_rolodex_ranges(struct world *mzx_world, boolean strings,
+ size_t num, size_t firsts[NUM_ROLODEX], size_t counts[NUM_ROLODEX],
+ size_t *after_z)
+{
+  char prefix[3];
+  int i;
+
+  for(i = 1; i < NUM_ROLODEX; i++)
+  {
+    if(strings)
+    {
+      snprintf(prefix, sizeof(prefix), "$%c", rolodex_letters[i]);
+      counts[i] = find_string_prefix(&(mzx_world->string_list), prefix,
+       &(firsts[i]));
+    }
+    else
+    {
+      snprintf(prefix, sizeof(prefix), "%c", rolodex_letters[i]);
+      counts[i] = find_counter_prefix(&(mzx_world->counter_list), prefix,
+       &(firsts[i]));
+    }
+  }
+
+  *after_z = firsts[NUM_ROLODEX - 1] + counts[NUM_ROLODEX - 1];
+  firsts[0] = 0;
+  counts[0] = firsts[1] + (num - *after_z);
+}
+
 static void init_counters_node(struct world *mzx_world, struct debug_node *dest)
 {
   struct counter_list *counter_list = &(mzx_world->counter_list);
   struct debug_node *nodes;
-  struct debug_node *current_node = NULL;
-  struct debug_var *current_var;
-  size_t var_counts[NUM_ROLODEX] = { 0 };
-  size_t num_counters = counter_list->num_counters;
-  int first_prev = -1;
-  int first;
-  int n = 0;
+  struct debug_var *vars;
+  size_t var_counts[NUM_ROLODEX];
+  size_t firsts[NUM_ROLODEX];
+  size_t num_counters;
+  size_t after_z;
   size_t i;
+  size_t j;
 
-  // The counter list may not be in the order we want to display it in.
-  sort_counter_list(counter_list);
+  // Counters need to be in the counter list to be displayed and edited.
+  expand_counter_families(counter_list);
+  num_counters = counter_list->num_counters;
 
-  // Get the number of vars for each node so they can be allocated in one pass.
-  for(i = 0; i < num_counters; i++)
-  {
-    first = counter_list->counters[i]->name[0];
-    if(first != first_prev)
-    {
-      n = get_rolodex_position(mzx_world, first);
-      first_prev = first;
-    }
-    var_counts[n]++;
-  }
+  // This also sorts the counter list, which may not be in display order.
+  get_rolodex_ranges(mzx_world, false, num_counters, firsts, var_counts,
+   &after_z);
 
   // Allocate and initialize subtree nodes.
   nodes = create_rolodex_nodes(dest, var_counts, "");
 
   // Insert vars into the newly allocated nodes.
-  first_prev = -1;
-  for(i = 0; i < num_counters; i++)
+  for(i = 0; i < NUM_ROLODEX; i++)
   {
-    first = counter_list->counters[i]->name[0];
-    if(first != first_prev)
+    vars = nodes[i].vars;
+    for(j = firsts[i]; j < firsts[i] + var_counts[i]; j++)
     {
-      n = get_rolodex_position(mzx_world, first);
-      first_prev = first;
-      current_node = &(nodes[n]);
+      // The '#' node continues after the end of the 'Z' node.
+      size_t pos = (i == 0 && j >= firsts[1]) ? j - firsts[1] + after_z : j;
+      init_counter_var(&(vars[nodes[i].num_vars++]),
+       counter_list->counters[pos]);
     }
-
-    current_var = &(current_node->vars[current_node->num_vars++]);
-
-    init_counter_var(current_var, counter_list->counters[i]);
   }
 }
 
@@ -2011,51 +2106,36 @@ static void init_strings_node(struct world *mzx_world, struct debug_node *dest)
 {
   struct string_list *string_list = &(mzx_world->string_list);
   struct debug_node *nodes;
-  struct debug_node *current_node = NULL;
-  struct debug_var *current_var;
-  size_t var_counts[NUM_ROLODEX] = { 0 };
+  struct debug_var *vars;
+  size_t var_counts[NUM_ROLODEX];
+  size_t firsts[NUM_ROLODEX];
   size_t num_strings = string_list->num_strings;
-  int first_prev = -1;
-  int first;
-  int n = 0;
+  size_t after_z;
   size_t i;
+  size_t j;
 
   // Don't create any child nodes if there are no strings.
   if(!num_strings)
     return;
 
-  // The string list may not be in the order we want to display it in.
-  sort_string_list(string_list);
-
-  // Get the number of vars for each node so they can be allocated in one pass.
-  for(i = 0; i < num_strings; i++)
-  {
-    first = string_list->strings[i]->name[1];
-    if(first != first_prev)
-    {
-      n = get_rolodex_position(mzx_world, first);
-      first_prev = first;
-    }
-    var_counts[n]++;
-  }
+  // This also sorts the string list, which may not be in display order.
+  get_rolodex_ranges(mzx_world, true, num_strings, firsts, var_counts,
+   &after_z);
 
   // Allocate and initialize subtree nodes.
   nodes = create_rolodex_nodes(dest, var_counts, "$");
 
   // Insert vars into the newly allocated nodes.
-  first_prev = -1;
-  for(i = 0; i < num_strings; i++)
+  for(i = 0; i < NUM_ROLODEX; i++)
   {
-    first = string_list->strings[i]->name[1];
-    if(first != first_prev)
+    vars = nodes[i].vars;
+    for(j = firsts[i]; j < firsts[i] + var_counts[i]; j++)
     {
-      n = get_rolodex_position(mzx_world, first);
-      first_prev = first;
-      current_node = &(nodes[n]);
+      // The '#' node continues after the end of the 'Z' node.
+      size_t pos = (i == 0 && j >= firsts[1]) ? j - firsts[1] + after_z : j;
+      init_string_var(&(vars[nodes[i].num_vars++]),
+       string_list->strings[pos]);
     }
-    current_var = &(current_node->vars[current_node->num_vars++]);
-
-    init_string_var(current_var, string_list->strings[i]);
   }
 }
 
@@ -2193,6 +2273,15 @@ static void init_world_ram_node(struct world *mzx_world, struct debug_node *dest
   init_virtual_node(mzx_world, dest, world_ram_var_list, num_world_ram_vars);
 }
 
+static void init_world_audio_node(struct world *mzx_world,
+ struct debug_node *dest)
+{
+  memset(&audio_stats, 0, sizeof(struct audio_callback_stats));
+  audio_get_callback_stats(&audio_stats);
+
+  init_virtual_node(mzx_world, dest, world_audio_var_list, num_world_audio_vars);
+}
+
 static void init_board_node(struct world *mzx_world, struct debug_node *dest)
 {
   init_builtin_node(mzx_world, dest, board_var_list, num_board_vars, 0);
@@ -2357,6 +2446,7 @@ enum root_node_ids
 enum world_node_ids
 {
   NODE_RAM,
+  NODE_AUDIO,
   NUM_WORLD_NODES
 };
 
@@ -2406,6 +2496,8 @@ static void repopulate_tree(struct world *mzx_world, struct debug_node *root)
 
   if(world->nodes)
   {
+    init_world_audio_node(mzx_world, &(world->nodes[NODE_AUDIO]));
+
     /**
      * The RAM node should be done last so the rest of the tree is finished
      * for the debug variables RAM calculation.
@@ -2523,6 +2615,20 @@ static void build_debug_tree(struct world *mzx_world, struct debug_node *root)
     NULL
   };
 
+  struct debug_node world_audio =
+  {
+    "Audio",
+    false,
+    true,
+    false,
+    false,
+    0,
+    0,
+    &(nodes[NODE_WORLD]),
+    NULL,
+    NULL
+  };
+
   struct debug_node board =
   {
     "Board",
@@ -2583,6 +2689,7 @@ static void build_debug_tree(struct world *mzx_world, struct debug_node *root)
   world.num_nodes = NUM_WORLD_NODES;
   world.nodes = world_n;
   world_n[NODE_RAM] = world_ram;
+  world_n[NODE_AUDIO] = world_audio;
 
   if(mzx_world->current_board->num_scrolls ||
    mzx_world->current_board->num_sensors)
@@ -2845,7 +2952,7 @@ static int new_counter_dialog(struct world *mzx_world, char *name)
         temp.value = (char *)"";
         temp.length = 0;
 
-        set_string(mzx_world, name, &temp, 0);
+        set_string(mzx_world, name, &temp, NULL, 0);
       }
 
       return 1;
@@ -3272,16 +3379,15 @@ void __debug_counters(context *ctx)
         {
           struct counter_list *counter_list = &(mzx_world->counter_list);
           struct string_list *string_list = &(mzx_world->string_list);
+          struct counter_iter iter;
           vfile *vf;
           size_t i;
 
           vf = vfopen_unsafe(export_name, "wb");
 
-          for(i = 0; i < counter_list->num_counters; i++)
-          {
-            struct counter *ctr = counter_list->counters[i];
-            vf_printf(vf, "set \"%s\" to %" PRId32 "\n", ctr->name, ctr->value);
-          }
+          memset(&iter, 0, sizeof(struct counter_iter));
+          while(next_counter(counter_list, &iter))
+            vf_printf(vf, "set \"%s\" to %d\n", iter.name, iter.value);
 
           for(i = 0; i < string_list->num_strings; i++)
           {
@@ -3377,6 +3483,10 @@ void __debug_counters(context *ctx)
   // Clear the big dumb tree first
   clear_debug_tree(&root, true);
 
+  // The tree no longer points to any counters, so put the counters that were
+  // taken out of families back.
+  collapse_counter_families(&(mzx_world->counter_list));
+
   // Get rid of the tree view
   free_tree_list(tree_list, tree_size);
 
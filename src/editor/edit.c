@@ -224,6 +224,9 @@ static boolean editor_reload_world(struct editor_context *editor,
   if(!reload_world(mzx_world, file, &ignore))
     return false;
 
+  // The editor needs every board to be loaded.
+  load_deferred_boards(mzx_world);
+
   // Part 1: Reset the config file.
   load_editor_config_backup();
 
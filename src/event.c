@@ -24,6 +24,8 @@
 #include "platform.h"
 #include "util.h"
 
+#include "audio/audio_offline.h"
+
 #include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -613,6 +615,8 @@ boolean update_event_status(void)
   rval  = __update_event_status();
   rval |= update_autorepeat();
 
+  audio_offline_update();
+
   return rval;
 }
 
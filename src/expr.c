@@ -225,6 +225,15 @@ static inline boolean ternary_short_circuit(char **_expression, char terminator,
     }
     else
 
+#ifdef CONFIG_DEBYTECODE
+    // Counter array indices can contain nested ternary operators.
+    if(current_char == '[')
+    {
+      expression = skip_identifier(expression, ']');
+    }
+    else
+#endif
+
     // The main concern here is reserved chars being found in identifiers.
     // The affected identifiers should always have quotes, though.
 #ifdef CONFIG_DEBYTECODE
@@ -1090,6 +1099,65 @@ static char *expr_skip_whitespace(char *expression)
   return expression;
 }
 
+#ifdef CONFIG_DEBYTECODE
+
+static int _parse_expression(struct world *mzx_world, char **_expression,
+ int *error, int id, const char *operand_a, const char terminator1,
+ const char terminator2);
+
+/**
+ * Evaluate a counter array element name[index] (2.94+). The index is an
+ * expression, and its value is used to access the array directly. If there is
+ * no array with this name, name[index] is read as a normal counter instead.
+ * If the index is invalid, the type is set to -1.
+ */
+static int parse_array_element(struct world *mzx_world, char *name,
+ char *name_end, char **_argument, int *type, int id)
+{
+  char name_buffer[ROBOT_MAX_TR];
+  char *expression = expr_skip_whitespace(name_end + 1);
+  size_t name_length = name_end - name;
+  boolean is_size = (*expression == ']');
+  int index = 0;
+  int value;
+  int error = 0;
+
+  if(!is_size)
+    index = _parse_expression(mzx_world, &expression, &error, id, NULL,
+     ']', ']');
+
+  if(error || *expression != ']')
+  {
+    *type = -1;
+    *_argument = expression;
+    return -1;
+  }
+
+  // Skip trailing ].
+  expression++;
+
+  *type = 0;
+  *_argument = expression;
+
+  if(!is_size &&
+   get_counter_array_element(mzx_world, name, name_length, index, &value))
+    return value;
+
+  if(is_size)
+  {
+    snprintf(name_buffer, sizeof(name_buffer), "%.*s[]",
+     (int)name_length, name);
+  }
+  else
+  {
+    snprintf(name_buffer, sizeof(name_buffer), "%.*s[%d]",
+     (int)name_length, name, index);
+  }
+  return get_counter(mzx_world, name_buffer, id);
+}
+
+#endif /* CONFIG_DEBYTECODE */
+
 static int parse_argument(struct world *mzx_world, char **_argument,
  int *type, int operand_a, int id)
 {
@@ -1526,6 +1594,12 @@ static int parse_argument(struct world *mzx_world, char **_argument,
         char temp = *end_p;
         int value;
 
+        if(temp == '[')
+        {
+          return parse_array_element(mzx_world, argument, end_p, _argument,
+           type, id);
+        }
+
         *end_p = 0;
         value = get_counter(mzx_world, argument, id);
         *end_p = temp;
@@ -17,8 +17,10 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "board.h"
 #include "error.h"
 #include "extmem.h"
+#include "platform.h"
 #include "platform_endian.h"
 #include "robot.h"
 #include "util.h"
@@ -26,6 +28,8 @@
 
 #include <limits.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <zlib.h>
 
 #ifdef CONFIG_NDS
@@ -36,6 +40,8 @@
 // Use a static buffer in fast RAM instead of the default stack buffer.
 // The benefits of this are questionable but at least it isn't on the stack.
 DTCM_BSS static uint32_t extram_deflate_buffer[4096 / sizeof(uint32_t)];
+// The LZ hash table is on the stack, which is also in fast RAM.
+#define EXTRAM_LZ_HASH_BITS 10
 #endif
 
 /**
@@ -96,6 +102,7 @@ enum extram_flags
   EXTRAM_DEFLATE          = (1 << 1), /* Buffer uses DEFLATE compression. */
   EXTRAM_PAGED            = (1 << 2), /* Buffer was paged to disk. (TODO?) */
   EXTRAM_RLE3             = (1 << 3), /* Buffer uses MZX RLE3 compression. */
+  EXTRAM_LZ               = (1 << 4), /* Buffer uses MZX LZ compression. */
 };
 
 struct extram_block
@@ -112,11 +119,71 @@ struct extram_data
 {
   z_stream z;
   size_t compression_threshold;
+  uint8_t *buffer;
+  size_t buffer_size;
+  struct extram_board_copy *copy;
   int status;
   boolean initialized;
   boolean free_data;
 };
 
+/* A copy of a board's extra RAM blocks that can be unpacked on another
+ * thread. Each buffer remembers the block it was copied from so it can be
+ * matched up again when the board is retrieved. */
+struct extram_copy_buffer
+{
+  const void *src;
+  struct extram_block *block;
+  char *dest;
+};
+
+struct extram_board_copy
+{
+  size_t num_buffers;
+  size_t pos;
+  struct extram_copy_buffer buffers[1];
+};
+
+#ifndef EXTRAM_NS_PER_BYTE
+/* How much store and retrieve time (in nanoseconds) saving one byte of RAM
+ * is worth when selecting a compression method. */
+#define EXTRAM_NS_PER_BYTE 32
+#endif
+
+/* Methods need to be measured with at least this much data before their
+ * measurements are trusted. */
+#define EXTRAM_MEASURE_MIN (1 << 16)
+/* Measurements are halved past this so they follow the current world. */
+#define EXTRAM_MEASURE_MAX (1 << 26)
+/* Every so often, retry the least measured method even if it looks worse. */
+#define EXTRAM_PROBE_INTERVAL 64
+
+#define RLE3_LZ_NAME(flags) (((flags) & EXTRAM_LZ) ? "LZ" : "RLE3")
+
+enum extram_method
+{
+  EXTRAM_M_LZ,
+  EXTRAM_M_RLE3,
+  EXTRAM_M_DEFLATE,
+  NUM_EXTRAM_METHODS
+};
+
+struct extram_measure
+{
+  uint64_t pack_in;
+  uint64_t pack_out;
+  uint64_t pack_ns;
+  uint64_t unpack_in;
+  uint64_t unpack_ns;
+};
+
+static struct extram_measure extram_measures[NUM_EXTRAM_METHODS];
+static unsigned int extram_probe_count;
+
+/* Unpacked copy of a board to use the next time it's retrieved. */
+static struct extram_board_copy *pending_copy;
+static struct board *pending_board;
+
 #ifdef EXTRAM_STATS
 struct method_stats
 {
@@ -129,6 +196,7 @@ struct method_stats
 
 static struct method_stats deflate_stats;
 static struct method_stats rle3_stats;
+static struct method_stats lz_stats;
 
 static void tick_method_stats(struct method_stats *stats, size_t compressed,
  size_t uncompressed)
@@ -154,6 +222,12 @@ static void tick_stats(struct extram_block *block)
   }
   else
 
+  if(block->flags & EXTRAM_LZ)
+  {
+    tick_method_stats(&lz_stats, block->compressed_size, block->uncompressed_size);
+  }
+  else
+
   if(block->flags & EXTRAM_DEFLATE)
     tick_method_stats(&deflate_stats, block->compressed_size, block->uncompressed_size);
 }
@@ -168,16 +242,39 @@ static void print_method_stats(struct method_stats *stats)
 
 static void print_stats(void)
 {
+  static const char * const method_names[NUM_EXTRAM_METHODS] =
+  {
+    "LZ", "RLE3", "DEFLATE"
+  };
+  int i;
+
   if(rle3_stats.total)
   {
     trace("--EXTRAM--   RLE3 stats:\n");
     print_method_stats(&rle3_stats);
   }
+  if(lz_stats.total)
+  {
+    trace("--EXTRAM--   LZ stats:\n");
+    print_method_stats(&lz_stats);
+  }
   if(deflate_stats.total)
   {
     trace("--EXTRAM--   DEFLATE stats:\n");
     print_method_stats(&deflate_stats);
   }
+
+  for(i = 0; i < NUM_EXTRAM_METHODS; i++)
+  {
+    struct extram_measure *em = &extram_measures[i];
+    if(em->pack_in && em->unpack_in)
+    {
+      trace("--EXTRAM--   %s measured:  RATIO:%.5f  STORE:%.3fns/B  RETRIEVE:%.3fns/B\n",
+       method_names[i], (double)em->pack_out / (double)em->pack_in,
+       (double)em->pack_ns / (double)em->pack_in,
+       (double)em->unpack_ns / (double)em->unpack_in);
+    }
+  }
 }
 #endif
 
@@ -595,6 +692,251 @@ static boolean RLE3_unpack(uint8_t * RESTRICT dest, size_t dest_len,
   return (i == dest_len);
 }
 
+#ifndef EXTRAM_LZ_HASH_BITS
+/* Size (in bits) of the LZ match finder hash table (4 bytes per entry). */
+#define EXTRAM_LZ_HASH_BITS 12
+#endif
+
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   0x7FFF
+#define LZ_RUN_MASK     0x0F
+
+/**
+ * Bound the maximum LZ stream size for an input of a given length.
+ *
+ * @param  src_len  length of the source data to be compressed.
+ * @return          upper bound size of the corresponding LZ stream.
+ */
+static inline size_t LZ_bound(size_t src_len)
+{
+  return src_len + src_len / 255u + 16u;
+}
+
+static inline uint32_t LZ_hash(const uint8_t *src)
+{
+  uint32_t v = src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+  return (v * 2654435761u) >> (32 - EXTRAM_LZ_HASH_BITS);
+}
+
+/**
+ * Emit an LZ sequence: a token, a run of literals, and optionally a match.
+ * Lengths that don't fit in the token are continued in 255-terminated bytes.
+ */
+static boolean LZ_pack_sequence(uint8_t * RESTRICT data, size_t data_len,
+ size_t *_j, const uint8_t *literals, size_t literal_len, size_t offset,
+ size_t match_len)
+{
+  size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+  size_t j = *_j;
+  size_t tmp;
+
+  if(j >= data_len)
+    return false;
+
+  data[j++] = (MIN(literal_len, LZ_RUN_MASK) << 4) | MIN(match_code, LZ_RUN_MASK);
+
+  if(literal_len >= LZ_RUN_MASK)
+  {
+    for(tmp = literal_len - LZ_RUN_MASK; ; tmp -= 255)
+    {
+      if(j >= data_len)
+        return false;
+
+      data[j++] = MIN(tmp, 255);
+      if(tmp < 255)
+        break;
+    }
+  }
+
+  if(j + literal_len > data_len)
+    return false;
+
+  memcpy(data + j, literals, literal_len);
+  j += literal_len;
+
+  if(match_len)
+  {
+    // Most board plane matches are runs or repeat the previous row, and
+    // most bytecode matches are nearby, so short offsets only use one byte.
+    if(j + 2 > data_len)
+      return false;
+
+    if(offset < 0x80)
+    {
+      data[j++] = offset;
+    }
+    else
+    {
+      data[j++] = 0x80 | (offset >> 8);
+      data[j++] = offset & 0xFF;
+    }
+
+    if(match_code >= LZ_RUN_MASK)
+    {
+      for(tmp = match_code - LZ_RUN_MASK; ; tmp -= 255)
+      {
+        if(j >= data_len)
+          return false;
+
+        data[j++] = MIN(tmp, 255);
+        if(tmp < 255)
+          break;
+      }
+    }
+  }
+  *_j = j;
+  return true;
+}
+
+/**
+ * Pack a buffer with LZ compression, a simple LZ77 scheme with byte-aligned
+ * sequences similar to LZ4. This is much faster than zlib DEFLATE to unpack
+ * and handles repeating robot bytecode much better than RLE3.
+ *
+ * @param   data      buffer to output LZ stream to.
+ * @param   data_len  size of LZ buffer.
+ * @param   src       uncompressed source data.
+ * @param   src_len   length of uncompressed source.
+ * @return            final LZ stream length, or 0 on failure.
+ */
+static size_t LZ_pack(uint8_t * RESTRICT data, size_t data_len,
+ const uint8_t *src, size_t src_len)
+{
+  uint32_t table[1 << EXTRAM_LZ_HASH_BITS];
+  size_t anchor = 0;
+  size_t i = 0;
+  size_t j = 0;
+
+  memset(table, 0, sizeof(table));
+
+  while(i + LZ_MIN_MATCH <= src_len)
+  {
+    uint32_t hash = LZ_hash(src + i);
+    size_t match = table[hash];
+    size_t match_len;
+
+    // Positions are stored +1 so 0 can mean empty.
+    table[hash] = i + 1;
+    if(!match || i - (match - 1) > LZ_MAX_OFFSET ||
+     memcmp(src + match - 1, src + i, LZ_MIN_MATCH))
+    {
+      i++;
+      continue;
+    }
+    match--;
+
+    match_len = LZ_MIN_MATCH;
+    while(i + match_len < src_len && src[match + match_len] == src[i + match_len])
+      match_len++;
+
+    if(!LZ_pack_sequence(data, data_len, &j, src + anchor, i - anchor,
+     i - match, match_len))
+      return 0;
+
+    i += match_len;
+    anchor = i;
+  }
+
+  // The stream always ends with a sequence of (possibly zero) literals.
+  if(!LZ_pack_sequence(data, data_len, &j, src + anchor, src_len - anchor, 0, 0))
+    return 0;
+
+  return j;
+}
+
+/**
+ * Unpack an LZ stream.
+ *
+ * @param   dest      destination buffer for the unpacked stream.
+ * @param   dest_len  size of destination buffer.
+ * @param   data      source LZ stream to unpack.
+ * @param   data_len  length of source LZ stream.
+ * @return            `true` on success, otherwise `false`. This function will
+ *                    fail if the unpacked stream size doesn't match `dest_len`.
+ */
+static boolean LZ_unpack(uint8_t * RESTRICT dest, size_t dest_len,
+ const uint8_t *data, size_t data_len)
+{
+  size_t i = 0;
+  size_t j = 0;
+
+  while(j < data_len)
+  {
+    uint8_t token = data[j++];
+    size_t literal_len = token >> 4;
+    size_t match_len = token & LZ_RUN_MASK;
+    size_t offset;
+    uint8_t tmp;
+
+    if(literal_len == LZ_RUN_MASK)
+    {
+      do
+      {
+        if(j >= data_len)
+          return false;
+
+        tmp = data[j++];
+        literal_len += tmp;
+      }
+      while(tmp == 255);
+    }
+
+    if(i + literal_len > dest_len || j + literal_len > data_len)
+      return false;
+
+    memcpy(dest + i, data + j, literal_len);
+    i += literal_len;
+    j += literal_len;
+
+    // The last sequence has no match.
+    if(j >= data_len)
+      break;
+
+    offset = data[j++];
+    if(offset & 0x80)
+    {
+      if(j >= data_len)
+        return false;
+
+      offset = ((offset & 0x7F) << 8) | data[j++];
+    }
+
+    if(match_len == LZ_RUN_MASK)
+    {
+      do
+      {
+        if(j >= data_len)
+          return false;
+
+        tmp = data[j++];
+        match_len += tmp;
+      }
+      while(tmp == 255);
+    }
+    match_len += LZ_MIN_MATCH;
+
+    if(!offset || offset > i || i + match_len > dest_len)
+      return false;
+
+    if(offset >= match_len)
+    {
+      memcpy(dest + i, dest + i - offset, match_len);
+      i += match_len;
+    }
+    else
+    {
+      // Overlapping match (usually a run).
+      const uint8_t *pos = dest + i - offset;
+      size_t k;
+      for(k = 0; k < match_len; k++)
+        dest[i + k] = pos[k];
+
+      i += match_len;
+    }
+  }
+  return (i == dest_len);
+}
+
 /**
  * Initialize a deflate stream.
  */
@@ -688,7 +1030,7 @@ static uint32_t extram_checksum(const void *src, size_t len)
   while(len > 0)
   {
     unsigned int blocklen = MIN(len, UINT_MAX);
-    checksum = adler32(checksum, src, blocklen);
+    checksum = adler32(checksum, (const Bytef *)src, blocklen);
     len -= blocklen;
   }
   return checksum;
@@ -797,6 +1139,125 @@ static size_t extram_block_size(size_t len)
   return sizeof(struct extram_block) + extram_alloc_size(len);
 }
 
+/**
+ * Get a buffer of at least `len` bytes for packing or unpacking. Small
+ * buffers use the local buffer, larger buffers are allocated and reused
+ * for the rest of the board.
+ */
+static uint8_t *extram_get_buffer(struct extram_data *data, void *local,
+ size_t local_size, size_t len)
+{
+  if(len <= local_size)
+    return (uint8_t *)local;
+
+  if(len > data->buffer_size)
+  {
+    free(data->buffer);
+    data->buffer = (uint8_t *)cmalloc(extram_alloc_size(len));
+    data->buffer_size = len;
+  }
+  return data->buffer;
+}
+
+static void extram_free_buffer(struct extram_data *data)
+{
+  free(data->buffer);
+  data->buffer = NULL;
+  data->buffer_size = 0;
+}
+
+static void extram_measure_pack(enum extram_method method, size_t in,
+ size_t out, uint64_t ns)
+{
+  struct extram_measure *em = &extram_measures[method];
+
+  em->pack_in += in;
+  em->pack_out += out;
+  em->pack_ns += ns;
+
+  if(em->pack_in > EXTRAM_MEASURE_MAX)
+  {
+    em->pack_in >>= 1;
+    em->pack_out >>= 1;
+    em->pack_ns >>= 1;
+  }
+}
+
+static void extram_measure_unpack(enum extram_method method, size_t out,
+ uint64_t ns)
+{
+  struct extram_measure *em = &extram_measures[method];
+
+  em->unpack_in += out;
+  em->unpack_ns += ns;
+
+  if(em->unpack_in > EXTRAM_MEASURE_MAX)
+  {
+    em->unpack_in >>= 1;
+    em->unpack_ns >>= 1;
+  }
+}
+
+/**
+ * Estimate the cost of storing a buffer with a compression method from the
+ * ratio and speed measured for previous buffers: the projected size plus the
+ * projected store and retrieve time, weighted by EXTRAM_NS_PER_BYTE. Methods
+ * that haven't been measured enough yet are always tried first.
+ */
+static uint64_t extram_method_cost(enum extram_method method, size_t len)
+{
+  struct extram_measure *em = &extram_measures[method];
+  uint64_t size;
+  uint64_t ns;
+
+  if(em->pack_in < EXTRAM_MEASURE_MIN)
+    return 0;
+
+  size = len * em->pack_out / em->pack_in;
+  ns = len * em->pack_ns / em->pack_in;
+  if(em->unpack_in)
+    ns += len * em->unpack_ns / em->unpack_in;
+
+  return size * EXTRAM_NS_PER_BYTE + ns;
+}
+
+/**
+ * Order the compression methods for a buffer from cheapest to most expensive.
+ */
+static void extram_select_methods(enum extram_method *order, size_t len)
+{
+  uint64_t cost[NUM_EXTRAM_METHODS];
+  int i;
+  int j;
+
+  for(i = 0; i < NUM_EXTRAM_METHODS; i++)
+  {
+    enum extram_method m = (enum extram_method)i;
+    cost[i] = extram_method_cost(m, len);
+
+    for(j = i; j > 0 && cost[order[j - 1]] > cost[i]; j--)
+      order[j] = order[j - 1];
+    order[j] = m;
+  }
+
+  // Periodically try the least measured method first so the measurements
+  // don't go stale for methods that stopped being selected.
+  if(++extram_probe_count >= EXTRAM_PROBE_INTERVAL)
+  {
+    enum extram_method probe = order[0];
+    extram_probe_count = 0;
+
+    for(i = 0; i < NUM_EXTRAM_METHODS; i++)
+      if(extram_measures[order[i]].pack_in < extram_measures[probe].pack_in)
+        probe = order[i];
+
+    for(i = 0; order[i] != probe; i++);
+    for(; i > 0; i--)
+      order[i] = order[i - 1];
+    order[0] = probe;
+  }
+}
+
 /**
  * Send a buffer to extra memory.
  *
@@ -810,33 +1271,69 @@ static boolean store_buffer_to_extram(struct extram_data *data,
 {
   struct extram_block *block;
   uint8_t *src = (uint8_t *)*_src;
+  uint8_t *packed = NULL;
   void *ptr;
   uint32_t flags = EXTRAM_PLATFORM_ALLOC;
   size_t projected_size = len;
   size_t alloc_size;
+  uint64_t start = 0;
   EXTRAM_BUFFER_DECL;
 
   trace("--EXTRAM-- store_buffer_to_extram %p %zu\n", src, len);
 
   if(len >= data->compression_threshold)
   {
-    // Before trying zlib (slow), how well does this RLE?
-    size_t rle3_size = RLE3_pack((void *)extram_deflate_buffer, sizeof(extram_deflate_buffer), src, len);
-    if(rle3_size > 0)
-    {
-      projected_size = rle3_size;
-      flags |= EXTRAM_RLE3;
-    }
-    else
+    enum extram_method order[NUM_EXTRAM_METHODS];
+    int i;
+
+    // Try the methods that have worked best so far until one compresses.
+    extram_select_methods(order, len);
+    for(i = 0; i < NUM_EXTRAM_METHODS && flags == EXTRAM_PLATFORM_ALLOC; i++)
     {
-      // Project compressed size...
-      data->z.next_in = (Bytef *)src;
-      data->z.avail_in = len;
+      size_t packed_size = 0;
+      uint32_t method_flag = 0;
 
-      if(extram_deflate_init(data))
+      start = get_ticks_ns();
+      switch(order[i])
       {
-        projected_size = deflateBound(&data->z, len);
-        flags |= EXTRAM_DEFLATE;
+        case EXTRAM_M_LZ:
+          packed = extram_get_buffer(data, extram_deflate_buffer,
+           sizeof(extram_deflate_buffer), len);
+          packed_size = LZ_pack(packed, len, src, len);
+          method_flag = EXTRAM_LZ;
+          break;
+
+        case EXTRAM_M_RLE3:
+          packed = extram_get_buffer(data, extram_deflate_buffer,
+           sizeof(extram_deflate_buffer), len);
+          packed_size = RLE3_pack(packed, len, src, len);
+          method_flag = EXTRAM_RLE3;
+          break;
+
+        case EXTRAM_M_DEFLATE:
+          // Project compressed size. This is measured after deflating.
+          data->z.next_in = (Bytef *)src;
+          data->z.avail_in = len;
+
+          if(extram_deflate_init(data))
+          {
+            projected_size = deflateBound(&data->z, len);
+            flags |= EXTRAM_DEFLATE;
+          }
+          continue;
+
+        case NUM_EXTRAM_METHODS:
+          break;
+      }
+
+      // Streams that don't save anything count as not compressing at all.
+      extram_measure_pack(order[i], len, packed_size ? packed_size : len,
+       get_ticks_ns() - start);
+
+      if(packed_size > 0)
+      {
+        projected_size = packed_size;
+        flags |= method_flag;
       }
     }
   }
@@ -848,7 +1345,7 @@ static boolean store_buffer_to_extram(struct extram_data *data,
   if(!block)
   {
     flags &= ~EXTRAM_PLATFORM_ALLOC;
-    block = cmalloc(alloc_size);
+    block = (struct extram_block *)cmalloc(alloc_size);
   }
 
   block->id = EXTRAM_ID;
@@ -899,6 +1396,8 @@ static boolean store_buffer_to_extram(struct extram_data *data,
     trace("--EXTRAM--   DEFLATE size=%zu\n", (size_t)data->z.total_out);
 
     block->compressed_size = data->z.total_out;
+    extram_measure_pack(EXTRAM_M_DEFLATE, len, block->compressed_size,
+     get_ticks_ns() - start);
 
     /* Shrink the allocation to the real compressed size. */
     new_alloc_size = extram_block_size(block->compressed_size);
@@ -919,15 +1418,15 @@ static boolean store_buffer_to_extram(struct extram_data *data,
   }
   else
 
-  if(flags & EXTRAM_RLE3)
+  if(flags & (EXTRAM_RLE3 | EXTRAM_LZ))
   {
-    // RLE3.
+    // RLE3 or LZ.
     block->compressed_size = projected_size;
 
-    if(!extram_copy(block->data, extram_deflate_buffer, projected_size))
+    if(!extram_copy(block->data, packed, projected_size))
       goto err;
 
-    trace("--EXTRAM--   RLE3 size=%zu\n", projected_size);
+    trace("--EXTRAM--   %s size=%zu\n", RLE3_LZ_NAME(flags), projected_size);
   }
   else
   {
@@ -952,7 +1451,7 @@ static boolean store_buffer_to_extram(struct extram_data *data,
   }
 
   free(src);
-  *_src = ptr;
+  *_src = (char *)ptr;
   return true;
 
 err:
@@ -967,6 +1466,35 @@ err:
   return false;
 }
 
+/**
+ * Find the unpacked copy of a block. The copy is only used if it was taken
+ * from this exact block, which can't be modified while it's in extra RAM.
+ */
+static void *extram_take_copy_buffer(struct extram_board_copy *copy,
+ const struct extram_block *block)
+{
+  struct extram_copy_buffer *cb;
+  size_t i;
+
+  for(i = 0; i < copy->num_buffers; i++)
+  {
+    cb = &copy->buffers[(copy->pos + i) % copy->num_buffers];
+    if(cb->src == block)
+    {
+      char *dest = cb->dest;
+      copy->pos = (copy->pos + i + 1) % copy->num_buffers;
+
+      if(!dest || cb->block->checksum != block->checksum ||
+       cb->block->uncompressed_size != block->uncompressed_size)
+        return NULL;
+
+      cb->dest = NULL;
+      return dest;
+    }
+  }
+  return NULL;
+}
+
 /**
  * Retrieve a buffer from extra memory.
  *
@@ -983,6 +1511,7 @@ static boolean retrieve_buffer_from_extram(struct extram_data *data,
   uint32_t checksum;
   size_t alloc_size;
   uint8_t *buffer = NULL;
+  uint64_t start;
   EXTRAM_BUFFER_DECL;
 
   trace("--EXTRAM-- retrieve_buffer_from_extram %p %zu\n", *src, len);
@@ -994,7 +1523,7 @@ static boolean retrieve_buffer_from_extram(struct extram_data *data,
      (void *)*src);
     goto err;
   }
-  block = ptr;
+  block = (struct extram_block *)ptr;
 
   platform_extram_lock();
 
@@ -1018,8 +1547,17 @@ static boolean retrieve_buffer_from_extram(struct extram_data *data,
   if(data->free_data)
     goto clear;
 
+  /* Use the prefetched copy of this block if there is one. */
+  if(data->copy)
+  {
+    buffer = (uint8_t *)extram_take_copy_buffer(data->copy, block);
+    if(buffer)
+      goto clear;
+  }
+
   alloc_size = extram_alloc_size(len);
-  buffer = cmalloc(alloc_size);
+  buffer = (uint8_t *)cmalloc(alloc_size);
+  start = get_ticks_ns();
 
   if(block->flags & EXTRAM_DEFLATE)
   {
@@ -1075,30 +1613,54 @@ static boolean retrieve_buffer_from_extram(struct extram_data *data,
     }
     trace("--EXTRAM--   inflated block of size %zu to %zu\n",
      (size_t)data->z.total_in, (size_t)data->z.total_out);
+
+    extram_measure_unpack(EXTRAM_M_DEFLATE, len, get_ticks_ns() - start);
   }
   else
 
-  if(block->flags & EXTRAM_RLE3)
+  if(block->flags & (EXTRAM_RLE3 | EXTRAM_LZ))
   {
-    // RLE3.
-    size_t sz = extram_alloc_size(block->compressed_size);
-    if(sz > sizeof(extram_deflate_buffer) ||
-     !extram_copy(extram_deflate_buffer, block->data, sz))
+    // RLE3 or LZ.
+    const uint8_t *packed = (const uint8_t *)block->data;
+    boolean ok;
+
+    if(block->flags & EXTRAM_PLATFORM_ALLOC)
     {
-      debug("--EXTRAM-- failed to copy RLE3 @ %p: uncompressed=%zu, compressed=%zu\n",
-        (void *)block, (size_t)block->uncompressed_size, (size_t)block->compressed_size
-      );
-      goto err;
+      // Platform extra RAM might not be byte addressable, so copy it first.
+      size_t sz = extram_alloc_size(block->compressed_size);
+      uint8_t *tmp = extram_get_buffer(data, extram_deflate_buffer,
+       sizeof(extram_deflate_buffer), sz);
+
+      if(!extram_copy(tmp, block->data, sz))
+      {
+        debug("--EXTRAM-- failed to copy %s @ %p: uncompressed=%zu, compressed=%zu\n",
+          RLE3_LZ_NAME(block->flags), (void *)block, (size_t)block->uncompressed_size,
+          (size_t)block->compressed_size
+        );
+        goto err;
+      }
+      packed = tmp;
     }
 
-    if(!RLE3_unpack(buffer, len, (void *)extram_deflate_buffer,
-     block->compressed_size))
+    if(block->flags & EXTRAM_LZ)
+    {
+      ok = LZ_unpack(buffer, len, packed, block->compressed_size);
+    }
+    else
+      ok = RLE3_unpack(buffer, len, packed, block->compressed_size);
+
+    if(!ok)
     {
-      debug("--EXTRAM-- failed to unpack RLE3 @ %p\n", (void *)block);
+      debug("--EXTRAM-- failed to unpack %s @ %p\n", RLE3_LZ_NAME(block->flags),
+       (void *)block);
       goto err;
     }
-    trace("--EXTRAM--   RLE3 unpacked block of size %zu to %zu\n",
-     (size_t)block->compressed_size, (size_t)block->uncompressed_size);
+    trace("--EXTRAM--   %s unpacked block of size %zu to %zu\n",
+     RLE3_LZ_NAME(block->flags), (size_t)block->compressed_size,
+     (size_t)block->uncompressed_size);
+
+    extram_measure_unpack((block->flags & EXTRAM_LZ) ? EXTRAM_M_LZ :
+     EXTRAM_M_RLE3, len, get_ticks_ns() - start);
   }
   else
   {
@@ -1132,7 +1694,7 @@ clear:
     free(block);
 
   platform_extram_unlock();
-  *src = (void *)buffer;
+  *src = (char *)buffer;
   return true;
 
 err:
@@ -1164,6 +1726,10 @@ void real_store_board_to_extram(struct board *board, const char *file, int line)
   trace("--EXTRAM-- storing board %p (%s:%d)\n", (void *)board, file, line);
   board->is_extram = true;
 
+  // Deferred boards have nothing to store yet.
+  if(board->deferred)
+    return;
+
   memset(&data, 0, sizeof(struct extram_data));
 
   // Layer data.
@@ -1232,6 +1798,7 @@ void real_store_board_to_extram(struct board *board, const char *file, int line)
 #endif
 
   extram_deflate_destroy(&data);
+  extram_free_buffer(&data);
   return;
 
 err:
@@ -1269,9 +1836,25 @@ void real_retrieve_board_from_extram(struct board *board, boolean free_data,
    (free_data ? "freeing" : "retrieving"), (void *)board, file, line);
   board->is_extram = false;
 
+  if(!free_data)
+    board->retrieved = BOARD_RETRIEVED_ALL;
+
+  if(board->deferred)
+  {
+    retrieve_board_deferred(board, free_data);
+    return;
+  }
+
   memset(&data, 0, sizeof(struct extram_data));
   data.free_data = free_data;
 
+  if(pending_copy && pending_board == board)
+  {
+    data.copy = pending_copy;
+    pending_copy = NULL;
+    pending_board = NULL;
+  }
+
   // Layer data.
   if(!retrieve_buffer_from_extram(&data, &board->level_id, board_size))
     goto err;
@@ -1332,6 +1915,8 @@ void real_retrieve_board_from_extram(struct board *board, boolean free_data,
     }
   }
   extram_inflate_destroy(&data);
+  extram_free_buffer(&data);
+  extram_free_board_copy(data.copy);
   return;
 
 err:
@@ -1342,6 +1927,256 @@ err:
   }
 }
 
+/**
+ * Get the extra RAM blocks of a board. If `blocks` is NULL, only count them.
+ */
+static size_t get_board_extram_blocks(struct board *board,
+ const void **blocks)
+{
+  struct robot **robot_list = board->robot_list;
+  const void *layers[8];
+  size_t num_layers = 6;
+  size_t num = 0;
+  size_t i;
+
+  layers[0] = board->level_id;
+  layers[1] = board->level_param;
+  layers[2] = board->level_color;
+  layers[3] = board->level_under_id;
+  layers[4] = board->level_under_param;
+  layers[5] = board->level_under_color;
+  if(board->overlay_mode)
+  {
+    layers[6] = board->overlay;
+    layers[7] = board->overlay_color;
+    num_layers = 8;
+  }
+
+  for(i = 0; i < num_layers; i++, num++)
+    if(blocks)
+      blocks[num] = layers[i];
+
+  for(i = 1; robot_list && i <= (size_t)board->num_robots; i++)
+  {
+    struct robot *cur_robot = robot_list[i];
+    if(!cur_robot)
+      continue;
+
+    if(cur_robot->program_bytecode)
+    {
+      if(blocks)
+        blocks[num] = cur_robot->program_bytecode;
+      num++;
+    }
+
+#if defined(CONFIG_DEBYTECODE) || defined(CONFIG_EDITOR)
+    if(cur_robot->program_source)
+    {
+      if(blocks)
+        blocks[num] = cur_robot->program_source;
+      num++;
+    }
+#endif
+
+#ifdef CONFIG_EDITOR
+    if(cur_robot->command_map)
+    {
+      if(blocks)
+        blocks[num] = cur_robot->command_map;
+      num++;
+    }
+#endif
+  }
+  return num;
+}
+
+/**
+ * Copy the extra RAM blocks of a board so they can be unpacked ahead of time
+ * on another thread with `extram_unpack_board_copy`. The board itself isn't
+ * touched. Returns NULL if the board isn't in extra RAM or its blocks are in
+ * platform extra RAM. `size` is set to the memory the copy will use once it
+ * has been unpacked.
+ */
+struct extram_board_copy *extram_copy_board(struct board *board, size_t *size)
+{
+#ifndef USE_PLATFORM_EXTRAM_STORE
+  struct extram_board_copy *copy;
+  const void **blocks;
+  size_t total;
+  size_t num;
+  size_t i;
+
+  if(!board->is_extram || board->deferred)
+    return NULL;
+
+  num = get_board_extram_blocks(board, NULL);
+  blocks = (const void **)cmalloc(num * sizeof(const void *));
+  get_board_extram_blocks(board, blocks);
+
+  total = sizeof(struct extram_board_copy) +
+   (num - 1) * sizeof(struct extram_copy_buffer);
+  copy = (struct extram_board_copy *)ccalloc(1, total);
+
+  for(i = 0; i < num; i++)
+  {
+    const struct extram_block *block = (const struct extram_block *)blocks[i];
+    struct extram_copy_buffer *cb = &copy->buffers[i];
+    size_t block_size;
+
+    if(block->id != EXTRAM_ID || (block->flags & EXTRAM_PLATFORM_ALLOC))
+      break;
+
+    block_size = extram_block_size(block->compressed_size);
+    cb->src = block;
+    cb->block = (struct extram_block *)cmalloc(block_size);
+    memcpy(cb->block, block, block_size);
+    copy->num_buffers++;
+
+    total += block_size + extram_alloc_size(block->uncompressed_size);
+  }
+  free(blocks);
+
+  if(copy->num_buffers < num)
+  {
+    extram_free_board_copy(copy);
+    return NULL;
+  }
+
+  *size = total;
+  return copy;
+#else
+  return NULL;
+#endif
+}
+
+/**
+ * Unpack an extra RAM block without using any shared state.
+ */
+static boolean extram_unpack_block(const struct extram_block *block,
+ uint8_t *dest, size_t len, z_stream *z, boolean *z_initialized)
+{
+  if(block->flags & EXTRAM_DEFLATE)
+  {
+    int res;
+
+    if(!*z_initialized)
+    {
+      memset(z, 0, sizeof(z_stream));
+      if(inflateInit2(z, -MAX_WBITS) != Z_OK)
+        return false;
+      *z_initialized = true;
+    }
+    else
+
+    if(inflateReset(z) != Z_OK)
+      return false;
+
+    z->next_in = (Bytef *)block->data;
+    z->avail_in = block->compressed_size;
+    z->next_out = dest;
+    z->avail_out = len;
+
+    res = inflate(z, Z_FINISH);
+    if(res != Z_STREAM_END || z->total_out != len)
+      return false;
+  }
+  else
+
+  if(block->flags & EXTRAM_LZ)
+  {
+    if(!LZ_unpack(dest, len, (const uint8_t *)block->data,
+     block->compressed_size))
+      return false;
+  }
+  else
+
+  if(block->flags & EXTRAM_RLE3)
+  {
+    if(!RLE3_unpack(dest, len, (const uint8_t *)block->data,
+     block->compressed_size))
+      return false;
+  }
+  else
+  {
+    if(block->compressed_size != len)
+      return false;
+    memcpy(dest, block->data, len);
+  }
+
+  return extram_checksum(dest, len) == block->checksum;
+}
+
+/**
+ * Unpack every block of a board copy. This is safe to call from any thread.
+ * Blocks that fail to unpack are retrieved normally instead.
+ */
+void extram_unpack_board_copy(struct extram_board_copy *copy)
+{
+  boolean z_initialized = false;
+  z_stream z;
+  size_t i;
+
+  for(i = 0; i < copy->num_buffers; i++)
+  {
+    struct extram_copy_buffer *cb = &copy->buffers[i];
+    size_t len = cb->block->uncompressed_size;
+    uint8_t *dest = (uint8_t *)malloc(extram_alloc_size(len));
+
+    if(dest && !extram_unpack_block(cb->block, dest, len, &z, &z_initialized))
+    {
+      free(dest);
+      dest = NULL;
+    }
+    cb->dest = (char *)dest;
+  }
+
+  if(z_initialized)
+    inflateEnd(&z);
+}
+
+/**
+ * Check if a board copy was taken from the blocks that are currently in
+ * extra RAM for a board.
+ */
+boolean extram_board_copy_is_current(struct board *board,
+ struct extram_board_copy *copy)
+{
+  const struct extram_block *block;
+
+  if(!board->is_extram || board->deferred || !copy->num_buffers)
+    return false;
+
+  block = (const struct extram_block *)board->level_id;
+  return copy->buffers[0].src == block &&
+   copy->buffers[0].block->checksum == block->checksum;
+}
+
+/**
+ * Use an unpacked board copy the next time this board is retrieved. This
+ * takes ownership of the copy.
+ */
+void extram_set_board_copy(struct board *board, struct extram_board_copy *copy)
+{
+  extram_free_board_copy(pending_copy);
+  pending_copy = copy;
+  pending_board = board;
+}
+
+void extram_free_board_copy(struct extram_board_copy *copy)
+{
+  size_t i;
+
+  if(!copy)
+    return;
+
+  for(i = 0; i < copy->num_buffers; i++)
+  {
+    free(copy->buffers[i].block);
+    free(copy->buffers[i].dest);
+  }
+  free(copy);
+}
+
 #ifdef CONFIG_EDITOR
 
 static boolean get_extram_buffer_usage(const void *buffer, size_t *compressed,
@@ -1382,7 +2217,7 @@ boolean board_extram_usage(struct board *board, size_t *compressed,
   *compressed = 0;
   *uncompressed = 0;
 
-  if(!board->is_extram)
+  if(!board->is_extram || board->deferred)
     return true;
 
   platform_extram_lock();
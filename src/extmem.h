@@ -25,9 +25,12 @@
 
 __M_BEGIN_DECLS
 
+#include "board.h"
 #include "board_struct.h"
 #include "world_struct.h"
 
+struct extram_board_copy;
+
 #define store_board_to_extram(b) \
  real_store_board_to_extram(b, __FILE__, __LINE__)
 #define retrieve_board_from_extram(b) \
@@ -51,6 +54,16 @@ CORE_LIBSPEC void real_store_board_to_extram(struct board *board,
 CORE_LIBSPEC void real_retrieve_board_from_extram(struct board *board,
  boolean free_data, const char *file, int line);
 
+// Copy a board's extra RAM so it can be unpacked ahead of time on another
+// thread (see board_prefetch.c), then hand the unpacked copy to the next
+// retrieval of that board.
+struct extram_board_copy *extram_copy_board(struct board *board, size_t *size);
+void extram_unpack_board_copy(struct extram_board_copy *copy);
+boolean extram_board_copy_is_current(struct board *board,
+ struct extram_board_copy *copy);
+void extram_set_board_copy(struct board *board, struct extram_board_copy *copy);
+void extram_free_board_copy(struct extram_board_copy *copy);
+
 #ifdef CONFIG_EDITOR
 CORE_LIBSPEC boolean board_extram_usage(struct board *board, size_t *compressed,
  size_t *uncompressed);
@@ -82,8 +95,23 @@ static inline void real_retrieve_board_from_extram(struct board *board,
   else
     warn("board %p isn't in extram! (%s:%d)\n", (void *)board, file, line);
 #endif
+
+  if(!free_data)
+    board->retrieved = BOARD_RETRIEVED_ALL;
+
+  if(board->deferred)
+    retrieve_board_deferred(board, free_data);
 }
 
+static inline struct extram_board_copy *extram_copy_board(struct board *board,
+ size_t *size) { return NULL; }
+static inline void extram_unpack_board_copy(struct extram_board_copy *copy) {}
+static inline boolean extram_board_copy_is_current(struct board *board,
+ struct extram_board_copy *copy) { return false; }
+static inline void extram_set_board_copy(struct board *board,
+ struct extram_board_copy *copy) {}
+static inline void extram_free_board_copy(struct extram_board_copy *copy) {}
+
 #endif /* !CONFIG_EXTRAM */
 
 static inline void real_set_current_board(struct world *mzx_world,
@@ -43,6 +43,7 @@
 #include "robot.h"
 #include "window.h"
 #include "world.h"
+#include "world_snapshot.h"
 #include "world_struct.h"
 #include "io/fsafeopen.h"
 #include "io/vio.h"
@@ -367,6 +368,39 @@ static boolean load_savegame(struct game_context *game, char *name)
   return false;
 }
 
+/**
+ * Restore a snapshot and prepare it for gameplay (see world_snapshots).
+ * The offset is relative to the snapshot last taken or restored; positive
+ * offsets rewind to older snapshots.
+ */
+
+static boolean load_snapshot(struct game_context *game, int offset)
+{
+  struct world *mzx_world = ((context *)game)->world;
+  boolean save_is_faded;
+
+  if(world_snapshot_restore(mzx_world, offset, &save_is_faded))
+  {
+    // Only send JUSTLOADED for savegames.
+    send_robot_def(mzx_world, 0, LABEL_JUSTLOADED);
+    find_player(mzx_world);
+
+    load_game_module(mzx_world, mzx_world->real_mod_playing, false);
+    sfx_clear_queue();
+
+    // Don't fade out and back in, so rewinding is seamless.
+    game->fade_in = false;
+    if(save_is_faded)
+      insta_fadeout();
+    else
+      insta_fadein();
+
+    caption_set_world(mzx_world);
+    return true;
+  }
+  return false;
+}
+
 /**
  * Open a user interface to select a world to load on the title.
  */
@@ -757,8 +791,13 @@ static boolean game_key(context *ctx, int *key)
       case IKEY_F9:
       {
         if(allow_save_menu(mzx_world))
-          save_world(mzx_world, curr_sav, true, MZX_VERSION);
-
+        {
+          // Shift+F9 - take a snapshot, or save normally if snapshots are
+          // disabled or the snapshot couldn't be taken.
+          if(!get_shift_status(keycode_internal) ||
+           !world_snapshot_take(mzx_world))
+            save_world(mzx_world, curr_sav, true, MZX_VERSION);
+        }
         return true;
       }
 
@@ -769,8 +808,17 @@ static boolean game_key(context *ctx, int *key)
         {
           struct stat file_info;
 
-          if(!vstat(curr_sav, &file_info))
-            load_savegame(game, curr_sav);
+          // Shift+F10 - restore the last snapshot (or load normally if
+          // there isn't one); Ctrl+F10 - rewind
+          if(get_ctrl_status(keycode_internal))
+            load_snapshot(game, 1);
+          else
+
+          if(!get_shift_status(keycode_internal) || !load_snapshot(game, 0))
+          {
+            if(!vstat(curr_sav, &file_info))
+              load_savegame(game, curr_sav);
+          }
         }
         return true;
       }
@@ -39,6 +39,8 @@
  * - The kh_get function has also been altered to optionally take a separate
  *   key pointer and key length parameters instead of a key struct.
  * - Alternate macros have been added to provide a uthash-like interface.
+ *   These only use per-table functions, so swisstable.h can provide the same
+ *   interface with a different table implementation.
  *
  * All changes to this file for MegaZeux are also licensed under the MIT License.
  * However, certain functions used here (check alloc, memcasecmp) are not.
@@ -290,6 +292,14 @@ static const size_t __ac_HASH_MAXIMUM = ((size_t)INT32_MAX) + 1;
     return 0;                                                             \
   } \
   \
+  static inline klib_unused int kh_reserve_##name(kh_##name##_t *h, size_t count) \
+  { \
+    size_t new_n_buckets = (size_t)(count / __ac_HASH_UPPER) + 1;         \
+    if(new_n_buckets <= h->n_buckets)                                     \
+      return 0;                                                           \
+    return kh_resize_##name(h, new_n_buckets);                            \
+  } \
+  \
   static inline klib_unused size_t kh_put_##name(kh_##name##_t *h, khkey_t key, int *ret) \
   { \
     size_t x;                                                             \
@@ -389,6 +399,25 @@ static const size_t __ac_HASH_MAXIMUM = ((size_t)INT32_MAX) + 1;
       if(kh_is_map)                                                       \
         h->vals[x] = 0;                                                   \
     }                                                                     \
+  } \
+  \
+  static inline klib_unused int kh_exist_##name(const kh_##name##_t *h, size_t x) \
+  { \
+    return kh_exist(h, x);                                                \
+  } \
+  \
+  static inline klib_unused size_t kh_memory_usage_##name(const kh_##name##_t *h) \
+  { \
+    size_t size = 0;                                                      \
+    if(h && h->keys)                                                      \
+    {                                                                     \
+      size = sizeof(*h);                                                  \
+      size += h->n_buckets * sizeof(h->keys[0]);                          \
+      size += __ac_fsize(h->n_buckets);                                   \
+      if(h->vals)                                                         \
+        size += h->n_buckets * sizeof(h->vals[0]);                        \
+    }                                                                     \
+    return size;                                                          \
   }
 
 #define KHASH_INIT2(name, khkey_t, khval_t, kh_is_map,    \
@@ -439,6 +468,14 @@ static const size_t __ac_HASH_MAXIMUM = ((size_t)INT32_MAX) + 1;
  */
 #define kh_resize(name, h, s) kh_resize_##name(h, s)
 
+/*! @function
+  @abstract     Make room in a hash table for a number of keys.
+  @param  name  Name of the hash table [symbol]
+  @param  h     Pointer to the hash table [khash_t(name)*]
+  @param  s     Number of keys the table should hold without growing [size_t]
+ */
+#define kh_reserve(name, h, s) kh_reserve_##name(h, s)
+
 /*! @function
   @abstract     Insert a key to the hash table.
   @param  name  Name of the hash table [symbol]
@@ -569,7 +606,7 @@ static const size_t __ac_HASH_MAXIMUM = ((size_t)INT32_MAX) + 1;
  */
 static inline uint32_t fnv_1a_hash_string_len(const void *_str, uint32_t len)
 {
-  const char *str = _str;
+  const char *str = (const char *)_str;
   uint32_t h = 0;
   for(; len; len--)
     h = (h ^ (uint32_t)memtolower((int)*(str++))) * 16777619;
@@ -615,6 +652,21 @@ static inline uint32_t fnv_1a_hash_string_len(const void *_str, uint32_t len)
   kh_put(n, (khash_t(n) *)h, keyobj, &_res);                      \
 } while(0)
 
+/**
+ * Make room in the hash table for a number of objects, so adding them won't
+ * need to grow the table. Useful when many objects are added at once.
+ * If the hash table hasn't been initialized, this function will initialize it.
+ *
+ * @param name    The unique identifier of the hash table type (e.g. COUNTER).
+ * @param h       Variable containing hash table pointer.
+ * @param count   Total number of objects the table should be able to hold.
+ */
+#define HASH_RESERVE(n, h, count) do                              \
+{                                                                 \
+  if(!h) h = kh_init(n);                                          \
+  kh_reserve(n, (khash_t(n) *)h, count);                          \
+} while(0)
+
 /**
  * Find an object in the hash table.
  * If the hash table hasn't been initialized, this function will do nothing.
@@ -693,7 +745,7 @@ static inline uint32_t fnv_1a_hash_string_len(const void *_str, uint32_t len)
   size_t __i;                                                     \
   if(_h) for(__i = kh_begin(__h); __i != kh_end(__h); __i++)      \
   {                                                               \
-    if(!kh_exist(__h, __i)) continue;                             \
+    if(!kh_exist_##n(__h, __i)) continue;                         \
     (element) = kh_key(__h, __i);                                 \
     code;                                                         \
   }                                                               \
@@ -708,17 +760,7 @@ static inline uint32_t fnv_1a_hash_string_len(const void *_str, uint32_t len)
  */
 #define HASH_MEMORY_USAGE(n, _h, size) do                         \
 {                                                                 \
-  khash_t(n) *__h = _h;                                           \
-  if(__h && __h->keys)                                            \
-  {                                                               \
-    (size) = sizeof(*__h);                                        \
-    (size) += __h->n_buckets * sizeof(__h->keys[0]);              \
-    (size) += __ac_fsize(__h->n_buckets);                         \
-    if(__h->vals)                                                 \
-      (size) += __h->n_buckets * sizeof(__h->vals[0]);            \
-  }                                                               \
-  else                                                            \
-    (size) = 0;                                                   \
+  (size) = kh_memory_usage_##n((const khash_t(n) *)(_h));         \
 } while(0)
 
 __M_END_DECLS
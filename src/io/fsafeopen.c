@@ -18,10 +18,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #include "fsafeopen.h"
@@ -52,6 +54,14 @@
 #define NO_EXTRA_CASE_CHECKS
 #endif
 
+#if !defined(CONFIG_DJGPP)
+// Keep the names found in recently scanned directories so case5 doesn't have
+// to read the entire directory again for every file opened from it. DOS
+// needs to check generated SFNs for every name, so this isn't useful there.
+#define FSAFE_DIR_CACHE
+#include "../hashtable.h"
+#endif
+
 enum sfn_type
 {
   NOT_AN_SFN,
@@ -300,6 +310,165 @@ static void case4(char *string)
     string[i] = toupper((int)string[i]);
 }
 
+#ifdef FSAFE_DIR_CACHE
+
+#define FSAFE_DIR_CACHE_SIZE 8
+
+struct fsafe_dir_name
+{
+  uint32_t hash;
+  uint16_t name_length;
+  char name[1];
+};
+
+HASH_SET_INIT(FSAFE_DIR, struct fsafe_dir_name *, name, name_length)
+
+struct fsafe_dir
+{
+  hash_t(FSAFE_DIR) *names;
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+  time_t scan_time;
+  unsigned int generation;
+  unsigned int last_used;
+  boolean valid;
+};
+
+static struct fsafe_dir fsafe_dir_cache[FSAFE_DIR_CACHE_SIZE];
+static unsigned int fsafe_dir_cache_uses;
+
+static void fsafe_dir_clear(struct fsafe_dir *d)
+{
+  struct fsafe_dir_name *n;
+
+  HASH_ITER(FSAFE_DIR, d->names, n, { free(n); });
+  HASH_CLEAR(FSAFE_DIR, d->names);
+  d->valid = false;
+}
+
+/**
+ * Read every name in a directory into a cache entry. If there are multiple
+ * names that only differ by case, the first one read is kept, which is the
+ * same one a scan in case5 would have found. The path buffer is reused to
+ * read names and must be MAX_PATH long.
+ */
+static boolean fsafe_dir_scan(struct fsafe_dir *d, char *path)
+{
+  vdir *wd = vdir_open_ext(path, VDIR_FAST);
+  if(!wd)
+    return false;
+
+  while(vdir_read(wd, path, MAX_PATH, NULL))
+  {
+    struct fsafe_dir_name *n;
+    size_t len = strlen(path);
+
+    HASH_FIND(FSAFE_DIR, d->names, path, len, n);
+    if(n || len > UINT16_MAX)
+      continue;
+
+    n = (struct fsafe_dir_name *)cmalloc(
+     offsetof(struct fsafe_dir_name, name) + len + 1);
+    n->name_length = len;
+    memcpy(n->name, path, len + 1);
+    HASH_ADD(FSAFE_DIR, d->names, n);
+  }
+
+  vdir_close(wd);
+  d->valid = true;
+  return true;
+}
+
+/**
+ * Find a case-insensitive match for a name using the cached names of the
+ * directory it is in, (re)scanning the directory if necessary. The cached
+ * names are discarded if the directory's modification time changes or if
+ * vio reports any changes made to the filesystem through it.
+ *
+ * @param  path     Directory to search, in a MAX_PATH buffer (may be modified).
+ * @param  string   Name to find. This will be replaced by the match, if any.
+ * @return          FSAFE_SUCCESS if a match was found,
+ *                  -FSAFE_BRUTE_FORCE_FAILED if there is no match, or
+ *                  -FSAFE_MATCH_FAILED if the directory can't be cached.
+ */
+static int fsafe_dir_cache_match(char *path, char *string)
+{
+  unsigned int generation = vio_directory_generation();
+  struct fsafe_dir *d = NULL;
+  struct fsafe_dir_name *n;
+  struct stat st;
+  size_t i;
+
+  // Directories are identified by their inode numbers, which aren't always
+  // available (Windows). The VFS already caches its own directory listings.
+  if(vstat(path, &st) || !S_ISDIR(st.st_mode) || !st.st_ino ||
+   st.st_dev == (dev_t)VFS_MZX_DEVICE)
+    return -FSAFE_MATCH_FAILED;
+
+  for(i = 0; i < FSAFE_DIR_CACHE_SIZE; i++)
+  {
+    struct fsafe_dir *c = &fsafe_dir_cache[i];
+    if(c->valid && c->dev == st.st_dev && c->ino == st.st_ino)
+    {
+      d = c;
+      break;
+    }
+  }
+
+  // Modification times usually have a resolution of one second, so names
+  // read during the same second as the last modification may be outdated.
+  if(d && (d->mtime != st.st_mtime || d->scan_time <= d->mtime ||
+   d->generation != generation))
+    fsafe_dir_clear(d);
+
+  if(!d || !d->valid)
+  {
+    if(!d)
+    {
+      d = &fsafe_dir_cache[0];
+      for(i = 1; i < FSAFE_DIR_CACHE_SIZE; i++)
+        if(fsafe_dir_cache[i].last_used < d->last_used)
+          d = &fsafe_dir_cache[i];
+
+      fsafe_dir_clear(d);
+    }
+
+    d->dev = st.st_dev;
+    d->ino = st.st_ino;
+    d->mtime = st.st_mtime;
+    d->scan_time = time(NULL);
+    d->generation = generation;
+    if(!fsafe_dir_scan(d, path))
+    {
+      fsafe_dir_clear(d);
+      return -FSAFE_MATCH_FAILED;
+    }
+  }
+  d->last_used = ++fsafe_dir_cache_uses;
+
+  HASH_FIND(FSAFE_DIR, d->names, string, strlen(string), n);
+  if(!n)
+    return -FSAFE_BRUTE_FORCE_FAILED;
+
+  memcpy(string, n->name, n->name_length + 1);
+  return FSAFE_SUCCESS;
+}
+
+#endif /* FSAFE_DIR_CACHE */
+
+/**
+ * Free the cached directory listings (if any). This should be called on exit.
+ */
+void fsafeopen_free_cache(void)
+{
+#ifdef FSAFE_DIR_CACHE
+  size_t i;
+  for(i = 0; i < FSAFE_DIR_CACHE_SIZE; i++)
+    fsafe_dir_clear(&fsafe_dir_cache[i]);
+#endif
+}
+
 // brute force method; returns -1 if no permutation can be found to work
 
 static int case5(char *path, size_t buffer_len, char *string, boolean check_sfn)
@@ -309,7 +478,7 @@ static int case5(char *path, size_t buffer_len, char *string, boolean check_sfn)
   vdir *wd;
   char *newpath;
 
-  newpath = cmalloc(MAX_PATH);
+  newpath = (char *)cmalloc(MAX_PATH);
 
   // prepend the working directory
   snprintf(newpath, MAX_PATH, "./");
@@ -323,6 +492,21 @@ static int case5(char *path, size_t buffer_len, char *string, boolean check_sfn)
     newpath[dirlen + 2 - 1] = 0;
   }
 
+#ifdef FSAFE_DIR_CACHE
+  // Truncated SFNs need to be checked against an SFN generated for every
+  // name in the directory, so they always need a full scan.
+  if(is_sfn(string, strlen(string)) != SFN_TRUNCATED)
+  {
+    ret = fsafe_dir_cache_match(newpath, string);
+    if(ret != -FSAFE_MATCH_FAILED)
+    {
+      free(newpath);
+      return ret;
+    }
+    ret = -FSAFE_BRUTE_FORCE_FAILED;
+  }
+#endif
+
   wd = vdir_open_ext(newpath, VDIR_FAST);
   if(wd)
   {
@@ -661,13 +845,16 @@ int fsafetranslate(const char *path, char *newpath, size_t buffer_len)
   return ret;
 }
 
-vfile *fsafeopen(const char *path, const char *mode)
+/**
+ * Validate a path and open it with user-defined vfile flags.
+ */
+vfile *fsafeopen_ext(const char *path, const char *mode, int user_flags)
 {
   char *newpath;
   int i, ret;
   vfile *f;
 
-  newpath = cmalloc(MAX_PATH);
+  newpath = (char *)cmalloc(MAX_PATH);
 
   // validate pathname, and optionally retrieve a better name
   ret = fsafetranslate(path, newpath, MAX_PATH);
@@ -695,11 +882,16 @@ vfile *fsafeopen(const char *path, const char *mode)
   }
 
   // _TRY_ opening the file
-  f = vfopen_unsafe(newpath, mode);
+  f = vfopen_unsafe_ext(newpath, mode, user_flags);
   free(newpath);
   return f;
 }
 
+vfile *fsafeopen(const char *path, const char *mode)
+{
+  return fsafeopen_ext(path, mode, 0);
+}
+
 /* It's conceivable that on some platforms (like Linux, or Macintosh classic),
  * fgets may return a string that still contains "EOL" characters considered
  * by another platform. For example, if a file is written out by Windows,
@@ -41,7 +41,9 @@ enum
 };
 
 int fsafetranslate(const char *path, char *newpath, size_t buffer_len);
+vfile *fsafeopen_ext(const char *path, const char *mode, int user_flags);
 vfile *fsafeopen(const char *path, const char *mode);
+CORE_LIBSPEC void fsafeopen_free_cache(void);
 
 __M_END_DECLS
 
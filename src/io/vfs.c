@@ -61,6 +61,7 @@ enum vfs_inode_flags
   VFS_INODE_DIR        = (1<<1),
   VFS_INODE_TYPEMASK   = VFS_INODE_FILE | VFS_INODE_DIR,
   VFS_INODE_IS_REAL    = (1<<2), // Cache of a real location in the filesystem.
+  VFS_INODE_IN_LRU     = (1<<3), // In the LRU list of cached files.
   VFS_INODE_NAME_ALLOC = (1<<7),
 };
 
@@ -84,6 +85,8 @@ struct vfs_inode
   uint8_t refcount; // If 255, refuse creation of new refs.
   uint16_t name_length;
   uint32_t parent;
+  uint32_t lru_prev;
+  uint32_t lru_next;
   char name[16];
 };
 
@@ -101,6 +104,8 @@ struct vfs_inode_name_alloc
   uint8_t refcount; // If 255, refuse creation of new refs.
   uint16_t name_length;
   uint32_t parent;
+  uint32_t lru_prev;
+  uint32_t lru_next;
   char *name;
 };
 
@@ -121,6 +126,11 @@ struct vfilesystem
   int num_promotions;
 #endif
   size_t cache_total;
+  size_t cache_hits;
+  size_t cache_misses;
+  size_t cache_evictions;
+  uint32_t lru_head; // Most recently used cached file.
+  uint32_t lru_tail; // Least recently used cached file.
   boolean is_writer;
   boolean disable_timestamp;
   int error;
@@ -651,6 +661,49 @@ static struct vfs_inode *vfs_get_inode_ptr(vfilesystem *vfs, uint32_t inode)
   return vfs->table[inode];
 }
 
+/**
+ * Cached files that aren't currently open are kept in a list ordered by when
+ * they were last used, so the least recently used file can be found for
+ * eviction without searching the inode table. The caller needs a write lock.
+ */
+static void vfs_lru_insert(vfilesystem *vfs, uint32_t inode)
+{
+  struct vfs_inode *n = vfs_get_inode_ptr(vfs, inode);
+  if(n->flags & VFS_INODE_IN_LRU)
+    return;
+
+  n->lru_prev = VFS_NO_INODE;
+  n->lru_next = vfs->lru_head;
+  if(vfs->lru_head != VFS_NO_INODE)
+    vfs_get_inode_ptr(vfs, vfs->lru_head)->lru_prev = inode;
+  else
+    vfs->lru_tail = inode;
+
+  vfs->lru_head = inode;
+  n->flags |= VFS_INODE_IN_LRU;
+}
+
+static void vfs_lru_remove(vfilesystem *vfs, uint32_t inode)
+{
+  struct vfs_inode *n = vfs_get_inode_ptr(vfs, inode);
+  if(~n->flags & VFS_INODE_IN_LRU)
+    return;
+
+  if(n->lru_prev != VFS_NO_INODE)
+    vfs_get_inode_ptr(vfs, n->lru_prev)->lru_next = n->lru_next;
+  else
+    vfs->lru_head = n->lru_next;
+
+  if(n->lru_next != VFS_NO_INODE)
+    vfs_get_inode_ptr(vfs, n->lru_next)->lru_prev = n->lru_prev;
+  else
+    vfs->lru_tail = n->lru_prev;
+
+  n->lru_prev = VFS_NO_INODE;
+  n->lru_next = VFS_NO_INODE;
+  n->flags &= ~VFS_INODE_IN_LRU;
+}
+
 /**
  * Get the next unused inode in the VFS. table_next will be advanced to the
  * position of the returned inode. This will allocate more inode space in the
@@ -1042,6 +1095,10 @@ static uint32_t vfs_make_inode(vfilesystem *vfs, uint32_t parent,
 
   vfs_inode_insert_directory(p, pos, pos_in_parent);
   n->parent = parent;
+
+  if(is_real && (flags & VFS_INODE_TYPEMASK) == VFS_INODE_FILE)
+    vfs_lru_insert(vfs, pos);
+
   return pos;
 }
 
@@ -1082,6 +1139,9 @@ static boolean vfs_delete_inode(vfilesystem *vfs, uint32_t inode)
     n->parent = VFS_NO_INODE;
   }
 
+  // Deleted files are never eligible for eviction, even while still open.
+  vfs_lru_remove(vfs, inode);
+
   // Clear the inode and mark it for reuse if it's not currently in-use.
   if(n->refcount == 0)
   {
@@ -1500,11 +1560,22 @@ int vfs_open_if_exists(vfilesystem *vfs, const char *path, boolean is_write,
   }
 
   n->refcount++;
+  *_inode = inode;
   if(VFS_IS_CACHED(n))
+  {
     code = VFS_ERR_IS_CACHED;
 
+    // Open files can't be evicted, so take this out of the LRU list.
+    if(vfs_elevate_lock(vfs))
+    {
+      vfs->cache_hits++;
+      vfs_lru_remove(vfs, inode);
+      vfs_write_unlock(vfs);
+      return -code;
+    }
+  }
+
   vfs_read_unlock(vfs);
-  *_inode = inode;
   return -code;
 
 err:
@@ -1537,17 +1608,22 @@ int vfs_close(vfilesystem *vfs, uint32_t inode)
   n->modify_time = vfs_get_date();
   if(VFS_IS_CACHED(n))
   {
-    if(n->refcount == 0 && VFS_IS_INVALIDATED(n))
+    if(!vfs->disable_timestamp)
+      n->timestamp = vfs_get_timestamp();
+
+    if(n->refcount == 0 && vfs_elevate_lock(vfs))
     {
-      if(vfs_elevate_lock(vfs))
+      // Another thread may have opened this while waiting for the lock.
+      if(n->refcount == 0)
       {
-        vfs_delete_inode(vfs, inode);
-        vfs_write_unlock(vfs);
-        return 0;
+        if(VFS_IS_INVALIDATED(n))
+          vfs_delete_inode(vfs, inode);
+        else
+          vfs_lru_insert(vfs, inode);
       }
+      vfs_write_unlock(vfs);
+      return 0;
     }
-    if(!vfs->disable_timestamp)
-      n->timestamp = vfs_get_timestamp();
   }
 
   vfs_read_unlock(vfs);
@@ -2591,35 +2667,11 @@ int vfs_invalidate_at_path(vfilesystem *vfs, const char *path)
   return -code;
 }
 
-struct sort_data
-{
-  struct vfs_inode *n;
-  uint32_t inode;
-};
-
-static int invalidate_sort_fn(const void *A, const void *B)
-{
-  const struct sort_data *a = (const struct sort_data *)A;
-  const struct sort_data *b = (const struct sort_data *)B;
-
-  // Sort by timestamp ascending (invalidate older files first).
-  // Intentionally underflow since these are 32-bit truncated timestamps.
-  if(a->n->timestamp != b->n->timestamp)
-    return (int32_t)b->n->timestamp - (int32_t)a->n->timestamp;
-
-  // Sort by size descending.
-  if(a->n->length_alloc != b->n->length_alloc)
-    return a->n->length_alloc > b->n->length_alloc ? -1 : 1;
-
-  // Stabilize using the unique inode number.
-  return a->inode < b->inode ? -1 : a->inode > b->inode ? 1 : 0;
-}
-
 /**
  * Free cached entries until the amount of memory pointed to by
- * `amount_to_free` has been invalidated. This function ignores cached
- * entries that have active references and directories. This may be an
- * expensive operation.
+ * `amount_to_free` has been invalidated. Entries are freed starting with the
+ * least recently used. This function ignores cached entries that have active
+ * references and directories.
  *
  * @param vfs       VFS handle
  * @param amount_to_free  a pointer to the amount of memory to be freed
@@ -2632,13 +2684,7 @@ static int invalidate_sort_fn(const void *A, const void *B)
  */
 int vfs_invalidate_at_least(vfilesystem *vfs, size_t *_amount_to_free)
 {
-  struct sort_data fallback[64];
-  struct sort_data *targets;
   size_t amount_to_free;
-  size_t total_free;
-  size_t max_targets;
-  size_t num_targets;
-  size_t i;
 
   if(!_amount_to_free)
     return -EINVAL;
@@ -2647,75 +2693,34 @@ int vfs_invalidate_at_least(vfilesystem *vfs, size_t *_amount_to_free)
 
   amount_to_free = *_amount_to_free;
 
-  if(!vfs_read_lock(vfs))
+  if(!vfs_write_lock(vfs))
     return -vfs_geterror(vfs);
 
-  // This is likely too large, but that's why there's a fallback table.
-  max_targets = vfs->table_length;
-  targets = (struct sort_data *)malloc(max_targets * sizeof(struct sort_data));
-  if(!targets)
-  {
-    targets = fallback;
-    max_targets = ARRAY_SIZE(fallback);
-  }
-
-  num_targets = 0;
-  for(i = 0; i < vfs->table_length; i++)
+  // Delete entries from least to most recently used until the threshold is
+  // reached. Directories are never in this list. Open files are normally
+  // removed from it, but vfs_open_if_exists can't do that if it fails to
+  // elevate its lock; unlink them here instead. vfs_close puts them back.
+  while(vfs->lru_tail != VFS_NO_INODE && amount_to_free > 0)
   {
-    struct vfs_inode *n = vfs->table[i];
-
-    if(n && VFS_INODE_TYPE(n) == VFS_INODE_FILE && n->refcount == 0 &&
-     VFS_IS_CACHED(n) && !VFS_IS_INVALIDATED(n))
-    {
-      struct sort_data tmp = { n, i };
-      targets[num_targets++] = tmp;
-
-      if(num_targets >= max_targets)
-        break;
-    }
-  }
-
-  if(num_targets)
-    qsort(targets, num_targets, sizeof(struct sort_data), invalidate_sort_fn);
-
-  // Can't do anything, just exit.
-  if(!num_targets || !vfs_elevate_lock(vfs))
-  {
-    vfs_read_unlock(vfs);
-    if(targets != fallback)
-      free(targets);
-    return 0;
-  }
+    uint32_t inode = vfs->lru_tail;
+    struct vfs_inode *n = vfs_get_inode_ptr(vfs, inode);
+    size_t length_alloc = n->length_alloc;
 
-  // If there is an oldest accessed file of at least the requested size and no
-  // open references, deleting it should be good enough.
-  for(i = 0; i < num_targets; i++)
-  {
-    if(targets[i].n->length_alloc >= amount_to_free)
+    if(n->refcount != 0 || !vfs_delete_inode(vfs, inode))
     {
-      vfs_delete_inode(vfs, targets[i].inode);
-      amount_to_free = 0;
-      goto success;
+      // Make sure this can't loop forever.
+      vfs_lru_remove(vfs, inode);
+      continue;
     }
-  }
 
-  // Delete entries from oldest to newest until the threshold is reached.
-  total_free = 0;
-  for(i = 0; i < num_targets && total_free < amount_to_free; i++)
-  {
-    total_free += targets[i].n->length_alloc;
-    vfs_delete_inode(vfs, targets[i].inode);
-    if(total_free >= amount_to_free)
-      break;
+    amount_to_free = amount_to_free > length_alloc ?
+     amount_to_free - length_alloc : 0;
+    vfs->cache_evictions++;
   }
-  amount_to_free = amount_to_free > total_free ? amount_to_free - total_free : 0;
 
-success:
   vfs_write_unlock(vfs);
 
   *_amount_to_free = amount_to_free;
-  if(targets != fallback)
-    free(targets);
   return 0;
 }
 
@@ -2869,6 +2874,8 @@ int vfs_cache_file_callback(vfilesystem *vfs, const char *path,
       n->length = readfn(n->contents.data, n->length_alloc, priv);
     else
       n->length = 0;
+
+    vfs->cache_misses++;
   }
   else
     code = vfs_geterror(vfs);
@@ -2949,6 +2956,27 @@ size_t vfs_get_cache_total_size(vfilesystem *vfs)
   return sz;
 }
 
+/**
+ * Get the number of cache hits, misses, and evictions since the VFS was
+ * created. A hit is any time a cached file is opened; a miss is any time
+ * a file is added to the cache.
+ *
+ * @param vfs         VFS handle.
+ * @param stats       pointer to store the cache statistics to.
+ */
+void vfs_get_cache_stats(vfilesystem *vfs, struct vfs_cache_stats *stats)
+{
+  memset(stats, 0, sizeof(struct vfs_cache_stats));
+
+  if(vfs_read_lock(vfs))
+  {
+    stats->hits = vfs->cache_hits;
+    stats->misses = vfs->cache_misses;
+    stats->evictions = vfs->cache_evictions;
+    vfs_read_unlock(vfs);
+  }
+}
+
 /**
  * Get the total memory usage for the entire VFS.
  * This may be a slow operation.
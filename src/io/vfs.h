@@ -66,6 +66,13 @@ struct vfs_dir
   size_t num_files;
 };
 
+struct vfs_cache_stats
+{
+  size_t hits;
+  size_t misses;
+  size_t evictions;
+};
+
 UTILS_LIBSPEC vfilesystem *vfs_init(void);
 UTILS_LIBSPEC void vfs_free(vfilesystem *vfs);
 
@@ -109,6 +116,8 @@ UTILS_LIBSPEC int vfs_cache_file_callback(vfilesystem *vfs, const char *path,
  size_t (*readfn)(void * RESTRICT, size_t, void * RESTRICT),
  void *priv, size_t data_length);
 UTILS_LIBSPEC size_t vfs_get_cache_total_size(vfilesystem *vfs);
+UTILS_LIBSPEC void vfs_get_cache_stats(vfilesystem *vfs,
+ struct vfs_cache_stats *stats);
 UTILS_LIBSPEC size_t vfs_get_total_memory_usage(vfilesystem *vfs);
 UTILS_LIBSPEC void vfs_set_timestamps_enabled(vfilesystem *vfs, boolean enable);
 
@@ -152,6 +161,8 @@ static inline int vfs_cache_file_callback(vfilesystem *v, const char *p,
  size_t (*r)(void * RESTRICT, size_t, void * RESTRICT),
  void *pr, size_t l) { return -1; }
 static inline size_t vfs_get_cache_total_size(vfilesystem *v) { return 0; }
+static inline void vfs_get_cache_stats(vfilesystem *v,
+ struct vfs_cache_stats *s) { s->hits = s->misses = s->evictions = 0; }
 static inline size_t vfs_get_total_memory_usage(vfilesystem *vfs) { return 0; }
 static inline void vfs_set_timestamps_enabled(vfilesystem *v, boolean e) { }
 
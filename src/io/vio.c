@@ -87,6 +87,10 @@ static size_t vfs_max_size = 0;
 static size_t vfs_max_auto_cache_file_size = 0;
 static boolean vfs_enable_auto_cache = false;
 
+// Incremented whenever a file or directory is created, renamed, or removed
+// through these functions. See vio_directory_generation.
+static unsigned int vio_dir_generation = 0;
+
 /**
  * Recursively cache the provided directory path if it doesn't exist in
  * the cache, including the root. This function will cache as much of `path`
@@ -364,6 +368,23 @@ size_t vio_filesystem_total_cached_usage(void)
   return 0;
 }
 
+/**
+ * Get the number of cache hits, misses, and evictions of the vio.c virtual
+ * filesystem.
+ */
+void vio_filesystem_cache_stats(size_t *hits, size_t *misses,
+ size_t *evictions)
+{
+  struct vfs_cache_stats stats = { 0, 0, 0 };
+
+  if(vfs_base)
+    vfs_get_cache_stats(vfs_base, &stats);
+
+  *hits = stats.hits;
+  *misses = stats.misses;
+  *evictions = stats.evictions;
+}
+
 /**
  * Get the total memory usage of the vio.c virtual filesystem,
  * INCLUDING cached files.
@@ -395,6 +416,8 @@ boolean vio_virtual_file(const char *path)
   if(!vfs_base)
     return false;
 
+  vio_dir_generation++;
+
   if(!vio_cache_parent_recursively(vfs_base, path))
     return false;
 
@@ -423,6 +446,8 @@ boolean vio_virtual_directory(const char *path)
   if(!vfs_base)
     return false;
 
+  vio_dir_generation++;
+
   if(!vio_cache_parent_recursively(vfs_base, path))
     return false;
 
@@ -433,6 +458,18 @@ boolean vio_virtual_directory(const char *path)
   return true;
 }
 
+/**
+ * Get a counter that is incremented whenever vmkdir, vrename, vunlink, vrmdir,
+ * or the virtual file/directory functions are called. Anything derived from
+ * directory listings should be discarded if this value changes. Changes made
+ * to directories by other programs (or by creating files with vfopen) are not
+ * reflected here; check the directory's modification time for those.
+ */
+unsigned int vio_directory_generation(void)
+{
+  return vio_dir_generation;
+}
+
 /**
  * Invalidate and purge cached files in the VFS until at least
  * the amount of memory pointed to by `amount_to_free` has been invalided.
@@ -808,6 +845,46 @@ boolean vfile_force_to_memory(vfile *vf)
   return true;
 }
 
+/**
+ * Like vfile_force_to_memory, but map a regular vfile in READ mode into
+ * memory instead of copying it. This function will ALWAYS rewind on success.
+ * Returns false (and leaves the vfile unmodified) if the vfile isn't a
+ * regular file in READ mode or if the platform doesn't support mapping.
+ */
+boolean vfile_map_to_memory(vfile *vf)
+{
+#ifdef PLATFORM_MMAP
+  int64_t len;
+  void *buffer;
+
+  assert(vf);
+  if((vf->flags & (VF_STORAGE_MASK | VF_WRITE | VF_VIRTUAL)) != VF_FILE)
+    return false;
+
+  len = vfilelength(vf, false);
+  if(len <= 0 || (uint64_t)len >= SIZE_MAX)
+    return false;
+
+  buffer = platform_mmap_read(vf->fp, len);
+  if(!buffer)
+    return false;
+
+  mfopen(buffer, len, &(vf->mf));
+  vf->mf.seek_past_end = true;
+  vf->tmp_chr = EOF;
+  vf->flags |= VF_MEMORY | VF_MEMORY_MAPPED;
+  vf->local_buffer = buffer;
+  vf->local_buffer_size = len;
+
+  fclose(vf->fp);
+  vf->flags &= ~VF_FILE;
+  vf->fp = NULL;
+  return true;
+#else
+  return false;
+#endif
+}
+
 /**
  * Close a file. The file pointer should not be used after using this function.
  */
@@ -836,6 +913,11 @@ int vfclose(vfile *vf)
     }
   }
 
+#ifdef PLATFORM_MMAP
+  if((vf->flags & VF_MEMORY) && (vf->flags & VF_MEMORY_MAPPED))
+    platform_munmap(vf->local_buffer, vf->local_buffer_size);
+#endif
+
   if(vf->flags & VF_FILE)
     retval = fclose(vf->fp);
 
@@ -903,6 +985,8 @@ char *vgetcwd(char *buf, size_t size)
  */
 int vmkdir(const char *path, int mode)
 {
+  vio_dir_generation++;
+
   if(vfs_base)
   {
     char buffer[MAX_PATH];
@@ -932,6 +1016,8 @@ int vmkdir(const char *path, int mode)
  */
 int vrename(const char *oldpath, const char *newpath)
 {
+  vio_dir_generation++;
+
   if(vfs_base)
   {
     char buffer1[MAX_PATH];
@@ -976,6 +1062,8 @@ int vrename(const char *oldpath, const char *newpath)
  */
 int vunlink(const char *path)
 {
+  vio_dir_generation++;
+
   if(vfs_base)
   {
     char buffer[MAX_PATH];
@@ -1006,6 +1094,8 @@ int vunlink(const char *path)
  */
 int vrmdir(const char *path)
 {
+  vio_dir_generation++;
+
   if(vfs_base)
   {
     char buffer[MAX_PATH];
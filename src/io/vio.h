@@ -45,6 +45,7 @@ enum vfileflags
   VF_BINARY             = (1<<7),
   VF_TRUNCATE           = (1<<8),
   VF_VIRTUAL            = (1<<9), // Virtual or cached file.
+  VF_MEMORY_MAPPED      = (1<<10), // Unmap memory buffer on vfclose.
 
   /* Public flags. */
   V_DONT_CACHE   = (1<<27), // do not add this file to the cache.
@@ -77,7 +78,10 @@ UTILS_LIBSPEC boolean vio_filesystem_init(size_t max_size, size_t max_file_size,
  boolean enable_auto_cache);
 UTILS_LIBSPEC boolean vio_filesystem_exit(void);
 UTILS_LIBSPEC size_t vio_filesystem_total_cached_usage(void);
+UTILS_LIBSPEC void vio_filesystem_cache_stats(size_t *hits, size_t *misses,
+ size_t *evictions);
 UTILS_LIBSPEC size_t vio_filesystem_total_memory_usage(void);
+UTILS_LIBSPEC unsigned int vio_directory_generation(void);
 UTILS_LIBSPEC boolean vio_virtual_file(const char *path);
 UTILS_LIBSPEC boolean vio_virtual_directory(const char *path);
 UTILS_LIBSPEC boolean vio_invalidate_at_least(size_t *amount_to_free);
@@ -92,6 +96,7 @@ UTILS_LIBSPEC vfile *vfile_init_mem_ext(void **external_buffer,
  size_t *external_buffer_size, const char *mode);
 UTILS_LIBSPEC vfile *vtempfile(size_t initial_size);
 UTILS_LIBSPEC boolean vfile_force_to_memory(vfile *vf);
+UTILS_LIBSPEC boolean vfile_map_to_memory(vfile *vf);
 UTILS_LIBSPEC int vfclose(vfile *vf);
 
 UTILS_LIBSPEC int vfile_get_mode_flags(const char *mode);
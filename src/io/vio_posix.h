@@ -221,6 +221,33 @@ static inline int64_t platform_filelength(FILE *fp)
 
 #endif /* fstat */
 
+#if defined(_POSIX_MAPPED_FILES) && _POSIX_MAPPED_FILES > 0 && \
+ !defined(__EMSCRIPTEN__)
+#define PLATFORM_MMAP 1
+#include <sys/mman.h>
+
+/**
+ * Map the first `len` bytes of a file into memory for reading. The mapping
+ * stays valid after the file is closed. Returns NULL on failure.
+ */
+static inline void *platform_mmap_read(FILE *fp, size_t len)
+{
+  int fd = fileno(fp);
+  void *ptr;
+
+  if(fd < 0 || !len)
+    return NULL;
+
+  ptr = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  return (ptr != MAP_FAILED) ? ptr : NULL;
+}
+
+static inline void platform_munmap(void *ptr, size_t len)
+{
+  munmap(ptr, len);
+}
+#endif /* _POSIX_MAPPED_FILES */
+
 __M_END_DECLS
 
 #endif /* __IO_VIO_POSIX_H */
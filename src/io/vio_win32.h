@@ -32,6 +32,8 @@ __M_BEGIN_DECLS
 #include <stdio.h>
 #include <sys/stat.h>
 
+#include <io.h>
+
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
@@ -382,6 +384,41 @@ static inline int64_t platform_filelength(FILE *fp)
   return fd >= 0 ? _filelengthi64(fd) : -1;
 }
 
+#define PLATFORM_MMAP 1
+
+/**
+ * Map the first `len` bytes of a file into memory for reading. The view
+ * stays valid after the file and the mapping handle are closed. Returns
+ * NULL on failure.
+ */
+static inline void *platform_mmap_read(FILE *fp, size_t len)
+{
+  int fd = _fileno(fp);
+  HANDLE fh;
+  HANDLE mapping;
+  void *ptr;
+
+  if(fd < 0 || !len)
+    return NULL;
+
+  fh = (HANDLE)_get_osfhandle(fd);
+  if(fh == INVALID_HANDLE_VALUE)
+    return NULL;
+
+  mapping = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+  if(!mapping)
+    return NULL;
+
+  ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, len);
+  CloseHandle(mapping);
+  return ptr;
+}
+
+static inline void platform_munmap(void *ptr, size_t len)
+{
+  UnmapViewOfFile(ptr);
+}
+
 __M_END_DECLS
 
 #endif /* __IO_VIO_WIN32_H */
@@ -75,6 +75,9 @@
 #define ZIP_STREAM_BUFFER_U_SIZE (ZIP_STREAM_BUFFER_SIZE * 3 / 4)
 #define ZIP_STREAM_BUFFER_C_SIZE (ZIP_STREAM_BUFFER_SIZE / 4)
 
+// Max compressed input provided at once when decompressing from memory.
+#define ZIP_MEMORY_INPUT_MAX ((size_t)1 << 30)
+
 #define LOCAL_FILE_HEADER_LEN 30
 #define CENTRAL_FILE_HEADER_LEN 46
 #define EOCD_RECORD_LEN 22
@@ -165,6 +168,8 @@ static const char *zip_error_string(enum zip_error code)
       return "can't write/close; not streaming";
     case ZIP_NOT_MEMORY_ARCHIVE:
       return "archive isn't a memory archive";
+    case ZIP_FILE_NOT_FOUND:
+      return "file not found in archive";
     case ZIP_NO_EOCD:
       return "file is not a zip archive";
     case ZIP_NO_EOCD_ZIP64:
@@ -439,7 +444,11 @@ static struct zip_file_header *zip_allocate_file_header(uint16_t filename_len)
   size_t size = MAX(sizeof(struct zip_file_header),
    offsetof(struct zip_file_header, file_name) + filename_len + 1);
 
-  return (struct zip_file_header *)malloc(size);
+  struct zip_file_header *fh = (struct zip_file_header *)malloc(size);
+  if(fh)
+    fh->decompressed = NULL;
+
+  return fh;
 }
 
 /**
@@ -450,6 +459,8 @@ static void zip_free_file_header(struct zip_file_header *fh)
 {
   // Filename is now allocated as part of the base struct, so no need to
   // explicitly free it...
+  if(fh)
+    free(fh->decompressed);
   free(fh);
 }
 
@@ -1162,13 +1173,33 @@ static enum zip_error zread_stream(uint8_t *destBuf, size_t readLen,
 
     while((result = decompress_fn(stream_data)) == ZIP_INPUT_EMPTY)
     {
-      in_size = MIN(in_size, zp->stream_left - *consumed);
-      if(!in_size)
-        return ZIP_EOF;
+      if(zp->is_memory)
+      {
+        // Memory archives (including mapped files) can provide the rest of
+        // the compressed data directly instead of copying it to the buffer.
+        // zlib stream sizes are 32-bit, so limit this to something sane.
+        struct memfile mf;
+
+        in_size = MIN(zp->stream_left - *consumed, ZIP_MEMORY_INPUT_MAX);
+        if(!in_size)
+          return ZIP_EOF;
+
+        if(!vfile_get_memfile_block(zp->vf, in_size, &mf) ||
+         vfseek(zp->vf, in_size, SEEK_CUR))
+          return ZIP_READ_ERROR;
+
+        zp->stream->input(stream_data, mf.start, in_size);
+      }
+      else
+      {
+        in_size = MIN(in_size, zp->stream_left - *consumed);
+        if(!in_size)
+          return ZIP_EOF;
 
-      zp->stream->input(stream_data, in, in_size);
-      if(!vfread(in, in_size, 1, zp->vf))
-        return ZIP_READ_ERROR;
+        zp->stream->input(stream_data, in, in_size);
+        if(!vfread(in, in_size, 1, zp->vf))
+          return ZIP_READ_ERROR;
+      }
 
       *consumed += in_size;
     }
@@ -1683,6 +1714,8 @@ enum zip_error zip_skip_file(struct zip_archive *zp)
     return ZIP_EOF;
   }
 
+  free(zp->files[zp->pos]->decompressed);
+  zp->files[zp->pos]->decompressed = NULL;
   zp->pos++;
 
   return ZIP_SUCCESS;
@@ -1692,6 +1725,382 @@ err_out:
   return result;
 }
 
+/**
+ * Get the compressed data of the next file in a memory archive without
+ * opening it or advancing to the next file. The returned memfile points
+ * directly into the archive and is valid until the archive is closed. This
+ * allows files to be decompressed outside of the archive, e.g. in another
+ * thread (see zip_decompress_raw_file).
+ *
+ * @param zp    zip archive structure.
+ * @param mf    memfile to open over the compressed data.
+ * @return      `ZIP_SUCCESS` on success;
+ *              `ZIP_NOT_MEMORY_ARCHIVE` if `zp` isn't a memory archive;
+ *              other errors if the local header is invalid.
+ */
+enum zip_error zip_get_next_raw_file(struct zip_archive *zp,
+ struct memfile *mf)
+{
+  struct zip_file_header *central_fh;
+  enum zip_error result;
+
+  result = (zp ? zp->read_file_error : ZIP_NULL);
+  if(result)
+    goto err_out;
+
+  if(zp->pos >= zp->num_files)
+  {
+    result = ZIP_EOF;
+    goto err_out;
+  }
+
+  if(!zp->is_memory)
+  {
+    result = ZIP_NOT_MEMORY_ARCHIVE;
+    goto err_out;
+  }
+
+  central_fh = zp->files[zp->pos];
+  if(vfseek(zp->vf, central_fh->offset, SEEK_SET))
+  {
+    result = ZIP_SEEK_ERROR;
+    goto err_out;
+  }
+
+  result = zip_verify_local_file_header(zp, central_fh);
+  if(result)
+    goto err_out;
+
+  if(central_fh->compressed_size > SIZE_MAX ||
+   !vfile_get_memfile_block(zp->vf, central_fh->compressed_size, mf))
+  {
+    result = ZIP_EOF;
+    goto err_out;
+  }
+  return ZIP_SUCCESS;
+
+err_out:
+  if(result != ZIP_EOF && result != ZIP_NOT_MEMORY_ARCHIVE)
+    zip_error("zip_get_next_raw_file", result);
+  memset(mf, 0, sizeof(struct memfile));
+  return result;
+}
+
+/**
+ * Decompress the data of a file in its entirety and check its CRC-32. `src`
+ * must contain the file's compressed data (see zip_get_next_raw_file) and
+ * `dest` must be at least the uncompressed size of the file. This function
+ * doesn't use the archive, so it is safe to call from other threads.
+ */
+enum zip_error zip_decompress_raw_file(const struct zip_file_header *fh,
+ const void *src, void *dest)
+{
+  struct zip_method_handler *handler;
+  struct zip_stream_data *stream_data;
+  enum zip_error result;
+
+  if(fh->uncompressed_size > SIZE_MAX || fh->compressed_size > SIZE_MAX)
+    return ZIP_BOUND_ERROR;
+
+  if(fh->method == ZIP_M_NONE)
+  {
+    if(fh->compressed_size != fh->uncompressed_size)
+      return ZIP_DECOMPRESS_FAILED;
+
+    memcpy(dest, src, fh->uncompressed_size);
+  }
+  else
+
+  // Block decompressors return early for empty output, so skip these.
+  if(fh->uncompressed_size)
+  {
+    if(fh->method > ZIP_M_MAX_SUPPORTED || !zip_method_handlers[fh->method])
+      return ZIP_UNSUPPORTED_DECOMPRESSION;
+
+    handler = zip_method_handlers[fh->method];
+    if(!handler->decompress_open)
+      return ZIP_UNSUPPORTED_DECOMPRESSION;
+
+    stream_data = handler->create();
+    if(!stream_data)
+      return ZIP_ALLOC_ERROR;
+
+    handler->decompress_open(stream_data, fh->method, fh->flags);
+    handler->input(stream_data, src, fh->compressed_size);
+    handler->output(stream_data, dest, fh->uncompressed_size);
+
+    if(handler->decompress_file)
+      result = handler->decompress_file(stream_data);
+    else
+      result = handler->decompress_block(stream_data);
+
+    handler->close(stream_data, NULL, NULL);
+    handler->destroy(stream_data);
+
+    if(result != ZIP_STREAM_FINISHED && result != ZIP_SUCCESS)
+      return ZIP_DECOMPRESS_FAILED;
+  }
+
+  if(crc32(0, (const Bytef *)dest, fh->uncompressed_size) != fh->crc32)
+    return ZIP_CRC32_MISMATCH;
+
+  return ZIP_SUCCESS;
+}
+
+/**
+ * Attach already-decompressed data to a file in the archive. The next
+ * zip_read_file of this file will copy this data instead of decompressing
+ * the file again. The archive takes ownership of `data`, which must be
+ * allocated with malloc and contain the entire uncompressed file. It is freed
+ * once the file is read or skipped, or when the archive is closed.
+ */
+enum zip_error zip_set_decompressed_file(struct zip_archive *zp,
+ size_t pos, void *data)
+{
+  enum zip_error result;
+
+  result = (zp ? zp->read_file_error : ZIP_NULL);
+  if(result)
+    goto err_out;
+
+  if(pos >= zp->num_files)
+  {
+    result = ZIP_EOF;
+    goto err_out;
+  }
+
+  free(zp->files[pos]->decompressed);
+  zp->files[pos]->decompressed = data;
+  return ZIP_SUCCESS;
+
+err_out:
+  zip_error("zip_set_decompressed_file", result);
+  free(data);
+  return result;
+}
+
+/**
+ * Hash a file name for the central directory index (FNV-1a).
+ */
+static uint32_t zip_index_hash_name(const char *name, size_t len)
+{
+  uint32_t hash = 0x811c9dc5u;
+  size_t i;
+
+  for(i = 0; i < len; i++)
+  {
+    hash ^= (uint8_t)name[i];
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+/**
+ * Hash a set of MZX file properties for the central directory index.
+ */
+static uint32_t zip_index_hash_mzx(unsigned int file_id,
+ unsigned int board_id, unsigned int robot_id)
+{
+  uint32_t hash = (file_id << 16) ^ (board_id << 8) ^ robot_id;
+
+  // Mix the bits so consecutive boards/robots don't form long probe runs.
+  hash ^= hash >> 16;
+  hash *= 0x7feb352du;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68bu;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+/**
+ * Free the central directory index, if it exists. This needs to be called
+ * any time the order of the files or their MZX properties change; lookups
+ * will rebuild the index as-needed.
+ */
+void zip_clear_index(struct zip_archive *zp)
+{
+  if(zp)
+  {
+    free(zp->name_index);
+    zp->name_index = NULL;
+    zp->mzx_index = NULL;
+    zp->index_mask = 0;
+  }
+}
+
+/**
+ * Build a hash index of the central directory by file name and by MZX file
+ * properties. This is optional; `zip_find_file` and `zip_find_mzx_file` will
+ * build the index automatically the first time they are used. The MZX file
+ * properties need to be assigned (see world_format.h) before the index is
+ * built for MZX property lookups to work.
+ *
+ * Both tables use open addressing and store the position of a file plus one,
+ * so zero marks an empty slot. Duplicate entries resolve to the first file
+ * in archive order.
+ */
+enum zip_error zip_build_index(struct zip_archive *zp)
+{
+  enum zip_error result = ZIP_NULL;
+  size_t size;
+  size_t i;
+
+  if(!zp)
+    goto err_out;
+
+  result = zp->read_file_error;
+  if(result)
+    goto err_out;
+
+  zip_clear_index(zp);
+
+  // Keep the load factor at or below 50%.
+  size = 16;
+  while(size < zp->num_files * 2)
+    size <<= 1;
+
+  zp->name_index = (uint32_t *)calloc(size * 2, sizeof(uint32_t));
+  if(!zp->name_index)
+  {
+    result = ZIP_ALLOC_ERROR;
+    goto err_out;
+  }
+  zp->mzx_index = zp->name_index + size;
+  zp->index_mask = size - 1;
+
+  for(i = 0; i < zp->num_files; i++)
+  {
+    struct zip_file_header *fh = zp->files[i];
+    size_t pos;
+
+    pos = zip_index_hash_name(fh->file_name, fh->file_name_length);
+    pos &= zp->index_mask;
+    while(zp->name_index[pos])
+      pos = (pos + 1) & zp->index_mask;
+    zp->name_index[pos] = i + 1;
+
+    if(fh->mzx_file_id)
+    {
+      pos = zip_index_hash_mzx(fh->mzx_file_id, fh->mzx_board_id,
+       fh->mzx_robot_id);
+      pos &= zp->index_mask;
+      while(zp->mzx_index[pos])
+        pos = (pos + 1) & zp->index_mask;
+      zp->mzx_index[pos] = i + 1;
+    }
+  }
+  return ZIP_SUCCESS;
+
+err_out:
+  zip_error("zip_build_index", result);
+  return result;
+}
+
+/**
+ * Find a file in the zip archive by name (case sensitive) using the central
+ * directory index. On success, the found file becomes the next file in the
+ * archive and can be read or opened as a stream normally.
+ *
+ * @param zp        zip archive structure.
+ * @param name      name of the file to find.
+ * @return          `ZIP_SUCCESS` on success;
+ *                  `ZIP_FILE_NOT_FOUND` if there is no file with this name;
+ *                  other error codes from `zip_build_index`.
+ */
+enum zip_error zip_find_file(struct zip_archive *zp, const char *name)
+{
+  enum zip_error result = ZIP_NULL;
+  size_t len;
+  size_t pos;
+
+  if(!zp || !name)
+    goto err_out;
+
+  result = zp->read_file_error;
+  if(result)
+    goto err_out;
+
+  if(!zp->name_index)
+  {
+    result = zip_build_index(zp);
+    if(result)
+      return result;
+  }
+
+  len = strlen(name);
+  pos = zip_index_hash_name(name, len) & zp->index_mask;
+  while(zp->name_index[pos])
+  {
+    struct zip_file_header *fh = zp->files[zp->name_index[pos] - 1];
+
+    if(fh->file_name_length == len && !memcmp(fh->file_name, name, len))
+    {
+      zp->pos = zp->name_index[pos] - 1;
+      return ZIP_SUCCESS;
+    }
+    pos = (pos + 1) & zp->index_mask;
+  }
+  return ZIP_FILE_NOT_FOUND;
+
+err_out:
+  zip_error("zip_find_file", result);
+  return result;
+}
+
+/**
+ * Find a file in the zip archive by its MZX properties using the central
+ * directory index. These properties need to be initialized externally; see
+ * world_format.h. On success, the found file becomes the next file in the
+ * archive and can be read or opened as a stream normally.
+ *
+ * @param zp        zip archive structure.
+ * @param file_id   file type ID to find.
+ * @param board_id  board number to find.
+ * @param robot_id  object number to find.
+ * @return          `ZIP_SUCCESS` on success;
+ *                  `ZIP_FILE_NOT_FOUND` if there is no matching file;
+ *                  other error codes from `zip_build_index`.
+ */
+enum zip_error zip_find_mzx_file(struct zip_archive *zp,
+ unsigned int file_id, unsigned int board_id, unsigned int robot_id)
+{
+  enum zip_error result = ZIP_NULL;
+  size_t pos;
+
+  if(!zp)
+    goto err_out;
+
+  result = zp->read_file_error;
+  if(result)
+    goto err_out;
+
+  if(!zp->mzx_index)
+  {
+    result = zip_build_index(zp);
+    if(result)
+      return result;
+  }
+
+  pos = zip_index_hash_mzx(file_id, board_id, robot_id) & zp->index_mask;
+  while(zp->mzx_index[pos])
+  {
+    struct zip_file_header *fh = zp->files[zp->mzx_index[pos] - 1];
+
+    if(fh->mzx_file_id == file_id && fh->mzx_board_id == board_id &&
+     fh->mzx_robot_id == robot_id)
+    {
+      zp->pos = zp->mzx_index[pos] - 1;
+      return ZIP_SUCCESS;
+    }
+    pos = (pos + 1) & zp->index_mask;
+  }
+  return ZIP_FILE_NOT_FOUND;
+
+err_out:
+  zip_error("zip_find_mzx_file", result);
+  return result;
+}
+
 /**
  * Read a file from the a zip archive. If provided, the value of readLen will
  * be set to the number of bytes read into the buffer.
@@ -1711,6 +2120,24 @@ enum zip_error zip_read_file(struct zip_archive *zp,
     goto err_out;
   }
 
+  // This file may have already been decompressed elsewhere.
+  if(zp && !zp->read_file_error && zp->pos < zp->num_files &&
+   zp->files[zp->pos]->decompressed)
+  {
+    struct zip_file_header *fh = zp->files[zp->pos];
+
+    u_size = MIN(destLen, fh->uncompressed_size);
+    memcpy(destBuf, fh->decompressed, u_size);
+    free(fh->decompressed);
+    fh->decompressed = NULL;
+    zp->pos++;
+
+    if(readLen)
+      *readLen = u_size;
+
+    return ZIP_SUCCESS;
+  }
+
   result = zip_read_open_file_stream(zp, &u_size);
   if(result)
     goto err_out;
@@ -1970,6 +2397,20 @@ enum zip_error zip_set_zip64_enabled(struct zip_archive *zp,
   return ZIP_SUCCESS;
 }
 
+/**
+ * Store every file written from now on instead of compressing it, regardless
+ * of the method requested. This is useful for archives that only exist in
+ * memory for a short time, where speed is more important than size.
+ */
+enum zip_error zip_set_store_only(struct zip_archive *zp, boolean store_only)
+{
+  if(!zp)
+    return ZIP_NULL;
+
+  zp->store_only = store_only;
+  return ZIP_SUCCESS;
+}
+
 /**
  * Writes the data descriptor for a file. If data descriptors are turned
  * off, this function will seek back and add the data into the local header.
@@ -2039,15 +2480,92 @@ static inline enum zip_error zip_write_data_descriptor(struct zip_archive *zp,
   return ZIP_SUCCESS;
 }
 
+/**
+ * Add a new file to the files list and write its local header at the current
+ * position. The flags, method, CRC-32, and sizes of the new file are copied
+ * from the provided header.
+ */
+static enum zip_error zip_write_add_file_header(struct zip_archive *zp,
+ const char *name, const struct zip_file_header *src_fh,
+ struct zip_file_header **_fh)
+{
+  struct zip_file_header *fh;
+  uint16_t file_name_len;
+  enum zip_error result;
+
+  // If needed, expand the files list so the file can be added to it.
+  if(zp->pos == zp->files_alloc)
+  {
+    size_t count = zp->files_alloc * 2;
+    struct zip_file_header **tmp = (struct zip_file_header **)realloc(zp->files,
+     count * sizeof(struct zip_file_header *));
+    if(!tmp)
+      return ZIP_ALLOC_ERROR;
+
+    zp->files = tmp;
+    zp->files_alloc = count;
+  }
+
+  file_name_len = strlen(name);
+  fh = zip_allocate_file_header(file_name_len);
+  if(!fh)
+    return ZIP_ALLOC_ERROR;
+
+  fh->flags = src_fh->flags;
+  fh->method = src_fh->method;
+  fh->crc32 = src_fh->crc32;
+  fh->compressed_size = src_fh->compressed_size;
+  fh->uncompressed_size = src_fh->uncompressed_size;
+  fh->offset = vftell(zp->vf);
+  fh->file_name_length = file_name_len;
+  memcpy(fh->file_name, name, file_name_len + 1);
+
+  // Write the header
+  result = zip_write_file_header(zp, fh, 0);
+  if(result)
+  {
+    zip_free_file_header(fh);
+    return result;
+  }
+
+  // Now that the header is written, it can be added to the files list.
+  zp->running_file_name_length += file_name_len;
+  zp->files[zp->pos] = fh;
+  zp->num_files++;
+
+  *_fh = fh;
+  return ZIP_SUCCESS;
+}
+
 /**
  * Common function for zip write stream opening.
  * mode should be either ZIP_S_WRITE_STREAM or ZIP_S_WRITE_MEMSTREAM.
  */
+/**
+ * Write every file taken by the archive's compressor (if any) so far. This
+ * needs to happen before any other file is written to keep files in order.
+ */
+static enum zip_error zip_write_flush_compressor(struct zip_archive *zp)
+{
+  boolean zip64_current = zp->zip64_current;
+  enum zip_error result;
+
+  if(!zp->compressor || zp->compressor_active)
+    return ZIP_SUCCESS;
+
+  // Zip64 may have already been selected for the file about to be written.
+  zp->compressor_active = true;
+  result = zp->compressor->flush(zp->compressor_priv, zp);
+  zp->compressor_active = false;
+  zp->zip64_current = zip64_current;
+  return result;
+}
+
 static enum zip_error zip_write_open_stream(struct zip_archive *zp,
  const char *name, int method, uint8_t mode)
 {
+  struct zip_file_header tmp;
   struct zip_file_header *fh;
-  uint16_t file_name_len;
 
   enum zip_error result;
 
@@ -2055,6 +2573,10 @@ static enum zip_error zip_write_open_stream(struct zip_archive *zp,
   if(result)
     return result;
 
+  result = zip_write_flush_compressor(zp);
+  if(result)
+    return result;
+
   // Special mem stream checks.
   if(mode == ZIP_S_WRITE_MEMSTREAM)
   {
@@ -2076,55 +2598,27 @@ static enum zip_error zip_write_open_stream(struct zip_archive *zp,
   if(result)
     return result;
 
-  // If needed, expand the files list so the file can be added to it.
-  if(zp->pos == zp->files_alloc)
-  {
-    size_t count = zp->files_alloc * 2;
-    struct zip_file_header **tmp = (struct zip_file_header **)realloc(zp->files,
-     count * sizeof(struct zip_file_header *));
-    if(!tmp)
-      return ZIP_ALLOC_ERROR;
-
-    zp->files = tmp;
-    zp->files_alloc = count;
-  }
-
-  file_name_len = strlen(name);
-  fh = zip_allocate_file_header(file_name_len);
-  if(!fh)
-    return ZIP_ALLOC_ERROR;
-
   // Set up the header
-  fh->flags = 0;
+  tmp.flags = 0;
 #ifdef ZIP_WRITE_DATA_DESCRIPTOR
-  fh->flags |= ZIP_F_DATA_DESCRIPTOR;
+  tmp.flags |= ZIP_F_DATA_DESCRIPTOR;
 #endif
 #ifdef ZIP_WRITE_DEFLATE_FAST
   if(method == ZIP_M_DEFLATE)
-    fh->flags |= ZIP_F_DEFLATE_FAST;
+    tmp.flags |= ZIP_F_DEFLATE_FAST;
 #endif
-  fh->method = method;
-  fh->crc32 = 0;
-  fh->compressed_size = 0;
-  fh->uncompressed_size = 0;
-  fh->offset = vftell(zp->vf);
-  fh->file_name_length = file_name_len;
-  memcpy(fh->file_name, name, file_name_len + 1);
+  tmp.method = method;
+  tmp.crc32 = 0;
+  tmp.compressed_size = 0;
+  tmp.uncompressed_size = 0;
 
-  // Write the header
-  result = zip_write_file_header(zp, fh, 0);
+  result = zip_write_add_file_header(zp, name, &tmp, &fh);
   if(result)
   {
-    zip_free_file_header(fh);
     zp->streaming_file = NULL;
     return result;
   }
 
-  // Now that the header is written, it can be added to the files list.
-  zp->running_file_name_length += file_name_len;
-  zp->files[zp->pos] = fh;
-  zp->num_files++;
-
   // Set up the stream
   zp->mode = mode;
   zp->streaming_file = fh;
@@ -2206,6 +2700,9 @@ enum zip_error zip_write_open_file_stream(struct zip_archive *zp,
 {
   enum zip_error result;
 
+  if(zp->store_only)
+    method = ZIP_M_NONE;
+
   zp->zip64_current = zp->zip64_enabled;
   result = zip_write_open_stream(zp, name, method, ZIP_S_WRITE_STREAM);
   if(result)
@@ -2370,6 +2867,42 @@ enum zip_error zip_write_file(struct zip_archive *zp, const char *name,
   if(srcLen < 256 && method == ZIP_M_DEFLATE)
     method = ZIP_M_NONE;
 
+  if(zp && zp->store_only)
+    method = ZIP_M_NONE;
+
+  // Files this large would need Zip64 decided before they're compressed.
+  if(zp && zp->compressor && !zp->compressor_active && !zp->write_file_error &&
+   (method == ZIP_M_NONE || method == ZIP_M_DEFLATE) && srcLen < 0x7ffffffful)
+  {
+    uint16_t flags = 0;
+    boolean queued;
+#ifdef ZIP_WRITE_DEFLATE_FAST
+    if(method == ZIP_M_DEFLATE)
+      flags |= ZIP_F_DEFLATE_FAST;
+#endif
+
+    zp->compressor_active = true;
+    queued = zp->compressor->queue(zp->compressor_priv, name, src, srcLen,
+     method, flags);
+    zp->compressor_active = false;
+
+    // If the compressor is full, write everything it has and try again.
+    if(!queued)
+    {
+      result = zip_write_flush_compressor(zp);
+      if(result)
+        goto err_out;
+
+      zp->compressor_active = true;
+      queued = zp->compressor->queue(zp->compressor_priv, name, src, srcLen,
+       method, flags);
+      zp->compressor_active = false;
+    }
+
+    if(queued)
+      return ZIP_SUCCESS;
+  }
+
   result = zip_write_autodetect_zip64(zp, method, ZIP_S_WRITE_STREAM, srcLen);
   if(result)
     goto err_out;
@@ -2396,6 +2929,185 @@ err_out:
   return result;
 }
 
+/**
+ * Write a file to a zip archive using the already compressed data of a file
+ * from another archive (see zip_get_next_raw_file). The method, CRC-32, and
+ * sizes of the data are copied from the provided header and aren't checked,
+ * so they must be correct for `src`.
+ */
+enum zip_error zip_write_raw_file(struct zip_archive *zp, const char *name,
+ const struct zip_file_header *src_fh, const void *src)
+{
+  struct zip_file_header tmp;
+  struct zip_file_header *fh;
+  enum zip_error result;
+
+  result = (zp ? zp->write_file_error : ZIP_NULL);
+  if(result)
+    goto err_out;
+
+  result = zip_write_flush_compressor(zp);
+  if(result)
+    goto err_out;
+
+  if(src_fh->compressed_size > SIZE_MAX)
+  {
+    result = ZIP_EOF;
+    goto err_out;
+  }
+
+  zp->zip64_current = (src_fh->compressed_size >= 0xfffffffful ||
+   src_fh->uncompressed_size >= 0xfffffffful);
+
+  if(zp->zip64_current && !zp->zip64_enabled)
+  {
+    result = ZIP_INVALID_ZIP64;
+    goto err_out;
+  }
+
+  if(zp->is_memory && zip_ensure_capacity(strlen(name) + 30, zp))
+  {
+    result = ZIP_EOF;
+    goto err_out;
+  }
+
+  tmp.flags = src_fh->flags & (ZIP_F_COMPRESSION_1 | ZIP_F_COMPRESSION_2);
+#ifdef ZIP_WRITE_DATA_DESCRIPTOR
+  tmp.flags |= ZIP_F_DATA_DESCRIPTOR;
+#endif
+  tmp.method = src_fh->method;
+  tmp.crc32 = src_fh->crc32;
+  tmp.compressed_size = src_fh->compressed_size;
+  tmp.uncompressed_size = src_fh->uncompressed_size;
+
+  result = zip_write_add_file_header(zp, name, &tmp, &fh);
+  if(result)
+    goto err_out;
+
+  if(fh->compressed_size)
+  {
+    result = zwrite_out(src, fh->compressed_size, zp);
+    if(result)
+      goto err_out;
+  }
+
+  result = zip_write_data_descriptor(zp, fh);
+  if(result)
+    goto err_out;
+
+  zp->pos++;
+  zp->mode = ZIP_S_WRITE_FILES;
+
+  precalculate_write_errors(zp);
+  return ZIP_SUCCESS;
+
+err_out:
+  zip_error("zip_write_raw_file", result);
+  return result;
+}
+
+/**
+ * Create a stream that can be used to compress any number of files with
+ * zip_compress_raw_file, one at a time. Returns NULL if the method isn't
+ * supported for compression.
+ */
+struct zip_stream_data *zip_compress_stream_create(int method)
+{
+  struct zip_method_handler *handler;
+
+  if(method <= ZIP_M_NONE || method > ZIP_M_MAX_SUPPORTED)
+    return NULL;
+
+  handler = zip_method_handlers[method];
+  if(!handler || !handler->compress_open || !handler->compress_bound)
+    return NULL;
+
+  return handler->create();
+}
+
+void zip_compress_stream_destroy(int method,
+ struct zip_stream_data *stream_data)
+{
+  if(stream_data)
+    zip_method_handlers[method]->destroy(stream_data);
+}
+
+/**
+ * Compress a file in memory without an archive. Unlike the other compression
+ * functions, this is safe to call from any thread as long as each thread
+ * uses its own stream (see zip_compress_stream_create), which is reused
+ * between files. The method, flags, and uncompressed size of the file should
+ * be set in `fh`; this sets its CRC-32 and compressed size. On success,
+ * `dest` is set to the compressed data, which must be freed with free.
+ */
+enum zip_error zip_compress_raw_file(struct zip_stream_data *stream_data,
+ struct zip_file_header *fh, const void *src, void **dest)
+{
+  struct zip_method_handler *handler;
+  enum zip_error result;
+  size_t src_len;
+  size_t bound;
+  size_t final_out = 0;
+  void *buffer;
+
+  if(!stream_data || fh->method <= ZIP_M_NONE ||
+   fh->method > ZIP_M_MAX_SUPPORTED || !zip_method_handlers[fh->method])
+    return ZIP_UNSUPPORTED_COMPRESSION;
+
+  if(fh->uncompressed_size > SIZE_MAX)
+    return ZIP_BOUND_ERROR;
+
+  handler = zip_method_handlers[fh->method];
+  src_len = fh->uncompressed_size;
+
+  handler->compress_open(stream_data, fh->method, fh->flags);
+  result = handler->compress_bound(stream_data, src_len, &bound);
+  if(result)
+    return result;
+
+  buffer = malloc(bound);
+  if(!buffer)
+    return ZIP_ALLOC_ERROR;
+
+  handler->input(stream_data, src, src_len);
+  handler->output(stream_data, buffer, bound);
+  result = handler->compress_block(stream_data, true);
+  handler->close(stream_data, NULL, &final_out);
+
+  if(result != ZIP_STREAM_FINISHED)
+  {
+    free(buffer);
+    return ZIP_COMPRESS_FAILED;
+  }
+
+  fh->crc32 = crc32(0, (const Bytef *)src, src_len);
+  fh->compressed_size = final_out;
+  *dest = buffer;
+  return ZIP_SUCCESS;
+}
+
+/**
+ * Hand files written with zip_write_file to a compressor instead of writing
+ * them immediately (or stop doing this if `compressor` is NULL).
+ * Any files the previous compressor still has are written first. Files are
+ * always written to the archive in the order they were provided.
+ */
+enum zip_error zip_set_write_compressor(struct zip_archive *zp,
+ const struct zip_write_compressor *compressor, void *priv)
+{
+  enum zip_error result = ZIP_SUCCESS;
+
+  if(!zp)
+    return ZIP_NULL;
+
+  if(!zp->write_file_error)
+    result = zip_write_flush_compressor(zp);
+
+  zp->compressor = compressor;
+  zp->compressor_priv = priv;
+  return result;
+}
+
 /**
  * Reads the central directory of a zip archive. This places the archive into
  * file read mode; read files using zip_read_file(). If this fails, the input
@@ -2942,6 +3654,7 @@ static enum zip_error zip_write_zip64_eocd_record(struct zip_archive *zp)
 enum zip_error zip_close(struct zip_archive *zp, uint64_t *final_length)
 {
   int result = ZIP_SUCCESS;
+  int flush_result = ZIP_SUCCESS;
   int mode;
   size_t i;
 
@@ -2959,6 +3672,15 @@ enum zip_error zip_close(struct zip_archive *zp, uint64_t *final_length)
     final_length = NULL;
   }
 
+  // Make sure any files still being compressed elsewhere are written first.
+  if(zp->compressor)
+  {
+    if(!zp->write_file_error)
+      flush_result = zip_write_flush_compressor(zp);
+
+    zp->compressor = NULL;
+  }
+
   mode = zp->mode;
 
   // Before initiating the close, make sure there wasn't an open write stream!
@@ -3080,11 +3802,15 @@ enum zip_error zip_close(struct zip_archive *zp, uint64_t *final_length)
     if(zip_method_handlers[i] && zp->stream_data_ptrs[i])
       zip_method_handlers[i]->destroy(zp->stream_data_ptrs[i]);
 
+  zip_clear_index(zp);
   free(zp->header_buffer);
   free(zp->stream_buffer);
   free(zp->files);
   free(zp);
 
+  if(result == ZIP_SUCCESS)
+    result = flush_result;
+
   if(result != ZIP_SUCCESS)
     zip_error("zip_close", result);
 
@@ -3159,6 +3885,18 @@ struct zip_archive *zip_open_vf_read(vfile *vf)
 
     zp->end_in_file = file_len;
 
+    // If possible, map the file into memory. This allows stored files to be
+    // read directly from the mapping (see zip_read_open_mem_stream) and
+    // compressed files to be decompressed without an extra copy.
+    if(vfile_map_to_memory(vf))
+      zp->is_memory = true;
+    else
+
+    // Files already copied into memory (see vfile_force_to_memory) can be
+    // used the same way.
+    if((vfile_get_flags(vf) & (VF_MEMORY | VF_WRITE | VF_VIRTUAL)) == VF_MEMORY)
+      zp->is_memory = true;
+
     if(ZIP_SUCCESS != zip_read_directory(zp))
     {
       zip_close(zp, NULL);
@@ -128,6 +128,7 @@ enum zip_error
   ZIP_INVALID_STREAM_READ,
   ZIP_INVALID_STREAM_WRITE,
   ZIP_NOT_MEMORY_ARCHIVE,
+  ZIP_FILE_NOT_FOUND,
   ZIP_NO_EOCD,
   ZIP_NO_EOCD_ZIP64,
   ZIP_NO_CENTRAL_DIRECTORY,
@@ -161,6 +162,7 @@ struct zip_file_header
   uint64_t compressed_size;
   uint64_t uncompressed_size;
   uint64_t offset;
+  void *decompressed; // Optional, see zip_set_decompressed_file.
   uint32_t mzx_file_id;
   uint8_t mzx_board_id;
   uint8_t mzx_robot_id;
@@ -201,6 +203,28 @@ struct zip_stream_data
 };
 
 struct zip_method_handler;
+struct zip_archive;
+
+/**
+ * Compressor that zip_write_file can hand files to instead of writing them
+ * immediately, e.g. to compress them on other threads (see
+ * zip_set_write_compressor).
+ */
+struct zip_write_compressor
+{
+  /**
+   * Take a file to compress (or store). `src` must be copied if it's needed
+   * after this returns. Returns `false` if the file can't be taken right now.
+   */
+  boolean (*queue)(void *priv, const char *name, const void *src,
+   size_t src_len, int method, uint16_t flags);
+
+  /**
+   * Write every file taken so far to the archive in the order they were
+   * taken, using zip_write_raw_file.
+   */
+  enum zip_error (*flush)(void *priv, struct zip_archive *zp);
+};
 
 struct zip_archive
 {
@@ -219,6 +243,12 @@ struct zip_archive
 
   struct zip_file_header **files;
   struct zip_file_header *streaming_file;
+
+  // Optional hash index of the central directory (see zip_build_index).
+  uint32_t *name_index;
+  uint32_t *mzx_index;
+  size_t index_mask;
+
   uint8_t *stream_buffer;
   uint32_t stream_buffer_pos;
   uint32_t stream_buffer_end;
@@ -242,12 +272,18 @@ struct zip_archive
   boolean is_memory;
   boolean zip64_enabled; // Zip64 should be used as-needed.
   boolean zip64_current; // Zip64 is active for current file.
+  boolean store_only; // Store all files written, ignoring their method.
   void **external_buffer;
   size_t *external_buffer_size;
 
   struct zip_method_handler *stream;
   struct zip_stream_data *stream_data;
   struct zip_stream_data *stream_data_ptrs[ZIP_M_MAX_SUPPORTED + 1];
+
+  // Optional, see zip_set_write_compressor.
+  const struct zip_write_compressor *compressor;
+  void *compressor_priv;
+  boolean compressor_active;
 };
 
 UTILS_LIBSPEC int zip_bound_deflate_usage(size_t length);
@@ -285,11 +321,27 @@ UTILS_LIBSPEC enum zip_error zip_skip_file(struct zip_archive *zp);
 UTILS_LIBSPEC enum zip_error zip_read_file(struct zip_archive *zp,
  void *destBuf, size_t destLen, size_t *readLen);
 
+UTILS_LIBSPEC enum zip_error zip_get_next_raw_file(struct zip_archive *zp,
+ struct memfile *mf);
+UTILS_LIBSPEC enum zip_error zip_decompress_raw_file(
+ const struct zip_file_header *fh, const void *src, void *dest);
+UTILS_LIBSPEC enum zip_error zip_set_decompressed_file(struct zip_archive *zp,
+ size_t pos, void *data);
+
+UTILS_LIBSPEC enum zip_error zip_build_index(struct zip_archive *zp);
+UTILS_LIBSPEC void zip_clear_index(struct zip_archive *zp);
+UTILS_LIBSPEC enum zip_error zip_find_file(struct zip_archive *zp,
+ const char *name);
+UTILS_LIBSPEC enum zip_error zip_find_mzx_file(struct zip_archive *zp,
+ unsigned int file_id, unsigned int board_id, unsigned int robot_id);
+
 UTILS_LIBSPEC enum zip_error zwrite(const void *src, size_t srcLen,
  struct zip_archive *zp);
 
 UTILS_LIBSPEC enum zip_error zip_set_zip64_enabled(struct zip_archive *zp,
  boolean enable_zip64);
+UTILS_LIBSPEC enum zip_error zip_set_store_only(struct zip_archive *zp,
+ boolean store_only);
 
 UTILS_LIBSPEC enum zip_error zip_write_open_file_stream(struct zip_archive *zp,
  const char *name, int method);
@@ -304,6 +356,17 @@ UTILS_LIBSPEC enum zip_error zip_write_close_mem_stream(struct zip_archive *zp,
 
 UTILS_LIBSPEC enum zip_error zip_write_file(struct zip_archive *zp,
  const char *name, const void *src, size_t srcLen, int method);
+UTILS_LIBSPEC enum zip_error zip_write_raw_file(struct zip_archive *zp,
+ const char *name, const struct zip_file_header *src_fh, const void *src);
+
+UTILS_LIBSPEC struct zip_stream_data *zip_compress_stream_create(int method);
+UTILS_LIBSPEC void zip_compress_stream_destroy(int method,
+ struct zip_stream_data *stream_data);
+UTILS_LIBSPEC enum zip_error zip_compress_raw_file(
+ struct zip_stream_data *stream_data, struct zip_file_header *fh,
+ const void *src, void **dest);
+UTILS_LIBSPEC enum zip_error zip_set_write_compressor(struct zip_archive *zp,
+ const struct zip_write_compressor *compressor, void *priv);
 
 UTILS_LIBSPEC enum zip_error zip_close(struct zip_archive *zp,
  uint64_t *final_length);
@@ -62,7 +62,7 @@ static inline void meter_initial_draw(int curr, int target, const char *title) {
 #endif //!CONFIG_LOADSAVE_METER
 
 static inline boolean legacy_load_counter(struct world *mzx_world,
- vfile *vf, struct counter_list *counter_list, int index, int file_version)
+ vfile *vf, struct counter_list *counter_list, int file_version)
 {
   char name_buffer[ROBOT_MAX_TR];
   int name_length;
@@ -117,7 +117,7 @@ static inline boolean legacy_load_counter(struct world *mzx_world,
     }
   }
 
-  load_new_counter(counter_list, index, name_buffer, name_length, value);
+  load_new_counter(counter_list, name_buffer, name_length, value);
   return true;
 }
 
@@ -127,24 +127,16 @@ static void legacy_load_counter_list(struct world *mzx_world, vfile *vf,
   struct counter_list *counter_list;
   int num_counters;
   int i;
-  int j;
 
   num_counters = vfgetd(vf);
   counter_list = &(mzx_world->counter_list);
-  counter_list->num_counters = num_counters;
+  counter_list->num_counters = 0;
   counter_list->num_counters_allocated = num_counters + extra;
   counter_list->counters = ccalloc(num_counters + extra, sizeof(struct counter *));
 
-  for(i = 0, j = 0; i < num_counters; i++)
-  {
-    if(!legacy_load_counter(mzx_world, vf, counter_list, j, file_version))
-    {
-      // Remove 2.84 special counters and counters that failed to load.
-      counter_list->num_counters--;
-      continue;
-    }
-    j++;
-  }
+  // 2.84 special counters and counters that fail to load aren't added.
+  for(i = 0; i < num_counters; i++)
+    legacy_load_counter(mzx_world, vf, counter_list, file_version);
 #ifndef CONFIG_COUNTER_HASH_TABLES
   // Versions without the hash table require these to be sorted at all times.
   sort_counter_list(counter_list);
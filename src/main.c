@@ -43,10 +43,13 @@
 #include "game.h"
 #include "error.h"
 #include "idput.h"
+#include "mzm.h"
 #include "util.h"
 #include "world.h"
+#include "world_snapshot.h"
 #include "counter.h"
 #include "run_stubs.h"
+#include "io/fsafeopen.h"
 #include "io/path.h"
 #include "io/vio.h"
 
@@ -346,6 +349,8 @@ __libspec int main(int argc, char *argv[])
     clear_world(&mzx_world);
     clear_global_data(&mzx_world);
   }
+  world_snapshots_free(&mzx_world);
+  mzm_cache_free(&mzx_world);
 
 #ifdef CONFIG_HELPSYS
   help_close(&mzx_world);
@@ -387,6 +392,7 @@ err_free_config:
   // FIXME maybe shouldn't be here...?
   if(mzx_world.update_done)
     free(mzx_world.update_done);
+  fsafeopen_free_cache();
   vio_filesystem_exit();
   free_config();
   free_editor_config();
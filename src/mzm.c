@@ -22,11 +22,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "mzm.h"
 
+#include "configure.h"
 #include "data.h"
 #include "error.h"
+#include "hashtable.h"
 #include "idput.h"
 #include "legacy_robot.h"
 #include "legacy_world.h"
@@ -426,31 +430,217 @@ static boolean read_mzm_header(struct memfile *mf, size_t file_length,
   return true;
 }
 
-// This will clip.
+/**
+ * An MZM decoded into separate planes, so it can be placed with row copies.
+ * Board storage MZMs use all six planes, with the IDs that aren't allowed in
+ * MZMs already removed; layer storage MZMs only use the param (char) and color
+ * planes. If the MZM contains robots, the file is also kept, since the robots
+ * need to be loaded from it every time the MZM is placed.
+ */
+struct mzm_data
+{
+  struct mzm_header header;
+  char *planes;
+  char *id;
+  char *param;
+  char *color;
+  char *under_id;
+  char *under_param;
+  char *under_color;
+  uint32_t *robot_cells;
+  int num_robot_cells;
+  const void *file;
+  size_t file_length;
+};
+
+struct mzm_cache_entry
+{
+  struct mzm_cache_entry *prev;
+  struct mzm_cache_entry *next;
+  struct mzm_data mzm;
+  uint32_t path_hash;
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+  off_t size;
+  size_t alloc_size;
+  char path[1];
+};
 
-static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
- int file_length, int start_x, int start_y, int mode, int savegame,
- enum thing layer_convert_id, char *name)
+/**
+ * Decoded MZM files, most recently used first. Entries are found by path and
+ * are discarded if the file's size or modification time changes.
+ */
+struct mzm_cache
 {
-  struct mzm_header mzm;
+  struct mzm_cache_entry *head;
+  struct mzm_cache_entry *tail;
+  size_t total_size;
+};
 
-  int data_start;
-  int expected_data_size;
+/**
+ * Decode an MZM. The file data is referenced by the decoded MZM if it has
+ * robots, so it must remain valid until the MZM is freed.
+ */
+static boolean mzm_decode(struct mzm_data *mzm, const void *file,
+ size_t file_length)
+{
+  struct mzm_header *header = &(mzm->header);
+  const unsigned char *src;
+  struct memfile mf;
+  size_t plane_size;
+  size_t data_start;
+  size_t expected_data_size;
+  size_t i;
 
-  if(!is_storageless(layer_convert_id))
-    layer_convert_id = CUSTOM_BLOCK;
+  memset(mzm, 0, sizeof(struct mzm_data));
+  mfopen(file, file_length, &mf);
 
-  if(!read_mzm_header(mf, file_length, &mzm))
-    goto err_invalid;
+  if(!read_mzm_header(&mf, file_length, header))
+    return false;
 
-  data_start = mftell(mf);
-  expected_data_size = (mzm.width * mzm.height) * (mzm.storage_mode ? 2 : 6);
+  data_start = mftell(&mf);
+  plane_size = header->width * header->height;
+  expected_data_size = plane_size * (header->storage_mode ? 2 : 6);
 
   // Validate MZM size, robots location (the other fields have been validated).
   if((file_length - data_start < expected_data_size) // not enough space
-   || (file_length < mzm.robots_location) // The end of file is before the robots
-   || (mzm.robots_location && (expected_data_size + data_start > mzm.robots_location)))
-    goto err_invalid;
+   || (file_length < (size_t)header->robots_location) // The end of file is before the robots
+   || (header->robots_location &&
+    (expected_data_size + data_start > (size_t)header->robots_location)))
+    return false;
+
+  mzm->planes = (char *)cmalloc(expected_data_size);
+  src = (const unsigned char *)file + data_start;
+
+  switch(header->storage_mode)
+  {
+    case MZM_STORAGE_MODE_BOARD:
+    {
+      uint32_t robot_cells[256];
+      int num_robot_cells = 0;
+
+      mzm->id = mzm->planes;
+      mzm->param = mzm->id + plane_size;
+      mzm->color = mzm->param + plane_size;
+      mzm->under_id = mzm->color + plane_size;
+      mzm->under_param = mzm->under_id + plane_size;
+      mzm->under_color = mzm->under_param + plane_size;
+
+      for(i = 0; i < plane_size; i++, src += 6)
+      {
+        enum thing current_id = (enum thing)src[0];
+
+        if(current_id >= SENSOR)
+        {
+          if(is_robot(current_id))
+          {
+            if(num_robot_cells < (int)ARRAY_SIZE(robot_cells))
+              robot_cells[num_robot_cells++] = i;
+          }
+          // Wipe a bunch of crap we don't want in MZMs with spaces
+          else
+            current_id = 0;
+        }
+
+        mzm->id[i] = current_id;
+        mzm->param[i] = src[1];
+        mzm->color[i] = src[2];
+
+        // We don't want this on the under layer, thanks
+        if(src[3] >= SENSOR)
+        {
+          mzm->under_id[i] = 0;
+          mzm->under_param[i] = 0;
+          mzm->under_color[i] = 7;
+        }
+        else
+        {
+          mzm->under_id[i] = src[3];
+          mzm->under_param[i] = src[4];
+          mzm->under_color[i] = src[5];
+        }
+      }
+
+      if(header->num_robots)
+      {
+        if(num_robot_cells)
+        {
+          mzm->robot_cells =
+           (uint32_t *)cmalloc(num_robot_cells * sizeof(uint32_t));
+          memcpy(mzm->robot_cells, robot_cells,
+           num_robot_cells * sizeof(uint32_t));
+          mzm->num_robot_cells = num_robot_cells;
+        }
+        mzm->file = file;
+        mzm->file_length = file_length;
+      }
+      break;
+    }
+
+    case MZM_STORAGE_MODE_LAYER:
+    {
+      mzm->param = mzm->planes;
+      mzm->color = mzm->param + plane_size;
+
+      for(i = 0; i < plane_size; i++, src += 2)
+      {
+        mzm->param[i] = src[0];
+        mzm->color[i] = src[1];
+      }
+      break;
+    }
+  }
+  return true;
+}
+
+static void mzm_data_free(struct mzm_data *mzm)
+{
+  free(mzm->planes);
+  free(mzm->robot_cells);
+}
+
+/**
+ * Check if any of the IDs in a row of the board are sensors, robots, scrolls,
+ * signs, or the player, which need to be handled individually.
+ */
+static boolean mzm_row_has_objects(const char *level_id, int width)
+{
+  int x;
+  for(x = 0; x < width; x++)
+    if((unsigned char)level_id[x] >= SENSOR)
+      return true;
+
+  return false;
+}
+
+static void mzm_clear_object(struct board *src_board, int offset)
+{
+  enum thing src_id = (enum thing)src_board->level_id[offset];
+  int param = src_board->level_param[offset];
+
+  if(src_id == SENSOR)
+    clear_sensor_id(src_board, param);
+  else
+
+  if(is_signscroll(src_id))
+    clear_scroll_id(src_board, param);
+  else
+
+  if(is_robot(src_id))
+    clear_robot_id(src_board, param);
+}
+
+// This will clip.
+
+static int place_mzm(struct world *mzx_world, const struct mzm_data *mzm_data,
+ int start_x, int start_y, int mode, int savegame,
+ enum thing layer_convert_id, char *name)
+{
+  struct mzm_header mzm = mzm_data->header;
+
+  if(!is_storageless(layer_convert_id))
+    layer_convert_id = CUSTOM_BLOCK;
 
   // If the mzm version is newer than the MZX version, notify
   if(mzm.world_version > MZX_VERSION)
@@ -474,8 +664,6 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
       int board_height = src_board->board_height;
       int effective_width = mzm.width;
       int effective_height = mzm.height;
-      int file_line_skip;
-      int line_skip;
       int x, y;
       int offset = start_x + (start_y * board_width);
       char *level_id = src_board->level_id;
@@ -484,7 +672,6 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
       char *level_under_id = src_board->level_under_id;
       char *level_under_param = src_board->level_under_param;
       char *level_under_color = src_board->level_under_color;
-      enum thing src_id;
 
       // Clip
 
@@ -494,107 +681,85 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
       if((effective_height + start_y) >= board_height)
         effective_height = board_height - start_y;
 
-      line_skip = board_width - effective_width;
-
       switch(mzm.storage_mode)
       {
         case MZM_STORAGE_MODE_BOARD:
         {
           // Board style, write as is
-          enum thing current_id;
-          int current_robot_loaded = 0;
           int robot_x_locations[256];
           int robot_y_locations[256];
-          int width_difference;
           int i;
 
-          width_difference = mzm.width - effective_width;
-
-          for(y = 0; y < effective_height; y++)
+          for(y = 0; y < effective_height; y++, offset += board_width)
           {
-            for(x = 0; x < effective_width; x++, offset++)
-            {
-              current_id = (enum thing)mfgetc(mf);
-
-              if(current_id >= SENSOR)
-              {
-                if(is_robot(current_id))
-                {
-                  robot_x_locations[current_robot_loaded] = x + start_x;
-                  robot_y_locations[current_robot_loaded] = y + start_y;
-                  current_robot_loaded++;
-                }
-                // Wipe a bunch of crap we don't want in MZMs with spaces
-                else
-                  current_id = 0;
-              }
-
-              src_id = (enum thing)level_id[offset];
+            int src_offset = y * mzm.width;
 
-              if(src_id >= SENSOR)
-              {
-                if(src_id == SENSOR)
-                  clear_sensor_id(src_board, level_param[offset]);
-                else
+            // Sensors, scrolls, and robots need to be cleared first, and
+            // the player shouldn't be overwritten.
+            if(!mzm_row_has_objects(level_id + offset, effective_width))
+            {
+              memcpy(level_id + offset, mzm_data->id + src_offset,
+               effective_width);
+              memcpy(level_param + offset, mzm_data->param + src_offset,
+               effective_width);
+              memcpy(level_color + offset, mzm_data->color + src_offset,
+               effective_width);
+              memcpy(level_under_id + offset, mzm_data->under_id + src_offset,
+               effective_width);
+              memcpy(level_under_param + offset,
+               mzm_data->under_param + src_offset, effective_width);
+              memcpy(level_under_color + offset,
+               mzm_data->under_color + src_offset, effective_width);
+              continue;
+            }
 
-                if(is_signscroll(src_id))
-                  clear_scroll_id(src_board, level_param[offset]);
-                else
+            for(x = 0; x < effective_width; x++)
+            {
+              int d = offset + x;
+              int s = src_offset + x;
 
-                if(is_robot(src_id))
-                  clear_robot_id(src_board, level_param[offset]);
-              }
+              mzm_clear_object(src_board, d);
 
               // Don't allow the player to be overwritten
-              if(src_id != PLAYER)
+              if((enum thing)level_id[d] != PLAYER)
               {
-                level_id[offset] = current_id;
-                level_param[offset] = mfgetc(mf);
-                level_color[offset] = mfgetc(mf);
-                level_under_id[offset] = mfgetc(mf);
-                level_under_param[offset] = mfgetc(mf);
-                level_under_color[offset] = mfgetc(mf);
-
-                // We don't want this on the under layer, thanks
-                if(level_under_id[offset] >= SENSOR)
-                {
-                  level_under_id[offset] = 0;
-                  level_under_param[offset] = 0;
-                  level_under_color[offset] = 7;
-                }
+                level_id[d] = mzm_data->id[s];
+                level_param[d] = mzm_data->param[s];
+                level_color[d] = mzm_data->color[s];
+                level_under_id[d] = mzm_data->under_id[s];
+                level_under_param[d] = mzm_data->under_param[s];
+                level_under_color[d] = mzm_data->under_color[s];
               }
-              else
-                mf->current += 5;
             }
+          }
 
-            offset += line_skip;
-
-            // Gotta run through and mark the next robots to be skipped
-            for(i = 0; i < width_difference; i++)
+          // Robots are matched to the robot cells of the MZM in order.
+          // Robots in the clipped part of the MZM are loaded and discarded.
+          for(i = 0; i < mzm.num_robots; i++)
+          {
+            robot_x_locations[i] = -1;
+            if(i < mzm_data->num_robot_cells)
             {
-              current_id = (enum thing)mfgetc(mf);
-              mf->current += 5;
+              x = mzm_data->robot_cells[i] % mzm.width;
+              y = mzm_data->robot_cells[i] / mzm.width;
 
-              if(is_robot(current_id))
+              if(x < effective_width && y < effective_height)
               {
-                robot_x_locations[current_robot_loaded] = -1;
-                current_robot_loaded++;
+                robot_x_locations[i] = x + start_x;
+                robot_y_locations[i] = y + start_y;
               }
             }
           }
 
-          for(i = current_robot_loaded; i < mzm.num_robots; i++)
-          {
-            robot_x_locations[i] = -1;
-          }
-
           if(mzm.num_robots)
           {
+            struct memfile _mf;
+            struct memfile *mf = &_mf;
+            int file_length = (int)mzm_data->file_length;
             struct zip_archive *zp;
             unsigned int file_id;
             unsigned int robot_id;
             int result;
-
             struct robot *cur_robot;
             int current_x, current_y;
             int offset;
@@ -604,6 +769,8 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
             int current_position;
             int dummy = 0;
 
+            mfopen(mzm_data->file, mzm_data->file_length, mf);
+
             // We suppress the errors that will generally occur here and barely
             // error check the zip functions. Why? This needs to run all the way
             // through, regardless of whether it finds errors. Otherwise, we'll
@@ -809,43 +976,42 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
         case MZM_STORAGE_MODE_LAYER:
         {
           // Compact style; expand to customblocks
-          // Board style, write as is
-
-          file_line_skip = (mzm.width - effective_width) * 2;
 
-          for(y = 0; y < effective_height; y++)
+          for(y = 0; y < effective_height; y++, offset += board_width)
           {
-            for(x = 0; x < effective_width; x++, offset++)
-            {
-              src_id = (enum thing)level_id[offset];
+            int src_offset = y * mzm.width;
 
-              if(src_id == SENSOR)
-                clear_sensor_id(src_board, level_param[offset]);
-              else
+            if(!mzm_row_has_objects(level_id + offset, effective_width))
+            {
+              memset(level_id + offset, layer_convert_id, effective_width);
+              memcpy(level_param + offset, mzm_data->param + src_offset,
+               effective_width);
+              memcpy(level_color + offset, mzm_data->color + src_offset,
+               effective_width);
+              memset(level_under_id + offset, 0, effective_width);
+              memset(level_under_param + offset, 0, effective_width);
+              memset(level_under_color + offset, 0, effective_width);
+              continue;
+            }
 
-              if(is_signscroll(src_id))
-                clear_scroll_id(src_board, level_param[offset]);
-              else
+            for(x = 0; x < effective_width; x++)
+            {
+              int d = offset + x;
+              int s = src_offset + x;
 
-              if(is_robot(src_id))
-                clear_robot_id(src_board, level_param[offset]);
+              mzm_clear_object(src_board, d);
 
               // Don't allow the player to be overwritten
-              if(src_id != PLAYER)
+              if((enum thing)level_id[d] != PLAYER)
               {
-                level_id[offset] = layer_convert_id;
-                level_param[offset] = mfgetc(mf);
-                level_color[offset] = mfgetc(mf);
-                level_under_id[offset] = 0;
-                level_under_param[offset] = 0;
-                level_under_color[offset] = 0;
+                level_id[d] = layer_convert_id;
+                level_param[d] = mzm_data->param[s];
+                level_color[d] = mzm_data->color[s];
+                level_under_id[d] = 0;
+                level_under_param[d] = 0;
+                level_under_color[d] = 0;
               }
-              else
-                mf->current += 2;
             }
-
-            offset += line_skip;
-            mf->current += file_line_skip;
           }
           break;
         }
@@ -864,9 +1030,7 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
       char *dest_colors;
       int effective_width = mzm.width;
       int effective_height = mzm.height;
-      int file_line_skip;
-      int line_skip;
-      int x, y;
+      int y;
       int offset;
 
       if(mode == MZM_LOAD_TO_OVERLAY)
@@ -899,54 +1063,16 @@ static int load_mzm_common(struct world *mzx_world, struct memfile *mf,
       if((effective_height + start_y) >= dest_height)
         effective_height = dest_height - start_y;
 
-      line_skip = dest_width - effective_width;
-
-      switch(mzm.storage_mode)
+      // For both storage modes, the param (used as the char for board
+      // storage) and color planes are transferred directly.
+      for(y = 0; y < effective_height; y++, offset += dest_width)
       {
-        case MZM_STORAGE_MODE_BOARD:
-        {
-          // Coming from board storage; for now use param as char
-
-          file_line_skip = (mzm.width - effective_width) * 6;
-
-          for(y = 0; y < effective_height; y++)
-          {
-            for(x = 0; x < effective_width; x++, offset++)
-            {
-              // Skip ID
-              mf->current += 1;
-              dest_chars[offset] = mfgetc(mf);
-              dest_colors[offset] = mfgetc(mf);
-              // Skip under parts
-              mf->current += 3;
-            }
-
-            offset += line_skip;
-            mf->current += file_line_skip;
-          }
-          break;
-        }
-
-        case MZM_STORAGE_MODE_LAYER:
-        {
-          // Coming from layer storage; transfer directly
-
-          file_line_skip = (mzm.width - effective_width) * 2;
-
-          for(y = 0; y < effective_height; y++)
-          {
-            for(x = 0; x < effective_width; x++, offset++)
-            {
-              dest_chars[offset] = mfgetc(mf);
-              dest_colors[offset] = mfgetc(mf);
-            }
-
-            offset += line_skip;
-            mf->current += file_line_skip;
-          }
-          break;
-        }
+        int src_offset = y * mzm.width;
 
+        memcpy(dest_chars + offset, mzm_data->param + src_offset,
+         effective_width);
+        memcpy(dest_colors + offset, mzm_data->color + src_offset,
+         effective_width);
       }
       break;
     }
@@ -961,21 +1087,170 @@ err_robots:
   // The main file loaded fine, but there was a problem handling robots
   error_message(E_MZM_ROBOT_CORRUPT, 0, name);
   return 0;
+}
+
+static void mzm_cache_unlink(struct mzm_cache *cache,
+ struct mzm_cache_entry *e)
+{
+  if(e->prev)
+    e->prev->next = e->next;
+  else
+    cache->head = e->next;
 
-err_invalid:
-  error_message(E_MZM_FILE_INVALID, 0, name);
-  return -1;
+  if(e->next)
+    e->next->prev = e->prev;
+  else
+    cache->tail = e->prev;
+
+  e->prev = NULL;
+  e->next = NULL;
+}
+
+static void mzm_cache_link_head(struct mzm_cache *cache,
+ struct mzm_cache_entry *e)
+{
+  e->prev = NULL;
+  e->next = cache->head;
+  if(cache->head)
+    cache->head->prev = e;
+  else
+    cache->tail = e;
+
+  cache->head = e;
+}
+
+static void mzm_cache_delete(struct mzm_cache *cache,
+ struct mzm_cache_entry *e)
+{
+  mzm_cache_unlink(cache, e);
+  cache->total_size -= e->alloc_size;
+  mzm_data_free(&(e->mzm));
+  free((void *)e->mzm.file);
+  free(e);
+}
+
+static struct mzm_cache_entry *mzm_cache_find(struct mzm_cache *cache,
+ const char *path, uint32_t path_hash)
+{
+  struct mzm_cache_entry *e;
+
+  for(e = cache->head; e; e = e->next)
+    if(e->path_hash == path_hash && !strcmp(e->path, path))
+      return e;
+
+  return NULL;
+}
+
+/**
+ * Add a decoded MZM to the cache, discarding the least recently used MZMs if
+ * the cache is over its memory limit. If the MZM can't be cached, returns
+ * NULL, in which case the caller still owns the decoded MZM and file data.
+ */
+static struct mzm_cache_entry *mzm_cache_add(struct world *mzx_world,
+ const char *path, uint32_t path_hash, const struct stat *st,
+ const struct mzm_data *mzm, size_t file_size)
+{
+  struct config_info *conf = get_config();
+  struct mzm_cache *cache = mzx_world->mzm_cache;
+  struct mzm_cache_entry *e;
+  size_t path_len = strlen(path);
+  size_t alloc_size;
+  size_t max_size;
+
+  if(conf->mzm_cache_memory <= 0)
+    return NULL;
+
+  // Modification times usually have a resolution of one second, so the file
+  // could still be modified without changing it if it was modified recently.
+  if(st->st_mtime >= time(NULL))
+    return NULL;
+
+  max_size = MIN((uint64_t)conf->mzm_cache_memory, SIZE_MAX);
+  alloc_size = sizeof(struct mzm_cache_entry) + path_len +
+   mzm->header.width * mzm->header.height * (mzm->header.storage_mode ? 2 : 6) +
+   mzm->num_robot_cells * sizeof(uint32_t) + (mzm->file ? file_size : 0);
+
+  if(alloc_size > max_size)
+    return NULL;
+
+  if(!cache)
+  {
+    cache = (struct mzm_cache *)ccalloc(1, sizeof(struct mzm_cache));
+    mzx_world->mzm_cache = cache;
+  }
+
+  while(cache->tail && cache->total_size + alloc_size > max_size)
+    mzm_cache_delete(cache, cache->tail);
+
+  e = (struct mzm_cache_entry *)cmalloc(sizeof(struct mzm_cache_entry) +
+   path_len);
+  memcpy(&(e->mzm), mzm, sizeof(struct mzm_data));
+  memcpy(e->path, path, path_len + 1);
+  e->path_hash = path_hash;
+  e->dev = st->st_dev;
+  e->ino = st->st_ino;
+  e->mtime = st->st_mtime;
+  e->size = st->st_size;
+  e->alloc_size = alloc_size;
+
+  mzm_cache_link_head(cache, e);
+  cache->total_size += alloc_size;
+  return e;
+}
+
+/**
+ * Free all decoded MZMs for a world. This should be called when the world is
+ * cleared.
+ */
+void mzm_cache_free(struct world *mzx_world)
+{
+  struct mzm_cache *cache = mzx_world->mzm_cache;
+  if(cache)
+  {
+    while(cache->head)
+      mzm_cache_delete(cache, cache->head);
+
+    free(cache);
+    mzx_world->mzm_cache = NULL;
+  }
 }
 
 int load_mzm(struct world *mzx_world, char *name, int start_x, int start_y,
  int mode, int savegame, enum thing layer_convert_id)
 {
+  struct mzm_cache_entry *e = NULL;
+  struct mzm_data mzm;
+  uint32_t path_hash = fnv_1a_hash_string_len(name, strlen(name));
+  boolean use_cache = false;
   vfile *input_file;
   size_t file_size;
   void *buffer;
   int success;
   int count;
-  struct memfile mf;
+  struct stat st;
+
+  // Files in the VFS have their modification time updated every time they
+  // are closed, so it can't be used to tell if they've changed.
+  if(!vstat(name, &st) && st.st_dev != (dev_t)VFS_MZX_DEVICE)
+    use_cache = true;
+
+  if(use_cache && mzx_world->mzm_cache)
+  {
+    e = mzm_cache_find(mzx_world->mzm_cache, name, path_hash);
+    if(e)
+    {
+      if(e->dev == st.st_dev && e->ino == st.st_ino &&
+       e->mtime == st.st_mtime && e->size == st.st_size)
+      {
+        mzm_cache_unlink(mzx_world->mzm_cache, e);
+        mzm_cache_link_head(mzx_world->mzm_cache, e);
+        return place_mzm(mzx_world, &(e->mzm), start_x, start_y, mode,
+         savegame, layer_convert_id, name);
+      }
+      mzm_cache_delete(mzx_world->mzm_cache, e);
+    }
+  }
+
   input_file = vfopen_unsafe(name, "rb");
   if(input_file)
   {
@@ -990,9 +1265,33 @@ int load_mzm(struct world *mzx_world, char *name, int start_x, int start_y,
       return -1;
     }
 
-    mfopen(buffer, file_size, &mf);
-    success = load_mzm_common(mzx_world, &mf, (int)file_size, start_x,
-     start_y, mode, savegame, layer_convert_id, name);
+    if(!mzm_decode(&mzm, buffer, file_size))
+    {
+      mzm_data_free(&mzm);
+      free(buffer);
+      error_message(E_MZM_FILE_INVALID, 0, name);
+      return -1;
+    }
+
+    // The file only needs to be kept if the MZM has robots.
+    if(!mzm.file)
+    {
+      free(buffer);
+      buffer = NULL;
+    }
+
+    if(use_cache)
+      e = mzm_cache_add(mzx_world, name, path_hash, &st, &mzm, file_size);
+
+    if(e)
+    {
+      return place_mzm(mzx_world, &(e->mzm), start_x, start_y, mode,
+       savegame, layer_convert_id, name);
+    }
+
+    success = place_mzm(mzx_world, &mzm, start_x, start_y, mode,
+     savegame, layer_convert_id, name);
+    mzm_data_free(&mzm);
     free(buffer);
     return success;
   }
@@ -1007,10 +1306,20 @@ int load_mzm_memory(struct world *mzx_world, char *name, int start_x,
  int start_y, int mode, int savegame, enum thing layer_convert_id,
  const void *buffer, size_t length)
 {
-  struct memfile mf;
-  mfopen(buffer, length, &mf);
-  return load_mzm_common(mzx_world, &mf, (int)length, start_x, start_y,
-   mode, savegame, layer_convert_id, name);
+  struct mzm_data mzm;
+  int success;
+
+  if(!mzm_decode(&mzm, buffer, length))
+  {
+    mzm_data_free(&mzm);
+    error_message(E_MZM_FILE_INVALID, 0, name);
+    return -1;
+  }
+
+  success = place_mzm(mzx_world, &mzm, start_x, start_y, mode, savegame,
+   layer_convert_id, name);
+  mzm_data_free(&mzm);
+  return success;
 }
 
 boolean load_mzm_header(char *name, struct mzm_header *mzm_header)
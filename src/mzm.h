@@ -68,6 +68,7 @@ CORE_LIBSPEC int load_mzm_memory(struct world *mzx_world, char *name, int start_
  int start_y, int mode, int savegame, enum thing layer_convert_id,
  const void *buffer, size_t length);
 CORE_LIBSPEC boolean load_mzm_header(char *name, struct mzm_header *mzm_header);
+CORE_LIBSPEC void mzm_cache_free(struct world *mzx_world);
 
 __M_END_DECLS
 
@@ -95,6 +95,7 @@ struct dso_syms_map
 
 CORE_LIBSPEC void delay(uint32_t ms);
 CORE_LIBSPEC uint64_t get_ticks(void);
+CORE_LIBSPEC uint64_t get_ticks_ns(void);
 CORE_LIBSPEC boolean platform_init(void);
 CORE_LIBSPEC void platform_quit(void);
 CORE_LIBSPEC boolean platform_system_time(struct tm *tm,
@@ -193,3 +193,33 @@ boolean platform_system_time(struct tm *tm, int64_t *epoch, int32_t *nano)
     return false;
   }
 }
+
+/**
+ * Get a monotonic timestamp in nanoseconds for profiling. The epoch is
+ * arbitrary, so this is only useful for measuring intervals. Platforms
+ * without a precise monotonic clock fall back to `get_ticks`.
+ */
+uint64_t get_ticks_ns(void)
+{
+#if defined(_WIN32)
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER count;
+
+  if(!freq.QuadPart)
+    QueryPerformanceFrequency(&freq);
+
+  if(freq.QuadPart && QueryPerformanceCounter(&count))
+  {
+    uint64_t secs = count.QuadPart / freq.QuadPart;
+    uint64_t rem = count.QuadPart % freq.QuadPart;
+    return secs * 1000000000ULL + rem * 1000000000ULL / freq.QuadPart;
+  }
+#elif defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0 && defined(CLOCK_MONOTONIC)
+  struct timespec tp;
+
+  if(!clock_gettime(CLOCK_MONOTONIC, &tp))
+    return (uint64_t)tp.tv_sec * 1000000000ULL + (uint64_t)tp.tv_nsec;
+#endif
+
+  return get_ticks() * 1000000ULL;
+}
@@ -3032,6 +3032,21 @@ static char *get_expr_value_token(char *src)
       if(next == start)
         return src;
 
+      // Counter array element (2.94+). The index is an expression, or empty
+      // for the size of the array.
+      if(*next == '[')
+      {
+        next = skip_whitespace(next + 1);
+        if(*next != ']')
+        {
+          char *index_end = get_expression(next, ']', ']');
+          if(index_end == next || *index_end != ']')
+            return src;
+
+          next = index_end;
+        }
+        next++;
+      }
       break;
     }
   }
@@ -1580,6 +1580,7 @@ void run_robot(context *ctx, int id, int x, int y)
         if(is_string(dest_buffer))
         {
           struct string dest;
+          struct string *src_str = NULL;
 
           // Is it a non-immediate
           if(*src_string)
@@ -1590,7 +1591,8 @@ void run_robot(context *ctx, int id, int x, int y)
             if(is_string(src_buffer))
             {
               // Is it another string?
-              if(!get_string(mzx_world, src_buffer, &dest, id))
+              if(!get_string_source(mzx_world, src_buffer, &dest, &src_str,
+               id))
               {
                 dest.value = src_buffer;
                 src_buffer[0] = '\0';
@@ -1611,7 +1613,7 @@ void run_robot(context *ctx, int id, int x, int y)
             dest.length = tmp;
           }
 
-          gotoed = set_string(mzx_world, dest_buffer, &dest, id);
+          gotoed = set_string(mzx_world, dest_buffer, &dest, src_str, id);
 
           // Loading source/robots from strings might have changed these
           if(gotoed)
@@ -1803,7 +1805,8 @@ void run_robot(context *ctx, int id, int x, int y)
             }
 
             src_value = 0;
-            dest_value = compare_strings(&dest, &src, exact_case, wildcards);
+            dest_value = compare_strings(mzx_world, &dest, &src, exact_case,
+             wildcards);
           }
           // Null-terminated string compares (2.80X and prior).
           else
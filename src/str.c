@@ -25,9 +25,11 @@
 
 #include "str.h"
 
+#include "arena.h"
 #include "counter.h"
 #include "error.h"
 #include "graphics.h"
+#include "hashtable.h"
 #include "memcasecmp.h"
 #include "rasm.h"
 #include "robot.h"
@@ -42,8 +44,10 @@
  * all string names.
  */
 
-#ifdef CONFIG_COUNTER_HASH_TABLES
-#include "hashtable.h"
+#if defined(CONFIG_COUNTER_SWISS_TABLES)
+#include "swisstable.h"
+SWISS_SET_INIT(STRING, struct string *, name, name_length)
+#elif defined(CONFIG_COUNTER_HASH_TABLES)
 HASH_SET_INIT(STRING, struct string *, name, name_length)
 #endif
 
@@ -132,20 +136,63 @@ static size_t get_string_alloc_size(size_t name_length)
    offsetof(struct string, name) + name_length + 1);
 }
 
+/**
+ * String values are reference counted so a string that is set to the entire
+ * value of another string can share that value until one of them is written
+ * to. The count is stored in a small header before the value.
+ */
+#define STRING_BUFFER_HEADER 8
+
+// Shorter values are just copied; sharing them would save almost nothing.
+#define STRING_SHARE_MIN_LENGTH 256
+
+// Maximum number of bytes delimited FREAD reads at a time. Anything read past
+// the delimiter has to be returned to the file, so this shouldn't be large.
+#define FREAD_BLOCK_SIZE 512
+
+static uint32_t *string_buffer_refs(char *value)
+{
+  return (uint32_t *)(value - STRING_BUFFER_HEADER);
+}
+
+static char *string_buffer_alloc(struct arena *arena, size_t length)
+{
+  char *buf = (char *)arena_pool_alloc(arena, length + STRING_BUFFER_HEADER);
+  if(!buf)
+    return NULL;
+
+  *(uint32_t *)buf = 1;
+  return buf + STRING_BUFFER_HEADER;
+}
+
+static void string_buffer_release(struct arena *arena, char *value,
+ size_t allocated_length)
+{
+  uint32_t *refs = string_buffer_refs(value);
+  if(--(*refs) == 0)
+    arena_pool_free(arena, refs, allocated_length + STRING_BUFFER_HEADER);
+}
+
 /**
  * Allocate a new string and initialize its name, length, and pointer fields.
  * This function does not add the new string to the string list or initialize
  * its value.
  */
-static struct string *allocate_new_string(const char *name, size_t name_length,
- size_t length)
+static struct string *allocate_new_string(struct string_list *string_list,
+ const char *name, size_t name_length, size_t length)
 {
-  struct string *dest = (struct string *)cmalloc(get_string_alloc_size(name_length));
-  char *value = (char *)cmalloc(MAX(length, 1));
-  if(!dest || !value)
+  struct arena *arena = &(string_list->arena);
+  struct string *dest;
+  char *value;
+
+  value = string_buffer_alloc(arena, length);
+  if(!value)
+    return NULL;
+
+  dest = (struct string *)arena_alloc(arena, get_string_alloc_size(name_length));
+  if(!dest)
   {
-    free(dest);
-    free(value);
+    string_buffer_release(arena, value, length);
     return NULL;
   }
 
@@ -153,6 +200,7 @@ static struct string *allocate_new_string(const char *name, size_t name_length,
   dest->name[name_length] = 0;
 
   dest->name_length = name_length;
+  dest->numeric_valid = false;
   dest->allocated_length = length;
   dest->length = length;
   dest->value = value;
@@ -203,7 +251,7 @@ static struct string *add_string_preallocate(struct string_list *string_list,
      (count - position) * sizeof(struct string *));
   }
 
-  dest = allocate_new_string(name, name_length, length);
+  dest = allocate_new_string(string_list, name, name_length, length);
   if(!dest)
     return NULL;
 
@@ -214,6 +262,12 @@ static struct string *add_string_preallocate(struct string_list *string_list,
   string_list->strings[position] = dest;
   string_list->num_strings = count + 1;
 
+#ifndef CONFIG_COUNTER_HASH_TABLES
+  // Without the hash table new strings are inserted in order. Otherwise,
+  // they're appended and sort_string_list will sort them later.
+  string_list->num_strings_sorted = count + 1;
+#endif
+
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_ADD(STRING, string_list->hash_table, dest);
 #endif
@@ -222,29 +276,63 @@ static struct string *add_string_preallocate(struct string_list *string_list,
 }
 
 /**
- * Reallocate an existing string.
+ * Reallocate an existing string. If the string's value is shared with other
+ * strings, it will be given its own copy of the value instead.
  */
 static struct string *reallocate_string(struct string_list *string_list,
  struct string *src, int pos, size_t length)
 {
-  char *value = (char *)crealloc(src->value, MAX(length, 1));
-  if(!value)
-    return NULL;
+  struct arena *arena = &(string_list->arena);
+  size_t old_length = src->allocated_length;
+  char *value;
+
+  if(*string_buffer_refs(src->value) > 1)
+  {
+    value = string_buffer_alloc(arena, length);
+    if(!value)
+      return NULL;
+
+    // Only the current value needs to be copied; the rest is filled below.
+    old_length = MIN(src->length, length);
+    memcpy(value, src->value, old_length);
+    string_buffer_release(arena, src->value, src->allocated_length);
+  }
+  else
+  {
+    char *buf = (char *)arena_pool_realloc(arena,
+     src->value - STRING_BUFFER_HEADER, old_length + STRING_BUFFER_HEADER,
+     length + STRING_BUFFER_HEADER);
+    if(!buf)
+      return NULL;
+
+    value = buf + STRING_BUFFER_HEADER;
+  }
 
   src->value = value;
+  src->numeric_valid = false;
 
   // any new bits of the string should be space filled
   // versions up to and including 2.81h used to fill this with garbage
-  if(src->allocated_length < length)
-  {
-    memset(&src->value[src->allocated_length], ' ',
-     length - src->allocated_length);
-  }
+  if(old_length < length)
+    memset(&src->value[old_length], ' ', length - old_length);
 
   src->allocated_length = length;
   return src;
 }
 
+/**
+ * Give a string its own copy of its value if it is shared with other strings.
+ * This must be done before writing to a string's value.
+ */
+static struct string *unshare_string(struct string_list *string_list,
+ struct string *src, int pos)
+{
+  if(*string_buffer_refs(src->value) > 1)
+    return reallocate_string(string_list, src, pos, src->allocated_length);
+
+  return src;
+}
+
 /**
  * Set a string's length and reallocate it if necessary.
  * If the string does not exist, it will be created.
@@ -270,6 +358,16 @@ static boolean force_string_length(struct string_list *string_list,
     if(!*str)
       return false;
   }
+  else
+  {
+    *str = unshare_string(string_list, *str, next);
+    if(!*str)
+      return false;
+  }
+
+  // The caller is about to modify the string, so its cached numeric value
+  // can't be trusted anymore.
+  (*str)->numeric_valid = false;
 
   /* Wipe string if the length has increased but not the allocated memory */
   if(*length > (*str)->length)
@@ -366,6 +464,41 @@ static boolean force_string_move(struct string_list *string_list,
   return true;
 }
 
+/**
+ * Set a string to share the value of another string (or the start of it).
+ * Both strings will use the same value until either is written to, at which
+ * point the string being written to gets its own copy. This is only valid for
+ * setting an entire string; splices must use force_string_move instead.
+ *
+ * If the string does not exist, it will be created.
+ * Returns false if a string could not be created, otherwise true.
+ */
+static boolean force_string_share(struct string_list *string_list,
+ const char *name, int next, struct string **str, struct string *src,
+ size_t length)
+{
+  if(!*str)
+  {
+    *str = add_string_preallocate(string_list, name, 0, next);
+    if(!*str)
+      return false;
+  }
+
+  if((*str)->value != src->value)
+  {
+    string_buffer_release(&(string_list->arena), (*str)->value,
+     (*str)->allocated_length);
+
+    (*string_buffer_refs(src->value))++;
+    (*str)->value = src->value;
+    (*str)->allocated_length = src->allocated_length;
+  }
+
+  (*str)->length = length;
+  (*str)->numeric_valid = false;
+  return true;
+}
+
 static void get_string_dot_value(char *dot_ptr, int *index,
  size_t *size, boolean *index_specified)
 {
@@ -471,6 +604,20 @@ static int get_string_numeric_value(struct string *src)
   return 0;
 }
 
+/**
+ * Get the numeric value of an entire string, reusing the value from the last
+ * time the string was read as a counter if it hasn't been modified since.
+ */
+static int get_string_numeric_value_cached(struct string *src)
+{
+  if(!src->numeric_valid)
+  {
+    src->numeric_value = get_string_numeric_value(src);
+    src->numeric_valid = true;
+  }
+  return src->numeric_value;
+}
+
 /**
  * Read a string as a counter. This occurs either when the string length is
  * read, a string index is read, or when a counter is set to a string or a
@@ -487,6 +634,7 @@ int string_read_as_counter(struct world *mzx_world,
 {
   struct string_list *string_list = &(mzx_world->string_list);
   char *dot_ptr = strchr(name_buffer + 1, '.');
+  struct string *source;
   struct string src;
 
   // User may have provided $str.N or $str.length explicitly
@@ -562,8 +710,14 @@ int string_read_as_counter(struct world *mzx_world,
   else
 
   // Otherwise fall back to looking up a regular string
-  if(get_string(mzx_world, name_buffer, &src, id))
+  if(get_string_source(mzx_world, name_buffer, &src, &source, id))
+  {
+    // Only the whole string has a cached value; splices are parsed directly.
+    if(src.value == source->value && src.length == source->length)
+      return get_string_numeric_value_cached(source);
+
     return get_string_numeric_value(&src);
+  }
 
   // The string wasn't found or the request was out of bounds
   return 0;
@@ -702,7 +856,7 @@ void string_write_as_counter(struct world *mzx_world,
 
     src_str.value = n_buffer;
     src_str.length = strlen(n_buffer);
-    set_string(mzx_world, name_buffer, &src_str, id);
+    set_string(mzx_world, name_buffer, &src_str, NULL, id);
   }
 }
 
@@ -849,11 +1003,14 @@ void load_string_board(struct world *mzx_world, char *name_buffer,
  * @param  mzx_world    World data.
  * @param  name_buffer  Mutable buffer containing the string name.
  * @param  src          String to set the destination string to.
+ * @param  src_str      String src is a view of (from get_string_source), or
+ *                      NULL. If src is the start of its value, the destination
+ *                      may share the value instead of copying it.
  * @param  id           Current robot ID or 0 for global.
  * @return              1 if the robot program was modified, otherwise 0.
  */
 int set_string(struct world *mzx_world, char *name, struct string *src,
- int id)
+ struct string *src_str, int id)
 {
   struct string_list *string_list = &(mzx_world->string_list);
   boolean offset_specified = false;
@@ -981,8 +1138,15 @@ int set_string(struct world *mzx_world, char *name, struct string *src,
         dest_value = dest->value;
         allocated = dest->allocated_length;
 
+        /* Read in blocks instead of a char at a time. Anything read after
+         * the terminator is returned to the file with a seek.
+         */
         while(read_pos < MAX_STRING_LEN)
         {
+          size_t block_size;
+          size_t block_read;
+          char *terminator;
+
           if(read_pos >= allocated)
           {
             if((allocated *= 2) > MAX_STRING_LEN)
@@ -992,12 +1156,30 @@ int set_string(struct world *mzx_world, char *name, struct string *src,
               break;
             dest_value = dest->value;
           }
-          current_char = vfgetc(input_file);
 
-          if(current_char == terminate_char || current_char == EOF)
+          block_size = MIN(allocated - read_pos, FREAD_BLOCK_SIZE);
+          block_read = vfread(dest_value + read_pos, 1, block_size, input_file);
+
+          terminator = (char *)memchr(dest_value + read_pos, terminate_char,
+           block_read);
+
+          if(terminator)
+          {
+            size_t used = terminator - (dest_value + read_pos);
+
+            vfseek(input_file, (int64_t)(used + 1) - (int64_t)block_read,
+             SEEK_CUR);
+            read_pos += used;
+            current_char = terminate_char;
             break;
+          }
 
-          dest_value[read_pos++] = current_char;
+          read_pos += block_read;
+          if(block_read < block_size)
+          {
+            current_char = EOF;
+            break;
+          }
         }
         // Should always be true.
         if(offset == 0 && !offset_specified)
@@ -1335,9 +1517,19 @@ int set_string(struct world *mzx_world, char *name, struct string *src,
 
   else
   {
-    // Just a normal string here.
-    force_string_move(string_list, name, next, &dest, src_length,
-     offset, offset_specified, &size, size_specified, src_value);
+    // Just a normal string here. If the value is the start of the source
+    // string, setting the whole string can share it.
+    if(src_str && src_value == src_str->value &&
+     src_length <= src_str->length && src_length >= STRING_SHARE_MIN_LENGTH &&
+     !offset_specified && !size_specified)
+    {
+      force_string_share(string_list, name, next, &dest, src_str, src_length);
+    }
+    else
+    {
+      force_string_move(string_list, name, next, &dest, src_length,
+       offset, offset_specified, &size, size_specified, src_value);
+    }
   }
 
   return 0;
@@ -1383,6 +1575,19 @@ struct string *new_string(struct world *mzx_world, const char *name,
  */
 int get_string(struct world *mzx_world, char *name_buffer, struct string *dest,
  int id)
+{
+  return get_string_source(mzx_world, name_buffer, dest, NULL, id);
+}
+
+/**
+ * Like get_string, but also provides the string the value belongs to. This
+ * can be passed to set_string to allow the destination to share the value.
+ *
+ * @param  source       Destination for the source string, or NULL. This will
+ *                      only be initialized on success.
+ */
+int get_string_source(struct world *mzx_world, char *name_buffer,
+ struct string *dest, struct string **source, int id)
 {
   struct string_list *string_list = &(mzx_world->string_list);
   boolean offset_specified = false;
@@ -1421,6 +1626,8 @@ int get_string(struct world *mzx_world, char *name_buffer, struct string *dest,
 
     dest->value = src->value + offset;
     dest->length = size;
+    if(source)
+      *source = src;
     return 1;
   }
 
@@ -1475,8 +1682,11 @@ void inc_string(struct world *mzx_world, char *name_buffer, struct string *src,
       return;
 
     // Concatenate
-    if(new_length > dest->allocated_length)
+    if(new_length > dest->allocated_length ||
+     *string_buffer_refs(dest->value) > 1)
     {
+      size_t alloc_length = MAX(new_length, dest->allocated_length);
+
       // Handle collisions, for incrementing something by a splice
       // of itself, which could relocate the string and the value...
       char *src_end = src->value + src->length;
@@ -1484,17 +1694,18 @@ void inc_string(struct world *mzx_world, char *name_buffer, struct string *src,
        (src_end >= dest->value))
       {
         char *old_dest_value = dest->value;
-        dest = reallocate_string(string_list, dest, next, new_length);
+        dest = reallocate_string(string_list, dest, next, alloc_length);
         src->value += (dest->value - old_dest_value);
       }
       else
       {
-        dest = reallocate_string(string_list, dest, next, new_length);
+        dest = reallocate_string(string_list, dest, next, alloc_length);
       }
     }
 
     memcpy(dest->value + dest->length, src->value, src->length);
     dest->length = new_length;
+    dest->numeric_valid = false;
   }
   else
   {
@@ -1530,9 +1741,58 @@ void dec_string_int(struct world *mzx_world, const char *name, int value,
       dest->length = 0;
     else
       dest->length -= value;
+
+    dest->numeric_valid = false;
   }
 }
 
+/**
+ * Wildcard patterns are compiled into groups of characters separated by %
+ * wildcards. Each group has a fixed length and may contain ? wildcards, so a
+ * pattern matches if the first group matches the start of the string, the
+ * last group matches the end of the string, and every group in between can
+ * be found in order (leftmost first) in the rest of the string. Compiled
+ * patterns are cached by pattern text since the same patterns tend to be
+ * compared over and over by the same few commands.
+ */
+
+#define WILDCARD_CACHE_SIZE 32
+#define WILDCARD_CACHE_MAX_LENGTH 64
+
+struct wildcard_group
+{
+  size_t offset;
+  size_t length;
+  // First character in the group that isn't a ? wildcard, or length if none.
+  size_t literal;
+};
+
+struct wildcard_pattern
+{
+  struct wildcard_group *groups;
+  // Pattern chars with escapes removed (lowercase if case insensitive).
+  unsigned char *chars;
+  // Nonzero where the pattern char is a ? wildcard.
+  char *any;
+  size_t num_groups;
+  boolean exact_case;
+  boolean has_wildcard;
+  boolean anchored_start;
+  boolean anchored_end;
+};
+
+struct wildcard_cache_entry
+{
+  struct wildcard_pattern pattern;
+  size_t pat_len;
+  char pat[WILDCARD_CACHE_MAX_LENGTH];
+  struct wildcard_group groups[WILDCARD_CACHE_MAX_LENGTH / 2 + 1];
+  unsigned char chars[WILDCARD_CACHE_MAX_LENGTH];
+  char any[WILDCARD_CACHE_MAX_LENGTH];
+};
+
+static struct wildcard_cache_entry wildcard_cache[WILDCARD_CACHE_SIZE];
+
 static boolean wildcard_char_is_escapable(unsigned char c)
 {
   return (c == '%') || (c == '?') || (c == '\\');
@@ -1713,7 +1973,8 @@ static int compare_wildcard_slow(const char *str, size_t str_len,
 // Basic wildcard match-- supports anything but % followed by literals.
 // This is a lot faster than the older algorithm, but if the aforementioned
 // case is encountered, it has to call the old algorithm instead.
-static int compare_wildcard(const char *str, size_t str_len,
+// Worlds prior to 2.94 use these functions so their results don't change.
+static int compare_wildcard_legacy(const char *str, size_t str_len,
  const char *pat, size_t pat_len, boolean exact_case)
 {
   size_t s = 0;
@@ -1861,8 +2122,243 @@ static int compare_wildcard(const char *str, size_t str_len,
   return 1;
 }
 
-int compare_strings(struct string *A, struct string *B, boolean exact_case,
- boolean allow_wildcards)
+/**
+ * Compile a pattern. The groups array must have room for pat_len / 2 + 1
+ * groups and the chars and any arrays must have room for pat_len chars.
+ */
+static void compile_wildcard(struct wildcard_pattern *dest,
+ const char *pat, size_t pat_len, boolean exact_case)
+{
+  struct wildcard_group *group = NULL;
+  size_t num_chars = 0;
+  size_t i;
+
+  dest->num_groups = 0;
+  dest->exact_case = exact_case;
+  dest->has_wildcard = false;
+  dest->anchored_start = true;
+  dest->anchored_end = true;
+
+  for(i = 0; i < pat_len; i++)
+  {
+    unsigned char c = pat[i];
+    char any = 0;
+
+    if(c == '%')
+    {
+      // Consecutive % wildcards are the same as one.
+      if(!dest->num_groups)
+        dest->anchored_start = false;
+
+      dest->has_wildcard = true;
+      dest->anchored_end = false;
+      group = NULL;
+      continue;
+    }
+
+    if(c == '?')
+      any = 1;
+    else
+
+    if(c == '\\' && i + 1 < pat_len && wildcard_char_is_escapable(pat[i + 1]))
+      c = pat[++i];
+
+    if(!group)
+    {
+      group = &(dest->groups[dest->num_groups++]);
+      group->offset = num_chars;
+      group->length = 0;
+      group->literal = 0;
+      dest->anchored_end = true;
+    }
+
+    // Track the number of leading ? wildcards in the group.
+    if(any && group->literal == group->length)
+      group->literal++;
+
+    dest->chars[num_chars] = exact_case ? c : memtolower(c);
+    dest->any[num_chars] = any;
+    num_chars++;
+    group->length++;
+  }
+}
+
+static boolean match_wildcard_group(const struct wildcard_pattern *pattern,
+ const struct wildcard_group *group, const char *str)
+{
+  const unsigned char *chars = pattern->chars + group->offset;
+  const char *any = pattern->any + group->offset;
+  size_t i;
+
+  if(pattern->exact_case)
+  {
+    for(i = 0; i < group->length; i++)
+      if(!any[i] && (unsigned char)str[i] != chars[i])
+        return false;
+  }
+  else
+  {
+    for(i = 0; i < group->length; i++)
+      if(!any[i] && memtolower(str[i]) != chars[i])
+        return false;
+  }
+  return true;
+}
+
+/**
+ * Find the first position from start where a group matches and fits before
+ * end. Returns the position or (size_t)-1 if the group isn't found.
+ */
+static size_t find_wildcard_group(const struct wildcard_pattern *pattern,
+ const struct wildcard_group *group, const char *str, size_t start,
+ size_t end)
+{
+  size_t literal = group->literal;
+  const char *next;
+  unsigned char c;
+  size_t pos;
+
+  if(end < group->length || start > end - group->length)
+    return (size_t)-1;
+
+  // All ? wildcards: any position that fits works.
+  if(literal == group->length)
+    return start;
+
+  // Only check positions where the group's first literal char matches.
+  // memtolower only changes A-Z, so memchr can be used for anything else.
+  c = pattern->chars[group->offset + literal];
+  end -= group->length;
+  for(pos = start; pos <= end; pos++)
+  {
+    if(pattern->exact_case || c < 'a' || c > 'z')
+    {
+      next = (const char *)memchr(str + pos + literal, c, end - pos + 1);
+      if(!next)
+        return (size_t)-1;
+
+      pos = next - str - literal;
+    }
+    else
+    {
+      while(pos <= end && memtolower(str[pos + literal]) != c)
+        pos++;
+
+      if(pos > end)
+        return (size_t)-1;
+    }
+
+    if(match_wildcard_group(pattern, group, str + pos))
+      return pos;
+  }
+  return (size_t)-1;
+}
+
+static int match_wildcard(const struct wildcard_pattern *pattern,
+ const char *str, size_t str_len)
+{
+  const struct wildcard_group *groups = pattern->groups;
+  size_t first = 0;
+  size_t last = pattern->num_groups;
+  size_t start = 0;
+  size_t end = str_len;
+  size_t i;
+
+  // No % wildcards: the only group must match the entire string.
+  if(!pattern->has_wildcard)
+  {
+    if(!last)
+      return (str_len == 0) ? 0 : 1;
+
+    if(groups[0].length != str_len)
+      return 1;
+
+    return match_wildcard_group(pattern, &groups[0], str) ? 0 : 1;
+  }
+
+  if(pattern->anchored_start && first < last)
+  {
+    if(groups[0].length > end ||
+     !match_wildcard_group(pattern, &groups[0], str))
+      return 1;
+
+    start = groups[0].length;
+    first++;
+  }
+
+  if(pattern->anchored_end && first < last)
+  {
+    const struct wildcard_group *group = &groups[last - 1];
+    if(end - start < group->length ||
+     !match_wildcard_group(pattern, group, str + end - group->length))
+      return 1;
+
+    end -= group->length;
+    last--;
+  }
+
+  for(i = first; i < last; i++)
+  {
+    size_t pos = find_wildcard_group(pattern, &groups[i], str, start, end);
+    if(pos == (size_t)-1)
+      return 1;
+
+    start = pos + groups[i].length;
+  }
+  return 0;
+}
+
+/**
+ * Compare a string to a wildcard pattern. Returns 0 if the string matches.
+ *
+ * The matcher used prior to 2.94 (compare_wildcard_legacy) failed to match in
+ * a few cases where it should have: a letter following % was compared
+ * case-sensitively by case-insensitive comparisons, ? following % could be
+ * misaligned when the pattern had multiple % wildcards, and a trailing
+ * backslash was compared to the char after the end of the pattern.
+ */
+static int compare_wildcard(const char *str, size_t str_len,
+ const char *pat, size_t pat_len, boolean exact_case)
+{
+  struct wildcard_pattern tmp;
+  struct wildcard_cache_entry *entry;
+  int res;
+
+  if(pat_len <= WILDCARD_CACHE_MAX_LENGTH)
+  {
+    uint32_t hash = fnv_1a_hash_string_len(pat, pat_len) + exact_case;
+    entry = &(wildcard_cache[hash % WILDCARD_CACHE_SIZE]);
+
+    if(!entry->pattern.groups || entry->pat_len != pat_len ||
+     entry->pattern.exact_case != exact_case ||
+     memcmp(entry->pat, pat, pat_len))
+    {
+      entry->pattern.groups = entry->groups;
+      entry->pattern.chars = entry->chars;
+      entry->pattern.any = entry->any;
+      entry->pat_len = pat_len;
+      memcpy(entry->pat, pat, pat_len);
+      compile_wildcard(&(entry->pattern), pat, pat_len, exact_case);
+    }
+    return match_wildcard(&(entry->pattern), str, str_len);
+  }
+
+  // Long patterns aren't worth caching.
+  tmp.groups = (struct wildcard_group *)cmalloc(
+   (pat_len / 2 + 1) * sizeof(struct wildcard_group));
+  tmp.chars = (unsigned char *)cmalloc(pat_len * 2);
+  tmp.any = (char *)tmp.chars + pat_len;
+
+  compile_wildcard(&tmp, pat, pat_len, exact_case);
+  res = match_wildcard(&tmp, str, str_len);
+
+  free(tmp.groups);
+  free(tmp.chars);
+  return res;
+}
+
+int compare_strings(struct world *mzx_world, struct string *A,
+ struct string *B, boolean exact_case, boolean allow_wildcards)
 {
   size_t cmp_length = MIN(A->length, B->length);
   int res = 0;
@@ -1880,8 +2376,7 @@ int compare_strings(struct string *A, struct string *B, boolean exact_case,
 
     // NOTE: Versions prior to 2.91e have a string ordering bug.
     // If it's necessary to emulate this bug,
-    // then passing mzx_world into this function
-    // and using this instead will suffice for most affected versions:
+    // using this instead will suffice for most affected versions:
     //if(res != 0 && mzx_world->version < V291)
     if(res != 0)
       return res;
@@ -1895,6 +2390,12 @@ int compare_strings(struct string *A, struct string *B, boolean exact_case,
     return res;
   }
 
+  if(mzx_world->version < V294)
+  {
+    return compare_wildcard_legacy(A->value, A->length, B->value, B->length,
+     exact_case);
+  }
+
   return compare_wildcard(A->value, A->length, B->value, B->length, exact_case);
 }
 
@@ -1922,13 +2423,24 @@ int compare_strings_null_terminated(struct string *A, struct string *B)
   return 0;
 }
 
+// Make room for a number of strings about to be added by load_new_string.
+void load_string_list_reserve(struct string_list *string_list, size_t count)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  HASH_RESERVE(STRING, string_list->hash_table, count);
+#endif
+}
+
 // Create a new string from loading a save file. This skips find_string.
 struct string *load_new_string(struct string_list *string_list, int index,
  const char *name, int name_length, int str_length)
 {
-  struct string *dest = allocate_new_string(name, name_length, str_length);
+  struct string *dest =
+   allocate_new_string(string_list, name, name_length, str_length);
 
   string_list->strings[index] = dest;
+  if((unsigned int)index < string_list->num_strings_sorted)
+    string_list->num_strings_sorted = index;
 
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_ADD(STRING, string_list->hash_table, dest);
@@ -1944,31 +2456,76 @@ static int string_sort_fcn(const void *a, const void *b)
    (*(const struct string **)b)->name);
 }
 
+/**
+ * Sort the string list by name. Only strings added since the last sort need
+ * to be sorted; they are merged into the rest of the list.
+ */
 void sort_string_list(struct string_list *string_list)
 {
-  qsort(string_list->strings, (size_t)string_list->num_strings,
-   sizeof(struct string *), string_sort_fcn);
+  string_list->num_strings_sorted = sort_list_tail(
+   (void **)string_list->strings, string_list->num_strings_sorted,
+   string_list->num_strings, string_sort_fcn);
 }
 
-void clear_string_list(struct string_list *string_list)
+/**
+ * Find the strings with names starting with a given prefix (ignoring case).
+ * The prefix should include the '$'. The string list will be sorted if
+ * necessary. Returns the number of matching strings; the first matching
+ * string's position is stored in first.
+ */
+size_t find_string_prefix(struct string_list *string_list,
+ const char *prefix, size_t *first)
 {
-  unsigned int i;
+  struct string **strings;
+  size_t prefix_length = strlen(prefix);
+  size_t bottom = 0;
+  size_t top;
+  size_t start;
+
+  sort_string_list(string_list);
+  strings = string_list->strings;
+
+  // Lower bound: the first string that doesn't sort before the prefix.
+  top = string_list->num_strings;
+  while(bottom < top)
+  {
+    size_t middle = bottom + (top - bottom) / 2;
+    if(strncasecmp(strings[middle]->name, prefix, prefix_length) < 0)
+      bottom = middle + 1;
+    else
+      top = middle;
+  }
+  start = bottom;
+
+  // Upper bound: the first string that sorts after the prefix.
+  top = string_list->num_strings;
+  while(bottom < top)
+  {
+    size_t middle = bottom + (top - bottom) / 2;
+    if(strncasecmp(strings[middle]->name, prefix, prefix_length) <= 0)
+      bottom = middle + 1;
+    else
+      top = middle;
+  }
 
+  *first = start;
+  return bottom - start;
+}
+
+void clear_string_list(struct string_list *string_list)
+{
 #ifdef CONFIG_COUNTER_HASH_TABLES
   HASH_CLEAR(STRING, string_list->hash_table);
   string_list->hash_table = NULL;
 #endif
 
-  for(i = 0; i < string_list->num_strings; i++)
-  {
-    free(string_list->strings[i]->value);
-    free(string_list->strings[i]);
-  }
-
+  // The strings and their values are all freed with the arena.
+  arena_clear(&(string_list->arena));
   free(string_list->strings);
 
   string_list->num_strings = 0;
   string_list->num_strings_allocated = 0;
+  string_list->num_strings_sorted = 0;
   string_list->strings = NULL;
 }
 
@@ -1989,24 +2546,7 @@ void string_list_size(struct string_list *string_list,
   }
 
   if(strings_size)
-  {
-    size_t total = 0;
-    size_t i;
-
-    if(string_list->strings)
-    {
-      for(i = 0; i < string_list->num_strings; i++)
-      {
-        struct string *s = string_list->strings[i];
-        if(s)
-        {
-          total += get_string_alloc_size(s->name_length);
-          total += s->allocated_length;
-        }
-      }
-    }
-    *strings_size = total;
-  }
+    *strings_size = string_list->arena.total_size;
 }
 
 #endif /* CONFIG_EDITOR */
@@ -60,13 +60,17 @@ static inline boolean is_string(const char *buffer)
 
 CORE_LIBSPEC int get_string(struct world *mzx_world, char *name_buffer,
  struct string *dest, int id);
+CORE_LIBSPEC int get_string_source(struct world *mzx_world, char *name_buffer,
+ struct string *dest, struct string **source, int id);
 CORE_LIBSPEC const struct string *get_string_pointer(struct world *mzx_world,
  const char *name, int id);
 CORE_LIBSPEC int set_string(struct world *mzx_world, char *name_buffer,
- struct string *src, int id);
+ struct string *src, struct string *src_str, int id);
 CORE_LIBSPEC struct string *new_string(struct world *mzx_world,
  const char *name, size_t length, int id);
 CORE_LIBSPEC void sort_string_list(struct string_list *string_list);
+CORE_LIBSPEC size_t find_string_prefix(struct string_list *string_list,
+ const char *prefix, size_t *first);
 CORE_LIBSPEC void string_list_size(struct string_list *string_list,
  size_t *list_size, size_t *table_size, size_t *strings_size);
 
@@ -79,14 +83,15 @@ void load_string_board(struct world *mzx_world, char *name_buffer,
  char *src_chars, int src_width, int block_width, int block_height,
  char terminator);
 
-void inc_string(struct world *mzx_world, char *name_buffer, struct string *src,
- int id);
-void dec_string_int(struct world *mzx_world, const char *name, int value,
- int id);
-int compare_strings(struct string *A, struct string *B, boolean exact_case,
- boolean allow_wildcards);
+CORE_LIBSPEC void inc_string(struct world *mzx_world, char *name_buffer,
+ struct string *src, int id);
+CORE_LIBSPEC void dec_string_int(struct world *mzx_world, const char *name,
+ int value, int id);
+CORE_LIBSPEC int compare_strings(struct world *mzx_world, struct string *A,
+ struct string *B, boolean exact_case, boolean allow_wildcards);
 int compare_strings_null_terminated(struct string *A, struct string *B);
 
+void load_string_list_reserve(struct string_list *string_list, size_t count);
 struct string *load_new_string(struct string_list *string_list, int index,
  const char *name, int name_length, int str_length);
 
@@ -0,0 +1,392 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Open addressing hash set in the style of Abseil's "Swiss tables". Each slot
+ * has a control byte which is either empty, deleted, or the top 7 bits of the
+ * hash of the key in that slot. Lookups probe groups of control bytes at once
+ * (16 with SSE2, otherwise 8 with NEON or plain 64-bit integer math) and only
+ * compare the keys of slots with a matching control byte.
+ *
+ * SWISS_SET_INIT is a drop-in replacement for HASH_SET_INIT: the table type
+ * and functions use the same names as hashtable.h, so the uthash-like macros
+ * in hashtable.h (HASH_ADD, HASH_FIND, etc.) work with either. A given table
+ * name can only be initialized with one of them. The key struct needs the
+ * same key, key length, and "hash" fields, and the hash function and key
+ * comparison are the same (case-insensitive).
+ */
+
+#ifndef __SWISSTABLE_H
+#define __SWISSTABLE_H
+
+#include "compat.h"
+#include "hashtable.h"
+
+__M_BEGIN_DECLS
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "platform_endian.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+ (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SWISS_SSE2
+#define SWISS_GROUP_WIDTH 16
+#define SWISS_MASK_SHIFT 0
+typedef uint32_t swiss_mask_t;
+
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+ PLATFORM_BYTE_ORDER == PLATFORM_LIL_ENDIAN
+#include <arm_neon.h>
+#define SWISS_NEON
+#define SWISS_GROUP_WIDTH 8
+#define SWISS_MASK_SHIFT 3
+typedef uint64_t swiss_mask_t;
+
+#else
+#define SWISS_GROUP_WIDTH 8
+#define SWISS_MASK_SHIFT 3
+typedef uint64_t swiss_mask_t;
+#endif
+
+#define SWISS_EMPTY   0x80
+#define SWISS_DELETED 0xFE
+#define SWISS_MIN_BUCKETS 16
+
+#define SWISS_LSBS 0x0101010101010101ULL
+#define SWISS_MSBS 0x8080808080808080ULL
+
+static inline uint8_t swiss_tag(uint32_t hash)
+{
+  return hash >> 25;
+}
+
+static inline size_t swiss_growth_limit(size_t n_buckets)
+{
+  return n_buckets - n_buckets / 8;
+}
+
+static inline unsigned int swiss_mask_first(swiss_mask_t m)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctzll(m) >> SWISS_MASK_SHIFT;
+#else
+  unsigned int i = 0;
+  while(!(m & 1))
+  {
+    m >>= 1;
+    i++;
+  }
+  return i >> SWISS_MASK_SHIFT;
+#endif
+}
+
+static inline swiss_mask_t swiss_mask_next(swiss_mask_t m)
+{
+  return m & (m - 1);
+}
+
+#if defined(SWISS_SSE2)
+
+static inline swiss_mask_t swiss_match(const uint8_t *ctrl, uint8_t tag)
+{
+  __m128i g = _mm_loadu_si128((const __m128i *)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)tag)));
+}
+
+static inline swiss_mask_t swiss_match_empty(const uint8_t *ctrl)
+{
+  return swiss_match(ctrl, SWISS_EMPTY);
+}
+
+static inline swiss_mask_t swiss_match_free(const uint8_t *ctrl)
+{
+  // Empty and deleted are the only control bytes with the top bit set.
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#elif defined(SWISS_NEON)
+
+static inline swiss_mask_t swiss_match(const uint8_t *ctrl, uint8_t tag)
+{
+  uint8x8_t eq = vceq_u8(vld1_u8(ctrl), vdup_n_u8(tag));
+  return vget_lane_u64(vreinterpret_u64_u8(eq), 0) & SWISS_MSBS;
+}
+
+static inline swiss_mask_t swiss_match_empty(const uint8_t *ctrl)
+{
+  return swiss_match(ctrl, SWISS_EMPTY);
+}
+
+static inline swiss_mask_t swiss_match_free(const uint8_t *ctrl)
+{
+  return vget_lane_u64(vreinterpret_u64_u8(vld1_u8(ctrl)), 0) & SWISS_MSBS;
+}
+
+#else
+
+static inline uint64_t swiss_load(const uint8_t *ctrl)
+{
+  // Always put the first control byte in the lowest bits.
+  uint64_t g = 0;
+  int i;
+  for(i = SWISS_GROUP_WIDTH - 1; i >= 0; i--)
+    g = (g << 8) | ctrl[i];
+  return g;
+}
+
+static inline swiss_mask_t swiss_match(const uint8_t *ctrl, uint8_t tag)
+{
+  // This can have false positives after a real match, but those are
+  // filtered out by comparing keys anyway.
+  uint64_t g = swiss_load(ctrl) ^ (SWISS_LSBS * tag);
+  return (g - SWISS_LSBS) & ~g & SWISS_MSBS;
+}
+
+static inline swiss_mask_t swiss_match_empty(const uint8_t *ctrl)
+{
+  // Empty is the only control byte with the top bit set and bit 1 clear.
+  uint64_t g = swiss_load(ctrl);
+  return g & (~g << 6) & SWISS_MSBS;
+}
+
+static inline swiss_mask_t swiss_match_free(const uint8_t *ctrl)
+{
+  return swiss_load(ctrl) & SWISS_MSBS;
+}
+
+#endif
+
+#define SWISS_SET_INIT(name, khkey_t, ptr_field, len_field) \
+  typedef struct kh_##name##_s \
+  { \
+    size_t n_buckets;   \
+    size_t size;        \
+    size_t growth_left; \
+    uint8_t *ctrl;      \
+    khkey_t *keys;      \
+  } kh_##name##_t; \
+  \
+  static inline klib_unused kh_##name##_t *kh_init_##name(void) \
+  { \
+    return (kh_##name##_t *)ccalloc(1, sizeof(kh_##name##_t));            \
+  } \
+  \
+  static inline klib_unused void kh_destroy_##name(kh_##name##_t *h) \
+  { \
+    if(h)                                                                 \
+    {                                                                     \
+      free(h->ctrl);                                                      \
+      free((void *)h->keys);                                              \
+      free(h);                                                            \
+    }                                                                     \
+  } \
+  \
+  static inline klib_unused size_t kh_get_no_obj_##name(const kh_##name##_t *h, \
+   const void *key_ptr, uint32_t key_len, uint32_t hash, int has_hash) \
+  { \
+    if(h->n_buckets)                                                      \
+    {                                                                     \
+      size_t group_mask = h->n_buckets / SWISS_GROUP_WIDTH - 1;           \
+      size_t g, step = 0;                                                 \
+      uint8_t tag;                                                        \
+      if(!has_hash)                                                       \
+        hash = kh_mem_hash_func(key_ptr, key_len);                        \
+      tag = swiss_tag(hash);                                              \
+      g = hash & group_mask;                                              \
+      while(1)                                                            \
+      {                                                                   \
+        const uint8_t *ctrl = h->ctrl + g * SWISS_GROUP_WIDTH;            \
+        swiss_mask_t m = swiss_match(ctrl, tag);                          \
+        for(; m; m = swiss_mask_next(m))                                  \
+        {                                                                 \
+          size_t i = g * SWISS_GROUP_WIDTH + swiss_mask_first(m);         \
+          khkey_t k = h->keys[i];                                         \
+          if(hash == k->hash &&                                           \
+           kh_mem_hash_equal(k->ptr_field, key_ptr, k->len_field, key_len)) \
+            return i;                                                     \
+        }                                                                 \
+        if(swiss_match_empty(ctrl) || step >= group_mask)                 \
+          break;                                                          \
+        g = (g + (++step)) & group_mask;                                  \
+      }                                                                   \
+    }                                                                     \
+    return h->n_buckets;                                                  \
+  } \
+  \
+  static inline klib_unused size_t kh_get_##name(const kh_##name##_t *h, khkey_t key) \
+  { \
+    return kh_get_no_obj_##name(h, key->ptr_field, key->len_field,        \
+     key->hash, 1);                                                       \
+  } \
+  \
+  /* Find the first empty or deleted slot for a hash. There must be one. */ \
+  static inline klib_unused size_t kh_find_free_##name(uint8_t *ctrl, \
+   size_t n_buckets, uint32_t hash) \
+  { \
+    size_t group_mask = n_buckets / SWISS_GROUP_WIDTH - 1;                \
+    size_t g = hash & group_mask;                                         \
+    size_t step = 0;                                                      \
+    while(1)                                                              \
+    {                                                                     \
+      swiss_mask_t m = swiss_match_free(ctrl + g * SWISS_GROUP_WIDTH);    \
+      if(m)                                                               \
+        return g * SWISS_GROUP_WIDTH + swiss_mask_first(m);               \
+      g = (g + (++step)) & group_mask;                                    \
+    }                                                                     \
+  } \
+  \
+  static inline klib_unused int kh_resize_##name(kh_##name##_t *h, size_t new_n_buckets) \
+  { \
+    uint8_t *new_ctrl;                                                    \
+    khkey_t *new_keys;                                                    \
+    size_t i;                                                             \
+  \
+    kroundup32(new_n_buckets);                                            \
+    if(new_n_buckets > __ac_HASH_MAXIMUM)                                 \
+      return -1;                                                          \
+    if(new_n_buckets < SWISS_MIN_BUCKETS)                                 \
+      new_n_buckets = SWISS_MIN_BUCKETS;                                  \
+    if(h->size >= swiss_growth_limit(new_n_buckets))                      \
+      return 0;                                                           \
+  \
+    new_ctrl = (uint8_t *)cmalloc(new_n_buckets);                         \
+    new_keys = (khkey_t *)cmalloc(new_n_buckets * sizeof(khkey_t));       \
+    if(!new_ctrl || !new_keys)                                            \
+    {                                                                     \
+      free(new_ctrl);                                                     \
+      free((void *)new_keys);                                             \
+      return -1;                                                          \
+    }                                                                     \
+    memset(new_ctrl, SWISS_EMPTY, new_n_buckets);                         \
+  \
+    /* Deleted slots are dropped here, so this also cleans up the table. */ \
+    for(i = 0; i < h->n_buckets; i++)                                     \
+    {                                                                     \
+      if(h->ctrl[i] < SWISS_EMPTY)                                        \
+      {                                                                   \
+        khkey_t key = h->keys[i];                                         \
+        size_t x = kh_find_free_##name(new_ctrl, new_n_buckets, key->hash); \
+        new_ctrl[x] = h->ctrl[i];                                         \
+        new_keys[x] = key;                                                \
+      }                                                                   \
+    }                                                                     \
+    free(h->ctrl);                                                        \
+    free((void *)h->keys);                                                \
+    h->ctrl = new_ctrl;                                                   \
+    h->keys = new_keys;                                                   \
+    h->n_buckets = new_n_buckets;                                         \
+    h->growth_left = swiss_growth_limit(new_n_buckets) - h->size;         \
+    return 0;                                                             \
+  } \
+  \
+  static inline klib_unused int kh_reserve_##name(kh_##name##_t *h, size_t count) \
+  { \
+    size_t new_n_buckets = SWISS_MIN_BUCKETS;                             \
+    while(swiss_growth_limit(new_n_buckets) < count &&                    \
+     new_n_buckets < __ac_HASH_MAXIMUM)                                   \
+      new_n_buckets <<= 1;                                                \
+    if(new_n_buckets <= h->n_buckets)                                     \
+      return 0;                                                           \
+    return kh_resize_##name(h, new_n_buckets);                            \
+  } \
+  \
+  static inline klib_unused size_t kh_put_##name(kh_##name##_t *h, khkey_t key, int *ret) \
+  { \
+    uint32_t hash = kh_mem_hash_func(key->ptr_field, key->len_field);     \
+    size_t x;                                                             \
+    key->hash = hash;                                                     \
+  \
+    x = kh_get_no_obj_##name(h, key->ptr_field, key->len_field, hash, 1); \
+    if(x != h->n_buckets)                                                 \
+    {                                                                     \
+      /* Don't touch h->keys[x] if present */                             \
+      *ret = 0;                                                           \
+      return x;                                                           \
+    }                                                                     \
+  \
+    if(!h->growth_left)                                                   \
+    {                                                                     \
+      /* Only grow if the table is mostly full of real keys; otherwise */ \
+      /* rehashing at the same size gets rid of the deleted slots. */     \
+      size_t new_n_buckets = h->n_buckets;                                \
+      if(!h->n_buckets)                                                   \
+        new_n_buckets = SWISS_MIN_BUCKETS;                                \
+      else                                                                \
+  \
+      if(h->size * 2 >= swiss_growth_limit(h->n_buckets))                 \
+        new_n_buckets = h->n_buckets * 2;                                 \
+      if(kh_resize_##name(h, new_n_buckets) < 0)                          \
+      {                                                                   \
+        *ret = -1;                                                        \
+        return h->n_buckets;                                              \
+      }                                                                   \
+    }                                                                     \
+  \
+    x = kh_find_free_##name(h->ctrl, h->n_buckets, hash);                 \
+    if(h->ctrl[x] == SWISS_EMPTY)                                         \
+      h->growth_left--;                                                   \
+    h->ctrl[x] = swiss_tag(hash);                                         \
+    h->keys[x] = key;                                                     \
+    h->size++;                                                            \
+    *ret = 1;                                                             \
+    return x;                                                             \
+  } \
+  \
+  static inline klib_unused void kh_del_##name(kh_##name##_t *h, size_t x) \
+  { \
+    if(x < h->n_buckets && h->ctrl[x] < SWISS_EMPTY)                      \
+    {                                                                     \
+      /* If this group has an empty slot, no probe for another key can */ \
+      /* have continued past it, so this slot can be made empty too. */   \
+      const uint8_t *group = h->ctrl + (x & ~(size_t)(SWISS_GROUP_WIDTH - 1)); \
+      if(swiss_match_empty(group))                                        \
+      {                                                                   \
+        h->ctrl[x] = SWISS_EMPTY;                                         \
+        h->growth_left++;                                                 \
+      }                                                                   \
+      else                                                                \
+        h->ctrl[x] = SWISS_DELETED;                                       \
+      h->keys[x] = 0;                                                     \
+      h->size--;                                                          \
+    }                                                                     \
+  } \
+  \
+  static inline klib_unused int kh_exist_##name(const kh_##name##_t *h, size_t x) \
+  { \
+    return h->ctrl[x] < SWISS_EMPTY;                                      \
+  } \
+  \
+  static inline klib_unused size_t kh_memory_usage_##name(const kh_##name##_t *h) \
+  { \
+    size_t size = 0;                                                      \
+    if(h && h->keys)                                                      \
+    {                                                                     \
+      size = sizeof(*h);                                                  \
+      size += h->n_buckets * (sizeof(h->keys[0]) + 1);                    \
+    }                                                                     \
+    return size;                                                          \
+  }
+
+__M_END_DECLS
+
+#endif /* __SWISSTABLE_H */
@@ -549,6 +549,58 @@ unsigned int Random(uint64_t range)
   return (((x * 0x2545F4914F6CDD1D) >> 32) * range) >> 32;
 }
 
+/**
+ * Sort a list of pointers where the first num_sorted elements are already
+ * sorted, e.g. a list that has had elements appended to it since it was last
+ * sorted. The start of the unsorted part is checked for elements that are
+ * already in order, the rest is sorted with qsort, and then the two parts are
+ * merged. The compare function is the same as for qsort. Returns num (the new
+ * number of sorted elements).
+ */
+size_t sort_list_tail(void **list, size_t num_sorted, size_t num,
+ int (*compare)(const void *, const void *))
+{
+  size_t tail_size;
+  void **tail;
+  size_t i, j, k;
+
+  if(!num_sorted && num)
+    num_sorted = 1;
+
+  while(num_sorted < num &&
+   compare(list + num_sorted - 1, list + num_sorted) <= 0)
+    num_sorted++;
+
+  if(num_sorted >= num)
+    return num;
+
+  tail_size = num - num_sorted;
+  tail = (void **)malloc(tail_size * sizeof(void *));
+  if(!tail)
+  {
+    qsort(list, num, sizeof(void *), compare);
+    return num;
+  }
+
+  qsort(list + num_sorted, tail_size, sizeof(void *), compare);
+  memcpy(tail, list + num_sorted, tail_size * sizeof(void *));
+
+  // Merge from the end so the sorted part doesn't need to be copied.
+  i = num_sorted;
+  j = tail_size;
+  k = num;
+  while(j > 0)
+  {
+    if(i > 0 && compare(list + i - 1, tail + j - 1) > 0)
+      list[--k] = list[--i];
+    else
+      list[--k] = tail[--j];
+  }
+
+  free(tail);
+  return num;
+}
+
 #if defined(__WIN32__) && defined(__STRICT_ANSI__)
 
 /* On WIN32 with C99 defining __STRICT_ANSI__ these POSIX.1-2001 functions
@@ -112,6 +112,9 @@ uint64_t rng_get_seed(void);
 void rng_set_seed(uint64_t seed);
 unsigned int Random(uint64_t range);
 
+size_t sort_list_tail(void **list, size_t num_sorted, size_t num,
+ int (*compare)(const void *, const void *));
+
 static inline size_t round_to_power_of_two(size_t v)
 {
   v -= (v > 0);
@@ -55,6 +55,7 @@
 
 #include "../const.h"
 #include "../graphics.h"
+#include "../memcasecmp.h"
 #include "../util.h"
 #include "../world.h"
 #include "../world_format.h"
@@ -62,8 +63,8 @@
 #include "../io/vio.h"
 #include "../io/zip.h"
 
-#define DOWNVER_VERSION "2.93"
-#define DOWNVER_EXT ".292"
+#define DOWNVER_VERSION "2.94"
+#define DOWNVER_EXT ".293"
 
 #define MZX_VERSION_HI ((MZX_VERSION >> 8) & 0xff)
 #define MZX_VERSION_LO (MZX_VERSION & 0xff)
@@ -91,8 +92,19 @@ struct downver_state
   struct zip_archive *out;
   struct zip_archive *in;
 
-  /* 2.93 conversion vars */
-  int screen_mode;
+  /* 2.94 conversion vars */
+  void *counters;
+  size_t counters_size;
+  void *arrays;
+  size_t arrays_size;
+};
+
+struct downver_array
+{
+  const unsigned char *name;
+  size_t name_length;
+  size_t size;
+  struct memfile values;
 };
 
 static inline void save_prop_p(int ident, struct memfile *prop,
@@ -101,20 +113,8 @@ static inline void save_prop_p(int ident, struct memfile *prop,
   save_prop_a(ident, prop->start, (prop->end - prop->start), 1, mf);
 }
 
-/* <2.92d did not properly terminate this field on loading it, convert it back
- * to an ASCIIZ string. */
-static inline void save_prop_s_to_asciiz(int ident, size_t len,
- struct memfile *prop, struct memfile *mf)
-{
-  char buf[BOARD_NAME_SIZE];
-  len = MIN(len, BOARD_NAME_SIZE - 1);
-
-  len = mfread(buf, 1, len, prop);
-  buf[len] = '\0';
-  save_prop_a(ident, buf, len + 1, 1, mf);
-}
-
-static enum zip_error zip_duplicate_file(struct downver_state *dv,
+static enum zip_error zip_convert_file(struct downver_state *dv,
+ const char *new_name,
  void (*handler)(struct downver_state *, struct memfile *, struct memfile *))
 {
   enum zip_error result;
@@ -162,48 +162,21 @@ static enum zip_error zip_duplicate_file(struct downver_state *dv,
     }
   }
 
-  result = zip_write_file(dv->out, name, buffer, actual_size, (int)method);
+  result = zip_write_file(dv->out, new_name ? new_name : name, buffer,
+   actual_size, (int)method);
 
 err_free:
   free(buffer);
   return result;
 }
 
-static void convert_293_to_292_status_counters(struct downver_state *dv,
- struct memfile *dest, struct memfile *src)
+static enum zip_error zip_duplicate_file(struct downver_state *dv,
+ void (*handler)(struct downver_state *, struct memfile *, struct memfile *))
 {
-  char counters[NUM_STATUS_COUNTERS * COUNTER_NAME_SIZE];
-  struct memfile prop;
-  int ident;
-  int len;
-  int num = 0;
-
-  memset(counters, 0, sizeof(counters));
-
-  while(next_prop(&prop, &ident, &len, src))
-  {
-    switch(ident)
-    {
-      case STATCTRPROP_SET_ID:
-        num = load_prop_int(&prop);
-        break;
-
-      case STATCTRPROP_NAME:
-        if(num < NUM_STATUS_COUNTERS)
-        {
-          char *pos = counters + num * COUNTER_NAME_SIZE;
-          len = MIN(len, COUNTER_NAME_SIZE - 1);
-          len = mfread(pos, 1, len, &prop);
-          pos[len] = '\0';
-        }
-        break;
-    }
-  }
-  save_prop_a(WPROP_STATUS_COUNTERS, counters,
-   COUNTER_NAME_SIZE, NUM_STATUS_COUNTERS, dest);
+  return zip_convert_file(dv, NULL, handler);
 }
 
-static void convert_293_to_292_world_info(struct downver_state *dv,
+static void convert_294_to_293_world_info(struct downver_state *dv,
  struct memfile *dest, struct memfile *src)
 {
   struct memfile prop;
@@ -215,30 +188,18 @@ static void convert_293_to_292_world_info(struct downver_state *dv,
     switch(ident)
     {
       case WPROP_WORLD_VERSION:
+      {
+        // Only lower the original world version of saves if needed.
+        int version = load_prop_int(&prop);
+        save_prop_w(ident, MIN(version, MZX_VERSION_PREV), dest);
+        break;
+      }
+
       case WPROP_FILE_VERSION:
         // Replace the version number
         save_prop_w(ident, MZX_VERSION_PREV, dest);
         break;
 
-      case WPROP_WORLD_NAME:
-        /* NO loading termination pre-2.92d */
-        save_prop_s_to_asciiz(ident, BOARD_NAME_SIZE, &prop, dest);
-        break;
-
-      case WPROP_STATUS_COUNTERS:
-        convert_293_to_292_status_counters(dv, dest, &prop);
-        break;
-
-      case WPROP_SMZX_MODE:
-        /* Load for palette conversion. */
-        dv->screen_mode = load_prop_int(&prop);
-        save_prop_c(ident, dv->screen_mode, dest);
-        break;
-
-      case WPROP_OUTPUT_MODE:
-        /* Added in 2.93 */
-        break;
-
       default:
         save_prop_p(ident, &prop, dest);
         break;
@@ -249,7 +210,7 @@ static void convert_293_to_292_world_info(struct downver_state *dv,
   mfresize(mftell(dest), dest);
 }
 
-static void convert_293_to_292_board_info(struct downver_state *dv,
+static void convert_294_to_293_board_info(struct downver_state *dv,
  struct memfile *dest, struct memfile *src)
 {
   struct memfile prop;
@@ -265,21 +226,6 @@ static void convert_293_to_292_board_info(struct downver_state *dv,
         save_prop_w(ident, MZX_VERSION_PREV, dest);
         break;
 
-      case BPROP_BOARD_NAME:
-        /* loading termination expects BOARD_NAME_SIZE input pre-2.93 */
-        save_prop_s_to_asciiz(ident, BOARD_NAME_SIZE, &prop, dest);
-        break;
-
-      case BPROP_RESET_ON_ENTRY_SAME_BOARD:
-      case BPROP_DRAGONS_CAN_RANDOMLY_MOVE:
-      case BPROP_BLIND_DUR:
-      case BPROP_FIREWALKER_DUR:
-      case BPROP_FREEZE_TIME_DUR:
-      case BPROP_SLOW_TIME_DUR:
-      case BPROP_WIND_DUR:
-        /* Added in 2.93 */
-        break;
-
       default:
         save_prop_p(ident, &prop, dest);
         break;
@@ -290,101 +236,333 @@ static void convert_293_to_292_board_info(struct downver_state *dv,
   mfresize(mftell(dest), dest);
 }
 
-static void convert_293_to_292_robot_info(struct downver_state *dv,
+/* Check the name lengths of a bulk counter or string file. */
+static boolean bulk_name_lengths_valid(struct memfile lengths, size_t count,
+ size_t names_size)
+{
+  size_t total = 0;
+  size_t i;
+
+  for(i = 0; i < count; i++)
+    total += mfgetw(&lengths);
+
+  return total == names_size;
+}
+
+/* 2.94 bulk strings: the number of strings, the size of the names, arrays
+ * of the name lengths and string lengths, the names, and then the values.
+ * 2.93 strings: the number of strings, then the name length, string length,
+ * name, and value of each string. This is never larger than twice the size
+ * of the bulk file. */
+static void convert_294_to_293_strings(struct downver_state *dv,
  struct memfile *dest, struct memfile *src)
 {
-  struct memfile prop;
-  int ident;
-  int len;
+  struct memfile name_lengths;
+  struct memfile str_lengths;
+  struct memfile names;
+  size_t num_strings;
+  size_t names_size;
+  size_t total = 0;
+  size_t i;
 
-  while(next_prop(&prop, &ident, &len, src))
-  {
-    switch(ident)
-    {
-      case RPROP_ROBOT_NAME:
-        /* NO loading termination pre-2.92d */
-        save_prop_s_to_asciiz(ident, ROBOT_NAME_SIZE, &prop, dest);
-        break;
+  if(!mfhasspace(8, src))
+    goto err;
 
-      default:
-        save_prop_p(ident, &prop, dest);
-        break;
-    }
+  num_strings = mfgetud(src);
+  names_size = mfgetud(src);
+
+  if(num_strings > (size_t)(src->end - src->current) / 6 ||
+   names_size > (size_t)(src->end - src->current) - num_strings * 6)
+    goto err;
+
+  mfopen(src->current, num_strings * 2, &name_lengths);
+  mfopen(src->current + num_strings * 2, num_strings * 4, &str_lengths);
+  mfopen(src->current + num_strings * 6, names_size, &names);
+  src->current += num_strings * 6 + names_size;
+
+  if(!bulk_name_lengths_valid(name_lengths, num_strings, names_size))
+    goto err;
+
+  for(i = 0; i < num_strings; i++)
+    total += mfgetud(&str_lengths);
+
+  if(total != (size_t)(src->end - src->current))
+    goto err;
+
+  mfseek(&str_lengths, 0, SEEK_SET);
+  mfputud(num_strings, dest);
+
+  for(i = 0; i < num_strings; i++)
+  {
+    size_t name_length = mfgetw(&name_lengths);
+    size_t str_length = mfgetud(&str_lengths);
+
+    mfputud(name_length, dest);
+    mfputud(str_length, dest);
+    mfwrite(names.current, name_length, 1, dest);
+    mfwrite(src->current, str_length, 1, dest);
+    names.current += name_length;
+    src->current += str_length;
   }
+  mfresize(mftell(dest), dest);
+  return;
 
-  save_prop_eof(dest);
+err:
+  error("Invalid strings file, discarding strings.\n");
+  if(mfhasspace(4, dest))
+    mfputud(0, dest);
   mfresize(mftell(dest), dest);
 }
 
-static void convert_293_to_292_sensor_info(struct downver_state *dv,
- struct memfile *dest, struct memfile *src)
+/* The counters file is written after everything else is converted (see
+ * write_293_counters), so just keep a copy of it for now. The same goes for
+ * the counter arrays file, which gets merged into the counters. */
+static enum zip_error read_294_counters(struct downver_state *dv,
+ void **dest, size_t *dest_size)
 {
-  struct memfile prop;
-  int ident;
-  int len;
+  enum zip_error result;
+  size_t actual_size;
+  void *buffer;
 
-  while(next_prop(&prop, &ident, &len, src))
+  result = zip_get_next_uncompressed_size(dv->in, &actual_size);
+  if(result)
+    return result;
+
+  buffer = malloc(actual_size ? actual_size : 1);
+  if(!buffer)
+    return ZIP_ALLOC_ERROR;
+
+  result = zip_read_file(dv->in, buffer, actual_size, &actual_size);
+  if(result)
   {
-    switch(ident)
-    {
-      case SENPROP_SENSOR_NAME:
-      case SENPROP_ROBOT_TO_MESG:
-        /* NO loading termination pre-2.92d */
-        save_prop_s_to_asciiz(ident, ROBOT_NAME_SIZE, &prop, dest);
-        break;
+    free(buffer);
+    return result;
+  }
 
-      default:
-        save_prop_p(ident, &prop, dest);
-        break;
-    }
+  free(*dest);
+  *dest = buffer;
+  *dest_size = actual_size;
+  return ZIP_SUCCESS;
+}
+
+/* 2.94 counter arrays: the number of arrays, then the name length, size,
+ * name, and values of each array. Stops at the first invalid array, the
+ * same as the world loader. */
+static size_t read_294_counter_arrays(struct downver_state *dv,
+ struct downver_array **_arrays)
+{
+  struct downver_array *arrays;
+  struct memfile mf;
+  size_t num_arrays;
+  size_t i;
+
+  *_arrays = NULL;
+  if(!dv->arrays)
+    return 0;
+
+  mfopen(dv->arrays, dv->arrays_size, &mf);
+  num_arrays = mfhasspace(4, &mf) ? mfgetud(&mf) : 0;
+  num_arrays = MIN(num_arrays, (size_t)(mf.end - mf.current) / 6);
+  if(!num_arrays)
+    return 0;
+
+  arrays = (struct downver_array *)malloc(num_arrays * sizeof(*arrays));
+  if(!arrays)
+    return 0;
+
+  for(i = 0; i < num_arrays; i++)
+  {
+    struct downver_array *a = &(arrays[i]);
+    if(!mfhasspace(6, &mf))
+      break;
+
+    a->name_length = mfgetw(&mf);
+    a->size = mfgetud(&mf);
+
+    if(!a->name_length || a->name_length >= ROBOT_MAX_TR ||
+     !mfhasspace(a->name_length, &mf))
+      break;
+
+    a->name = mf.current;
+    mf.current += a->name_length;
+
+    if(a->size > (size_t)(mf.end - mf.current) / 4)
+      break;
+
+    mfopen(mf.current, a->size * 4, &(a->values));
+    mf.current += a->size * 4;
   }
 
-  save_prop_eof(dest);
-  mfresize(mftell(dest), dest);
+  if(i < num_arrays)
+    error("Invalid counter arrays file, discarding %u arrays.\n",
+     (unsigned int)(num_arrays - i));
+
+  *_arrays = arrays;
+  return i;
 }
 
-static void convert_293_to_292_sfx(struct downver_state *dv,
- struct memfile *dest, struct memfile *src)
+/* Counters whose names 2.94 reads as an array element or an array size can't
+ * be reached in 2.94, but would shadow the converted array in 2.93. This
+ * mirrors find_counter_array_ref. */
+static boolean is_shadowed_counter(const unsigned char *name, size_t length,
+ struct downver_array *arrays, size_t num_arrays)
 {
-  struct memfile prop;
-  int ident;
-  int len;
-  int num = 0;
-  char buf[8];
+  size_t open;
+  size_t i;
+
+  if(length < 3 || name[length - 1] != ']')
+    return false;
+
+  open = length - 2;
+  while(open > 0 && name[open] != '[')
+    open--;
+
+  if(open == 0)
+    return false;
+
+  if(open + 2 == length)
+    return true;
 
-  mfresize(NUM_BUILTIN_SFX * LEGACY_SFX_SIZE, dest);
-  memset(dest->start, 0, NUM_BUILTIN_SFX * LEGACY_SFX_SIZE);
+  for(i = 0; i < num_arrays; i++)
+    if(arrays[i].name_length == open &&
+     !memcasecmp(arrays[i].name, name, open))
+      return true;
 
-  if(mfread(buf, 8, 1, src) && !memcmp(buf, "MZFX\x1a", 6))
+  return false;
+}
+
+/* Write an array as a size counter "name[]" followed by a counter "name[#]"
+ * for each nonzero element. */
+static size_t write_293_counter_array(struct downver_array *a,
+ struct memfile *dest)
+{
+  char buffer[ROBOT_MAX_TR + 16];
+  size_t num_counters = 1;
+  size_t name_length;
+  size_t i;
+
+  mfputd((int)a->size, dest);
+  mfputud(a->name_length + 2, dest);
+  mfwrite(a->name, a->name_length, 1, dest);
+  mfwrite("[]", 2, 1, dest);
+
+  for(i = 0; i < a->size; i++)
   {
-    while(next_prop(&prop, &ident, &len, src))
-    {
-      switch(ident)
-      {
-        case SFXPROP_SET_ID:
-          num = load_prop_int(&prop);
-          break;
-
-        case SFXPROP_STRING:
-          if(num >= 0 && num < NUM_BUILTIN_SFX)
-          {
-            len = MIN(len, LEGACY_SFX_SIZE - 1);
-            mfseek(dest, num * LEGACY_SFX_SIZE, SEEK_SET);
-            mfread(dest->current, len, 1, &prop);
-          }
-          break;
-      }
-    }
+    int value = mfgetd(&(a->values));
+    if(!value)
+      continue;
+
+    name_length = snprintf(buffer, sizeof(buffer), "%.*s[%u]",
+     (int)a->name_length, (const char *)a->name, (unsigned int)i);
+    if(name_length >= ROBOT_MAX_TR)
+      continue;
+
+    mfputd(value, dest);
+    mfputud(name_length, dest);
+    mfwrite(buffer, name_length, 1, dest);
+    num_counters++;
   }
-  else
+  return num_counters;
+}
+
+/* 2.94 bulk counters: the number of counters, the size of the names, arrays
+ * of the values and name lengths, and then the names.
+ * 2.93 counters: the number of counters, then the value, name length, and
+ * name of each counter. 2.93 has no counter arrays, so they're converted to
+ * plain counters with the same names. */
+static enum zip_error write_293_counters(struct downver_state *dv)
+{
+  enum zip_error result;
+  struct memfile src;
+  struct memfile values;
+  struct memfile lengths;
+  struct memfile dest;
+  struct downver_array *arrays;
+  const unsigned char *names;
+  size_t num_arrays;
+  size_t num_counters = 0;
+  size_t names_size = 0;
+  size_t total = 0;
+  size_t dest_size;
+  void *buffer;
+  size_t i;
+
+  if(!dv->counters && !dv->arrays)
+    return ZIP_SUCCESS;
+
+  mfopen(dv->counters ? dv->counters : "", dv->counters_size, &src);
+  if(mfhasspace(8, &src))
+  {
+    num_counters = mfgetud(&src);
+    names_size = mfgetud(&src);
+  }
+
+  if(num_counters > (size_t)(src.end - src.current) / 6 ||
+   names_size != (size_t)(src.end - src.current) - num_counters * 6)
+  {
+    error("Invalid counters file, discarding counters.\n");
+    num_counters = 0;
+    names_size = 0;
+  }
+
+  mfopen(src.current, num_counters * 4, &values);
+  mfopen(src.current + num_counters * 4, num_counters * 2, &lengths);
+  names = src.current + num_counters * 6;
+
+  if(!bulk_name_lengths_valid(lengths, num_counters, names_size))
+  {
+    error("Invalid counters file, discarding counters.\n");
+    num_counters = 0;
+    names_size = 0;
+  }
+
+  num_arrays = read_294_counter_arrays(dv, &arrays);
+
+  // Each array element is at most its value, name length, name, and index.
+  dest_size = 4 + num_counters * 8 + names_size;
+  for(i = 0; i < num_arrays; i++)
+    dest_size += (arrays[i].size + 1) * (8 + arrays[i].name_length + 12);
+
+  buffer = malloc(dest_size);
+  if(!buffer)
+  {
+    free(arrays);
+    return ZIP_ALLOC_ERROR;
+  }
+
+  mfopen_wr(buffer, dest_size, &dest);
+  mfputud(0, &dest);
+
+  for(i = 0; i < num_counters; i++)
   {
-    mfseek(src, 0, SEEK_SET);
-    mfread(dest->start, LEGACY_SFX_SIZE, NUM_BUILTIN_SFX, src);
-    dest->end[-1] = '\0';
+    size_t name_length = mfgetw(&lengths);
+    int value = mfgetd(&values);
+
+    if(!is_shadowed_counter(names, name_length, arrays, num_arrays))
+    {
+      mfputd(value, &dest);
+      mfputud(name_length, &dest);
+      mfwrite(names, name_length, 1, &dest);
+      total++;
+    }
+    names += name_length;
   }
+
+  for(i = 0; i < num_arrays; i++)
+    total += write_293_counter_array(&(arrays[i]), &dest);
+
+  dest_size = mftell(&dest);
+  mfseek(&dest, 0, SEEK_SET);
+  mfputud(total, &dest);
+
+  result = zip_write_file(dv->out, "counter", buffer, dest_size,
+   ZIP_M_DEFLATE);
+  free(arrays);
+  free(buffer);
+  return result;
 }
 
-static enum status convert_293_to_292(struct downver_state *dv)
+static enum status convert_294_to_293(struct downver_state *dv)
 {
   enum zip_error err = ZIP_SUCCESS;
   unsigned int file_id;
@@ -405,85 +583,23 @@ static enum status convert_293_to_292(struct downver_state *dv)
     switch(file_id)
     {
       case FILE_ID_WORLD_INFO:
-        err = zip_duplicate_file(dv, convert_293_to_292_world_info);
+        err = zip_duplicate_file(dv, convert_294_to_293_world_info);
         break;
 
       case FILE_ID_BOARD_INFO:
-        err = zip_duplicate_file(dv, convert_293_to_292_board_info);
-        break;
-
-      case FILE_ID_WORLD_GLOBAL_ROBOT:
-      case FILE_ID_ROBOT:
-        err = zip_duplicate_file(dv, convert_293_to_292_robot_info);
-        break;
-
-      case FILE_ID_SENSOR:
-        err = zip_duplicate_file(dv, convert_293_to_292_sensor_info);
+        err = zip_duplicate_file(dv, convert_294_to_293_board_info);
         break;
 
-      case FILE_ID_WORLD_SFX:
-        err = zip_duplicate_file(dv, convert_293_to_292_sfx);
+      case FILE_ID_WORLD_COUNTERS_BULK:
+        err = read_294_counters(dv, &dv->counters, &dv->counters_size);
         break;
 
-      case FILE_ID_WORLD_PAL:
-        if(!dv->screen_mode)
-          err = zip_duplicate_file(dv, NULL);
-        else
-          zip_skip_file(dv->in);
+      case FILE_ID_WORLD_COUNTER_ARRAYS:
+        err = read_294_counters(dv, &dv->arrays, &dv->arrays_size);
         break;
 
-      case FILE_ID_WORLD_PAL_SMZX:
-        if(dv->screen_mode)
-        {
-          char buf[SMZX_PAL_SIZE * 3];
-          memset(buf, 0, sizeof(buf));
-          err = zip_read_file(dv->in, buf, SMZX_PAL_SIZE * 3, NULL);
-          err = zip_write_file(dv->out, "pal", buf, SMZX_PAL_SIZE * 3, ZIP_M_DEFLATE);
-        }
-        else
-          zip_skip_file(dv->in);
-        break;
-
-      case FILE_ID_WORLD_PAL_INTENSITY:
-        if(!dv->screen_mode)
-        {
-          char buf[PAL_SIZE * 4];
-          int i;
-
-          memset(buf, 0, sizeof(buf));
-          err = zip_read_file(dv->in, buf, PAL_SIZE * 4, NULL);
-          if(err == ZIP_SUCCESS)
-          {
-            // Convert to the old format.
-            for(i = 0; i < PAL_SIZE; i++)
-              buf[i] = buf[i * 4];
-
-            zip_write_file(dv->out, "palint", buf, PAL_SIZE, ZIP_M_NONE);
-          }
-        }
-        else
-          zip_skip_file(dv->in);
-        break;
-
-      case FILE_ID_WORLD_PAL_INTENSITY_SMZX:
-        if(dv->screen_mode)
-        {
-          char buf[SMZX_PAL_SIZE * 4];
-          int i;
-
-          memset(buf, 0, sizeof(buf));
-          err = zip_read_file(dv->in, buf, SMZX_PAL_SIZE * 4, NULL);
-          if(err == ZIP_SUCCESS)
-          {
-            // Convert to the old format.
-            for(i = 0; i < SMZX_PAL_SIZE; i++)
-              buf[i] = buf[i * 4];
-
-            zip_write_file(dv->out, "palint", buf, SMZX_PAL_SIZE, ZIP_M_NONE);
-          }
-        }
-        else
-          zip_skip_file(dv->in);
+      case FILE_ID_WORLD_STRINGS_BULK:
+        err = zip_convert_file(dv, "string", convert_294_to_293_strings);
         break;
 
       default:
@@ -499,6 +615,12 @@ static enum status convert_293_to_292(struct downver_state *dv)
     }
   }
 
+  err = write_293_counters(dv);
+  if(err != ZIP_SUCCESS)
+    error("Failed to write counters.\n");
+
+  free(dv->counters);
+  free(dv->arrays);
   zip_close(dv->in, NULL);
   zip_close(dv->out, NULL);
   return SUCCESS;
@@ -544,8 +666,8 @@ static void fix_magic(char *magic, boolean save)
     magic[4] = MZX_VERSION_PREV_LO;
 
     /* Also lower the original world version value (little endian). */
-    if(magic[6] > MZX_VERSION_HI ||
-     (magic[6] == MZX_VERSION_HI && magic[5] > MZX_VERSION_LO))
+    if(magic[6] > MZX_VERSION_PREV_HI ||
+     (magic[6] == MZX_VERSION_PREV_HI && magic[5] > MZX_VERSION_PREV_LO))
     {
       magic[5] = MZX_VERSION_PREV_LO;
       magic[6] = MZX_VERSION_PREV_HI;
@@ -745,7 +867,7 @@ int main(int argc, char *argv[])
   if(MZX_VERSION_PREV < V293)
     zip_set_zip64_enabled(dv.out, false);
 
-  ret = convert_293_to_292(&dv);
+  ret = convert_294_to_293(&dv);
   out = NULL;
   in = NULL;
 
@@ -32,10 +32,14 @@
 #endif
 
 #include "world.h"
+#include "world_compress.h"
+#include "world_decompress.h"
 #include "world_format.h"
+#include "world_snapshot.h"
 #include "legacy_world.h"
 
 #include "board.h"
+#include "board_prefetch.h"
 #include "configure.h"
 #include "const.h"
 #include "counter.h"
@@ -46,6 +50,7 @@
 #include "game_player.h"
 #include "graphics.h"
 #include "idput.h"
+#include "mzm.h"
 #include "robot.h"
 #include "sprite.h"
 #include "str.h"
@@ -1758,9 +1763,7 @@ static inline int save_world_counters(struct world *mzx_world,
   uint8_t buffer[8];
   struct memfile mf;
   struct counter_list *counter_list = &(mzx_world->counter_list);
-  struct counter *src_counter;
-  size_t name_length;
-  size_t i;
+  struct counter_iter iter;
   int result;
 
   result = zip_write_open_file_stream(zp, name, ZIP_M_DEFLATE);
@@ -1768,19 +1771,17 @@ static inline int save_world_counters(struct world *mzx_world,
     return result;
 
   mfopen_wr(buffer, 8, &mf);
-  mfputud(counter_list->num_counters, &mf);
+  mfputud(get_total_counters(counter_list), &mf);
   zwrite(buffer, 4, zp);
 
-  for(i = 0; i < counter_list->num_counters; i++)
+  memset(&iter, 0, sizeof(struct counter_iter));
+  while(next_counter(counter_list, &iter))
   {
-    src_counter = counter_list->counters[i];
-    name_length = src_counter->name_length;
-
     mf.current = buffer;
-    mfputd(src_counter->value, &mf);
-    mfputud(name_length, &mf);
+    mfputd(iter.value, &mf);
+    mfputud(iter.name_length, &mf);
     zwrite(buffer, 8, zp);
-    zwrite(src_counter->name, name_length, zp);
+    zwrite(iter.name, iter.name_length, zp);
   }
 
   return zip_write_close_stream(zp);
@@ -1818,9 +1819,10 @@ static inline int load_world_counters(struct world *mzx_world,
   // If there aren't already any counters, allocate manually.
   if(!num_prev_allocated)
   {
-    counter_list->num_counters = num_counters;
+    counter_list->num_counters = 0;
     counter_list->num_counters_allocated = num_counters;
     counter_list->counters = ccalloc(num_counters, sizeof(struct counter *));
+    load_counter_list_reserve(counter_list, num_counters);
   }
 
   for(i = 0; i < num_counters; i++)
@@ -1847,15 +1849,10 @@ static inline int load_world_counters(struct world *mzx_world,
     // Otherwise, put them in the list manually.
     else
     {
-      load_new_counter(counter_list, i, name_buffer, name_length, value);
+      load_new_counter(counter_list, name_buffer, name_length, value);
     }
   }
 
-  // If there weren't any previously allocated, the number successfully read is
-  // the new number of counters.
-  if(!num_prev_allocated)
-    counter_list->num_counters = i;
-
 #ifndef CONFIG_COUNTER_HASH_TABLES
   // Versions without the hash table require this to be sorted at all times
   sort_counter_list(counter_list);
@@ -1939,6 +1936,7 @@ static inline int load_world_strings(struct world *mzx_world,
     string_list->num_strings = num_strings;
     string_list->num_strings_allocated = num_strings;
     string_list->strings = ccalloc(num_strings, sizeof(struct string *));
+    load_string_list_reserve(string_list, num_strings);
   }
 
   for(i = 0; i < num_strings; i++)
@@ -1988,6 +1986,489 @@ static inline int load_world_strings(struct world *mzx_world,
   return zip_read_close_stream(zp);
 }
 
+// Bulk counters and strings
+
+/**
+ * Check the name lengths array of a bulk counter or string list. Every name
+ * must fit in a name buffer and the names must fill the names block exactly.
+ */
+static boolean bulk_name_lengths_valid(const uint8_t *lengths, size_t count,
+ size_t names_size)
+{
+  struct memfile mf;
+  size_t total = 0;
+  size_t length;
+  size_t i;
+
+  mfopen(lengths, count * 2, &mf);
+  for(i = 0; i < count; i++)
+  {
+    length = mfgetw(&mf);
+    if(length >= ROBOT_MAX_TR)
+      return false;
+
+    total += length;
+  }
+  return total == names_size;
+}
+
+/**
+ * The bulk counter and string formats store the counter values and name
+ * lengths as arrays followed by every name in one contiguous block, so the
+ * entire list can be read with a few large reads instead of two small reads
+ * per counter. These are used by saves of version 2.94 and up.
+ */
+static inline int save_world_counters_bulk(struct world *mzx_world,
+ struct zip_archive *zp, const char *name)
+{
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  struct counter_iter iter;
+  struct memfile mf;
+  struct memfile values;
+  struct memfile lengths;
+  size_t num_counters = get_total_counters(counter_list);
+  size_t names_size = 0;
+  size_t data_size;
+  uint8_t *data;
+  int result;
+
+  memset(&iter, 0, sizeof(struct counter_iter));
+  while(next_counter(counter_list, &iter))
+    names_size += iter.name_length;
+
+  data_size = 8 + num_counters * 6 + names_size;
+  data = (uint8_t *)cmalloc(data_size);
+  if(!data)
+    return -1;
+
+  mfopen_wr(data, 8, &mf);
+  mfputud(num_counters, &mf);
+  mfputud(names_size, &mf);
+
+  mfopen_wr(data + 8, num_counters * 4, &values);
+  mfopen_wr(data + 8 + num_counters * 4, num_counters * 2, &lengths);
+  mfopen_wr(data + 8 + num_counters * 6, names_size, &mf);
+
+  memset(&iter, 0, sizeof(struct counter_iter));
+  while(next_counter(counter_list, &iter))
+  {
+    mfputd(iter.value, &values);
+    mfputw(iter.name_length, &lengths);
+    mfwrite(iter.name, iter.name_length, 1, &mf);
+  }
+
+  result = zip_write_file(zp, name, data, data_size, ZIP_M_DEFLATE);
+  free(data);
+  return result;
+}
+
+static inline int load_world_counters_bulk(struct world *mzx_world,
+ struct zip_archive *zp)
+{
+  uint8_t header[8];
+  struct memfile mf;
+  struct memfile values;
+  struct memfile lengths;
+  char name_buffer[ROBOT_MAX_TR];
+  const char *names;
+  size_t names_size;
+  size_t names_pos = 0;
+  size_t name_length;
+  size_t data_size;
+  uint64_t file_size;
+  uint8_t *data;
+  int value;
+
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  size_t num_prev_allocated;
+  size_t num_counters;
+  size_t i;
+
+  enum zip_error result;
+
+  result = zip_read_open_file_stream(zp, &file_size);
+  if(result)
+    return result;
+
+  result = zread(header, 8, zp);
+  if(result)
+    goto err_close;
+
+  mfopen(header, 8, &mf);
+  num_counters = mfgetud(&mf);
+  names_size = mfgetud(&mf);
+
+  // The arrays and names must account for the rest of the file exactly, and
+  // the names can't be longer than the number of counters allows.
+  if(file_size < 8 || num_counters > (file_size - 8) / 6 ||
+   num_counters * 6 + names_size != file_size - 8 ||
+   names_size > num_counters * (ROBOT_MAX_TR - 1))
+    goto err_close;
+
+  data_size = num_counters * 6 + names_size;
+  data = (uint8_t *)cmalloc(data_size ? data_size : 1);
+  result = zread(data, data_size, zp);
+  if(result ||
+   !bulk_name_lengths_valid(data + num_counters * 4, num_counters, names_size))
+  {
+    free(data);
+    goto err_close;
+  }
+
+  mfopen(data, num_counters * 4, &values);
+  mfopen(data + num_counters * 4, num_counters * 2, &lengths);
+  names = (const char *)data + num_counters * 6;
+
+  num_prev_allocated = counter_list->num_counters_allocated;
+
+  // If there aren't already any counters, allocate manually.
+  if(!num_prev_allocated)
+  {
+    counter_list->num_counters = 0;
+    counter_list->num_counters_allocated = num_counters;
+    counter_list->counters = ccalloc(num_counters, sizeof(struct counter *));
+    load_counter_list_reserve(counter_list, num_counters);
+  }
+
+  for(i = 0; i < num_counters; i++)
+  {
+    value = mfgetd(&values);
+    name_length = mfgetw(&lengths);
+
+    // If there were already counters, use new_counter to set or add them
+    // into the existing counters as-needed.
+    if(num_prev_allocated)
+    {
+      memcpy(name_buffer, names + names_pos, name_length);
+      name_buffer[name_length] = 0;
+      new_counter(mzx_world, name_buffer, value, -1);
+    }
+
+    // Otherwise, put them in the list manually.
+    else
+    {
+      load_new_counter(counter_list, names + names_pos, name_length, value);
+    }
+    names_pos += name_length;
+  }
+
+#ifndef CONFIG_COUNTER_HASH_TABLES
+  // Versions without the hash table require this to be sorted at all times
+  sort_counter_list(counter_list);
+#endif
+
+  free(data);
+
+err_close:
+  // Invalid data is ignored. Closing the stream skips whatever wasn't read.
+  return zip_read_close_stream(zp);
+}
+
+/**
+ * Counter arrays are stored as the number of arrays followed by the name
+ * length, size, name, and values of each array (2.94+).
+ */
+static inline int save_world_counter_arrays(struct world *mzx_world,
+ struct zip_archive *zp, const char *name)
+{
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  struct counter_array *array;
+  struct memfile mf;
+  size_t data_size = 4;
+  uint8_t *data;
+  size_t i;
+  size_t j;
+  int result;
+
+  for(i = 0; i < counter_list->num_arrays; i++)
+  {
+    array = counter_list->arrays[i];
+    data_size += 6 + array->name_length + array->size * 4;
+  }
+
+  data = (uint8_t *)cmalloc(data_size);
+  if(!data)
+    return -1;
+
+  mfopen_wr(data, data_size, &mf);
+  mfputud(counter_list->num_arrays, &mf);
+
+  for(i = 0; i < counter_list->num_arrays; i++)
+  {
+    array = counter_list->arrays[i];
+    mfputw(array->name_length, &mf);
+    mfputud(array->size, &mf);
+    mfwrite(array->name, array->name_length, 1, &mf);
+
+    for(j = 0; j < array->size; j++)
+      mfputd(array->values[j], &mf);
+  }
+
+  result = zip_write_file(zp, name, data, data_size, ZIP_M_DEFLATE);
+  free(data);
+  return result;
+}
+
+static inline int load_world_counter_arrays(struct world *mzx_world,
+ struct zip_archive *zp)
+{
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  struct memfile mf;
+  const char *name;
+  int32_t *values;
+  uint8_t *data;
+  size_t data_size;
+  size_t num_arrays;
+  size_t name_length;
+  uint64_t file_size;
+  size_t size;
+  size_t i;
+  size_t j;
+  enum zip_error result;
+
+  result = zip_read_open_file_stream(zp, &file_size);
+  if(result)
+    return result;
+
+  data_size = file_size;
+  data = (uint8_t *)cmalloc(data_size ? data_size : 1);
+  result = zread(data, data_size, zp);
+  if(result)
+    goto err_free;
+
+  mfopen(data, data_size, &mf);
+  num_arrays = mfhasspace(4, &mf) ? mfgetud(&mf) : 0;
+
+  for(i = 0; i < num_arrays; i++)
+  {
+    if(!mfhasspace(6, &mf))
+      break;
+
+    name_length = mfgetw(&mf);
+    size = mfgetud(&mf);
+
+    if(!name_length || name_length >= ROBOT_MAX_TR ||
+     !mfhasspace(name_length, &mf))
+      break;
+
+    name = (const char *)mf.current;
+    mf.current += name_length;
+
+    if(size > (size_t)(mf.end - mf.current) / 4)
+      break;
+
+    values = load_counter_array(counter_list, name, name_length, size);
+    if(!values)
+    {
+      mf.current += size * 4;
+      continue;
+    }
+
+    for(j = 0; j < size; j++)
+      values[j] = mfgetd(&mf);
+  }
+
+err_free:
+  free(data);
+  // Closing the stream skips whatever wasn't read.
+  return zip_read_close_stream(zp);
+}
+
+static inline int save_world_strings_bulk(struct world *mzx_world,
+ struct zip_archive *zp, const char *name)
+{
+  struct string_list *string_list = &(mzx_world->string_list);
+  struct string *src_string;
+  struct memfile mf;
+  size_t num_strings = string_list->num_strings;
+  size_t names_size = 0;
+  size_t data_size;
+  uint8_t *data;
+  size_t i;
+  int result;
+
+  result = zip_write_open_file_stream(zp, name, ZIP_M_DEFLATE);
+  if(result != ZIP_SUCCESS)
+    return result;
+
+  for(i = 0; i < num_strings; i++)
+    names_size += string_list->strings[i]->name_length;
+
+  data_size = 8 + num_strings * 6 + names_size;
+  data = (uint8_t *)cmalloc(data_size);
+  if(!data)
+  {
+    zip_write_close_stream(zp);
+    return -1;
+  }
+
+  mfopen_wr(data, data_size, &mf);
+  mfputud(num_strings, &mf);
+  mfputud(names_size, &mf);
+
+  for(i = 0; i < num_strings; i++)
+    mfputw(string_list->strings[i]->name_length, &mf);
+
+  for(i = 0; i < num_strings; i++)
+    mfputud(string_list->strings[i]->length, &mf);
+
+  for(i = 0; i < num_strings; i++)
+  {
+    src_string = string_list->strings[i];
+    mfwrite(src_string->name, src_string->name_length, 1, &mf);
+  }
+
+  zwrite(data, data_size, zp);
+  free(data);
+
+  // The values are written directly from the strings since they can be large.
+  for(i = 0; i < num_strings; i++)
+  {
+    src_string = string_list->strings[i];
+    zwrite(src_string->value, src_string->length, zp);
+  }
+
+  return zip_write_close_stream(zp);
+}
+
+static inline int load_world_strings_bulk(struct world *mzx_world,
+ struct zip_archive *zp)
+{
+  uint8_t header[8];
+  struct memfile mf;
+  struct memfile name_lengths;
+  struct memfile str_lengths;
+  struct string *src_string;
+  char name_buffer[ROBOT_MAX_TR];
+  const char *names;
+  size_t names_size;
+  size_t names_pos = 0;
+  size_t name_length;
+  size_t str_length;
+  size_t data_size;
+  uint64_t values_size;
+  uint64_t file_size;
+  uint8_t *data;
+
+  struct string_list *string_list = &(mzx_world->string_list);
+  size_t num_prev_allocated;
+  size_t num_strings;
+  size_t i;
+
+  enum zip_error result;
+
+  result = zip_read_open_file_stream(zp, &file_size);
+  if(result)
+    return result;
+
+  result = zread(header, 8, zp);
+  if(result)
+    goto err_close;
+
+  mfopen(header, 8, &mf);
+  num_strings = mfgetud(&mf);
+  names_size = mfgetud(&mf);
+
+  // The string values follow the arrays and names. The names can't be longer
+  // than the number of strings allows.
+  if(file_size < 8 || num_strings > (file_size - 8) / 6 ||
+   names_size > file_size - 8 - num_strings * 6 ||
+   names_size > num_strings * (ROBOT_MAX_TR - 1))
+    goto err_close;
+
+  data_size = num_strings * 6 + names_size;
+  data = (uint8_t *)cmalloc(data_size ? data_size : 1);
+  result = zread(data, data_size, zp);
+  if(result || !bulk_name_lengths_valid(data, num_strings, names_size))
+  {
+    free(data);
+    goto err_close;
+  }
+
+  // The string lengths must account for the rest of the file exactly.
+  values_size = 0;
+  mfopen(data + num_strings * 2, num_strings * 4, &str_lengths);
+  for(i = 0; i < num_strings; i++)
+  {
+    str_length = mfgetud(&str_lengths);
+    if(str_length > MAX_STRING_LEN)
+      break;
+
+    values_size += str_length;
+  }
+
+  if(i < num_strings || values_size != file_size - 8 - data_size)
+  {
+    free(data);
+    goto err_close;
+  }
+
+  mfopen(data, num_strings * 2, &name_lengths);
+  mfopen(data + num_strings * 2, num_strings * 4, &str_lengths);
+  names = (const char *)data + num_strings * 6;
+
+  num_prev_allocated = string_list->num_strings_allocated;
+
+  // If there aren't already any strings, allocate manually.
+  if(!num_prev_allocated)
+  {
+    string_list->num_strings = num_strings;
+    string_list->num_strings_allocated = num_strings;
+    string_list->strings = ccalloc(num_strings, sizeof(struct string *));
+    load_string_list_reserve(string_list, num_strings);
+  }
+
+  for(i = 0; i < num_strings; i++)
+  {
+    name_length = mfgetw(&name_lengths);
+    str_length = mfgetud(&str_lengths);
+
+    // If there were already string, use new_string to set or add them
+    // into the existing strings as-needed.
+    if(num_prev_allocated)
+    {
+      memcpy(name_buffer, names + names_pos, name_length);
+      name_buffer[name_length] = 0;
+      src_string = new_string(mzx_world, name_buffer, str_length, -1);
+      if(!src_string)
+        break;
+    }
+
+    // Otherwise, put them in the list manually.
+    else
+    {
+      src_string = load_new_string(string_list, i,
+       names + names_pos, name_length, str_length);
+    }
+    names_pos += name_length;
+
+    if(ZIP_SUCCESS != zread(src_string->value, str_length, zp))
+    {
+      // Keep the string, but don't leave garbage in it.
+      src_string->length = 0;
+      i++;
+      break;
+    }
+    src_string->length = str_length;
+  }
+
+  // If there weren't any previously allocated, the number successfully read is
+  // the new number of strings.
+  if(!num_prev_allocated)
+    string_list->num_strings = i;
+
+#ifndef CONFIG_COUNTER_HASH_TABLES
+  // Versions without the hash table require this to be sorted at all times
+  sort_string_list(string_list);
+#endif
+
+  free(data);
+
+err_close:
+  // Invalid data is ignored. Closing the stream skips whatever wasn't read.
+  return zip_read_close_stream(zp);
+}
+
 
 void save_counters_file(struct world *mzx_world, const char *file)
 {
@@ -2020,11 +2501,8 @@ int load_counters_file(struct world *mzx_world, const char *file)
 {
   vfile *vf = vfopen_unsafe_ext(file, "rb", V_LARGE_BUFFER);
   struct zip_archive *zp;
-  enum zip_error err;
   char magic[8];
 
-  unsigned int prop_id;
-
   if(!vf)
   {
     error_message(E_FILE_DOES_NOT_EXIST, 0, NULL);
@@ -2045,32 +2523,23 @@ int load_counters_file(struct world *mzx_world, const char *file)
   // Treat this like a world file since this contains world file IDs...
   world_assign_file_ids(zp, true);
 
-  while(ZIP_SUCCESS == zip_get_next_mzx_file_id(zp, &prop_id, NULL, NULL))
+  if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_COUNTERS, 0, 0))
   {
-    err = ZIP_SUCCESS;
-
-    switch(prop_id)
+    if(load_world_counters(mzx_world, zp) != ZIP_SUCCESS)
     {
-      case FILE_ID_WORLD_COUNTERS:
-        err = load_world_counters(mzx_world, zp);
-        break;
-
-      case FILE_ID_WORLD_STRINGS:
-        err = load_world_strings(mzx_world, zp);
-        break;
-
-      default:
-        err = zip_skip_file(zp);
-        break;
+      fprintf(mzxerr, "ERROR - Read error @ file ID %u\n",
+       FILE_ID_WORLD_COUNTERS);
+      fflush(mzxerr);
     }
+  }
 
-    // File failed to load? Skip it
-    if(err != ZIP_SUCCESS)
+  if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_STRINGS, 0, 0))
+  {
+    if(load_world_strings(mzx_world, zp) != ZIP_SUCCESS)
     {
-      fprintf(mzxerr, "ERROR - Read error @ file ID %u\n", prop_id);
+      fprintf(mzxerr, "ERROR - Read error @ file ID %u\n",
+       FILE_ID_WORLD_STRINGS);
       fflush(mzxerr);
-      if(zip_skip_file(zp) != ZIP_SUCCESS)
-        break;
     }
   }
 
@@ -2092,7 +2561,6 @@ err_close_file:
 static enum val_result validate_world_zip(struct world *mzx_world,
  struct zip_archive *zp, boolean savegame, int *file_version)
 {
-  unsigned int file_id;
   int result;
 
   int has_world = 0;
@@ -2104,63 +2572,39 @@ static enum val_result validate_world_zip(struct world *mzx_world,
   // The directory has already been read by this point.
   world_assign_file_ids(zp, true);
 
-  // Step through the directory and make sure the mandatory files exist.
-  while(ZIP_SUCCESS == zip_get_next_mzx_file_id(zp, &file_id, NULL, NULL))
+  // Look up the mandatory files directly instead of stepping through the
+  // entire directory. Everything needs the world info, no negotiations.
+  if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_INFO, 0, 0))
   {
-    // Can we stop early?
-    if((!savegame && has_pal) || has_string)
-      break;
+    result = validate_world_info(mzx_world, zp, savegame, file_version);
+    if(result != VAL_SUCCESS)
+      return result;
 
-    switch(file_id)
-    {
-      // Everything needs this, no negotiations.
-      case FILE_ID_WORLD_INFO:
-        result = validate_world_info(mzx_world, zp, savegame, file_version);
-        if(result != VAL_SUCCESS)
-          return result;
-        // Continue so it doesn't skip the file.
-        has_world = 1;
-        continue;
-
-      // These are pretty much the bare minimum of what counts as a world
-      case FILE_ID_WORLD_CHARS:
-        has_chars = 1;
-        break;
-
-      case FILE_ID_WORLD_PAL:
-        has_pal = 1;
-        break;
-
-      // These are pretty much the bare minimum of what counts as a save
-      case FILE_ID_WORLD_COUNTERS:
-        has_counter = 1;
-        break;
+    has_world = 1;
+  }
 
-      case FILE_ID_WORLD_STRINGS:
-        has_string = 1;
-        break;
+  // These are pretty much the bare minimum of what counts as a world
+  if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_CHARS, 0, 0))
+    has_chars = 1;
 
-      // These should exist, but can be replaced with defaults if missing.
-      case FILE_ID_WORLD_GLOBAL_ROBOT:
-      case FILE_ID_WORLD_PAL_INDEX:
-      case FILE_ID_WORLD_PAL_INTENSITY:
-      case FILE_ID_WORLD_PAL_INTENSITY_SMZX:
-      case FILE_ID_WORLD_VCO:
-      case FILE_ID_WORLD_VCH:
-      case FILE_ID_WORLD_SPRITES:
-        break;
+  if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_PAL, 0, 0))
+    has_pal = 1;
 
-      // Completely optional.
-      case FILE_ID_WORLD_SFX:
-        break;
+  // These are pretty much the bare minimum of what counts as a save
+  if(savegame)
+  {
+    if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_COUNTERS, 0, 0) ||
+     ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_COUNTERS_BULK, 0, 0))
+      has_counter = 1;
 
-      // Everything else: who knows
-      default:
-        break;
-    }
-    zip_skip_file(zp);
+    if(ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_STRINGS, 0, 0) ||
+     ZIP_SUCCESS == zip_find_mzx_file(zp, FILE_ID_WORLD_STRINGS_BULK, 0, 0))
+      has_string = 1;
   }
 
+  // Everything else should exist but can be replaced with defaults if
+  // missing, is completely optional, or who knows.
+
   if(!(has_world && has_pal && has_chars))
     goto err_out;
 
@@ -2181,22 +2625,150 @@ err_out:
 }
 
 
-static int save_world_zip(struct world *mzx_world, const char *file,
+static boolean read_world_header(vfile *vf, boolean savegame,
+ int *file_version, int *protected, char *name);
+
+/**
+ * Incremental saving copies boards that haven't been retrieved since the
+ * world was last loaded or saved from that file when saving over it again.
+ * The editor modifies boards without retrieving them, so don't do it there.
+ */
+static boolean use_world_incremental_save(struct world *mzx_world)
+{
+  return get_config()->world_incremental_save && !mzx_world->editing;
+}
+
+/**
+ * Mark every board except the current board as not retrieved for a copy of
+ * the world that was just loaded or saved. The current board is always saved
+ * in full.
+ */
+static void world_clear_boards_retrieved(struct world *mzx_world,
+ int retrieved_flag)
+{
+  struct board *cur_board;
+  int i;
+
+  for(i = 0; i < mzx_world->num_boards; i++)
+  {
+    cur_board = mzx_world->board_list[i];
+    if(!cur_board)
+      continue;
+
+    if(cur_board == mzx_world->current_board)
+      cur_board->retrieved |= retrieved_flag;
+    else
+      cur_board->retrieved &= ~retrieved_flag;
+  }
+}
+
+/**
+ * Get the full path of a world file relative to the current directory, so it
+ * can be matched regardless of how it was named when it was loaded or saved.
+ */
+static void get_world_file_path(char *dest, size_t dest_len, const char *file)
+{
+  if(!vgetcwd(dest, dest_len) ||
+   path_navigate_no_check(dest, dest_len, file) < 0)
+    snprintf(dest, dest_len, "%s", file);
+}
+
+/**
+ * Record the file the world was just loaded from or saved to, and mark every
+ * board except the current board as not retrieved for it.
+ */
+static void record_world_file(struct world *mzx_world, const char *file,
  boolean savegame, int file_version)
 {
+  struct world_file_record *rec = &mzx_world->last_file;
+  struct stat file_info;
+
+  rec->valid = false;
+  if(!file || vstat(file, &file_info) < 0)
+    return;
+
+  get_world_file_path(rec->path, MAX_PATH, file);
+  rec->savegame = savegame;
+  rec->file_version = file_version;
+  rec->size = file_info.st_size;
+  rec->mtime = file_info.st_mtime;
+  rec->dev = file_info.st_dev;
+  rec->ino = file_info.st_ino;
+  rec->valid = true;
+
+  world_clear_boards_retrieved(mzx_world, BOARD_RETRIEVED_SAVE);
+}
+
+/**
+ * Open the previous version of a file being saved over, if it's the recorded
+ * file and nothing else has modified it since. The entire file is read into
+ * memory since it's about to be overwritten.
+ */
+static struct zip_archive *open_previous_world_file(struct world *mzx_world,
+ const char *file, boolean savegame, int file_version)
+{
+  struct world_file_record *rec = &mzx_world->last_file;
+  struct zip_archive *zp;
+  struct stat file_info;
+  char path[MAX_PATH];
+  char name[BOARD_NAME_SIZE];
   vfile *vf;
+  int v = 0;
+
+  if(!rec->valid || !use_world_incremental_save(mzx_world))
+    return NULL;
+
+  get_world_file_path(path, MAX_PATH, file);
+  if(rec->savegame != savegame || rec->file_version != file_version ||
+   strcmp(rec->path, path))
+    return NULL;
+
+  if(vstat(file, &file_info) < 0 || rec->size != file_info.st_size ||
+   rec->mtime != file_info.st_mtime || rec->dev != file_info.st_dev ||
+   rec->ino != file_info.st_ino)
+    return NULL;
+
+  vf = vfopen_unsafe_ext(file, "rb", V_LARGE_BUFFER);
+  if(!vf)
+    return NULL;
+
+  if(!read_world_header(vf, savegame, &v, NULL, name) || v != file_version ||
+   !vfile_force_to_memory(vf))
+  {
+    vfclose(vf);
+    return NULL;
+  }
+
+  zp = zip_open_vf_read(vf);
+  if(!zp)
+    return NULL;
+
+  world_assign_file_ids(zp, true);
+  return zp;
+}
+
+/**
+ * Write a world or save file to a vfile, which is closed afterward. Boards
+ * that haven't been retrieved for retrieved_flag are copied from prev_zp (if
+ * provided) instead of being saved again. Snapshots are written without compression and without
+ * displaying a meter. Returns the final size of the file through final_size.
+ */
+static int save_world_zip_vf(struct world *mzx_world, vfile *vf,
+ boolean savegame, int file_version, struct zip_archive *prev_zp,
+ int retrieved_flag, boolean is_snapshot, uint64_t *final_size)
+{
+  struct world_compress *wc = NULL;
   struct zip_archive *zp = NULL;
   struct board *cur_board;
+  enum zip_error result;
+  boolean show_meter = !is_snapshot;
   int i;
 
   int meter_curr = 0;
   int meter_target = 2 + mzx_world->num_boards + mzx_world->temporary_board;
 
-  meter_initial_draw(meter_curr, meter_target, "Saving...");
-
-  vf = vfopen_unsafe_ext(file, "wb", V_LARGE_BUFFER);
-  if(!vf)
-    goto err;
+  if(show_meter)
+    meter_initial_draw(meter_curr, meter_target, "Saving...");
 
   // Header
   if(!savegame)
@@ -2242,6 +2814,12 @@ static int save_world_zip(struct world *mzx_world, const char *file,
   if(file_version < V293)
     zip_set_zip64_enabled(zp, false);
 
+  // Snapshots only live in memory for a short while, so don't compress them.
+  if(is_snapshot)
+    zip_set_store_only(zp, true);
+  else
+    wc = world_compress_start(zp, get_config()->world_save_threads);
+
   if(save_world_info(mzx_world, zp, savegame, file_version, "world"))
     goto err_close;
 
@@ -2261,16 +2839,51 @@ static int save_world_zip(struct world *mzx_world, const char *file,
     if(save_world_pal_inten(mzx_world, zp, file_version, "palint"))   goto err_close;
     if(save_world_pal_inten_smzx(mzx_world, zp,"palints"))  goto err_close;
     if(save_world_sprites(mzx_world, zp,       "spr"))      goto err_close;
-    if(save_world_counters(mzx_world, zp,      "counter"))  goto err_close;
-    if(save_world_strings(mzx_world, zp,       "string"))   goto err_close;
+
+    if(file_version >= V294)
+    {
+      if(save_world_counters_bulk(mzx_world, zp, "ctrbulk")) goto err_close;
+      if(save_world_strings_bulk(mzx_world, zp,  "strbulk")) goto err_close;
+    }
+    else
+    {
+      if(save_world_counters(mzx_world, zp,    "counter"))  goto err_close;
+      if(save_world_strings(mzx_world, zp,     "string"))   goto err_close;
+    }
+
+    // Counter arrays only exist in 2.94+ worlds.
+    if(file_version >= V294 && mzx_world->counter_list.num_arrays &&
+     save_world_counter_arrays(mzx_world, zp, "ctrarr"))
+      goto err_close;
   }
 
-  meter_update_screen(&meter_curr, meter_target);
+  if(show_meter)
+    meter_update_screen(&meter_curr, meter_target);
 
   for(i = 0; i < mzx_world->num_boards; i++)
   {
     cur_board = mzx_world->board_list[i];
 
+    if(cur_board && can_save_board_deferred(cur_board, savegame, file_version))
+    {
+      // This board was never loaded, so copy it from the world archive.
+      if(save_board_deferred(mzx_world, cur_board, zp, savegame, file_version,
+       i))
+        goto err_close;
+    }
+    else
+
+    if(cur_board && prev_zp && !(cur_board->retrieved & retrieved_flag) &&
+     cur_board != mzx_world->current_board &&
+     ZIP_SUCCESS == zip_find_mzx_file(prev_zp, FILE_ID_BOARD_INFO, i, 0))
+    {
+      // This board hasn't changed since the previous save, so copy it.
+      if(save_board_copy(mzx_world, cur_board, zp, savegame, file_version, i,
+       prev_zp))
+        goto err_close;
+    }
+    else
+
     if(cur_board)
     {
       if(cur_board != mzx_world->current_board)
@@ -2283,7 +2896,8 @@ static int save_world_zip(struct world *mzx_world, const char *file,
         store_board_to_extram(cur_board);
     }
 
-    meter_update_screen(&meter_curr, meter_target);
+    if(show_meter)
+      meter_update_screen(&meter_curr, meter_target);
   }
 
   if(mzx_world->temporary_board)
@@ -2292,28 +2906,73 @@ static int save_world_zip(struct world *mzx_world, const char *file,
      file_version, TEMPORARY_BOARD))
       goto err_close;
 
-    meter_update_screen(&meter_curr, meter_target);
+    if(show_meter)
+      meter_update_screen(&meter_curr, meter_target);
   }
 
-  meter_update_screen(&meter_curr, meter_target);
+  // Write any files that are still being compressed.
+  result = world_compress_stop(wc, zp);
+  wc = NULL;
+  if(result)
+    goto err_close;
 
-  meter_restore_screen();
+  if(show_meter)
+  {
+    meter_update_screen(&meter_curr, meter_target);
+    meter_restore_screen();
+  }
+
+  if(zip_close(zp, final_size) != ZIP_SUCCESS)
+    return -1;
 
-  zip_close(zp, NULL);
   return 0;
 
 err_close:
+  world_compress_stop(wc, zp);
   if(zp)
     zip_close(zp, NULL);
   else
     vfclose(vf);
 
-err:
-  error_message(E_WORLD_IO_SAVING, 0, NULL);
-  meter_restore_screen();
+  if(show_meter)
+    meter_restore_screen();
+
   return -1;
 }
 
+static int save_world_zip(struct world *mzx_world, const char *file,
+ boolean savegame, int file_version)
+{
+  struct zip_archive *prev_zp;
+  vfile *vf;
+  int ret;
+
+  // This needs to be read before the file is truncated.
+  prev_zp = open_previous_world_file(mzx_world, file, savegame, file_version);
+  mzx_world->last_file.valid = false;
+
+  vf = vfopen_unsafe_ext(file, "wb", V_LARGE_BUFFER);
+  if(vf)
+  {
+    ret = save_world_zip_vf(mzx_world, vf, savegame, file_version, prev_zp,
+     BOARD_RETRIEVED_SAVE, false, NULL);
+  }
+  else
+    ret = -1;
+
+  if(prev_zp)
+    zip_close(prev_zp, NULL);
+
+  if(ret)
+  {
+    error_message(E_WORLD_IO_SAVING, 0, NULL);
+    return -1;
+  }
+
+  record_world_file(mzx_world, file, savegame, file_version);
+  return 0;
+}
+
 #undef if_savegame
 #undef if_savegame_or_291
 
@@ -2321,9 +2980,20 @@ err:
 #define if_savegame_or_291  if(!savegame && mzx_world->version < V291) \
                              { zip_skip_file(zp); break; }
 
+/**
+ * Lazy loading keeps the world archive open to load boards from later. The
+ * editor expects every board to be loaded, so don't bother there.
+ */
+static boolean use_world_lazy_load(struct world *mzx_world)
+{
+  return get_config()->world_lazy_load && !mzx_world->editing;
+}
+
 static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
  boolean savegame, int file_version, boolean *faded)
 {
+  struct world_decompress *wd = NULL;
+  boolean lazy = use_world_lazy_load(mzx_world) && zp->is_memory;
   unsigned int file_id;
   unsigned int board_id;
   enum zip_error err;
@@ -2337,6 +3007,9 @@ static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
   meter_initial_draw(meter_curr, meter_target, "Loading...");
 
   // The directory has already been read by this point, and we're at the start.
+  // Start decompressing boards in the background (if possible).
+  if(!lazy)
+    wd = world_decompress_start(zp, get_config()->world_load_threads);
 
   while(ZIP_SUCCESS == zip_get_next_mzx_file_id(zp, &file_id, &board_id, NULL))
   {
@@ -2423,13 +3096,38 @@ static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
         err = load_world_strings(mzx_world, zp);
         break;
 
+      case FILE_ID_WORLD_COUNTERS_BULK:
+        if_savegame
+        err = load_world_counters_bulk(mzx_world, zp);
+        break;
+
+      case FILE_ID_WORLD_STRINGS_BULK:
+        if_savegame
+        err = load_world_strings_bulk(mzx_world, zp);
+        break;
+
+      case FILE_ID_WORLD_COUNTER_ARRAYS:
+        if_savegame
+        err = load_world_counter_arrays(mzx_world, zp);
+        break;
+
       // Defer to the board loader.
       case FILE_ID_BOARD_INFO:
       {
+        world_decompress_board(wd, zp, board_id);
+
         if((int)board_id < mzx_world->num_boards)
         {
-          mzx_world->board_list[board_id] =
-           load_board_allocate(mzx_world, zp, savegame, file_version, board_id);
+          if(lazy)
+          {
+            mzx_world->board_list[board_id] = load_board_allocate_deferred(
+             mzx_world, zp, savegame, file_version, board_id);
+          }
+          else
+          {
+            mzx_world->board_list[board_id] = load_board_allocate(mzx_world,
+             zp, savegame, file_version, board_id);
+          }
 
           store_board_to_extram(mzx_world->board_list[board_id]);
           meter_update_screen(&meter_curr, meter_target);
@@ -2474,6 +3172,8 @@ static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
     }
   }
 
+  world_decompress_stop(wd);
+
   // Check for missing global robot
   if(!loaded_global_robot)
   {
@@ -2506,7 +3206,17 @@ static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
 
   meter_restore_screen();
 
-  zip_close(zp, NULL);
+  // Deferred boards will be loaded from the archive later.
+  if(lazy)
+    mzx_world->board_archive = zp;
+
+  board_prefetch_free(mzx_world->board_prefetch);
+  mzx_world->board_prefetch = board_prefetch_init(lazy ? zp : NULL,
+   get_config()->world_prefetch_memory);
+
+  if(!lazy)
+    zip_close(zp, NULL);
+
   return 0;
 }
 
@@ -2515,6 +3225,41 @@ static int load_world_zip(struct world *mzx_world, struct zip_archive *zp,
 static void v1_store_globals_to_board(struct world *mzx_world);
 static void v1_load_globals_from_board(struct world *mzx_world);
 
+/**
+ * Synchronize state that is kept outside of the world data before saving.
+ */
+static void save_world_prepare(struct world *mzx_world)
+{
+  // Prepare input pos
+  if(!mzx_world->input_is_dir && mzx_world->input_file)
+  {
+    mzx_world->temp_input_pos = vftell(mzx_world->input_file);
+  }
+  else
+
+  if(mzx_world->input_is_dir)
+  {
+    mzx_world->temp_input_pos = vdir_tell(mzx_world->input_directory);
+  }
+  else
+  {
+    mzx_world->temp_input_pos = 0;
+  }
+
+  // Prepare output pos
+  if(mzx_world->output_file)
+  {
+    mzx_world->temp_output_pos = vftell(mzx_world->output_file);
+  }
+  else
+  {
+    mzx_world->temp_output_pos = 0;
+  }
+
+  // Synchronize global variables in the current board.
+  v1_store_globals_to_board(mzx_world);
+}
+
 int save_world(struct world *mzx_world, const char *file, boolean savegame,
  int file_version)
 {
@@ -2555,34 +3300,7 @@ int save_world(struct world *mzx_world, const char *file, boolean savegame,
   }
 #endif /* CONFIG_DEBYTECODE */
 
-  // Prepare input pos
-  if(!mzx_world->input_is_dir && mzx_world->input_file)
-  {
-    mzx_world->temp_input_pos = vftell(mzx_world->input_file);
-  }
-  else
-
-  if(mzx_world->input_is_dir)
-  {
-    mzx_world->temp_input_pos = vdir_tell(mzx_world->input_directory);
-  }
-  else
-  {
-    mzx_world->temp_input_pos = 0;
-  }
-
-  // Prepare output pos
-  if(mzx_world->output_file)
-  {
-    mzx_world->temp_output_pos = vftell(mzx_world->output_file);
-  }
-  else
-  {
-    mzx_world->temp_output_pos = 0;
-  }
-
-  // Synchronize global variables in the current board.
-  v1_store_globals_to_board(mzx_world);
+  save_world_prepare(mzx_world);
 
   // Supported file format versions are the current version (typical world or
   // save files) and the previous version (downver export from the editor).
@@ -2830,31 +3548,39 @@ void optimize_null_boards(struct world *mzx_world)
 }
 
 
+/**
+ * Load a world or save from an archive or legacy file. Snapshots don't have
+ * a file name, so the current directory and config are left alone for them.
+ */
 static void load_world(struct world *mzx_world, struct zip_archive *zp,
  vfile *vf, const char *file, boolean savegame, int file_version, char *name,
  boolean *faded)
 {
-  int file_name_len = strlen(file) - 4;
   char config_file_name[MAX_PATH];
   char current_dir[MAX_PATH];
   char file_path[MAX_PATH];
   struct stat file_info;
 
-  // Change to the game (or save) directory.
-  if(path_get_directory(file_path, MAX_PATH, file) > 0)
+  if(file)
   {
-    vgetcwd(current_dir, MAX_PATH);
+    int file_name_len = strlen(file) - 4;
 
-    if(strcmp(current_dir, file_path))
-      vchdir(file_path);
-  }
+    // Change to the game (or save) directory.
+    if(path_get_directory(file_path, MAX_PATH, file) > 0)
+    {
+      vgetcwd(current_dir, MAX_PATH);
+
+      if(strcmp(current_dir, file_path))
+        vchdir(file_path);
+    }
 
-  // load world config file
-  snprintf(config_file_name, MAX_PATH, "%.*s.cnf", file_name_len, file);
-  config_file_name[MAX_PATH - 1] = '\0';
+    // load world config file
+    snprintf(config_file_name, MAX_PATH, "%.*s.cnf", file_name_len, file);
+    config_file_name[MAX_PATH - 1] = '\0';
 
-  if(vstat(config_file_name, &file_info) >= 0)
-    set_config_from_file(GAME_CNF, config_file_name);
+    if(vstat(config_file_name, &file_info) >= 0)
+      set_config_from_file(GAME_CNF, config_file_name);
+  }
 
   // Some initial setting(s)
   sfx_free(&mzx_world->custom_sfx);
@@ -2866,7 +3592,15 @@ static void load_world(struct world *mzx_world, struct zip_archive *zp,
   // If we're here, there's either a zip (regular) or a file (legacy).
   if(zp)
   {
-    load_world_zip(mzx_world, zp, savegame, file_version, faded);
+    if(!load_world_zip(mzx_world, zp, savegame, file_version, faded) && file)
+    {
+      // The current directory is now the game directory, so the file is
+      // recorded by its name relative to it.
+      if(path_get_filename(file_path, MAX_PATH, file) <= 0)
+        snprintf(file_path, MAX_PATH, "%s", file);
+
+      record_world_file(mzx_world, file_path, savegame, file_version);
+    }
   }
   else
   {
@@ -2897,7 +3631,8 @@ static void load_world(struct world *mzx_world, struct zip_archive *zp,
     }
     else if(err == -FSAFE_SUCCESS)
     {
-      mzx_world->input_file = vfopen_unsafe(translated_path, "rb");
+      mzx_world->input_file = vfopen_unsafe_ext(translated_path, "rb",
+       V_LARGE_BUFFER);
       if(mzx_world->input_file)
         vfseek(mzx_world->input_file, mzx_world->temp_input_pos, SEEK_SET);
     }
@@ -2909,9 +3644,11 @@ static void load_world(struct world *mzx_world, struct zip_archive *zp,
     // Truncation occurred during the initial FWRITE_APPEND,
     // so wb and r+b should both be reopened as r+b.
     if(mzx_world->output_mode == FWRITE_MODE_APPEND)
-      mzx_world->output_file = fsafeopen(mzx_world->output_file_name, "ab");
+      mzx_world->output_file = fsafeopen_ext(mzx_world->output_file_name,
+       "ab", V_LARGE_BUFFER);
     else
-      mzx_world->output_file = fsafeopen(mzx_world->output_file_name, "r+b");
+      mzx_world->output_file = fsafeopen_ext(mzx_world->output_file_name,
+       "r+b", V_LARGE_BUFFER);
 
     if(mzx_world->output_file)
     {
@@ -3045,6 +3782,11 @@ static struct zip_archive *try_load_zip_world(struct world *mzx_world,
   if(v > 0 && v <= MZX_LEGACY_FORMAT_VERSION)
     goto err_close;
 
+  // Lazy loading reads boards from the archive long after it's opened, so
+  // copy it into memory in case the file is changed (e.g. saved over).
+  if(use_world_lazy_load(mzx_world))
+    vfile_force_to_memory(vf);
+
   zp = zip_open_vf_read(vf);
   if(!zp)
   {
@@ -3223,6 +3965,10 @@ void change_board(struct world *mzx_world, int board_id)
     mzx_world->temporary_board = 0;
   }
 
+  // Use the new board's prefetched data, if any, when it's retrieved.
+  board_prefetch_claim(mzx_world->board_prefetch,
+   mzx_world->board_list[board_id]);
+
   mzx_world->current_board_id = board_id;
   set_current_board_ext(mzx_world, mzx_world->board_list[board_id]);
 
@@ -3241,6 +3987,9 @@ void change_board(struct world *mzx_world, int board_id)
 
   // Load globals from the current board.
   v1_load_globals_from_board(mzx_world);
+
+  // Start loading the boards that are likely to be entered next.
+  board_prefetch_update(mzx_world->board_prefetch, mzx_world);
 }
 
 void change_board_set_values(struct world *mzx_world)
@@ -3423,6 +4172,9 @@ boolean reload_world(struct world *mzx_world, const char *file, boolean *faded)
     clear_global_data(mzx_world);
   }
 
+  // Snapshots of the previous world can't be restored anymore.
+  world_snapshots_free(mzx_world);
+
   // Always switch back to regular mode before loading the world,
   // because we want the world's intrinsic palette to be applied.
   set_screen_mode(0);
@@ -3512,6 +4264,149 @@ boolean reload_swap(struct world *mzx_world, const char *file, boolean *faded)
   return true;
 }
 
+/**
+ * Open a snapshot archive from a vfile containing it.
+ */
+static struct zip_archive *open_world_snapshot(vfile *vf, int *file_version)
+{
+  struct zip_archive *zp;
+
+  if(!read_world_header(vf, true, file_version, NULL, NULL) ||
+   *file_version != MZX_VERSION)
+  {
+    vfclose(vf);
+    return NULL;
+  }
+
+  zp = zip_open_vf_read(vf);
+  if(!zp)
+    return NULL;
+
+  world_assign_file_ids(zp, true);
+  return zp;
+}
+
+/**
+ * Save the game state to a new save file in memory (see world_snapshots).
+ * Boards that haven't been retrieved since the snapshot prev_data was taken
+ * or restored are copied from it instead of being saved again.
+ */
+int save_world_snapshot(struct world *mzx_world, void **data, size_t *size,
+ const void *prev_data, size_t prev_size)
+{
+  struct zip_archive *prev_zp = NULL;
+  size_t buffer_size = prev_size ? prev_size : 65536;
+  void *buffer = cmalloc(buffer_size);
+  uint64_t final_size = 0;
+  vfile *vf;
+  int v;
+
+  save_world_prepare(mzx_world);
+
+  if(prev_data)
+  {
+    vf = vfile_init_mem((void *)prev_data, prev_size, "rb");
+    if(vf)
+      prev_zp = open_world_snapshot(vf, &v);
+  }
+
+  vf = vfile_init_mem_ext(&buffer, &buffer_size, "wb");
+  if(!vf || save_world_zip_vf(mzx_world, vf, true, MZX_VERSION, prev_zp,
+   BOARD_RETRIEVED_SNAPSHOT, true, &final_size))
+  {
+    if(prev_zp)
+      zip_close(prev_zp, NULL);
+
+    free(buffer);
+    return -1;
+  }
+
+  if(prev_zp)
+    zip_close(prev_zp, NULL);
+
+  if(final_size < buffer_size)
+    buffer = crealloc(buffer, final_size);
+
+  world_clear_boards_retrieved(mzx_world, BOARD_RETRIEVED_SNAPSHOT);
+  *data = buffer;
+  *size = final_size;
+  return 0;
+}
+
+/**
+ * Replace the game state with a snapshot taken by save_world_snapshot. Like
+ * reload_savegame, the caller is responsible for everything else required to
+ * resume gameplay. The snapshot is loaded in place, so it must not be freed
+ * while it is open as the board archive (see world_lazy_load).
+ */
+boolean reload_world_snapshot(struct world *mzx_world, const void *data,
+ size_t size, boolean *faded)
+{
+  struct zip_archive *zp;
+  vfile *vf;
+  int version = 0;
+
+  vf = vfile_init_mem((void *)data, size, "rb");
+  if(!vf)
+    return false;
+
+  zp = open_world_snapshot(vf, &version);
+  if(!zp)
+    return false;
+
+  if(validate_world_zip(mzx_world, zp, true, &version) != VAL_SUCCESS)
+  {
+    zip_close(zp, NULL);
+    return false;
+  }
+  zip_rewind(zp);
+
+  if(mzx_world->active)
+  {
+    clear_world(mzx_world);
+    clear_global_data(mzx_world);
+  }
+
+  default_sprite_data(mzx_world);
+  default_vlayer(mzx_world);
+
+  load_world(mzx_world, zp, NULL, NULL, true, version, NULL, faded);
+  world_clear_boards_retrieved(mzx_world, BOARD_RETRIEVED_SNAPSHOT);
+  return true;
+}
+
+/**
+ * Load the rest of every deferred board and close the world archive.
+ */
+void load_deferred_boards(struct world *mzx_world)
+{
+  struct board *cur_board;
+  int i;
+
+  board_prefetch_free(mzx_world->board_prefetch);
+  mzx_world->board_prefetch = NULL;
+
+  for(i = 0; i < mzx_world->num_boards; i++)
+  {
+    cur_board = mzx_world->board_list[i];
+    if(cur_board && cur_board->deferred)
+    {
+      retrieve_board_from_extram(cur_board);
+      store_board_to_extram(cur_board);
+    }
+  }
+
+  if(mzx_world->board_archive)
+  {
+    zip_close(mzx_world->board_archive, NULL);
+    mzx_world->board_archive = NULL;
+  }
+
+  // Boards in extra RAM can still be prefetched.
+  mzx_world->board_prefetch = board_prefetch_init(NULL,
+   get_config()->world_prefetch_memory);
+}
+
 // This only clears boards, no global data. Useful for swap world,
 // when you want to maintain counters and sprites and all that.
 
@@ -3525,6 +4420,9 @@ void clear_world(struct world *mzx_world)
 
   memset(mzx_world->status_counters_shown, 0, NUM_STATUS_COUNTERS * COUNTER_NAME_SIZE);
 
+  board_prefetch_free(mzx_world->board_prefetch);
+  mzx_world->board_prefetch = NULL;
+
   for(i = 0; i < num_boards; i++)
   {
     if(mzx_world->current_board_id != i)
@@ -3539,6 +4437,15 @@ void clear_world(struct world *mzx_world)
     clear_board(mzx_world->current_board);
   }
 
+  if(mzx_world->board_archive)
+  {
+    zip_close(mzx_world->board_archive, NULL);
+    mzx_world->board_archive = NULL;
+  }
+
+  mzx_world->last_file.valid = false;
+  world_snapshots_clear(mzx_world->snapshots);
+  mzm_cache_free(mzx_world);
   mzx_world->temporary_board = 0;
   mzx_world->current_board_id = 0;
   mzx_world->current_board = NULL;
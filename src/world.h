@@ -131,7 +131,7 @@ enum mzx_version
  * such as altering semantics or actually changing the binary format, this
  * value MUST be bumped.
  */
-#define MZX_VERSION      (V293)
+#define MZX_VERSION      (V294)
 
 /* The world version that worlds will be saved as when Export Downver. World
  * is used from the editor. This function is also fulfilled by the downver util.
@@ -140,7 +140,7 @@ enum mzx_version
  * previous value; this way, users can always downgrade their work to an
  * older version (if it at all makes sense to do so).
  */
-#define MZX_VERSION_PREV (V292)
+#define MZX_VERSION_PREV (V293)
 
 // This is the last version of MegaZeux to use the legacy world format.
 #define MZX_LEGACY_FORMAT_VERSION (V284)
@@ -148,7 +148,7 @@ enum mzx_version
 // FIXME: hack
 #ifdef CONFIG_DEBYTECODE
 #undef  MZX_VERSION_PREV
-#define MZX_VERSION_PREV (V293)
+#define MZX_VERSION_PREV (V294)
 #undef  MZX_VERSION
 #define MZX_VERSION      (VERSION_SOURCE)
 #endif
@@ -173,6 +173,7 @@ CORE_LIBSPEC int save_world(struct world *mzx_world, const char *file,
 CORE_LIBSPEC boolean reload_world(struct world *mzx_world, const char *file,
  boolean *faded);
 CORE_LIBSPEC void clear_world(struct world *mzx_world);
+CORE_LIBSPEC void load_deferred_boards(struct world *mzx_world);
 CORE_LIBSPEC void clear_global_data(struct world *mzx_world);
 CORE_LIBSPEC void default_scroll_values(struct world *mzx_world);
 
@@ -183,9 +184,13 @@ CORE_LIBSPEC void change_board_load_assets(struct world *mzx_world);
 CORE_LIBSPEC void remap_vlayer(struct world *mzx_world,
  int new_width, int new_height);
 
-boolean reload_savegame(struct world *mzx_world, const char *file,
+CORE_LIBSPEC boolean reload_savegame(struct world *mzx_world, const char *file,
  boolean *faded);
 boolean reload_swap(struct world *mzx_world, const char *file, boolean *faded);
+CORE_LIBSPEC int save_world_snapshot(struct world *mzx_world, void **data,
+ size_t *size, const void *prev_data, size_t prev_size);
+CORE_LIBSPEC boolean reload_world_snapshot(struct world *mzx_world,
+ const void *data, size_t size, boolean *faded);
 
 void save_counters_file(struct world *mzx_world, const char *file);
 int load_counters_file(struct world *mzx_world, const char *file);
@@ -0,0 +1,300 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Parallel compression of files while saving worlds. Files written with
+ * zip_write_file are copied into a queue instead of being written right
+ * away, and a pool of worker threads compresses them into memory buffers
+ * (each with its own deflate stream, which is reset between files instead of
+ * being reinitialized). Whenever anything else needs to be written to the
+ * archive, or the queue is full, the main thread writes the finished files
+ * in the order they were queued, so the saved file is the same as it would
+ * be without this.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "platform.h"
+#include "util.h"
+#include "world_compress.h"
+#include "io/zip.h"
+
+#ifndef PLATFORM_NO_THREADING
+
+// Bounds on the files waiting to be written, which must all be kept in
+// memory until then.
+#define MAX_COMPRESS_JOBS 64
+#define MAX_COMPRESS_PENDING (1 << 24)
+
+struct compress_job
+{
+  struct zip_file_header fh;
+  char *name;
+  void *src;
+  void *dest;
+  boolean done;
+};
+
+struct world_compress
+{
+  platform_thread threads[MAX_WORLD_SAVE_THREADS];
+  platform_mutex lock;
+  platform_cond cond;
+  struct compress_job jobs[MAX_COMPRESS_JOBS];
+  size_t first_job;
+  size_t next_job;
+  size_t end_job;
+  size_t pending_size;
+  unsigned int num_threads;
+  boolean stop;
+};
+
+static THREAD_RES world_compress_worker(void *priv)
+{
+  struct world_compress *wc = (struct world_compress *)priv;
+  struct zip_stream_data *stream = zip_compress_stream_create(ZIP_M_DEFLATE);
+
+  platform_mutex_lock(&wc->lock);
+  while(!wc->stop)
+  {
+    struct compress_job *job;
+    void *dest = NULL;
+
+    if(wc->next_job == wc->end_job)
+    {
+      platform_cond_wait(&wc->cond, &wc->lock);
+      continue;
+    }
+    job = &wc->jobs[wc->next_job % MAX_COMPRESS_JOBS];
+    wc->next_job++;
+    platform_mutex_unlock(&wc->lock);
+
+    if(job->fh.method == ZIP_M_NONE)
+    {
+      job->fh.crc32 = crc32(0, (const Bytef *)job->src,
+       job->fh.uncompressed_size);
+    }
+    else
+
+    if(zip_compress_raw_file(stream, &job->fh, job->src, &dest) != ZIP_SUCCESS)
+      dest = NULL;
+
+    platform_mutex_lock(&wc->lock);
+    job->dest = dest;
+    job->done = true;
+    platform_cond_broadcast(&wc->cond);
+  }
+  platform_mutex_unlock(&wc->lock);
+
+  zip_compress_stream_destroy(ZIP_M_DEFLATE, stream);
+  THREAD_RETURN;
+}
+
+static boolean world_compress_queue(void *priv, const char *name,
+ const void *src, size_t src_len, int method, uint16_t flags)
+{
+  struct world_compress *wc = (struct world_compress *)priv;
+  struct compress_job *job;
+  size_t name_len = strlen(name) + 1;
+  char *name_copy;
+  void *src_copy;
+
+  // Always take at least one file, no matter how large it is.
+  if(wc->end_job - wc->first_job >= MAX_COMPRESS_JOBS ||
+   (wc->end_job != wc->first_job &&
+    wc->pending_size + src_len > MAX_COMPRESS_PENDING))
+    return false;
+
+  name_copy = (char *)malloc(name_len);
+  src_copy = malloc(src_len ? src_len : 1);
+  if(!name_copy || !src_copy)
+  {
+    free(name_copy);
+    free(src_copy);
+    return false;
+  }
+  memcpy(name_copy, name, name_len);
+  memcpy(src_copy, src, src_len);
+
+  platform_mutex_lock(&wc->lock);
+  job = &wc->jobs[wc->end_job % MAX_COMPRESS_JOBS];
+  memset(job, 0, sizeof(struct compress_job));
+  job->fh.method = method;
+  job->fh.flags = flags;
+  job->fh.uncompressed_size = src_len;
+  job->fh.compressed_size = src_len;
+  job->name = name_copy;
+  job->src = src_copy;
+  wc->end_job++;
+  wc->pending_size += src_len;
+  platform_cond_broadcast(&wc->cond);
+  platform_mutex_unlock(&wc->lock);
+  return true;
+}
+
+static void world_compress_free_job(struct world_compress *wc,
+ struct compress_job *job)
+{
+  wc->pending_size -= job->fh.uncompressed_size;
+  free(job->name);
+  free(job->src);
+  free(job->dest);
+  job->name = NULL;
+  job->src = NULL;
+  job->dest = NULL;
+}
+
+static enum zip_error world_compress_flush(void *priv, struct zip_archive *zp)
+{
+  struct world_compress *wc = (struct world_compress *)priv;
+  enum zip_error result = ZIP_SUCCESS;
+
+  while(wc->first_job != wc->end_job)
+  {
+    struct compress_job *job = &wc->jobs[wc->first_job % MAX_COMPRESS_JOBS];
+
+    platform_mutex_lock(&wc->lock);
+    while(!job->done)
+      platform_cond_wait(&wc->cond, &wc->lock);
+    platform_mutex_unlock(&wc->lock);
+
+    if(!result)
+    {
+      if(job->fh.method == ZIP_M_NONE)
+        result = zip_write_raw_file(zp, job->name, &job->fh, job->src);
+      else
+
+      if(job->dest)
+        result = zip_write_raw_file(zp, job->name, &job->fh, job->dest);
+
+      else
+      {
+        // Compression failed in the worker, so try again normally.
+        result = zip_write_file(zp, job->name, job->src,
+         job->fh.uncompressed_size, job->fh.method);
+      }
+    }
+
+    world_compress_free_job(wc, job);
+    wc->first_job++;
+  }
+  return result;
+}
+
+static const struct zip_write_compressor world_compress_spec =
+{
+  world_compress_queue,
+  world_compress_flush,
+};
+
+/**
+ * Start compressing the files written to a world archive in the background.
+ * Returns NULL if threaded compression isn't possible, in which case files
+ * are written normally.
+ */
+struct world_compress *world_compress_start(struct zip_archive *zp,
+ unsigned int num_threads)
+{
+  struct world_compress *wc;
+  unsigned int i;
+
+  if(!num_threads || !zp)
+    return NULL;
+
+  wc = (struct world_compress *)ccalloc(1, sizeof(struct world_compress));
+
+  if(!platform_mutex_init(&wc->lock))
+    goto err_free;
+
+  if(!platform_cond_init(&wc->cond))
+    goto err_destroy_mutex;
+
+  num_threads = MIN(num_threads, MAX_WORLD_SAVE_THREADS);
+  for(i = 0; i < num_threads; i++)
+  {
+    if(!platform_thread_create(&wc->threads[i], world_compress_worker, wc))
+      break;
+    wc->num_threads++;
+  }
+
+  if(!wc->num_threads)
+    goto err_destroy_cond;
+
+  zip_set_write_compressor(zp, &world_compress_spec, wc);
+  return wc;
+
+err_destroy_cond:
+  platform_cond_destroy(&wc->cond);
+err_destroy_mutex:
+  platform_mutex_destroy(&wc->lock);
+err_free:
+  free(wc);
+  return NULL;
+}
+
+/**
+ * Write any remaining files to the archive, then stop all workers. Returns
+ * the result of writing the remaining files.
+ */
+enum zip_error world_compress_stop(struct world_compress *wc,
+ struct zip_archive *zp)
+{
+  enum zip_error result;
+  size_t i;
+
+  if(!wc)
+    return ZIP_SUCCESS;
+
+  result = zip_set_write_compressor(zp, NULL, NULL);
+
+  platform_mutex_lock(&wc->lock);
+  wc->stop = true;
+  platform_cond_broadcast(&wc->cond);
+  platform_mutex_unlock(&wc->lock);
+
+  for(i = 0; i < wc->num_threads; i++)
+    platform_thread_join(&wc->threads[i]);
+
+  // These should only be left over if writing failed.
+  for(i = wc->first_job; i < wc->end_job; i++)
+    world_compress_free_job(wc, &wc->jobs[i % MAX_COMPRESS_JOBS]);
+
+  platform_cond_destroy(&wc->cond);
+  platform_mutex_destroy(&wc->lock);
+  free(wc);
+  return result;
+}
+
+#else /* PLATFORM_NO_THREADING */
+
+struct world_compress *world_compress_start(struct zip_archive *zp,
+ unsigned int num_threads)
+{
+  return NULL;
+}
+
+enum zip_error world_compress_stop(struct world_compress *wc,
+ struct zip_archive *zp)
+{
+  return ZIP_SUCCESS;
+}
+
+#endif /* PLATFORM_NO_THREADING */
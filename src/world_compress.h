@@ -0,0 +1,41 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __WORLD_COMPRESS_H
+#define __WORLD_COMPRESS_H
+
+#include "compat.h"
+
+__M_BEGIN_DECLS
+
+#include "io/zip.h"
+
+// Upper bound for the "world_save_threads" config option.
+#define MAX_WORLD_SAVE_THREADS 16
+
+struct world_compress;
+
+struct world_compress *world_compress_start(struct zip_archive *zp,
+ unsigned int num_threads);
+enum zip_error world_compress_stop(struct world_compress *wc,
+ struct zip_archive *zp);
+
+__M_END_DECLS
+
+#endif /* __WORLD_COMPRESS_H */
@@ -0,0 +1,326 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Parallel decompression of board files during world loads. The main thread
+ * finds the compressed data of every board file in the archive up front, and
+ * a pool of worker threads inflates them in archive order. Before loading
+ * each board, the main thread waits for that board's files and attaches the
+ * decompressed data to the archive, so the board loaders (and all validation
+ * and error reporting) run on the main thread exactly as they would without
+ * this. Files that fail to decompress in a worker are simply left alone to
+ * be decompressed (and reported) normally.
+ *
+ * This requires a memory archive, which is usually the case for worlds
+ * since zip_open_vf_read maps files into memory if possible.
+ */
+
+#include <stdlib.h>
+
+#include "const.h"
+#include "legacy_rasm.h"
+#include "platform.h"
+#include "robot.h"
+#include "util.h"
+#include "world_decompress.h"
+#include "world_format.h"
+#include "io/memfile.h"
+#include "io/zip.h"
+
+#ifndef PLATFORM_NO_THREADING
+
+#define MAX_DECOMPRESS_THREADS 16
+
+// Workers may not start files for boards further than this past the board
+// currently being loaded, which bounds the memory used by finished files.
+#define DECOMPRESS_LOOKAHEAD 8
+
+// Bound on the total size of the files workers have started that haven't
+// been attached yet. The sizes come from the archive, so they can't be
+// trusted to be reasonable on their own.
+#define MAX_DECOMPRESS_PENDING (1 << 25)
+
+struct decompress_job
+{
+  const struct zip_file_header *fh;
+  const void *src;
+  void *dest;
+  size_t pos;
+  unsigned int board_id;
+  boolean done;
+};
+
+struct world_decompress
+{
+  platform_thread threads[MAX_DECOMPRESS_THREADS];
+  platform_mutex lock;
+  platform_cond cond;
+  struct decompress_job *jobs;
+  size_t num_jobs;
+  size_t next_job;
+  size_t next_attach;
+  size_t pending_size;
+  unsigned int num_threads;
+  unsigned int window_board;
+  boolean stop;
+};
+
+static boolean is_board_file(const struct zip_file_header *fh)
+{
+  switch(fh->mzx_file_id)
+  {
+    case FILE_ID_BOARD_INFO:
+    case FILE_ID_BOARD_BID:
+    case FILE_ID_BOARD_BPR:
+    case FILE_ID_BOARD_BCO:
+    case FILE_ID_BOARD_UID:
+    case FILE_ID_BOARD_UPR:
+    case FILE_ID_BOARD_UCO:
+    case FILE_ID_BOARD_OCH:
+    case FILE_ID_BOARD_OCO:
+    case FILE_ID_ROBOT:
+    case FILE_ID_SCROLL:
+    case FILE_ID_SENSOR:
+      return true;
+  }
+  return false;
+}
+
+/**
+ * Get the largest size a valid board file of a given type can have. Files
+ * claiming to be larger than this are left to the regular loader.
+ */
+static size_t max_board_file_size(const struct zip_file_header *fh)
+{
+  switch(fh->mzx_file_id)
+  {
+    case FILE_ID_BOARD_INFO:
+      return BOARD_PROPS_SIZE + BOARD_SAVE_PROPS_SIZE;
+
+    case FILE_ID_ROBOT:
+      return ROBOT_PROPS_SIZE + ROBOT_SAVE_PROPS_SIZE + ROBOT_NAME_SIZE +
+       MAX_OBJ_SIZE + 4 * ROBOT_MAX_STACK;
+
+    case FILE_ID_SCROLL:
+      return SCROLL_PROPS_SIZE + MAX_OBJ_SIZE;
+
+    case FILE_ID_SENSOR:
+      return SENSOR_PROPS_SIZE;
+  }
+  return MAX_BOARD_SIZE;
+}
+
+static THREAD_RES world_decompress_worker(void *priv)
+{
+  struct world_decompress *wd = (struct world_decompress *)priv;
+
+  platform_mutex_lock(&wd->lock);
+  while(!wd->stop && wd->next_job < wd->num_jobs)
+  {
+    struct decompress_job *job = &wd->jobs[wd->next_job];
+    size_t size = job->fh->uncompressed_size;
+    void *dest;
+
+    // Always allow one file, no matter how large it is.
+    if(job->board_id > wd->window_board ||
+     (wd->pending_size && wd->pending_size + size > MAX_DECOMPRESS_PENDING))
+    {
+      platform_cond_wait(&wd->cond, &wd->lock);
+      continue;
+    }
+    wd->pending_size += size;
+    wd->next_job++;
+    platform_mutex_unlock(&wd->lock);
+
+    dest = malloc(size);
+    if(dest && zip_decompress_raw_file(job->fh, job->src, dest) != ZIP_SUCCESS)
+    {
+      free(dest);
+      dest = NULL;
+    }
+
+    platform_mutex_lock(&wd->lock);
+    job->dest = dest;
+    job->done = true;
+    platform_cond_broadcast(&wd->cond);
+  }
+  platform_mutex_unlock(&wd->lock);
+
+  THREAD_RETURN;
+}
+
+/**
+ * Start decompressing the board files of a world archive in the background.
+ * The file IDs of the archive must already be assigned. Returns NULL if
+ * threaded decompression isn't possible or useful for this archive, in which
+ * case the world should be loaded normally.
+ */
+struct world_decompress *world_decompress_start(struct zip_archive *zp,
+ unsigned int num_threads)
+{
+  struct world_decompress *wd;
+  struct memfile mf;
+  size_t pos = zp->pos;
+  size_t i;
+
+  if(!num_threads || !zp->is_memory)
+    return NULL;
+
+  wd = (struct world_decompress *)ccalloc(1, sizeof(struct world_decompress));
+  wd->jobs = (struct decompress_job *)ccalloc(zp->num_files,
+   sizeof(struct decompress_job));
+
+  // Find the compressed data for each board file. Stored files are already
+  // read directly from memory, so don't bother with them.
+  for(i = 0; i < zp->num_files; i++)
+  {
+    struct zip_file_header *fh = zp->files[i];
+    struct decompress_job *job = &wd->jobs[wd->num_jobs];
+
+    if(!is_board_file(fh) || fh->method != ZIP_M_DEFLATE ||
+     !fh->uncompressed_size || fh->compressed_size > UINT32_MAX ||
+     fh->uncompressed_size > max_board_file_size(fh))
+      continue;
+
+    zp->pos = i;
+    if(zip_get_next_raw_file(zp, &mf) != ZIP_SUCCESS)
+      continue;
+
+    job->fh = fh;
+    job->src = mf.start;
+    job->pos = i;
+    job->board_id = fh->mzx_board_id;
+    wd->num_jobs++;
+  }
+  zp->pos = pos;
+
+  if(!wd->num_jobs)
+    goto err_free;
+
+  if(!platform_mutex_init(&wd->lock))
+    goto err_free;
+
+  if(!platform_cond_init(&wd->cond))
+    goto err_destroy_mutex;
+
+  wd->window_board = DECOMPRESS_LOOKAHEAD;
+  num_threads = MIN(num_threads, MAX_DECOMPRESS_THREADS);
+  for(i = 0; i < num_threads; i++)
+  {
+    if(!platform_thread_create(&wd->threads[i], world_decompress_worker, wd))
+      break;
+    wd->num_threads++;
+  }
+
+  if(!wd->num_threads)
+    goto err_destroy_cond;
+
+  return wd;
+
+err_destroy_cond:
+  platform_cond_destroy(&wd->cond);
+err_destroy_mutex:
+  platform_mutex_destroy(&wd->lock);
+err_free:
+  free(wd->jobs);
+  free(wd);
+  return NULL;
+}
+
+/**
+ * Wait for the board files of a board to finish decompressing and attach them
+ * to the archive. This should be called right before the board is loaded.
+ * Boards must be requested in archive order; finished files for boards
+ * skipped along the way are discarded.
+ */
+void world_decompress_board(struct world_decompress *wd,
+ struct zip_archive *zp, unsigned int board_id)
+{
+  if(!wd)
+    return;
+
+  platform_mutex_lock(&wd->lock);
+  wd->window_board = board_id + DECOMPRESS_LOOKAHEAD;
+  platform_cond_broadcast(&wd->cond);
+
+  while(wd->next_attach < wd->num_jobs)
+  {
+    struct decompress_job *job = &wd->jobs[wd->next_attach];
+    if(job->board_id > board_id)
+      break;
+
+    while(!job->done)
+      platform_cond_wait(&wd->cond, &wd->lock);
+
+    if(job->dest && job->board_id == board_id)
+      zip_set_decompressed_file(zp, job->pos, job->dest);
+    else
+      free(job->dest);
+
+    job->dest = NULL;
+    wd->next_attach++;
+
+    // Let workers waiting on the memory bound continue.
+    wd->pending_size -= job->fh->uncompressed_size;
+    platform_cond_broadcast(&wd->cond);
+  }
+  platform_mutex_unlock(&wd->lock);
+}
+
+/**
+ * Stop all workers and free any files that were never attached.
+ */
+void world_decompress_stop(struct world_decompress *wd)
+{
+  size_t i;
+
+  if(!wd)
+    return;
+
+  platform_mutex_lock(&wd->lock);
+  wd->stop = true;
+  platform_cond_broadcast(&wd->cond);
+  platform_mutex_unlock(&wd->lock);
+
+  for(i = 0; i < wd->num_threads; i++)
+    platform_thread_join(&wd->threads[i]);
+
+  for(i = 0; i < wd->num_jobs; i++)
+    free(wd->jobs[i].dest);
+
+  platform_cond_destroy(&wd->cond);
+  platform_mutex_destroy(&wd->lock);
+  free(wd->jobs);
+  free(wd);
+}
+
+#else /* PLATFORM_NO_THREADING */
+
+struct world_decompress *world_decompress_start(struct zip_archive *zp,
+ unsigned int num_threads)
+{
+  return NULL;
+}
+
+void world_decompress_board(struct world_decompress *wd,
+ struct zip_archive *zp, unsigned int board_id) {}
+
+void world_decompress_stop(struct world_decompress *wd) {}
+
+#endif /* PLATFORM_NO_THREADING */
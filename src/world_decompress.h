@@ -0,0 +1,38 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __WORLD_DECOMPRESS_H
+#define __WORLD_DECOMPRESS_H
+
+#include "compat.h"
+
+__M_BEGIN_DECLS
+
+struct zip_archive;
+struct world_decompress;
+
+struct world_decompress *world_decompress_start(struct zip_archive *zp,
+ unsigned int num_threads);
+void world_decompress_board(struct world_decompress *wd,
+ struct zip_archive *zp, unsigned int board_id);
+void world_decompress_stop(struct world_decompress *wd);
+
+__M_END_DECLS
+
+#endif /* __WORLD_DECOMPRESS_H */
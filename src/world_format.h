@@ -53,6 +53,9 @@ enum world_file_id
   FILE_ID_WORLD_SPRITES           = 0x0080, // properties file
   FILE_ID_WORLD_COUNTERS          = 0x0081, // counter format, use stream
   FILE_ID_WORLD_STRINGS           = 0x0082, // string format, use stream
+  FILE_ID_WORLD_COUNTERS_BULK     = 0x0083, // bulk counter format
+  FILE_ID_WORLD_STRINGS_BULK      = 0x0084, // bulk string format, use stream
+  FILE_ID_WORLD_COUNTER_ARRAYS    = 0x0085, // counter array format
 
   FILE_ID_BOARD_INFO              = 0x0100, // properties file (board_id)
   FILE_ID_BOARD_BID               = 0x0101, // data
@@ -770,6 +773,15 @@ static inline void world_assign_file_ids(struct zip_archive *zp, boolean is_a_wo
         case FILE_ID_6('s','t','r','i','n','g'):
           file_id = FILE_ID_WORLD_STRINGS;
           break;
+        case FILE_ID_7('c','t','r','b','u','l','k'):
+          file_id = FILE_ID_WORLD_COUNTERS_BULK;
+          break;
+        case FILE_ID_7('s','t','r','b','u','l','k'):
+          file_id = FILE_ID_WORLD_STRINGS_BULK;
+          break;
+        case FILE_ID_6('c','t','r','a','r','r'):
+          file_id = FILE_ID_WORLD_COUNTER_ARRAYS;
+          break;
       }
 
       // Set the properties
@@ -779,8 +791,10 @@ static inline void world_assign_file_ids(struct zip_archive *zp, boolean is_a_wo
     }
   }
 
-  // Sort the archive and reset to the beginning
+  // Sort the archive and reset to the beginning. Any existing index of the
+  // archive is now out of date.
   qsort(fh_list, num_fh, sizeof(struct zip_file_header *), world_file_id_cmp);
+  zip_clear_index(zp);
   zp->pos = 0;
 }
 
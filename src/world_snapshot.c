@@ -0,0 +1,215 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * In-memory snapshots of the game state for quick saving, quick loading, and
+ * rewinding. Each snapshot is a complete save file written to memory without
+ * compression, and restoring one goes through the normal world loader, so
+ * these cost about as much as saving and loading an uncompressed savegame.
+ * The snapshots don't share any data with each other or with the world.
+ * Boards that haven't been retrieved since the previous snapshot was taken or
+ * restored (the base snapshot) are copied from it as-is instead of being
+ * serialized again, and restoring a snapshot with world_lazy_load enabled
+ * defers loading boards until they are used.
+ *
+ * Restored snapshots are loaded in place, so a snapshot that is still open
+ * as the world's board archive has to be loaded in full before it is freed.
+ *
+ * The snapshots are kept in a ring of world_snapshots entries. Taking a
+ * snapshot replaces the oldest snapshot once the ring is full.
+ */
+
+#include <stdlib.h>
+
+#include "configure.h"
+#include "util.h"
+#include "world.h"
+#include "world_snapshot.h"
+#include "world_struct.h"
+
+struct world_snapshot
+{
+  void *data;
+  size_t size;
+};
+
+struct world_snapshots
+{
+  struct world_snapshot *slots;
+  unsigned int num_slots;
+  unsigned int count;
+  unsigned int newest;
+
+  // Age of the snapshot that boards that haven't been retrieved match, or -1
+  // if none.
+  int base;
+
+  // Age of the snapshot most recently taken or restored.
+  unsigned int current;
+
+  // Data of the snapshot the board archive was opened from, if any.
+  const void *archive_data;
+};
+
+static struct world_snapshot *world_snapshot_get(struct world_snapshots *ws,
+ unsigned int age)
+{
+  if(age >= ws->count)
+    return NULL;
+
+  return &ws->slots[(ws->newest + ws->num_slots - age) % ws->num_slots];
+}
+
+/**
+ * Make sure the board archive isn't using a snapshot before it is freed.
+ */
+static void world_snapshot_release(struct world *mzx_world,
+ struct world_snapshot *s)
+{
+  struct world_snapshots *ws = mzx_world->snapshots;
+
+  if(s->data && s->data == ws->archive_data)
+  {
+    if(mzx_world->board_archive)
+      load_deferred_boards(mzx_world);
+
+    ws->archive_data = NULL;
+  }
+}
+
+/**
+ * Take a snapshot of the current game state and add it to the ring. Returns
+ * false if snapshots are disabled or the snapshot couldn't be taken.
+ */
+boolean world_snapshot_take(struct world *mzx_world)
+{
+  struct world_snapshots *ws = mzx_world->snapshots;
+  struct world_snapshot *prev = NULL;
+  struct world_snapshot *dest;
+  unsigned int num_slots = get_config()->world_snapshots;
+  void *data;
+  size_t size;
+
+  if(!num_slots)
+    return false;
+
+  if(!ws)
+  {
+    ws = (struct world_snapshots *)ccalloc(1, sizeof(struct world_snapshots));
+    ws->slots = (struct world_snapshot *)ccalloc(num_slots,
+     sizeof(struct world_snapshot));
+    ws->num_slots = num_slots;
+    ws->newest = num_slots - 1;
+    ws->base = -1;
+    mzx_world->snapshots = ws;
+  }
+
+  if(ws->base >= 0)
+    prev = world_snapshot_get(ws, ws->base);
+
+  if(save_world_snapshot(mzx_world, &data, &size,
+   prev ? prev->data : NULL, prev ? prev->size : 0))
+  {
+    // Boards that haven't been retrieved may not match the base snapshot
+    // anymore.
+    ws->base = -1;
+    return false;
+  }
+
+  ws->newest = (ws->newest + 1) % ws->num_slots;
+  dest = &ws->slots[ws->newest];
+  world_snapshot_release(mzx_world, dest);
+  free(dest->data);
+  dest->data = data;
+  dest->size = size;
+
+  if(ws->count < ws->num_slots)
+    ws->count++;
+
+  ws->base = 0;
+  ws->current = 0;
+  return true;
+}
+
+/**
+ * Restore a snapshot relative to the snapshot most recently taken or restored.
+ * An offset of 0 restores that snapshot again (quick load), and positive
+ * offsets restore older snapshots (rewind). If the offset goes past the end of
+ * the ring, the closest snapshot is used instead. Returns false if there are
+ * no snapshots or the snapshot couldn't be restored.
+ */
+boolean world_snapshot_restore(struct world *mzx_world, int offset,
+ boolean *faded)
+{
+  struct world_snapshots *ws = mzx_world->snapshots;
+  struct world_snapshot *src;
+  int age;
+
+  if(!ws || !ws->count)
+    return false;
+
+  age = CLAMP((int)ws->current + offset, 0, (int)ws->count - 1);
+  src = world_snapshot_get(ws, age);
+
+  if(!reload_world_snapshot(mzx_world, src->data, src->size, faded))
+  {
+    ws->base = -1;
+    return false;
+  }
+
+  ws->base = age;
+  ws->current = age;
+  ws->archive_data = src->data;
+  return true;
+}
+
+/**
+ * The world was cleared, so its boards don't match the base snapshot anymore
+ * and its board archive was closed.
+ */
+void world_snapshots_clear(struct world_snapshots *ws)
+{
+  if(ws)
+  {
+    ws->base = -1;
+    ws->archive_data = NULL;
+  }
+}
+
+/**
+ * Free every snapshot. This should be done when a new world is loaded.
+ */
+void world_snapshots_free(struct world *mzx_world)
+{
+  struct world_snapshots *ws = mzx_world->snapshots;
+  unsigned int i;
+
+  if(!ws)
+    return;
+
+  for(i = 0; i < ws->num_slots; i++)
+  {
+    world_snapshot_release(mzx_world, &ws->slots[i]);
+    free(ws->slots[i].data);
+  }
+
+  free(ws->slots);
+  free(ws);
+  mzx_world->snapshots = NULL;
+}
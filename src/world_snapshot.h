@@ -0,0 +1,38 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef __WORLD_SNAPSHOT_H
+#define __WORLD_SNAPSHOT_H
+
+#include "compat.h"
+
+__M_BEGIN_DECLS
+
+struct world;
+struct world_snapshots;
+
+CORE_LIBSPEC boolean world_snapshot_take(struct world *mzx_world);
+CORE_LIBSPEC boolean world_snapshot_restore(struct world *mzx_world,
+ int offset, boolean *faded);
+void world_snapshots_clear(struct world_snapshots *ws);
+CORE_LIBSPEC void world_snapshots_free(struct world *mzx_world);
+
+__M_END_DECLS
+
+#endif /* __WORLD_SNAPSHOT_H */
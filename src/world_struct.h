@@ -27,6 +27,7 @@ __M_BEGIN_DECLS
 #include <stdio.h>
 #include <stdint.h>
 #include <time.h>
+#include <sys/types.h>
 
 #include "board_struct.h"
 #include "robot_struct.h"
@@ -38,6 +39,11 @@ __M_BEGIN_DECLS
 
 #define COMMAND_CACHE_CURRENT_TIME (1 << 0)
 
+struct zip_archive;
+struct board_prefetch;
+struct world_snapshots;
+struct mzm_cache;
+
 enum change_game_state_value
 {
   CHANGE_STATE_NONE,
@@ -58,6 +64,22 @@ enum fwrite_mode
   FWRITE_MODE_MAX
 };
 
+// The world or save file that was last loaded or saved. If the file hasn't
+// been modified since, boards that haven't been retrieved since can be
+// copied from it. The path is a full path so it can be matched against the
+// file being saved regardless of the current directory.
+struct world_file_record
+{
+  boolean valid;
+  boolean savegame;
+  int file_version;
+  int64_t size;
+  time_t mtime;
+  dev_t dev;
+  ino_t ino;
+  char path[MAX_PATH];
+};
+
 struct world
 {
   // 0 if a world has been loaded, 1 if it hasn't
@@ -157,6 +179,17 @@ struct world
   int current_board_id;
   int temporary_board;
 
+  // World archive that deferred boards are loaded from (see world_lazy_load).
+  struct zip_archive *board_archive;
+  struct board_prefetch *board_prefetch;
+  struct world_file_record last_file;
+
+  // Quick save and rewind snapshots (see world_snapshots).
+  struct world_snapshots *snapshots;
+
+  // Decoded MZM files (see mzm_cache_memory).
+  struct mzm_cache *mzm_cache;
+
   struct robot global_robot;
 
   struct sfx_list custom_sfx;
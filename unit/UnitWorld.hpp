@@ -0,0 +1,121 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef UNIT_WORLD_HPP
+#define UNIT_WORLD_HPP
+
+/**
+ * Helper for tests that need a complete world loaded from the test worlds.
+ * These tests require a modular build.
+ */
+
+#include "Unit.hpp"
+
+#include "../src/configure.h"
+#include "../src/counter.h"
+#include "../src/graphics.h"
+#include "../src/world.h"
+#include "../src/world_snapshot.h"
+#include "../src/world_struct.h"
+
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace unit
+{
+  /**
+   * Load a test world. Loading changes the current directory to the world's
+   * directory, so paths to other files need to be absolute (see `path`).
+   * Video isn't initialized, so anything loading does with the renderer is
+   * ignored.
+   */
+  class world final
+  {
+    char cwd[MAX_PATH];
+    std::vector<std::string> temp_files;
+
+    static void update_colors(struct graphics_data *graphics,
+     struct rgb_color *palette, unsigned int count) {}
+
+  public:
+    struct ::world *mzx_world;
+
+    world()
+    {
+      if(!getcwd(cwd, MAX_PATH))
+        FAIL("getcwd");
+
+      // The function counter lookup table is normally built by main().
+      counter_fsg();
+      default_config();
+      graphics.renderer.update_colors = update_colors;
+      mzx_world = (struct ::world *)calloc(1, sizeof(struct ::world));
+    }
+
+    ~world()
+    {
+      if(mzx_world->active)
+      {
+        clear_world(mzx_world);
+        clear_global_data(mzx_world);
+      }
+      world_snapshots_free(mzx_world);
+      free(mzx_world->update_done);
+      free(mzx_world);
+
+      if(chdir(cwd))
+        perror("chdir");
+      for(const std::string &file : temp_files)
+        unlink(file.c_str());
+      free_config();
+    }
+
+    /**
+     * Load a world relative to the test's directory.
+     */
+    boolean load(const char *file)
+    {
+      char tmp[MAX_PATH];
+      boolean faded;
+      path(tmp, file);
+      return reload_world(mzx_world, tmp, &faded);
+    }
+
+    /**
+     * Get the full path of a file relative to the test's directory.
+     */
+    void path(char *dest, const char *file)
+    {
+      snprintf(dest, MAX_PATH, "%s/%s", cwd, file);
+    }
+
+    /**
+     * Like `path`, but the file will be deleted when the test finishes.
+     */
+    void temp_path(char *dest, const char *file)
+    {
+      path(dest, file);
+      temp_files.push_back(dest);
+    }
+  };
+}
+
+#endif /* UNIT_WORLD_HPP */
@@ -0,0 +1,150 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "Unit.hpp"
+
+#include "../src/arena.c"
+
+UNITTEST(arena_alloc)
+{
+  struct arena a{};
+  char *ptrs[10000];
+  size_t i;
+
+  for(i = 0; i < (size_t)arraysize(ptrs); i++)
+  {
+    size_t size = 1 + (i % 61);
+    ptrs[i] = (char *)arena_alloc(&a, size);
+    ASSERT(ptrs[i], "%zu", i);
+    ASSERTEQ((size_t)ptrs[i] & (ARENA_ALIGN - 1), 0, "%zu", i);
+    memset(ptrs[i], i & 0xff, size);
+  }
+
+  for(i = 0; i < (size_t)arraysize(ptrs); i++)
+  {
+    size_t size = 1 + (i % 61);
+    size_t j;
+    for(j = 0; j < size; j++)
+      ASSERTEQ((uint8_t)ptrs[i][j], i & 0xff, "%zu", i);
+  }
+
+  ASSERT(a.blocks, "");
+  ASSERT(a.total_size >= 10000 * 8, "%zu", a.total_size);
+
+  // Allocations larger than a block get their own block.
+  ASSERT(arena_alloc(&a, ARENA_BLOCK_SIZE * 2), "");
+
+  arena_clear(&a);
+  ASSERTEQ(a.blocks, nullptr, "");
+  ASSERTEQ(a.total_size, 0, "");
+}
+
+UNITTEST(arena_pool)
+{
+  struct arena a{};
+
+  SECTION(classes)
+  {
+    static const size_t sizes[][2] =
+    {
+      { 1, 16 },
+      { 16, 16 },
+      { 17, 32 },
+      { 255, 256 },
+      { 256, 256 },
+      { 4095, 4096 },
+      { 4096, 4096 },
+    };
+
+    for(const size_t (&s)[2] : sizes)
+      ASSERTEQ(arena_class_size(arena_class(s[0])), s[1], "%zu", s[0]);
+  }
+
+  SECTION(reuse)
+  {
+    void *p1 = arena_pool_alloc(&a, 100);
+    void *p2 = arena_pool_alloc(&a, 100);
+    ASSERT(p1 && p2 && p1 != p2, "");
+
+    arena_pool_free(&a, p1, 100);
+    ASSERTEQ(arena_pool_alloc(&a, 120), p1, "same class should be reused");
+    arena_pool_free(&a, p2, 100);
+    ASSERT(arena_pool_alloc(&a, 50) != p2, "different class");
+  }
+
+  SECTION(realloc)
+  {
+    char *p = (char *)arena_pool_alloc(&a, 20);
+    char *q;
+    size_t i;
+
+    memcpy(p, "abcdefghijklmnopqrst", 20);
+
+    // Same class: not moved.
+    ASSERTEQ(arena_pool_realloc(&a, p, 20, 32), p, "");
+
+    // Larger class: moved and copied.
+    q = (char *)arena_pool_realloc(&a, p, 32, 1000);
+    ASSERT(q && q != p, "");
+    ASSERTMEM(q, "abcdefghijklmnopqrst", 20, "");
+
+    // Large allocations.
+    p = (char *)arena_pool_realloc(&a, q, 1000, 100000);
+    ASSERT(p, "");
+    ASSERTMEM(p, "abcdefghijklmnopqrst", 20, "");
+    ASSERT(a.large, "");
+    for(i = 20; i < 100000; i++)
+      p[i] = i;
+
+    p = (char *)arena_pool_realloc(&a, p, 100000, 200000);
+    ASSERT(p, "");
+    ASSERTMEM(p, "abcdefghijklmnopqrst", 20, "");
+    for(i = 20; i < 100000; i++)
+      ASSERTEQ((uint8_t)p[i], i & 0xff, "%zu", i);
+
+    q = (char *)arena_pool_realloc(&a, p, 200000, 10);
+    ASSERT(q, "");
+    ASSERTMEM(q, "abcdefghij", 10, "");
+    ASSERTEQ(a.large, nullptr, "");
+  }
+
+  SECTION(large)
+  {
+    void *l[8];
+    size_t total;
+    size_t i;
+
+    for(i = 0; i < (size_t)arraysize(l); i++)
+    {
+      l[i] = arena_pool_alloc(&a, 10000 + i);
+      ASSERT(l[i], "%zu", i);
+    }
+    total = a.total_size;
+
+    arena_pool_free(&a, l[3], 10003);
+    arena_pool_free(&a, l[7], 10007);
+    arena_pool_free(&a, l[0], 10000);
+    ASSERTEQ(a.total_size, total - 3 * ARENA_LARGE_HEADER - 30010, "");
+  }
+
+  arena_clear(&a);
+  ASSERTEQ(a.blocks, nullptr, "");
+  ASSERTEQ(a.large, nullptr, "");
+  ASSERTEQ(a.total_size, 0, "");
+}
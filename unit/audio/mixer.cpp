@@ -29,6 +29,9 @@
 
 #define DATA_BASE_DIR "../mixer"
 
+#define PROLOGUE_SAMPLES (PROLOGUE_FRAMES * STEREO)
+#define EPILOGUE_SAMPLES (EPILOGUE_FRAMES * STEREO)
+
 void destruct_audio_stream(struct audio_stream *a_src)
 {
   // nop to shut up linker
@@ -70,15 +73,15 @@ public:
 
     std::vector<uint8_t> in = unit::io::load(path);
     input_frames = in.size() / (SRC_CHANNELS * 2);
-    input.resize(input_frames * SRC_CHANNELS + PROLOGUE_LENGTH + EPILOGUE_LENGTH);
+    input.resize(input_frames * SRC_CHANNELS + PROLOGUE_SAMPLES + EPILOGUE_SAMPLES);
 
     size_t i, j;
-    for(i = 0, j = PROLOGUE_LENGTH; i < in.size(); i += 2, j++)
+    for(i = 0, j = PROLOGUE_SAMPLES; i < in.size(); i += 2, j++)
       input[j] = static_cast<int16_t>(unit::io::read16le(in, i));
 
-    for(j = 0; j < PROLOGUE_LENGTH; j++)
+    for(j = 0; j < PROLOGUE_SAMPLES; j++)
       input[j] = 0;
-    for(j = 0; j < EPILOGUE_LENGTH; j++)
+    for(j = 0; j < EPILOGUE_SAMPLES; j++)
       input[input.size() - j - 1] = 0;
 
     did_init = true;
@@ -93,7 +96,7 @@ public:
   const int16_t *start() const
   {
     ASSERT(did_init, "run init() before calling start()");
-    return input.data() + PROLOGUE_LENGTH;
+    return input.data() + PROLOGUE_SAMPLES;
   }
 
   size_t frames() const
@@ -374,3 +377,94 @@ UNITTEST(Cubic)
 {
   GENERATE_SECTIONS(resample_full, resample_dynamic, CUBIC);
 }
+
+/**
+ * The float mixer functions should render the same output as the integer
+ * mixer functions (give or take rounding) for the same input converted to
+ * float samples. These are tested against the integer mixer instead of the
+ * expected output files since the rounding differs.
+ */
+template<mixer_channels DEST_CHANNELS, mixer_channels SRC_CHANNELS,
+ mixer_volume VOLUME, mixer_resample RESAMPLE, int N>
+static void test_float(const mixer_input<SRC_CHANNELS> &input,
+ const sequence (&seq)[N])
+{
+  const std::vector<int16_t> &in = input.get();
+  std::vector<float> in_float(in.size());
+  struct sampled_stream strm{};
+
+  for(size_t i = 0; i < in.size(); i++)
+    in_float[i] = in[i] / 32768.0f;
+
+  strm.channels = SRC_CHANNELS;
+  strm.dest_channels = DEST_CHANNELS;
+
+  for(const sequence &s : seq)
+  {
+    size_t dest_frames = static_cast<size_t>(ceil(input.frames() / s.delta));
+    std::vector<int32_t> dest(dest_frames * DEST_CHANNELS);
+    std::vector<float> dest_float(dest_frames * DEST_CHANNELS);
+
+    strm.frequency_delta = static_cast<int64_t>((1 << FP_SHIFT) * s.delta);
+
+    strm.sample_index = 0;
+    mixer_function<DEST_CHANNELS, SRC_CHANNELS, VOLUME>(&strm, dest.data(),
+     dest_frames, input.start(), s.volume, RESAMPLE);
+
+    strm.sample_index = 0;
+    mixer_function<DEST_CHANNELS, SRC_CHANNELS, VOLUME>(&strm,
+     dest_float.data(), dest_frames, in_float.data() + PROLOGUE_SAMPLES,
+     s.volume, RESAMPLE);
+
+    for(size_t i = 0; i < dest.size(); i++)
+    {
+      int32_t smpl = static_cast<int32_t>(lrintf(dest_float[i] * 32768.0f));
+      int diff = smpl - dest[i];
+      ASSERT(diff >= -2 && diff <= 2, "data mismatch @ %zu: %d != %d",
+       i, smpl, dest[i]);
+    }
+  }
+}
+
+#define GENERATE_FLOAT_SECTIONS(seq, resample) \
+do { \
+  mono.init(); \
+  stereo.init(); \
+  \
+  SECTION(MonoToMono)                                           \
+  {                                                             \
+    test_float<MONO, MONO, DYNAMIC, resample>(mono, seq);       \
+  }                                                             \
+  SECTION(MonoToStereo)                                         \
+  {                                                             \
+    test_float<STEREO, MONO, DYNAMIC, resample>(mono, seq);     \
+  }                                                             \
+  SECTION(StereoToMono)                                         \
+  {                                                             \
+    test_float<MONO, STEREO, DYNAMIC, resample>(stereo, seq);   \
+  }                                                             \
+  SECTION(StereoToStereo)                                       \
+  {                                                             \
+    test_float<STEREO, STEREO, DYNAMIC, resample>(stereo, seq); \
+  }                                                             \
+} while(0)
+
+UNITTEST(FloatFlat)
+{
+  GENERATE_FLOAT_SECTIONS(flat_dynamic, FLAT);
+}
+
+UNITTEST(FloatNearest)
+{
+  GENERATE_FLOAT_SECTIONS(resample_dynamic, NEAREST);
+}
+
+UNITTEST(FloatLinear)
+{
+  GENERATE_FLOAT_SECTIONS(resample_dynamic, LINEAR);
+}
+
+UNITTEST(FloatCubic)
+{
+  GENERATE_FLOAT_SECTIONS(resample_dynamic, CUBIC);
+}
@@ -560,11 +560,31 @@ UNITTEST(Settings)
     TEST_INT("audio_buffer_samples", conf->audio_buffer_samples, 1, INT_MAX);
   }
 
+  SECTION(audio_offline)
+  {
+    TEST_ENUM("audio_offline", conf->audio_offline, boolean_data);
+  }
+
+  SECTION(audio_offline_file)
+  {
+    TEST_STRING("audio_offline_file", conf->audio_offline_file, string_data);
+  }
+
   SECTION(audio_output_channels)
   {
     TEST_INT("audio_output_channels", conf->audio_output_channels, 1, 2);
   }
 
+  SECTION(audio_stats)
+  {
+    TEST_ENUM("audio_stats", conf->audio_stats, boolean_data);
+  }
+
+  SECTION(audio_float_mix)
+  {
+    TEST_ENUM("audio_float_mix", conf->audio_float_mix, boolean_data);
+  }
+
   SECTION(enable_oversampling)
   {
     TEST_ENUM("enable_oversampling", conf->oversampling_on, boolean_data);
@@ -783,6 +803,41 @@ UNITTEST(Settings)
     TEST_STRING("save_slots_ext", conf->save_slots_ext, string_data);
   }
 
+  SECTION(world_load_threads)
+  {
+    TEST_INT("world_load_threads", conf->world_load_threads, 0, MAX_WORLD_LOAD_THREADS);
+  }
+
+  SECTION(world_save_threads)
+  {
+    TEST_INT("world_save_threads", conf->world_save_threads, 0, MAX_WORLD_LOAD_THREADS);
+  }
+
+  SECTION(world_lazy_load)
+  {
+    TEST_ENUM("world_lazy_load", conf->world_lazy_load, boolean_data);
+  }
+
+  SECTION(world_prefetch_memory)
+  {
+    TEST_INT("world_prefetch_memory", conf->world_prefetch_memory, 0, SSIZE_MAX);
+  }
+
+  SECTION(world_incremental_save)
+  {
+    TEST_ENUM("world_incremental_save", conf->world_incremental_save, boolean_data);
+  }
+
+  SECTION(world_snapshots)
+  {
+    TEST_INT("world_snapshots", conf->world_snapshots, 0, MAX_WORLD_SNAPSHOTS);
+  }
+
+  SECTION(mzm_cache_memory)
+  {
+    TEST_INT("mzm_cache_memory", conf->mzm_cache_memory, 0, SSIZE_MAX);
+  }
+
   // Editor options used by core.
 
   SECTION(test_mode)
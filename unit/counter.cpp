@@ -0,0 +1,534 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for how counters are stored. Counter behavior in general is tested
+ * more comprehensively by the test worlds.
+ */
+
+#include "Unit.hpp"
+#include "UnitWorld.hpp"
+
+#include "../src/counter.h"
+#include "../src/counter_struct.h"
+#include "../src/io/zip.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const char TEST_WORLD[] =
+ "../../testworlds/2.93/009 Reset same board off.mzx";
+static const char TEST_SAVE[] = "_counter_tmp.sav";
+static const char TEST_WORLD_SAVE[] = "_counter_tmp.mzx";
+
+typedef std::vector<std::pair<std::string, int>> counter_values;
+
+/**
+ * Get every counter (with the case of its name as stored) using next_counter.
+ */
+static counter_values get_all_counters(struct world *mzx_world)
+{
+  struct counter_iter iter{};
+  counter_values counters;
+
+  while(next_counter(&(mzx_world->counter_list), &iter))
+  {
+    counters.push_back({ std::string(iter.name, iter.name_length),
+     iter.value });
+  }
+  std::sort(counters.begin(), counters.end());
+  return counters;
+}
+
+/**
+ * Get the name of a counter as it was stored, or an empty string if the
+ * counter doesn't exist.
+ */
+static std::string get_stored_name(struct world *mzx_world, const char *name)
+{
+  struct counter_iter iter{};
+
+  while(next_counter(&(mzx_world->counter_list), &iter))
+    if(iter.name_length == strlen(name) && !strcasecmp(iter.name, name))
+      return std::string(iter.name, iter.name_length);
+
+  return "";
+}
+
+/**
+ * Check if a counter is in the counter list instead of a family.
+ */
+static boolean in_counter_list(struct world *mzx_world, const char *name)
+{
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  unsigned int i;
+
+  for(i = 0; i < counter_list->num_counters; i++)
+    if(!strcasecmp(counter_list->counters[i]->name, name))
+      return true;
+
+  return false;
+}
+
+#ifdef CONFIG_COUNTER_HASH_TABLES
+
+/**
+ * Set a counter and check where it was stored. Every counter that isn't in
+ * the counter list should have been added to a family.
+ */
+static void set_family(struct world *mzx_world, const char *name, int value,
+ boolean expect_family)
+{
+  struct counter_list *counter_list = &(mzx_world->counter_list);
+  boolean exists = !get_stored_name(mzx_world, name).empty();
+  unsigned int num_family = counter_list->num_family_counters;
+
+  set_counter(mzx_world, name, value, 0);
+  ASSERTEQ(get_counter(mzx_world, name, 0), value, "%s", name);
+  ASSERTEQ(in_counter_list(mzx_world, name), !expect_family, "%s", name);
+  if(!exists && expect_family)
+    ASSERTEQ(counter_list->num_family_counters, num_family + 1, "%s", name);
+  else
+    ASSERTEQ(counter_list->num_family_counters, num_family, "%s", name);
+}
+
+#endif
+
+UNITTEST(Families)
+{
+#ifdef CONFIG_COUNTER_HASH_TABLES
+  char name[ROBOT_MAX_TR];
+  int i;
+
+  unit::world w;
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+
+  struct counter_list *counter_list = &(w.mzx_world->counter_list);
+
+  SECTION(SparseToDense)
+  {
+    set_family(w.mzx_world, "dense0", 100, true);
+
+    // Too sparse for the family, so this goes into the counter list.
+    set_family(w.mzx_world, "dense1000", 1, false);
+
+    // The family grows as long as enough of it is used.
+    for(i = 1; i < 600; i++)
+    {
+      snprintf(name, sizeof(name), "dense%d", i);
+      set_family(w.mzx_world, name, i + 100, true);
+    }
+    ASSERTEQ(get_counter(w.mzx_world, "dense1000", 0), 1, "");
+
+    for(i = 0; i < 600; i++)
+    {
+      snprintf(name, sizeof(name), "dense%d", i);
+      ASSERTEQ(get_counter(w.mzx_world, name, 0), i + 100, "%s", name);
+      set_counter(w.mzx_world, name, -i, 0);
+      ASSERTEQ(get_counter(w.mzx_world, name, 0), -i, "%s", name);
+    }
+
+    // Existing counters stay where they are.
+    set_family(w.mzx_world, "dense1000", 2, false);
+    set_family(w.mzx_world, "dense999", 3, true);
+  }
+
+  SECTION(Suffixes)
+  {
+    static const char *not_members[] =
+    {
+      // Leading zeroes.
+      "zero00",
+      "zero01",
+      "zero0001",
+      // Too large or too many digits.
+      "big65536",
+      "big99999",
+      "big100000",
+      "big0065535",
+      // No prefix or no number.
+      "12345",
+      "zero",
+    };
+
+    set_family(w.mzx_world, "zero0", 10, true);
+    set_family(w.mzx_world, "zero1", 11, true);
+    set_family(w.mzx_world, "big1", 12, true);
+
+    for(i = 0; i < arraysize(not_members); i++)
+    {
+      snprintf(name, sizeof(name), "%s", not_members[i]);
+      set_family(w.mzx_world, name, 20 + i, false);
+    }
+
+    // These are all different counters.
+    ASSERTEQ(get_counter(w.mzx_world, "zero0", 0), 10, "");
+    ASSERTEQ(get_counter(w.mzx_world, "zero1", 0), 11, "");
+    ASSERTEQ(get_counter(w.mzx_world, "big1", 0), 12, "");
+    for(i = 0; i < arraysize(not_members); i++)
+      ASSERTEQ(get_counter(w.mzx_world, not_members[i], 0), 20 + i, "");
+  }
+
+  SECTION(Case)
+  {
+    set_family(w.mzx_world, "MixedCase1", 1, true);
+    ASSERTEQ(get_counter(w.mzx_world, "MIXEDCASE1", 0), 1, "");
+    ASSERTEQ(get_counter(w.mzx_world, "mixedcase1", 0), 1, "");
+
+    // Lookups ignore case, so this is the same counter.
+    set_family(w.mzx_world, "mIXEDcASE1", 2, true);
+    ASSERTEQ(get_counter(w.mzx_world, "MixedCase1", 0), 2, "");
+
+    // The family's prefix has a different case, so this would be saved with
+    // the wrong name if it were added to the family.
+    set_family(w.mzx_world, "MIXEDCASE2", 3, false);
+    set_family(w.mzx_world, "mixedcase2", 4, false);
+    set_family(w.mzx_world, "MixedCase3", 5, true);
+
+    ASSERTCMP(get_stored_name(w.mzx_world, "mixedcase1").c_str(),
+     "MixedCase1", "");
+    ASSERTCMP(get_stored_name(w.mzx_world, "mixedcase2").c_str(),
+     "MIXEDCASE2", "");
+    ASSERTCMP(get_stored_name(w.mzx_world, "mixedcase3").c_str(),
+     "MixedCase3", "");
+    ASSERTEQ(get_counter(w.mzx_world, "mixedcase2", 0), 4, "");
+  }
+
+  SECTION(ExpandCollapse)
+  {
+    const struct counter *other;
+    const struct counter *member;
+    unsigned int num_family;
+    counter_values before;
+
+    for(i = 0; i < 10; i++)
+    {
+      snprintf(name, sizeof(name), "expand%d", i);
+      set_family(w.mzx_world, name, i, true);
+    }
+    set_family(w.mzx_world, "other", 1, false);
+    num_family = counter_list->num_family_counters;
+    before = get_all_counters(w.mzx_world);
+
+    // Family members don't have a counter struct to point to.
+    other = get_counter_pointer(w.mzx_world, "other", 0);
+    ASSERT(other, "");
+    ASSERT(!get_counter_pointer(w.mzx_world, "expand3", 0), "");
+    ASSERTEQ(counter_list->num_family_counters, num_family, "");
+
+    for(int cycle = 0; cycle < 2; cycle++)
+    {
+      expand_counter_families(counter_list);
+      ASSERTEQ(counter_list->num_family_counters, 0u, "");
+      ASSERT(get_all_counters(w.mzx_world) == before, "");
+
+      member = get_counter_pointer(w.mzx_world, "expand3", 0);
+      ASSERT(member, "");
+      ASSERTEQ(member->value, 3, "");
+      ASSERT(in_counter_list(w.mzx_world, "expand3"), "");
+
+      collapse_counter_families(counter_list);
+      ASSERTEQ(counter_list->num_family_counters, num_family, "");
+      ASSERT(!in_counter_list(w.mzx_world, "expand3"), "");
+      ASSERT(get_all_counters(w.mzx_world) == before, "");
+    }
+
+    // Changes made while the families are expanded are kept.
+    expand_counter_families(counter_list);
+    set_counter(w.mzx_world, "expand3", 33, 0);
+    set_counter(w.mzx_world, "expand10", 10, 0);
+    set_counter(w.mzx_world, "other", 2, 0);
+    collapse_counter_families(counter_list);
+
+    ASSERTEQ(counter_list->num_family_counters, num_family + 1, "");
+    ASSERTEQ(get_counter(w.mzx_world, "expand3", 0), 33, "");
+    ASSERTEQ(get_counter(w.mzx_world, "expand10", 0), 10, "");
+    ASSERT(!in_counter_list(w.mzx_world, "expand10"), "");
+
+    // Counters that were already in the counter list aren't moved.
+    ASSERT(other == get_counter_pointer(w.mzx_world, "other", 0), "");
+    ASSERTEQ(other->value, 2, "");
+  }
+
+  SECTION(SaveLoad)
+  {
+    unsigned int num_family;
+    counter_values before;
+    char path[MAX_PATH];
+    boolean faded;
+    void *data;
+    size_t size;
+
+    w.temp_path(path, TEST_SAVE);
+
+    for(i = 0; i < 300; i++)
+    {
+      snprintf(name, sizeof(name), "saved%d", i);
+      if(i != 10)
+        set_family(w.mzx_world, name, i * 3, true);
+    }
+    set_family(w.mzx_world, "saved5000", 5000, false);
+    set_family(w.mzx_world, "saved007", 7, false);
+    // If this were loaded before the family, it would start its own family
+    // and the rest of the members would have to go in the counter list.
+    set_family(w.mzx_world, "SAVED10", 10, false);
+    num_family = counter_list->num_family_counters;
+    before = get_all_counters(w.mzx_world);
+
+    // Snapshots use the bulk counter format.
+    ASSERTEQ(save_world_snapshot(w.mzx_world, &data, &size, nullptr, 0), 0, "");
+    set_counter(w.mzx_world, "saved1", -1, 0);
+    ASSERT(reload_world_snapshot(w.mzx_world, data, size, &faded), "");
+    free(data);
+
+    ASSERT(get_all_counters(w.mzx_world) == before, "");
+    ASSERTEQ(counter_list->num_family_counters, num_family, "");
+    ASSERT(in_counter_list(w.mzx_world, "SAVED10"), "");
+
+    // Save files use the normal counter format.
+    ASSERTEQ(save_world(w.mzx_world, path, true, MZX_VERSION), 0, "");
+    set_counter(w.mzx_world, "saved1", -1, 0);
+    ASSERT(reload_savegame(w.mzx_world, path, &faded), "");
+
+    ASSERT(get_all_counters(w.mzx_world) == before, "");
+    ASSERTEQ(counter_list->num_family_counters, num_family, "");
+    ASSERT(in_counter_list(w.mzx_world, "SAVED10"), "");
+  }
+
+  SECTION(Gateways)
+  {
+    const struct counter *ammo;
+    const struct counter *member;
+
+    // Built-in counters with gateways are never stored in families, and
+    // counters in families never use a gateway.
+    set_counter(w.mzx_world, "AMMO", -5, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "AMMO", 0), 0, "");
+    ammo = get_counter_pointer(w.mzx_world, "AMMO", 0);
+    ASSERT(ammo, "");
+    ASSERT(ammo->gateway_write, "");
+
+    set_family(w.mzx_world, "AMMO1", -5, true);
+    set_family(w.mzx_world, "ammo2", -5, false);
+    ASSERTEQ(get_counter(w.mzx_world, "AMMO", 0), 0, "");
+
+    expand_counter_families(counter_list);
+    member = get_counter_pointer(w.mzx_world, "AMMO1", 0);
+    ASSERT(member, "");
+    ASSERTEQ(member->gateway_write, 0, "");
+    collapse_counter_families(counter_list);
+    ASSERT(ammo == get_counter_pointer(w.mzx_world, "AMMO", 0), "");
+  }
+
+#else
+  SKIP();
+#endif
+}
+
+/**
+ * Set a counter with a name built by the test.
+ */
+static void set_named(struct world *mzx_world, const std::string &name,
+ int value)
+{
+  set_counter(mzx_world, name.c_str(), value, 0);
+}
+
+static int get_named(struct world *mzx_world, const std::string &name)
+{
+  return get_counter(mzx_world, name.c_str(), 0);
+}
+
+static void set_test_array(struct world *mzx_world, const char *name,
+ int size)
+{
+  std::string base(name);
+  int i;
+
+  set_named(mzx_world, base + "[]", size);
+  for(i = 0; i < size; i++)
+    set_named(mzx_world, base + "[" + std::to_string(i) + "]", i * 7 - 3);
+}
+
+static void check_test_array(struct world *mzx_world, const char *name,
+ int size)
+{
+  std::string base(name);
+  int value;
+  int i;
+
+  ASSERTEQ(get_named(mzx_world, base + "[]"), size, "%s", name);
+  for(i = 0; i < size; i++)
+  {
+    std::string element = base + "[" + std::to_string(i) + "]";
+    ASSERTEQ(get_named(mzx_world, element), i * 7 - 3, "%s", element.c_str());
+
+    ASSERT(get_counter_array_element(mzx_world, name, base.size(), i, &value),
+     "%s", element.c_str());
+    ASSERTEQ(value, i * 7 - 3, "%s", element.c_str());
+  }
+}
+
+UNITTEST(Arrays)
+{
+  char world_path[MAX_PATH];
+  boolean faded;
+  int value;
+
+  unit::world w;
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+
+  // Counter arrays are a 2.94 feature, so upgrade the test world first.
+  w.temp_path(world_path, TEST_WORLD_SAVE);
+  ASSERTEQ(save_world(w.mzx_world, world_path, false, MZX_VERSION), 0, "");
+  ASSERT(reload_world(w.mzx_world, world_path, &faded), "");
+  ASSERTEQ(w.mzx_world->version, V294, "");
+
+  SECTION(SizeAndIndex)
+  {
+    set_test_array(w.mzx_world, "arr", 10);
+    check_test_array(w.mzx_world, "arr", 10);
+
+    // Array names ignore case, like counter names.
+    ASSERTEQ(get_counter(w.mzx_world, "ARR[3]", 0), 18, "");
+    set_counter(w.mzx_world, "aRr[3]", 100, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[3]", 0), 100, "");
+
+    // Elements aren't counters.
+    ASSERT(!in_counter_list(w.mzx_world, "arr[3]"), "");
+    ASSERT(!in_counter_list(w.mzx_world, "arr[]"), "");
+
+    // Growing the array keeps the old values and clears the new ones.
+    set_counter(w.mzx_world, "arr[]", 20, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[]", 0), 20, "");
+    ASSERTEQ(get_counter(w.mzx_world, "arr[9]", 0), 60, "");
+    ASSERTEQ(get_counter(w.mzx_world, "arr[19]", 0), 0, "");
+    set_counter(w.mzx_world, "arr[19]", 19, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[19]", 0), 19, "");
+
+    // Shrinking it drops the values past the end.
+    set_counter(w.mzx_world, "arr[]", 5, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[]", 0), 5, "");
+    ASSERTEQ(get_counter(w.mzx_world, "arr[4]", 0), 25, "");
+    ASSERTEQ(get_counter(w.mzx_world, "arr[9]", 0), 0, "");
+
+    // Setting the size to 0 deletes it.
+    set_counter(w.mzx_world, "arr[]", 0, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[]", 0), 0, "");
+    ASSERT(!get_counter_array_element(w.mzx_world, "arr", 3, 0, &value), "");
+    ASSERTEQ(w.mzx_world->counter_list.num_arrays, 0u, "");
+  }
+
+  SECTION(OutOfRange)
+  {
+    static const char *invalid[] =
+    {
+      "arr[10]",
+      "arr[-1]",
+      "arr[2147483648]",
+      "arr[x]",
+      "arr[3x]",
+      "arr[ 3]",
+    };
+    unsigned int num_counters = w.mzx_world->counter_list.num_counters;
+    int i;
+
+    set_test_array(w.mzx_world, "arr", 10);
+
+    // Invalid indices read as 0 and writes to them are ignored.
+    for(i = 0; i < arraysize(invalid); i++)
+    {
+      set_counter(w.mzx_world, invalid[i], 1234, 0);
+      ASSERTEQ(get_counter(w.mzx_world, invalid[i], 0), 0, "%s", invalid[i]);
+    }
+    check_test_array(w.mzx_world, "arr", 10);
+    ASSERTEQ(w.mzx_world->counter_list.num_counters, num_counters, "");
+
+    ASSERT(get_counter_array_element(w.mzx_world, "arr", 3, 10, &value), "");
+    ASSERTEQ(value, 0, "");
+    ASSERT(get_counter_array_element(w.mzx_world, "arr", 3, -1, &value), "");
+    ASSERTEQ(value, 0, "");
+
+    // Without an array, these are normal counters.
+    set_counter(w.mzx_world, "none[1]", 5, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "none[1]", 0), 5, "");
+    ASSERT(in_counter_list(w.mzx_world, "none[1]"), "");
+    ASSERT(!get_counter_array_element(w.mzx_world, "none", 4, 1, &value), "");
+    ASSERTEQ(get_counter(w.mzx_world, "none[]", 0), 0, "");
+  }
+
+  SECTION(OldWorlds)
+  {
+    // Before 2.94, these are all normal counters.
+    ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+    ASSERTEQ(w.mzx_world->version, V293, "");
+    set_counter(w.mzx_world, "arr[]", 10, 0);
+    set_counter(w.mzx_world, "arr[3]", 5, 0);
+    ASSERTEQ(get_counter(w.mzx_world, "arr[]", 0), 10, "");
+    ASSERTEQ(get_counter(w.mzx_world, "arr[3]", 0), 5, "");
+    ASSERT(in_counter_list(w.mzx_world, "arr[]"), "");
+    ASSERT(in_counter_list(w.mzx_world, "arr[3]"), "");
+    ASSERTEQ(w.mzx_world->counter_list.num_arrays, 0u, "");
+  }
+
+  SECTION(SaveLoad)
+  {
+    char path[MAX_PATH];
+    void *data;
+    size_t size;
+
+    w.temp_path(path, TEST_SAVE);
+
+    set_test_array(w.mzx_world, "arr", 10);
+    set_test_array(w.mzx_world, "Mixed_Case", 1);
+    set_test_array(w.mzx_world, "big", 100000);
+    set_counter(w.mzx_world, "arr_counter", 5, 0);
+
+    ASSERTEQ(save_world(w.mzx_world, path, true, MZX_VERSION), 0, "");
+    set_counter(w.mzx_world, "arr[]", 0, 0);
+    set_counter(w.mzx_world, "new[]", 1, 0);
+    ASSERT(reload_savegame(w.mzx_world, path, &faded), "");
+
+    ASSERTEQ(w.mzx_world->counter_list.num_arrays, 3u, "");
+    check_test_array(w.mzx_world, "arr", 10);
+    check_test_array(w.mzx_world, "mixed_case", 1);
+    check_test_array(w.mzx_world, "big", 100000);
+    ASSERTEQ(get_counter(w.mzx_world, "arr_counter", 0), 5, "");
+    ASSERTEQ(get_counter(w.mzx_world, "new[]", 0), 0, "");
+
+    // Snapshots save arrays the same way.
+    ASSERTEQ(save_world_snapshot(w.mzx_world, &data, &size, nullptr, 0), 0, "");
+    set_counter(w.mzx_world, "arr[]", 0, 0);
+    ASSERT(reload_world_snapshot(w.mzx_world, data, size, &faded), "");
+    free(data);
+
+    ASSERTEQ(w.mzx_world->counter_list.num_arrays, 3u, "");
+    check_test_array(w.mzx_world, "arr", 10);
+    check_test_array(w.mzx_world, "big", 100000);
+
+    // Saves for 2.93 can't contain arrays.
+    ASSERTEQ(save_world(w.mzx_world, path, true, MZX_VERSION_PREV), 0, "");
+    struct zip_archive *zp = zip_open_file_read(path);
+    ASSERT(zp, "");
+    ASSERTEQ(zip_find_file(zp, "ctrarr"), ZIP_FILE_NOT_FOUND, "");
+    zip_close(zp, nullptr);
+  }
+}
@@ -0,0 +1,210 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for the extra RAM compression codecs.
+ */
+
+// extmem.c is only built with extra RAM support, but its codecs can be
+// tested regardless.
+#ifndef CONFIG_EXTRAM
+#define CONFIG_EXTRAM
+#endif
+
+#include "Unit.hpp"
+
+// C++ doesn't have flexible array members.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#include "../src/extmem.c"
+#pragma GCC diagnostic pop
+
+#include <vector>
+
+static std::vector<uint8_t> lz_pack(const std::vector<uint8_t> &src)
+{
+  std::vector<uint8_t> packed(LZ_bound(src.size()));
+  size_t len = LZ_pack(packed.data(), packed.size(), src.data(), src.size());
+  packed.resize(len);
+  return packed;
+}
+
+static void lz_round_trip(const std::vector<uint8_t> &src)
+{
+  std::vector<uint8_t> packed = lz_pack(src);
+  std::vector<uint8_t> dest(src.size() + 1);
+
+  ASSERT(packed.size() > 0, "%zu", src.size());
+  ASSERT(packed.size() <= LZ_bound(src.size()), "%zu", packed.size());
+
+  ASSERT(LZ_unpack(dest.data(), src.size(), packed.data(), packed.size()),
+   "%zu", src.size());
+  if(src.size())
+    ASSERTMEM(dest.data(), src.data(), src.size(), "");
+
+  // The unpacked size must match exactly.
+  ASSERT(!LZ_unpack(dest.data(), src.size() + 1, packed.data(), packed.size()),
+   "%zu", src.size());
+  if(src.size())
+  {
+    ASSERT(!LZ_unpack(dest.data(), src.size() - 1, packed.data(),
+     packed.size()), "%zu", src.size());
+  }
+}
+
+static std::vector<uint8_t> random_data(size_t len, uint32_t seed)
+{
+  std::vector<uint8_t> data(len);
+  for(size_t i = 0; i < len; i++)
+  {
+    seed = seed * 1103515245u + 12345u;
+    data[i] = seed >> 24;
+  }
+  return data;
+}
+
+UNITTEST(LZ_empty)
+{
+  std::vector<uint8_t> src;
+  std::vector<uint8_t> packed = lz_pack(src);
+  uint8_t dest[1];
+
+  // A single empty sequence.
+  ASSERTEQ(packed.size(), 1u, "");
+  ASSERTEQ(packed[0], 0, "");
+  ASSERT(LZ_unpack(dest, 0, packed.data(), packed.size()), "");
+  ASSERT(!LZ_unpack(dest, 1, packed.data(), packed.size()), "");
+}
+
+UNITTEST(LZ_incompressible)
+{
+  static const size_t sizes[] =
+  {
+    1, 3, 4, 5, 14, 15, 16, 270, 271, 4096, 65536
+  };
+
+  for(size_t size : sizes)
+  {
+    std::vector<uint8_t> src = random_data(size, size);
+    std::vector<uint8_t> packed = lz_pack(src);
+
+    lz_round_trip(src);
+    // Incompressible data can't get any smaller.
+    ASSERT(packed.size() > size, "%zu", size);
+  }
+}
+
+UNITTEST(LZ_runs)
+{
+  SECTION(Zeroes)
+  {
+    std::vector<uint8_t> src(100000, 0);
+    lz_round_trip(src);
+    ASSERT(lz_pack(src).size() < 500, "%zu", lz_pack(src).size());
+  }
+
+  SECTION(RunLengths)
+  {
+    // Runs crossing every length continuation boundary.
+    std::vector<uint8_t> src;
+    for(size_t len = 1; len < 800; len += 7)
+      src.insert(src.end(), len, (uint8_t)len);
+
+    lz_round_trip(src);
+    ASSERT(lz_pack(src).size() < src.size() / 4, "%zu", lz_pack(src).size());
+  }
+
+  SECTION(Rows)
+  {
+    // Repeating rows, like a board plane.
+    std::vector<uint8_t> row = random_data(100, 1);
+    std::vector<uint8_t> src;
+    for(size_t i = 0; i < 100; i++)
+    {
+      src.insert(src.end(), row.begin(), row.end());
+      row[i] ^= 0x55;
+    }
+    lz_round_trip(src);
+    ASSERT(lz_pack(src).size() < src.size() / 4, "%zu", lz_pack(src).size());
+  }
+
+  SECTION(FarMatches)
+  {
+    // Matches at the maximum offset and beyond it.
+    std::vector<uint8_t> block = random_data(1000, 2);
+    std::vector<uint8_t> src = block;
+    std::vector<uint8_t> filler = random_data(LZ_MAX_OFFSET - 1000, 3);
+    src.insert(src.end(), filler.begin(), filler.end());
+    src.insert(src.end(), block.begin(), block.end());
+    filler = random_data(LZ_MAX_OFFSET + 1, 4);
+    src.insert(src.end(), filler.begin(), filler.end());
+    src.insert(src.end(), block.begin(), block.end());
+    lz_round_trip(src);
+  }
+}
+
+UNITTEST(LZ_small_buffer)
+{
+  SECTION(Pack)
+  {
+    std::vector<uint8_t> src = random_data(1000, 5);
+    std::vector<uint8_t> runs(1000, 'a');
+    std::vector<uint8_t> packed(LZ_bound(src.size()));
+    size_t len = LZ_pack(packed.data(), packed.size(), src.data(), src.size());
+    size_t i;
+
+    ASSERT(len > 0, "");
+    for(i = 0; i < len; i++)
+    {
+      ASSERTEQ(LZ_pack(packed.data(), i, src.data(), src.size()), 0u,
+       "%zu", i);
+    }
+
+    len = LZ_pack(packed.data(), packed.size(), runs.data(), runs.size());
+    ASSERT(len > 0, "");
+    for(i = 0; i < len; i++)
+    {
+      ASSERTEQ(LZ_pack(packed.data(), i, runs.data(), runs.size()), 0u,
+       "%zu", i);
+    }
+  }
+
+  SECTION(Unpack)
+  {
+    std::vector<uint8_t> src = random_data(300, 6);
+    src.insert(src.end(), 300, 'b');
+    std::vector<uint8_t> packed = lz_pack(src);
+    std::vector<uint8_t> dest(src.size());
+    size_t i;
+
+    // Truncated streams should fail cleanly. Only the final empty sequence
+    // can be left out without losing anything.
+    for(i = 0; i < packed.size() - 1; i++)
+      ASSERT(!LZ_unpack(dest.data(), dest.size(), packed.data(), i), "%zu", i);
+
+    ASSERT(LZ_unpack(dest.data(), dest.size(), packed.data(), i), "");
+    ASSERTMEM(dest.data(), src.data(), src.size(), "");
+
+    // Matches reaching before the start of the output should fail.
+    static const uint8_t bad_offset[] = { 0x10, 'x', 0x02 };
+    ASSERT(!LZ_unpack(dest.data(), 5, bad_offset, sizeof(bad_offset)), "");
+    static const uint8_t zero_offset[] = { 0x10, 'x', 0x00 };
+    ASSERT(!LZ_unpack(dest.data(), 5, zero_offset, sizeof(zero_offset)), "");
+  }
+}
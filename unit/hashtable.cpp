@@ -0,0 +1,300 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for the two counter/string hash table implementations. Both use the
+ * same uthash-like interface, so the same tests are run for each.
+ *
+ * Set MZX_UNIT_BENCHMARK in the environment to also run the benchmarks, which
+ * compare both tables on counter names similar to those used by games.
+ */
+
+#include "Unit.hpp"
+#include "../src/hashtable.h"
+#include "../src/swisstable.h"
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+struct test_obj
+{
+  uint32_t hash;
+  uint16_t name_length;
+  alignas(4) char name[48];
+};
+
+HASH_SET_INIT(KHASH, struct test_obj *, name, name_length)
+SWISS_SET_INIT(SWISS, struct test_obj *, name, name_length)
+
+static std::vector<test_obj> make_objs(size_t count)
+{
+  static const char *prefixes[] =
+  {
+    "hp", "enemy", "room", "pos", "flag", "item", "quest", "tile", "loop",
+    "local", "timer", "shot", "door", "key", "npc", "wall", "spr", "map",
+  };
+  static const char *suffixes[] =
+  {
+    "", "", "", "x", "y", "hp", "_dir", "_state", "count",
+  };
+  std::mt19937 rng(1234);
+  std::vector<test_obj> objs(count);
+  size_t i;
+
+  for(i = 0; i < count; i++)
+  {
+    test_obj &o = objs[i];
+    memset(&o, 0, sizeof(test_obj));
+
+    // Mostly numbered families of counters plus a few grid-style names;
+    // the index keeps every name unique.
+    if(i % 16 == 0)
+    {
+      snprintf(o.name, sizeof(o.name), "x%zuy%zu", i % 97, i / 97);
+    }
+    else
+    {
+      snprintf(o.name, sizeof(o.name), "%s%zu%s",
+       prefixes[rng() % arraysize(prefixes)], i,
+       suffixes[rng() % arraysize(suffixes)]);
+    }
+    o.name_length = strlen(o.name);
+  }
+  return objs;
+}
+
+static void random_case(char *dest, const char *src, std::mt19937 &rng)
+{
+  for(; *src; src++, dest++)
+    *dest = (rng() & 1) ? toupper(*src) : *src;
+  *dest = '\0';
+}
+
+#define TEST_TABLE(n) do \
+{ \
+  khash_t(n) *table = nullptr; \
+  std::vector<test_obj> objs = make_objs(5000); \
+  std::mt19937 rng(5678); \
+  struct test_obj *found; \
+  size_t count; \
+  size_t size; \
+  size_t i; \
+  \
+  for(i = 0; i < objs.size(); i++) \
+    HASH_ADD(n, table, &objs[i]); \
+  ASSERTEQ(kh_size(table), objs.size(), ""); \
+  \
+  /* Adding again shouldn't do anything. */ \
+  HASH_ADD(n, table, &objs[10]); \
+  ASSERTEQ(kh_size(table), objs.size(), ""); \
+  \
+  for(i = 0; i < objs.size(); i++) \
+  { \
+    char buf[48]; \
+    random_case(buf, objs[i].name, rng); \
+    HASH_FIND(n, table, buf, strlen(buf), found); \
+    ASSERTEQ(found, &objs[i], "%s", buf); \
+  } \
+  HASH_FIND(n, table, "notacounter", 11, found); \
+  ASSERTEQ(found, nullptr, ""); \
+  \
+  for(i = 0; i < objs.size(); i += 2) \
+    HASH_DELETE(n, table, &objs[i]); \
+  ASSERTEQ(kh_size(table), objs.size() / 2, ""); \
+  \
+  for(i = 0; i < objs.size(); i++) \
+  { \
+    HASH_FIND(n, table, objs[i].name, objs[i].name_length, found); \
+    ASSERTEQ(found, (i & 1) ? &objs[i] : nullptr, "%s", objs[i].name); \
+  } \
+  \
+  count = 0; \
+  HASH_ITER(n, table, found, { ASSERT(found->name_length, ""); count++; }); \
+  ASSERTEQ(count, objs.size() / 2, ""); \
+  \
+  /* Re-adding after deleting (reuses deleted slots). */ \
+  for(i = 0; i < objs.size(); i += 2) \
+    HASH_ADD(n, table, &objs[i]); \
+  for(i = 0; i < objs.size(); i++) \
+  { \
+    HASH_FIND(n, table, objs[i].name, objs[i].name_length, found); \
+    ASSERTEQ(found, &objs[i], "%s", objs[i].name); \
+  } \
+  \
+  HASH_MEMORY_USAGE(n, table, size); \
+  ASSERT(size > objs.size() * sizeof(void *), "%zu", size); \
+  \
+  HASH_CLEAR(n, table); \
+  ASSERTEQ(table, nullptr, ""); \
+  HASH_MEMORY_USAGE(n, table, size); \
+  ASSERTEQ(size, 0, ""); \
+} while(0)
+
+UNITTEST(hashtable)
+{
+  SECTION(khash)
+  {
+    TEST_TABLE(KHASH);
+  }
+
+  SECTION(swiss)
+  {
+    TEST_TABLE(SWISS);
+  }
+}
+
+UNITTEST(swisstable_churn)
+{
+  // Lots of adds and deletes without the table growing should recycle
+  // deleted slots instead of filling the table with them.
+  khash_t(SWISS) *table = nullptr;
+  std::vector<test_obj> objs = make_objs(20000);
+  struct test_obj *found;
+  size_t i;
+  size_t j;
+
+  for(i = 0; i < 100; i++)
+    HASH_ADD(SWISS, table, &objs[i]);
+
+  for(i = 100; i < objs.size(); i++)
+  {
+    HASH_DELETE(SWISS, table, &objs[i - 100]);
+    HASH_ADD(SWISS, table, &objs[i]);
+    ASSERTEQ(kh_size(table), 100, "");
+  }
+  ASSERT(kh_n_buckets(table) <= 256, "%zu", kh_n_buckets(table));
+
+  for(j = 0; j < objs.size(); j++)
+  {
+    HASH_FIND(SWISS, table, objs[j].name, objs[j].name_length, found);
+    ASSERTEQ(found, (j >= objs.size() - 100) ? &objs[j] : nullptr, "%zu", j);
+  }
+  HASH_CLEAR(SWISS, table);
+}
+
+#define TEST_RESERVE(n) do \
+{ \
+  khash_t(n) *table = nullptr; \
+  std::vector<test_obj> objs = make_objs(5000); \
+  struct test_obj *found; \
+  size_t buckets; \
+  size_t i; \
+  \
+  HASH_RESERVE(n, table, objs.size()); \
+  buckets = kh_n_buckets(table); \
+  ASSERT(buckets >= objs.size(), "%zu", buckets); \
+  \
+  /* The table shouldn't need to grow while adding the reserved objects. */ \
+  for(i = 0; i < objs.size(); i++) \
+    HASH_ADD(n, table, &objs[i]); \
+  ASSERTEQ(kh_n_buckets(table), buckets, ""); \
+  ASSERTEQ(kh_size(table), objs.size(), ""); \
+  \
+  for(i = 0; i < objs.size(); i++) \
+  { \
+    HASH_FIND(n, table, objs[i].name, objs[i].name_length, found); \
+    ASSERTEQ(found, &objs[i], "%s", objs[i].name); \
+  } \
+  \
+  /* Reserving less than the current size does nothing. */ \
+  HASH_RESERVE(n, table, 10); \
+  ASSERTEQ(kh_n_buckets(table), buckets, ""); \
+  HASH_CLEAR(n, table); \
+} while(0)
+
+UNITTEST(hashtable_reserve)
+{
+  SECTION(khash)
+  {
+    TEST_RESERVE(KHASH);
+  }
+
+  SECTION(swiss)
+  {
+    TEST_RESERVE(SWISS);
+  }
+}
+
+#define BENCH_TABLE(n, objs, queries, add_ns, find_ns) do \
+{ \
+  khash_t(n) *table = nullptr; \
+  struct test_obj *found; \
+  size_t hits = 0; \
+  size_t i; \
+  auto t0 = std::chrono::steady_clock::now(); \
+  for(i = 0; i < objs.size(); i++) \
+    HASH_ADD(n, table, &objs[i]); \
+  auto t1 = std::chrono::steady_clock::now(); \
+  for(const std::string &q : queries) \
+  { \
+    HASH_FIND(n, table, q.c_str(), q.size(), found); \
+    if(found) \
+      hits++; \
+  } \
+  auto t2 = std::chrono::steady_clock::now(); \
+  add_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / \
+   objs.size(); \
+  find_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / \
+   queries.size(); \
+  ASSERT(hits > queries.size() / 2, ""); \
+  HASH_CLEAR(n, table); \
+} while(0)
+
+UNITTEST(benchmark)
+{
+  static const size_t sizes[] = { 100, 5000, 200000 };
+
+  if(!getenv("MZX_UNIT_BENCHMARK"))
+    SKIP();
+
+  for(size_t count : sizes)
+  {
+    std::vector<test_obj> objs = make_objs(count);
+    std::vector<std::string> queries;
+    std::mt19937 rng(9999);
+    double k_add, k_find, s_add, s_find;
+    size_t i;
+
+    // Most counter lookups are hits, but commands like INC on a new counter
+    // and most built-in counter names checked against the list are misses.
+    for(i = 0; i < 1000000; i++)
+    {
+      char buf[48];
+      if(rng() % 10)
+      {
+        const test_obj &o = objs[rng() % count];
+        random_case(buf, o.name, rng);
+      }
+      else
+        snprintf(buf, sizeof(buf), "missing%u", (unsigned int)rng());
+
+      queries.push_back(buf);
+    }
+
+    BENCH_TABLE(KHASH, objs, queries, k_add, k_find);
+    BENCH_TABLE(SWISS, objs, queries, s_add, s_find);
+
+    fprintf(stderr, "%7zu names: khash add %6.1fns find %6.1fns; "
+     "swiss add %6.1fns find %6.1fns\n", count, k_add, k_find, s_add, s_find);
+  }
+}
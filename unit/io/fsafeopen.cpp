@@ -0,0 +1,221 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for case-insensitive file name matching and its directory cache.
+ */
+
+#include "../Unit.hpp"
+#include "../../src/io/vio.h"
+#include "../../src/io/fsafeopen.c"
+
+#include <time.h>
+
+#ifndef _WIN32
+#include <utime.h>
+#endif
+
+static constexpr char TEST_DIR[] = "FSAFE_TEST_DIR";
+
+static void create_file(const char *path)
+{
+  // Use stdio so vio doesn't see the file being created.
+  FILE *fp = fopen_unsafe(path, "wb");
+  ASSERT(fp, "%s", path);
+  fclose(fp);
+}
+
+/**
+ * Translate a path and return the result, or nullptr if it wasn't found.
+ */
+static const char *translate(const char *path)
+{
+  static char buffer[MAX_PATH];
+  int ret = fsafetranslate(path, buffer, MAX_PATH);
+  if(ret != FSAFE_SUCCESS)
+    return nullptr;
+  return buffer;
+}
+
+class fsafe_test_dir
+{
+public:
+  fsafe_test_dir()
+  {
+    cleanup();
+    ASSERTEQ(vmkdir(TEST_DIR, 0755), 0, "");
+    create_file("FSAFE_TEST_DIR/MixedCase.txt");
+    create_file("FSAFE_TEST_DIR/other.TXT");
+    fsafeopen_free_cache();
+  }
+
+  ~fsafe_test_dir()
+  {
+    cleanup();
+    fsafeopen_free_cache();
+  }
+
+  static void cleanup()
+  {
+    char path[MAX_PATH];
+    vdir *dir = vdir_open(TEST_DIR);
+    if(dir)
+    {
+      char name[MAX_PATH];
+      while(vdir_read(dir, name, MAX_PATH, NULL))
+      {
+        snprintf(path, MAX_PATH, "%s/%s", TEST_DIR, name);
+        unlink(path);
+      }
+      vdir_close(dir);
+      rmdir(TEST_DIR);
+    }
+  }
+
+  /**
+   * Set the directory's modification time without changing its contents, if
+   * possible. Otherwise, the directory listing is never cached anyway.
+   */
+  static void set_mtime(time_t mtime)
+  {
+#ifndef _WIN32
+    struct utimbuf t;
+    t.actime = mtime;
+    t.modtime = mtime;
+    ASSERTEQ(utime(TEST_DIR, &t), 0, "");
+#endif
+  }
+};
+
+UNITTEST(CaseMismatch)
+{
+  fsafe_test_dir dir;
+
+  SECTION(Exact)
+  {
+    ASSERTCMP(translate("FSAFE_TEST_DIR/MixedCase.txt"),
+     "FSAFE_TEST_DIR/MixedCase.txt", "");
+  }
+
+  SECTION(Mismatch)
+  {
+    // These don't match any of the simple case conversions, so they
+    // need to be found in the directory listing.
+    ASSERTCMP(translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"),
+     "FSAFE_TEST_DIR/MixedCase.txt", "");
+    ASSERTCMP(translate("fsafe_test_dir/OtHeR.txt"),
+     "FSAFE_TEST_DIR/other.TXT", "");
+
+    // Again, from the cache.
+    ASSERTCMP(translate("FSAFE_TEST_DIR/mixedCASE.txt"),
+     "FSAFE_TEST_DIR/MixedCase.txt", "");
+    ASSERTCMP(translate("FSAFE_TEST_DIR/OTHER.txt"),
+     "FSAFE_TEST_DIR/other.TXT", "");
+  }
+
+  SECTION(NotFound)
+  {
+    ASSERT(!translate("FSAFE_TEST_DIR/mIXEDcASE.TX"), "");
+    ASSERT(!translate("FSAFE_TEST_DIR/MixedCase.txt.bak"), "");
+    ASSERT(!translate("FSAFE_TEST_DIR/nothing"), "");
+  }
+}
+
+UNITTEST(CacheInvalidation)
+{
+  fsafe_test_dir dir;
+  time_t mtime = time(NULL) - 100;
+
+  // Changes made through vio should invalidate the cached listing even if
+  // the modification time doesn't change.
+  dir.set_mtime(mtime);
+  ASSERTCMP(translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"),
+   "FSAFE_TEST_DIR/MixedCase.txt", "");
+
+  SECTION(vrename)
+  {
+    ASSERTEQ(vrename("FSAFE_TEST_DIR/MixedCase.txt",
+     "FSAFE_TEST_DIR/Renamed.txt"), 0, "");
+    dir.set_mtime(mtime);
+    ASSERT(!translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"), "");
+    ASSERTCMP(translate("FSAFE_TEST_DIR/rENAMED.TXT"),
+     "FSAFE_TEST_DIR/Renamed.txt", "");
+  }
+
+  SECTION(vunlink)
+  {
+    ASSERTEQ(vunlink("FSAFE_TEST_DIR/MixedCase.txt"), 0, "");
+    dir.set_mtime(mtime);
+    ASSERT(!translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"), "");
+  }
+
+  SECTION(vmkdir)
+  {
+    // The file is created without vio, but making the directory afterward
+    // is a change made through vio.
+    create_file("FSAFE_TEST_DIR/NewFile.txt");
+    ASSERTEQ(vmkdir("FSAFE_TEST_DIR/NewDir", 0755), 0, "");
+    dir.set_mtime(mtime);
+    ASSERTCMP(translate("FSAFE_TEST_DIR/nEWfILE.TXT"),
+     "FSAFE_TEST_DIR/NewFile.txt", "");
+    ASSERTEQ(vrmdir("FSAFE_TEST_DIR/NewDir"), 0, "");
+  }
+}
+
+UNITTEST(CacheModificationTime)
+{
+#if defined(FSAFE_DIR_CACHE) && !defined(_WIN32)
+  fsafe_test_dir dir;
+  time_t now = time(NULL);
+
+  SECTION(Older)
+  {
+    // The listing was read after the last modification, so it's trusted
+    // until the modification time changes.
+    dir.set_mtime(now - 100);
+    ASSERTCMP(translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"),
+     "FSAFE_TEST_DIR/MixedCase.txt", "");
+
+    create_file("FSAFE_TEST_DIR/NewFile.txt");
+    dir.set_mtime(now - 100);
+    ASSERT(!translate("FSAFE_TEST_DIR/nEWfILE.TXT"), "stale listing");
+
+    dir.set_mtime(now - 99);
+    ASSERTCMP(translate("FSAFE_TEST_DIR/nEWfILE.TXT"),
+     "FSAFE_TEST_DIR/NewFile.txt", "");
+  }
+
+  SECTION(SameSecond)
+  {
+    // The listing was read during (or before) the second the directory was
+    // last modified, so more changes could have been made in that second
+    // without changing the modification time. It shouldn't be trusted.
+    dir.set_mtime(now + 100);
+    ASSERTCMP(translate("FSAFE_TEST_DIR/mIXEDcASE.TXT"),
+     "FSAFE_TEST_DIR/MixedCase.txt", "");
+
+    create_file("FSAFE_TEST_DIR/NewFile.txt");
+    dir.set_mtime(now + 100);
+    ASSERTCMP(translate("FSAFE_TEST_DIR/nEWfILE.TXT"),
+     "FSAFE_TEST_DIR/NewFile.txt", "");
+  }
+#else
+  SKIP();
+#endif
+}
@@ -1851,15 +1851,16 @@ UNITTEST(vfs_invalidate_at_least)
     { 0, 800, 0, 392,
      {
       { "dirA/filedel", -ENOENT },
-      { "dirA/dirB/file3", -VFS_ERR_IS_CACHED },
+      { "dirA/file2", -ENOENT },
+      { "dirA/dirB/file3", -ENOENT },
       { "dirA/dirB/file4", -ENOENT },
       { "dirA/dirC/file5", -ENOENT },
-      { "fat://fileX", -ENOENT }}},
+      { "dirA/dirC/file6", -VFS_ERR_IS_CACHED },
+      { "fat://fileX", -VFS_ERR_IS_CACHED }}},
     { 0, 1000, 640, fileopen_len,
      {
-      { "dirA/file2", -ENOENT },
-      { "dirA/dirB/file3", -ENOENT },
-      { "dirA/dirB/file6", -ENOENT },
+      { "dirA/dirC/file6", -ENOENT },
+      { "fat://fileX", -ENOENT },
       { "fat://dirX/fileY", -ENOENT }}},
     { 0, 256, 256, fileopen_len, {}},
   };
@@ -1869,10 +1870,8 @@ UNITTEST(vfs_invalidate_at_least)
   size_t sz;
   int ret;
 
-  // The sort used by this function uses timestamps to prioritize
-  // stale files for deletion. Disable them so this test is deterministic...
-  vfs_set_timestamps_enabled(vfs, false);
-
+  // Nothing has been opened since the files were cached, so they should be
+  // deleted in the order they were created.
   /*size_t total =*/ setup_cache_testing_vfs(vfs);
   uint32_t inode = fileopen_prologue(vfs);
 
@@ -1912,6 +1911,83 @@ UNITTEST(vfs_invalidate_at_least)
   //fileopen_epilogue(vfs, inode);
 }
 
+UNITTEST(vfs_invalidate_lru)
+{
+#ifndef VIRTUAL_FILESYSTEM
+  SKIP();
+#endif
+
+  ScopedVFS vfs = vfs_init();
+  ASSERT(vfs, "");
+  struct vfs_cache_stats stats;
+  struct stat st{};
+  uint32_t inode;
+  size_t left;
+  int ret;
+
+  setup_cache_testing_vfs(vfs);
+  vfs_get_cache_stats(vfs, &stats);
+  ASSERTEQ(stats.hits, 0, "");
+  ASSERTEQ(stats.misses, 10, "");
+  ASSERTEQ(stats.evictions, 0, "");
+
+  // Using the oldest file should move it to the end of the list.
+  ret = vfs_open_if_exists(vfs, "file1", false, &inode);
+  ASSERTEQ(ret, -VFS_ERR_IS_CACHED, "");
+  ret = vfs_close(vfs, inode);
+  ASSERTEQ(ret, 0, "");
+
+  left = 256;
+  ret = vfs_invalidate_at_least(vfs, &left);
+  ASSERTEQ(ret, 0, "");
+  ASSERTEQ(left, 0, "");
+  ret = vfs_stat(vfs, "file1", &st);
+  ASSERTEQ(ret, -VFS_ERR_IS_CACHED, "");
+  ret = vfs_stat(vfs, "dirA/filedel", &st);
+  ASSERTEQ(ret, -ENOENT, "");
+  ret = vfs_stat(vfs, "dirA/file2", &st);
+  ASSERTEQ(ret, -ENOENT, "");
+  ret = vfs_stat(vfs, "dirA/dirB/file3", &st);
+  ASSERTEQ(ret, -VFS_ERR_IS_CACHED, "");
+
+  vfs_get_cache_stats(vfs, &stats);
+  ASSERTEQ(stats.hits, 1, "");
+  ASSERTEQ(stats.misses, 10, "");
+  ASSERTEQ(stats.evictions, 2, "");
+
+  // Invalidated files should be removed from the list.
+  ret = vfs_invalidate_at_path(vfs, "dirA/dirB/file3");
+  ASSERTEQ(ret, 0, "");
+
+  // Open files should be skipped, and file1 should still be evicted last.
+  inode = fileopen_prologue(vfs);
+  left = 840;
+  ret = vfs_invalidate_at_least(vfs, &left);
+  ASSERTEQ(ret, 0, "");
+  ASSERTEQ(left, 0, "");
+  ret = vfs_stat(vfs, "fat://dirX/fileY", &st);
+  ASSERTEQ(ret, -ENOENT, "");
+  ret = vfs_stat(vfs, "file1", &st);
+  ASSERTEQ(ret, -VFS_ERR_IS_CACHED, "");
+  ret = vfs_close(vfs, inode);
+  ASSERTEQ(ret, 0, "");
+  left = vfs_get_cache_total_size(vfs);
+  ASSERTEQ(left, 256 + fileopen_len, "");
+
+  vfs_get_cache_stats(vfs, &stats);
+  ASSERTEQ(stats.hits, 2, "");
+  ASSERTEQ(stats.evictions, 7, "");
+
+  // The file that was just closed is now the most recently used.
+  left = 1;
+  ret = vfs_invalidate_at_least(vfs, &left);
+  ASSERTEQ(ret, 0, "");
+  ret = vfs_stat(vfs, "file1", &st);
+  ASSERTEQ(ret, -ENOENT, "");
+  ret = vfs_stat(vfs, "fileopen", &st);
+  ASSERTEQ(ret, -VFS_ERR_IS_CACHED, "");
+}
+
 UNITTEST(vfs_invalidate_all)
 {
 #ifndef VIRTUAL_FILESYSTEM
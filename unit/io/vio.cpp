@@ -2340,3 +2340,68 @@ UNITTEST(vfile_force_to_memory)
     common_test("r+b", false);
   }
 }
+
+UNITTEST(vfile_map_to_memory)
+{
+  int ret;
+
+  // Safety--make sure this really is disabled.
+  vio_filesystem_exit();
+
+  ret = vchdir(execdir);
+  ASSERTEQ(ret, 0, "");
+
+  SECTION(Read)
+  {
+    ScopedFile<vfile, vfclose> vf = vfopen_unsafe(TEST_READ_FILENAME, "rb");
+    ASSERT(vf, "");
+
+    uint8_t buf[sizeof(test_data)];
+    size_t sz = vfread(buf, 1, 4, vf);
+    ASSERTEQ(sz, 4, "");
+
+    ret = vfile_map_to_memory(vf);
+    if(!ret)
+      SKIP();
+
+    int flags = vfile_get_flags(vf);
+    ASSERT(flags & VF_MEMORY, "");
+    ASSERT(flags & VF_MEMORY_MAPPED, "");
+    ASSERT(~flags & VF_FILE, "");
+
+    // Should have rewound.
+    sz = vfread(buf, 1, sizeof(test_data), vf);
+    ASSERTEQ(sz, sizeof(test_data), "");
+    ASSERTMEM(buf, test_data, sizeof(test_data), "");
+
+    // Mapped files can't be remapped, but they're already in memory.
+    ret = vfile_map_to_memory(vf);
+    ASSERT(!ret, "");
+    ret = vfile_force_to_memory(vf);
+    ASSERT(ret, "");
+  }
+
+  SECTION(Write)
+  {
+    // This function should reject writes.
+    ScopedFile<vfile, vfclose> vf = vfopen_unsafe(TEST_READ_FILENAME, "r+b");
+    ASSERT(vf, "");
+
+    ret = vfile_map_to_memory(vf);
+    ASSERT(!ret, "");
+  }
+
+  SECTION(VFS)
+  {
+    // Cached files are already in memory and shouldn't be mapped.
+#ifndef VIRTUAL_FILESYSTEM
+    SKIP();
+#endif
+    vfssetup a(true);
+    ScopedFile<vfile, vfclose> vf = vfopen_unsafe(TEST_READ_FILENAME, "rb");
+    ASSERT(vf, "");
+
+    ret = vfile_map_to_memory(vf);
+    ASSERT(!ret, "");
+  }
+}
@@ -20,6 +20,10 @@
 #include "../Unit.hpp"
 #include "../UnitIO.hpp"
 
+#include <string>
+#include <vector>
+#include <zlib.h>
+
 #include "../../src/util.h"
 #include "../../src/io/memfile.h"
 #include "../../src/io/path.h"
@@ -958,8 +962,227 @@ UNITTEST(ZipRead)
     if(!has_files)
       FAIL("Add test zips with files to read!");
   }
+
+  SECTION(ReadRawFile)
+  {
+    for(const zip_test_data &d : raw_zip_data)
+    {
+      if(d.num_files)
+      {
+        has_files = true;
+        zp = zip_test_open(d, file_buffer, BUFFER_SIZE);
+        zip_check(d, zp);
+
+        // Decompress every file outside of the archive, attach the results,
+        // then read them back through the archive.
+        for(size_t j = 0; j < d.num_files; j++)
+        {
+          const zip_test_file_data &df = d.files[j];
+          struct memfile mf;
+
+          zp->pos = j;
+          result = zip_get_next_raw_file(zp, &mf);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j);
+          ASSERTEQ((size_t)(mf.end - mf.start), df.compressed_size, "%s file %zu", d.testname, j);
+
+          void *dest = malloc(MAX(df.uncompressed_size, 1));
+          ASSERT(dest, "%s file %zu", d.testname, j);
+          result = zip_decompress_raw_file(zp->files[j], mf.start, dest);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j);
+
+          result = zip_set_decompressed_file(zp, j, dest);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j);
+        }
+
+        zip_rewind(zp);
+        for(size_t j = 0; j < d.num_files; j++)
+        {
+          const zip_test_file_data &df = d.files[j];
+          size_t real_length = 0;
+
+          ASSERT(zp->files[j]->decompressed, "%s file %zu", d.testname, j);
+          result = zip_read_file(zp, buffer, BUFFER_SIZE, &real_length);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j);
+          ASSERTEQ(real_length, df.uncompressed_size, "%s file %zu", d.testname, j);
+          ASSERTEQ(zp->files[j]->decompressed, nullptr, "%s file %zu", d.testname, j);
+
+          if(real_length)
+          {
+            const char *contents = ZIP_GET_CONTENTS(df);
+            cmp = memcmp(buffer, contents, real_length);
+            ASSERTEQ(cmp, 0, "%s file %zu", d.testname, j);
+          }
+        }
+        result = zip_close(zp, nullptr);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s", d.testname);
+      }
+    }
+    if(!has_files)
+      FAIL("Add test zips with files to read!");
+  }
+
+  SECTION(FindFile)
+  {
+    for(const zip_test_data &d : raw_zip_data)
+    {
+      zp = zip_test_open(d);
+      zip_check(d, zp);
+
+      // Read the files in reverse order to make sure random access works.
+      for(size_t j = d.num_files; j > 0; j--)
+      {
+        const zip_test_file_data &df = d.files[j - 1];
+        size_t real_length = 0;
+
+        result = zip_find_file(zp, df.filename);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j - 1);
+        ASSERTEQ(zp->pos, j - 1, "%s file %zu", d.testname, j - 1);
+
+        result = zip_read_file(zp, buffer, BUFFER_SIZE, &real_length);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j - 1);
+        ASSERTEQ(real_length, df.uncompressed_size, "%s file %zu", d.testname, j - 1);
+
+        if(real_length)
+        {
+          const char *contents = ZIP_GET_CONTENTS(df);
+          cmp = memcmp(buffer, contents, real_length);
+          ASSERTEQ(cmp, 0, "%s file %zu", d.testname, j - 1);
+        }
+      }
+
+      result = zip_find_file(zp, "not a file in the archive");
+      ASSERTEQ(result, ZIP_FILE_NOT_FOUND, "%s", d.testname);
+
+      result = zip_close(zp, nullptr);
+      ASSERTEQ(result, ZIP_SUCCESS, "%s", d.testname);
+    }
+  }
+
+  SECTION(FindMZXFile)
+  {
+    for(const zip_test_data &d : raw_zip_data)
+    {
+      if(d.num_files)
+      {
+        has_files = true;
+        zp = zip_test_open(d);
+        zip_check(d, zp);
+
+        // Assign fake MZX properties; the index must be rebuilt after this.
+        for(size_t j = 0; j < d.num_files; j++)
+        {
+          zp->files[j]->mzx_file_id = j + 1;
+          zp->files[j]->mzx_board_id = j;
+          zp->files[j]->mzx_robot_id = 255 - j;
+        }
+        zip_clear_index(zp);
+
+        for(size_t j = d.num_files; j > 0; j--)
+        {
+          const zip_test_file_data &df = d.files[j - 1];
+          uint64_t real_length = 0;
+
+          result = zip_find_mzx_file(zp, j, j - 1, 256 - j);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j - 1);
+          ASSERTEQ(zp->pos, j - 1, "%s file %zu", d.testname, j - 1);
+
+          result = zip_read_open_file_stream(zp, &real_length);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j - 1);
+          ASSERTEQ(real_length, df.uncompressed_size, "%s file %zu", d.testname, j - 1);
+          result = zip_read_close_stream(zp);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s file %zu", d.testname, j - 1);
+        }
+
+        result = zip_find_mzx_file(zp, 1, 1, 255);
+        ASSERTEQ(result, ZIP_FILE_NOT_FOUND, "%s", d.testname);
+
+        result = zip_close(zp, nullptr);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s", d.testname);
+      }
+    }
+    if(!has_files)
+      FAIL("Add test zips with files to read!");
+  }
 }
 
+/**
+ * Compressor that holds onto a few files at a time and compresses them when
+ * they're flushed (see zip_set_write_compressor).
+ */
+struct test_compressor
+{
+  struct queued_file
+  {
+    std::string name;
+    std::vector<uint8_t> data;
+    int method;
+    uint16_t flags;
+  };
+  static constexpr size_t MAX_QUEUED = 2;
+  std::vector<queued_file> queued;
+  zip_stream_data *stream = zip_compress_stream_create(ZIP_M_DEFLATE);
+  size_t num_flushes = 0;
+
+  ~test_compressor()
+  {
+    zip_compress_stream_destroy(ZIP_M_DEFLATE, stream);
+  }
+
+  static boolean queue(void *priv, const char *name, const void *src,
+   size_t src_len, int method, uint16_t flags)
+  {
+    test_compressor *tc = reinterpret_cast<test_compressor *>(priv);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(src);
+    if(tc->queued.size() >= MAX_QUEUED)
+      return false;
+
+    tc->queued.push_back({ name, { data, data + src_len }, method, flags });
+    return true;
+  }
+
+  static enum zip_error flush(void *priv, struct zip_archive *zp)
+  {
+    test_compressor *tc = reinterpret_cast<test_compressor *>(priv);
+    tc->num_flushes++;
+
+    for(queued_file &f : tc->queued)
+    {
+      struct zip_file_header fh{};
+      void *dest = nullptr;
+      enum zip_error result;
+
+      fh.method = f.method;
+      fh.flags = f.flags;
+      fh.uncompressed_size = f.data.size();
+      fh.compressed_size = f.data.size();
+      if(f.method == ZIP_M_NONE)
+      {
+        fh.crc32 = crc32(0, f.data.data(), f.data.size());
+        result = zip_write_raw_file(zp, f.name.c_str(), &fh, f.data.data());
+      }
+      else
+      {
+        result = zip_compress_raw_file(tc->stream, &fh, f.data.data(), &dest);
+        if(result)
+          return result;
+
+        result = zip_write_raw_file(zp, f.name.c_str(), &fh, dest);
+        free(dest);
+      }
+      if(result)
+        return result;
+    }
+    tc->queued.clear();
+    return ZIP_SUCCESS;
+  }
+};
+
+static const struct zip_write_compressor test_compressor_spec =
+{
+  test_compressor::queue,
+  test_compressor::flush,
+};
+
 static void verify_boilerplate(const zip_test_data &d, struct zip_archive *zp,
  const char *label, char *verify_buffer, char *db64_buffer)
 {
@@ -988,6 +1211,7 @@ UNITTEST(ZipWrite)
 {
   ScopedPtr<char[]> verify_buffer = new char[BUFFER_SIZE];
   ScopedPtr<char[]> db64_buffer = new char[BUFFER_SIZE];
+  ScopedPtr<char[]> file_buffer = new char[BUFFER_SIZE];
   // This buffer needs to be resized by C code...
   char *ext_buffer = (char *)cmalloc(32);
   size_t ext_buffer_size = 32;
@@ -998,7 +1222,7 @@ UNITTEST(ZipWrite)
   enum zip_error result;
   uint64_t final_size;
 
-  ASSERT(verify_buffer && db64_buffer, "");
+  ASSERT(verify_buffer && db64_buffer && file_buffer, "");
 
   SECTION(WriteFile)
   {
@@ -1083,6 +1307,111 @@ UNITTEST(ZipWrite)
     }
   }
 
+  // Copy the compressed data of every file from another archive.
+  SECTION(WriteRawFile)
+  {
+    for(int type = 0; type < 4; type++)
+    {
+      const char *label = LABEL[type];
+      for(const zip_test_data &d : raw_zip_data)
+      {
+        struct zip_archive *src = zip_test_open(d, file_buffer, BUFFER_SIZE);
+        ASSERT(src, "%s %s", label, d.testname);
+
+        if(type < 2)
+          zp = zip_open_file_write(OUTPUT_FILE);
+        else
+          zp = zip_open_mem_write_ext((void **)&ext_buffer, &ext_buffer_size, 0);
+
+        ASSERT(zp, "%s %s", label, d.testname);
+
+        zip_set_zip64_enabled(zp, type & 1);
+
+        for(size_t j = 0; j < d.num_files; j++)
+        {
+          const zip_test_file_data &df = d.files[j];
+          struct memfile mf;
+
+          result = zip_get_next_raw_file(src, &mf);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+          result = zip_write_raw_file(zp, df.filename, src->files[j], mf.start);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+          result = zip_skip_file(src);
+          ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+        }
+        result = zip_close(src, nullptr);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s %s", label, d.testname);
+        result = zip_close(zp, &final_size);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s %s", label, d.testname);
+
+        if(type < 2)
+          zp = zip_open_file_read(OUTPUT_FILE);
+        else
+          zp = zip_open_mem_read(ext_buffer, final_size);
+
+        verify_boilerplate(d, zp, label, verify_buffer, db64_buffer);
+      }
+    }
+  }
+
+  // Hand files to a compressor that writes them later, mixed with streams,
+  // which need to be written after everything the compressor has.
+  SECTION(WriteCompressor)
+  {
+    for(int type = 0; type < 4; type++)
+    {
+      const char *label = LABEL[type];
+      for(const zip_test_data &d : raw_zip_data)
+      {
+        test_compressor tc;
+        ASSERT(tc.stream, "%s %s", label, d.testname);
+
+        if(type < 2)
+          zp = zip_open_file_write(OUTPUT_FILE);
+        else
+          zp = zip_open_mem_write_ext((void **)&ext_buffer, &ext_buffer_size, 0);
+
+        ASSERT(zp, "%s %s", label, d.testname);
+
+        zip_set_zip64_enabled(zp, type & 1);
+        result = zip_set_write_compressor(zp, &test_compressor_spec, &tc);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s %s", label, d.testname);
+
+        for(size_t j = 0; j < d.num_files; j++)
+        {
+          const zip_test_file_data &df = d.files[j];
+          const char *contents = ZIP_GET_CONTENTS(df);
+
+          if(j % 4 == 3)
+          {
+            result = zip_write_open_file_stream(zp, df.filename, df.method);
+            ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+            result = zwrite(contents, df.uncompressed_size, zp);
+            ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+            result = zip_write_close_stream(zp);
+          }
+          else
+          {
+            result = zip_write_file(zp, df.filename, (const void *)contents,
+             df.uncompressed_size, df.method);
+          }
+          ASSERTEQ(result, ZIP_SUCCESS, "%s %s %zu", label, d.testname, j);
+        }
+        result = zip_close(zp, &final_size);
+        ASSERTEQ(result, ZIP_SUCCESS, "%s %s", label, d.testname);
+        ASSERT(tc.queued.empty(), "%s %s", label, d.testname);
+        ASSERT(tc.num_flushes > 0, "%s %s", label, d.testname);
+
+        if(type < 2)
+          zp = zip_open_file_read(OUTPUT_FILE);
+        else
+          zp = zip_open_mem_read(ext_buffer, final_size);
+
+        verify_boilerplate(d, zp, label, verify_buffer, db64_buffer);
+      }
+    }
+  }
+
   // This is a special version of streaming that allows direct write access to
   // the buffer. This only works with the STORE method and likely doesn't work
   // very well with expandable buffers right now.
@@ -1235,6 +1564,14 @@ UNITTEST(Zip64)
       result = zip_read_close_stream(zp);
       ASSERTEQ(result, ZIP_SUCCESS, "");
     }
+
+    // Every file should be reachable through the index.
+    for(size_t i = zp->num_files; i > 0; i--)
+    {
+      result = zip_find_file(zp, zp->files[i - 1]->file_name);
+      ASSERTEQ(result, ZIP_SUCCESS, "%zu", i - 1);
+      ASSERTEQ(zp->pos, i - 1, "%zu", i - 1);
+    }
     zip_close(zp, NULL);
   }
 
@@ -0,0 +1,222 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for placing MZMs. More comprehensive MZM testing is performed by the
+ * test worlds.
+ */
+
+#include "Unit.hpp"
+#include "UnitWorld.hpp"
+
+#include "../src/board_struct.h"
+#include "../src/data.h"
+#include "../src/mzm.h"
+#include "../src/robot_struct.h"
+
+#include <string>
+#include <time.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <utime.h>
+#endif
+
+static const char TEST_WORLD[] =
+ "../../testworlds/2.92/004 Robot position.mzx";
+static const char TEST_MZM[] = "_mzm_tmp.mzm";
+
+struct board_copy
+{
+  int width;
+  int height;
+  std::vector<uint8_t> id;
+  std::vector<uint8_t> param;
+  std::vector<uint8_t> color;
+  std::vector<uint8_t> under_id;
+  std::vector<uint8_t> under_param;
+  std::vector<uint8_t> under_color;
+  std::vector<std::string> robot_name;
+
+  board_copy(const struct board *b):
+   width(b->board_width), height(b->board_height)
+  {
+    size_t size = width * height;
+    id.assign(b->level_id, b->level_id + size);
+    param.assign(b->level_param, b->level_param + size);
+    color.assign(b->level_color, b->level_color + size);
+    under_id.assign(b->level_under_id, b->level_under_id + size);
+    under_param.assign(b->level_under_param, b->level_under_param + size);
+    under_color.assign(b->level_under_color, b->level_under_color + size);
+    robot_name.resize(size);
+
+    for(size_t i = 0; i < size; i++)
+      if(is_robot((enum thing)id[i]))
+        robot_name[i] = b->robot_list[param[i]]->robot_name;
+  }
+};
+
+/**
+ * Every robot should be on a robot cell that refers back to it.
+ */
+static int check_robots(const struct board *b)
+{
+  int count = 0;
+  int i;
+
+  for(i = 1; i <= b->num_robots; i++)
+  {
+    const struct robot *cur_robot = b->robot_list[i];
+    int offset;
+    if(!cur_robot)
+      continue;
+
+    offset = cur_robot->xpos + cur_robot->ypos * b->board_width;
+    ASSERT(is_robot((enum thing)b->level_id[offset]), "robot %d", i);
+    ASSERTEQ(b->level_param[offset], i, "robot %d", i);
+    count++;
+  }
+  return count;
+}
+
+/**
+ * Check an MZM of the entire source board placed at (start_x, start_y). It
+ * should be clipped to the bottom right corner of the board, and only the
+ * robots from the part of the MZM on the board should have been placed.
+ * Returns the number of robots placed.
+ */
+static int check_placed_mzm(const struct board *b, const board_copy &src,
+ const board_copy &prev, int start_x, int start_y)
+{
+  int placed_robots = 0;
+  int other_robots = 0;
+  int x;
+  int y;
+
+  for(y = 0; y < src.height; y++)
+  {
+    for(x = 0; x < src.width; x++)
+    {
+      int d = x + y * src.width;
+      int s = (x - start_x) + (y - start_y) * src.width;
+
+      if(x < start_x || y < start_y)
+      {
+        // Outside of the MZM; this shouldn't have changed.
+        ASSERTEQ(b->level_id[d], prev.id[d], "%d,%d", x, y);
+        if(is_robot((enum thing)prev.id[d]))
+          other_robots++;
+        continue;
+      }
+
+      // The player isn't overwritten, and MZMs don't contain it.
+      if(prev.id[d] == PLAYER || src.id[s] == PLAYER)
+        continue;
+
+      ASSERTEQ(b->level_id[d], src.id[s], "%d,%d", x, y);
+      ASSERTEQ(b->level_color[d], src.color[s], "%d,%d", x, y);
+      ASSERTEQ(b->level_under_id[d], src.under_id[s], "%d,%d", x, y);
+      ASSERTEQ(b->level_under_param[d], src.under_param[s], "%d,%d", x, y);
+      ASSERTEQ(b->level_under_color[d], src.under_color[s], "%d,%d", x, y);
+
+      if(is_robot((enum thing)src.id[s]))
+      {
+        const struct robot *cur_robot =
+         b->robot_list[(uint8_t)b->level_param[d]];
+        ASSERT(cur_robot, "%d,%d", x, y);
+        ASSERTEQ(cur_robot->xpos, x, "%d,%d", x, y);
+        ASSERTEQ(cur_robot->ypos, y, "%d,%d", x, y);
+        ASSERTCMP(cur_robot->robot_name, src.robot_name[s].c_str(),
+         "%d,%d", x, y);
+        placed_robots++;
+      }
+      else
+        ASSERTEQ(b->level_param[d], src.param[s], "%d,%d", x, y);
+    }
+  }
+
+  ASSERTEQ(check_robots(b), placed_robots + other_robots, "");
+  return placed_robots;
+}
+
+UNITTEST(BoardClipped)
+{
+  char path[MAX_PATH];
+  struct board *b;
+  int start_x;
+  int start_y;
+  int placed;
+
+  unit::world w;
+  w.temp_path(path, TEST_MZM);
+
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+  b = w.mzx_world->current_board;
+  ASSERT(b->board_width >= 2 && b->board_height >= 2, "");
+
+  // Clip the MZM on both axes, leaving some robots out.
+  start_x = b->board_width / 2;
+  start_y = b->board_height / 2;
+
+  save_mzm(w.mzx_world, path, 0, 0, b->board_width, b->board_height,
+   MZM_BOARD_TO_BOARD_STORAGE, 1);
+
+  board_copy src(b);
+  board_copy prev(b);
+  int src_robots = check_robots(b);
+  ASSERT(src_robots > 0, "");
+
+  SECTION(NoCache)
+  {
+    get_config()->mzm_cache_memory = 0;
+
+    ASSERTEQ(load_mzm(w.mzx_world, path, start_x, start_y, MZM_LOAD_TO_BOARD,
+     1, CUSTOM_BLOCK), 0, "");
+    ASSERT(!w.mzx_world->mzm_cache, "");
+    placed = check_placed_mzm(b, src, prev, start_x, start_y);
+    ASSERT(placed > 0 && placed < src_robots, "%d", placed);
+  }
+
+  SECTION(Cache)
+  {
+#ifndef _WIN32
+    // Recently modified MZMs aren't cached, so make this one older.
+    struct utimbuf t;
+    t.actime = time(NULL) - 10;
+    t.modtime = t.actime;
+    ASSERTEQ(utime(path, &t), 0, "");
+#else
+    SKIP();
+#endif
+    get_config()->mzm_cache_memory = 1 << 20;
+
+    ASSERTEQ(load_mzm(w.mzx_world, path, start_x, start_y, MZM_LOAD_TO_BOARD,
+     1, CUSTOM_BLOCK), 0, "");
+    ASSERT(w.mzx_world->mzm_cache, "");
+    placed = check_placed_mzm(b, src, prev, start_x, start_y);
+    ASSERT(placed > 0 && placed < src_robots, "%d", placed);
+
+    // Placing it again from the cache should replace the robots placed
+    // the first time.
+    board_copy prev2(b);
+    ASSERTEQ(load_mzm(w.mzx_world, path, start_x, start_y, MZM_LOAD_TO_BOARD,
+     1, CUSTOM_BLOCK), 0, "");
+    ASSERTEQ(check_placed_mzm(b, src, prev2, start_x, start_y), placed, "");
+  }
+}
@@ -0,0 +1,591 @@
+/* MegaZeux
+ *
+ * Copyright (C) 2026 MegaZeux developers (github.com/AliceLR/megazeux)
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * Tests for strings that can't easily be performed by the test worlds.
+ */
+
+#include "Unit.hpp"
+#include "UnitWorld.hpp"
+
+#include "../src/counter.h"
+#include "../src/mzm.h"
+#include "../src/str.h"
+#include "../src/io/vio.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const char TEST_WORLD[] = "../../testworlds/2.93/000 Format.mzx";
+static const char TEST_FILE[] = "_str_tmp.txt";
+
+static void set(struct world *mzx_world, const char *name, std::string value)
+{
+  char buffer[ROBOT_MAX_TR];
+  struct string src{};
+
+  snprintf(buffer, sizeof(buffer), "%s", name);
+  src.value = &value[0];
+  src.length = value.size();
+  set_string(mzx_world, buffer, &src, nullptr, 0);
+}
+
+/**
+ * Set a string the way SET "$dest" "$src" does, sharing the value if possible.
+ */
+static void set_from(struct world *mzx_world, const char *name,
+ const char *src_name)
+{
+  char buffer[ROBOT_MAX_TR];
+  char src_buffer[ROBOT_MAX_TR];
+  struct string *source;
+  struct string src;
+
+  snprintf(buffer, sizeof(buffer), "%s", name);
+  snprintf(src_buffer, sizeof(src_buffer), "%s", src_name);
+  ASSERT(get_string_source(mzx_world, src_buffer, &src, &source, 0), "%s",
+   src_name);
+  set_string(mzx_world, buffer, &src, source, 0);
+}
+
+static std::string get(struct world *mzx_world, const char *name)
+{
+  char buffer[ROBOT_MAX_TR];
+  struct string src;
+
+  snprintf(buffer, sizeof(buffer), "%s", name);
+  ASSERT(get_string(mzx_world, buffer, &src, 0), "%s", name);
+  return std::string(src.value, src.length);
+}
+
+/**
+ * Write a string as a counter. This modifies the name, so it needs a buffer.
+ */
+static void set_as_counter(struct world *mzx_world, const char *name,
+ int value)
+{
+  char buffer[ROBOT_MAX_TR];
+  snprintf(buffer, sizeof(buffer), "%s", name);
+  set_counter(mzx_world, buffer, value, 0);
+}
+
+static boolean is_shared(struct world *mzx_world, const char *a, const char *b)
+{
+  const struct string *str_a = get_string_pointer(mzx_world, a, 0);
+  const struct string *str_b = get_string_pointer(mzx_world, b, 0);
+  ASSERT(str_a && str_b, "%s %s", a, b);
+  return str_a->value == str_b->value;
+}
+
+UNITTEST(SharedValues)
+{
+  std::string value_a;
+  std::string value_b;
+  std::string tmp;
+  size_t i;
+
+  unit::world w;
+  struct world *mzx_world = w.mzx_world;
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+
+  for(i = 0; i < 400; i++)
+    value_a += (char)('a' + i % 26);
+
+  set(mzx_world, "$a", value_a);
+
+  SECTION(Short)
+  {
+    // Values that are too short to be worth sharing are copied.
+    set(mzx_world, "$c", "short value");
+    set_from(mzx_world, "$b", "$c");
+    ASSERT(!is_shared(mzx_world, "$b", "$c"), "");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), "short value", "");
+  }
+
+  SECTION(Splice)
+  {
+    // Only views at the start of another string are shared.
+    set_from(mzx_world, "$b", "$a#300");
+    ASSERT(is_shared(mzx_world, "$a", "$b"), "");
+    set_from(mzx_world, "$c", "$a+10#300");
+    ASSERT(!is_shared(mzx_world, "$a", "$c"), "");
+    ASSERTCMP(get(mzx_world, "$c").c_str(), value_a.substr(10, 300).c_str(),
+     "");
+
+    // Splice writes to either string.
+    set(mzx_world, "$b+10#5", "XXXXX");
+    set(mzx_world, "$a+20#5", "YYYYY");
+    ASSERT(!is_shared(mzx_world, "$a", "$b"), "");
+
+    value_b = value_a.substr(0, 300);
+    value_b.replace(10, 5, "XXXXX");
+    value_a.replace(20, 5, "YYYYY");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), value_b.c_str(), "");
+  }
+
+  SECTION(SpliceAppend)
+  {
+    // A splice past the end of a shared string with room to spare.
+    set_from(mzx_world, "$b", "$a#300");
+    set(mzx_world, "$b+300", "XXXXX");
+    ASSERT(!is_shared(mzx_world, "$a", "$b"), "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+    ASSERTCMP(get(mzx_world, "$b").c_str(),
+     (value_a.substr(0, 300) + "XXXXX").c_str(), "");
+  }
+
+  SECTION(Index)
+  {
+    set_from(mzx_world, "$b", "$a");
+    set_as_counter(mzx_world, "$b.3", 'X');
+    set_as_counter(mzx_world, "$b.length", 350);
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+
+    value_b = value_a.substr(0, 350);
+    value_b[3] = 'X';
+    ASSERTCMP(get(mzx_world, "$b").c_str(), value_b.c_str(), "");
+  }
+
+  SECTION(Inc)
+  {
+    char buffer[ROBOT_MAX_TR] = "$b";
+    struct string src{};
+
+    // The shared value has room for this without reallocating.
+    set_from(mzx_world, "$b", "$a#300");
+    src.value = (char *)"XXXXX";
+    src.length = 5;
+    inc_string(mzx_world, buffer, &src, 0);
+    ASSERT(!is_shared(mzx_world, "$a", "$b"), "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+    ASSERTCMP(get(mzx_world, "$b").c_str(),
+     (value_a.substr(0, 300) + "XXXXX").c_str(), "");
+
+    // Increment by a view of the other string.
+    set_from(mzx_world, "$b", "$a#300");
+    ASSERT(get_string(mzx_world, buffer, &src, 0), "");
+    inc_string(mzx_world, buffer, &src, 0);
+    ASSERT(!is_shared(mzx_world, "$a", "$b"), "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+    tmp = value_a.substr(0, 300);
+    ASSERTCMP(get(mzx_world, "$b").c_str(), (tmp + tmp).c_str(), "");
+  }
+
+  SECTION(Dec)
+  {
+    set_from(mzx_world, "$b", "$a");
+    dec_string_int(mzx_world, "$b", 100, 0);
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), value_a.substr(0, 300).c_str(),
+     "");
+  }
+
+  SECTION(FREAD)
+  {
+    char path[MAX_PATH];
+    FILE *fp;
+
+    w.temp_path(path, TEST_FILE);
+    fp = fopen_unsafe(path, "wb");
+    ASSERT(fp, "");
+    fputs("first line\nsecond line\nthird", fp);
+    fclose(fp);
+
+    mzx_world->input_file = vfopen_unsafe(path, "rb");
+    mzx_world->input_is_dir = false;
+    mzx_world->fread_delimiter = '\n';
+    ASSERT(mzx_world->input_file, "");
+
+    // Delimited read.
+    set_from(mzx_world, "$b", "$a");
+    set(mzx_world, "$b", "fread");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), "first line", "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+
+    // Delimited read to a splice.
+    set_from(mzx_world, "$b", "$a");
+    set(mzx_world, "$b+10", "fread");
+    value_b = value_a;
+    value_b.replace(10, 11, "second line");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), value_b.c_str(), "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+
+    // Fixed length read.
+    set_from(mzx_world, "$b", "$a");
+    set(mzx_world, "$b", "fread3");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), "thi", "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+
+    vfclose(mzx_world->input_file);
+    mzx_world->input_file = nullptr;
+  }
+
+  SECTION(SaveMZM)
+  {
+    const struct string *str;
+
+    set_from(mzx_world, "$b", "$a");
+    save_mzm_string(mzx_world, "$b", 0, 0, 4, 4,
+     MZM_BOARD_TO_BOARD_STORAGE, 1, 0);
+    ASSERT(!is_shared(mzx_world, "$a", "$b"), "");
+    ASSERTCMP(get(mzx_world, "$a").c_str(), value_a.c_str(), "");
+
+    str = get_string_pointer(mzx_world, "$b", 0);
+    ASSERTMEM(str->value, "MZM3", 4, "");
+  }
+
+  SECTION(Counter)
+  {
+    // Reading one string as a counter shouldn't affect the cached value of
+    // the other.
+    set(mzx_world, "$a", "12345" + std::string(300, ' '));
+    set_from(mzx_world, "$b", "$a");
+    ASSERTEQ(get_counter(mzx_world, "$a", 0), 12345, "");
+    ASSERTEQ(get_counter(mzx_world, "$b", 0), 12345, "");
+    set(mzx_world, "$b", "54321" + std::string(300, ' '));
+    ASSERTEQ(get_counter(mzx_world, "$a", 0), 12345, "");
+    ASSERTEQ(get_counter(mzx_world, "$b", 0), 54321, "");
+    set(mzx_world, "$b+0#2", "99");
+    ASSERTEQ(get_counter(mzx_world, "$a", 0), 12345, "");
+    ASSERTEQ(get_counter(mzx_world, "$b", 0), 99321, "");
+  }
+}
+
+UNITTEST(FREAD_delimited)
+{
+  static const char *lines[] =
+  {
+    "short",
+    "",
+    nullptr, // long line
+    "last line",
+  };
+  std::string long_line;
+  std::string data;
+  char path[MAX_PATH];
+  FILE *fp;
+  size_t pos;
+  size_t i;
+
+  unit::world w;
+  struct world *mzx_world = w.mzx_world;
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+
+  for(i = 0; i < 3000; i++)
+    long_line += (char)('a' + i % 26);
+
+  for(i = 0; i < (size_t)arraysize(lines); i++)
+  {
+    data += lines[i] ? lines[i] : long_line;
+    if(i + 1 < (size_t)arraysize(lines))
+      data += '\n';
+  }
+
+  w.temp_path(path, TEST_FILE);
+  fp = fopen_unsafe(path, "wb");
+  ASSERT(fp, "");
+  fwrite(data.data(), data.size(), 1, fp);
+  fclose(fp);
+
+  mzx_world->input_file = vfopen_unsafe(path, "rb");
+  mzx_world->input_is_dir = false;
+  mzx_world->fread_delimiter = '\n';
+  ASSERT(mzx_world->input_file, "");
+
+  SECTION(Small)
+  {
+    set(mzx_world, "$b", "");
+  }
+
+  SECTION(LargeAllocation)
+  {
+    // Reads into a string with a large allocation should still only read
+    // the current line from the file.
+    set(mzx_world, "$b", std::string(100000, ' '));
+    set(mzx_world, "$b", "");
+    ASSERT(get_string_pointer(mzx_world, "$b", 0)->allocated_length >= 100000,
+     "");
+  }
+
+  pos = 0;
+  for(i = 0; i < (size_t)arraysize(lines); i++)
+  {
+    const char *expected = lines[i] ? lines[i] : long_line.c_str();
+
+    set(mzx_world, "$b", "fread");
+    ASSERTCMP(get(mzx_world, "$b").c_str(), expected, "%zu", i);
+
+    pos = std::min(pos + strlen(expected) + 1, data.size());
+    ASSERTEQ((size_t)vftell(mzx_world->input_file), pos, "%zu", i);
+  }
+
+  // At the end of the file.
+  set(mzx_world, "$b", "fread");
+  ASSERTCMP(get(mzx_world, "$b").c_str(), "", "");
+
+  vfclose(mzx_world->input_file);
+  mzx_world->input_file = nullptr;
+}
+
+/**
+ * Simple dynamic programming wildcard matcher to compare compare_strings to.
+ */
+static bool wildcard_reference(const std::string &str, const std::string &pat,
+ bool exact_case)
+{
+  enum { LITERAL, ANY_CHAR, ANY_STRING };
+  std::vector<std::pair<int, char>> tokens;
+  size_t i;
+  size_t j;
+
+  for(i = 0; i < pat.size(); i++)
+  {
+    char c = pat[i];
+    if(c == '%')
+      tokens.push_back({ ANY_STRING, 0 });
+    else
+
+    if(c == '?')
+      tokens.push_back({ ANY_CHAR, 0 });
+    else
+    {
+      if(c == '\\' && i + 1 < pat.size() &&
+       (pat[i + 1] == '%' || pat[i + 1] == '?' || pat[i + 1] == '\\'))
+        c = pat[++i];
+
+      tokens.push_back({ LITERAL, c });
+    }
+  }
+
+  // match[i][j]: str from i matches tokens from j.
+  std::vector<std::vector<bool>> match(str.size() + 1,
+   std::vector<bool>(tokens.size() + 1, false));
+
+  match[str.size()][tokens.size()] = true;
+  for(i = str.size() + 1; i-- > 0;)
+  {
+    for(j = tokens.size(); j-- > 0;)
+    {
+      int type = tokens[j].first;
+      char c = tokens[j].second;
+
+      if(type == ANY_STRING)
+        match[i][j] = match[i][j + 1] || (i < str.size() && match[i + 1][j]);
+      else
+
+      if(i < str.size() && (type == ANY_CHAR ||
+       (exact_case ? str[i] == c : tolower(str[i]) == tolower(c))))
+        match[i][j] = match[i + 1][j + 1];
+    }
+  }
+  return match[0][0];
+}
+
+static bool wildcard_match(const std::string &str, const std::string &pat,
+ bool exact_case, int version = V294)
+{
+  static struct world mzx_world;
+  struct string a{};
+  struct string b{};
+
+  mzx_world.version = version;
+
+  a.value = const_cast<char *>(str.data());
+  a.length = str.size();
+  b.value = const_cast<char *>(pat.data());
+  b.length = pat.size();
+  return compare_strings(&mzx_world, &a, &b, exact_case, true) == 0;
+}
+
+struct wildcard_data
+{
+  const char *str;
+  const char *pat;
+  bool exact_case;
+  bool expected;
+};
+
+static const wildcard_data wildcard_tests[] =
+{
+  // Empty strings and patterns.
+  { "",             "",             false,  true },
+  { "a",            "",             false,  false },
+  { "",             "%",            false,  true },
+  { "",             "%%%",          false,  true },
+  { "",             "?",            false,  false },
+  { "abc",          "%",            false,  true },
+  // No % wildcards.
+  { "abc",          "abc",          true,   true },
+  { "abc",          "a?c",          true,   true },
+  { "abc",          "ab",           true,   false },
+  { "abc",          "abcd",         true,   false },
+  { "abc",          "???",          true,   true },
+  { "abc",          "????",         true,   false },
+  // Case sensitivity.
+  { "Hello",        "%L%",          false,  true },
+  { "Hello",        "%L%",          true,   false },
+  { "Hello",        "hELLO",        false,  true },
+  { "Hello",        "hELLO",        true,   false },
+  { "Hello",        "h%O",          false,  true },
+  // Multiple % groups.
+  { "Hello World",  "%l%o%W%",      false,  true },
+  { "Hello World",  "%o%o%o%",      false,  false },
+  { "abcabc",       "%c%c",         true,   true },
+  { "abcabc",       "%b%b%b%",      true,   false },
+  { "abcabc",       "a%b%c",        true,   true },
+  { "abcabc",       "a%b%b",        true,   false },
+  { "aaaa",         "%aa%aa%",      true,   true },
+  { "aaa",          "%aa%aa%",      true,   false },
+  { "xaybzc",       "x%?b%c",       true,   true },
+  { "xaybzc",       "%?y%?z?",      true,   true },
+  { "xaybzc",       "%?y%??z?",     true,   false },
+  { "ab",           "%a%b%",        true,   true },
+  { "ba",           "%a%b%",        true,   false },
+  // Escapes.
+  { "50%",          "50\\%",        true,   true },
+  { "50x",          "50\\%",        true,   false },
+  { "a?",           "%\\?",         true,   true },
+  { "ab",           "%\\?",         true,   false },
+  { "a\\",          "a\\\\",        true,   true },
+  { "a\\",          "a\\",          true,   true },
+  { "a\\b",         "a\\b",         true,   true },
+  { "ab",           "a\\",          true,   false },
+};
+
+UNITTEST(Wildcards)
+{
+  SECTION(Table)
+  {
+    for(const wildcard_data &d : wildcard_tests)
+    {
+      ASSERTEQ(wildcard_reference(d.str, d.pat, d.exact_case), d.expected,
+       "'%s' '%s' %d", d.str, d.pat, d.exact_case);
+
+      // The second comparison is from the cache.
+      ASSERTEQ(wildcard_match(d.str, d.pat, d.exact_case), d.expected,
+       "'%s' '%s' %d", d.str, d.pat, d.exact_case);
+      ASSERTEQ(wildcard_match(d.str, d.pat, d.exact_case), d.expected,
+       "'%s' '%s' %d", d.str, d.pat, d.exact_case);
+    }
+  }
+
+  SECTION(Legacy)
+  {
+    // Worlds prior to 2.94 keep the results of the old matcher, including
+    // case-sensitive comparison of a letter following %.
+    ASSERT(!wildcard_match("Hello", "%L%", false, V293), "");
+    ASSERT(wildcard_match("Hello", "h%O", false, V293), "");
+    ASSERT(wildcard_match("Hello", "hELLO", false, V293), "");
+    ASSERT(wildcard_match("Hello World", "%l%o%W%", true, V293), "");
+    ASSERT(!wildcard_match("Hello World", "%o%o%o%", true, V293), "");
+    ASSERT(wildcard_match("50%", "50\\%", true, V293), "");
+    ASSERT(!wildcard_match("50x", "50\\%", true, V293), "");
+    ASSERT(wildcard_match("abc", "a?c", true, V293), "");
+
+    ASSERT(wildcard_match("Hello", "%L%", false, V294), "");
+    ASSERT(wildcard_match("Hello", "h%O", false, V294), "");
+  }
+
+  SECTION(LongPatterns)
+  {
+    // Patterns too long to be cached.
+    std::string str;
+    std::string pat;
+    size_t i;
+
+    for(i = 0; i < 200; i++)
+      str += (char)('a' + i % 26);
+
+    ASSERT(wildcard_match(str, str, true), "");
+    ASSERT(wildcard_match(str, "%" + str.substr(100), true), "");
+    ASSERT(wildcard_match(str, str.substr(0, 100) + "%", true), "");
+    ASSERT(!wildcard_match(str, str.substr(0, 100) + "?", true), "");
+
+    for(i = 0; i < 100; i++)
+      pat += (i % 5 == 0) ? "%" : (i % 7 == 0) ? "?" : str.substr(i, 1);
+
+    ASSERT(pat.size() > 64, "");
+    ASSERTEQ(wildcard_match(str, pat, true),
+     wildcard_reference(str, pat, true), "");
+    ASSERTEQ(wildcard_match(str, pat + "z", true),
+     wildcard_reference(str, pat + "z", true), "");
+  }
+
+  SECTION(Random)
+  {
+    // Many more patterns than cache entries, compared in an order that
+    // reuses, replaces, and collides with cached patterns.
+    static const char pat_chars[] = "aAbB%%??\\";
+    static const char str_chars[] = "aAbB%?\\";
+    std::vector<std::string> patterns;
+    std::vector<std::string> strings;
+    uint32_t seed = 1;
+    size_t matches = 0;
+    size_t i;
+    size_t j;
+
+    auto rand_str = [&seed](const char *chars, size_t num_chars, size_t len)
+    {
+      std::string tmp;
+      while(len--)
+      {
+        seed = seed * 1103515245u + 12345u;
+        tmp += chars[(seed >> 16) % num_chars];
+      }
+      return tmp;
+    };
+
+    for(i = 0; i < 300; i++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      patterns.push_back(rand_str(pat_chars, sizeof(pat_chars) - 1,
+       (seed >> 16) % 80));
+    }
+    for(i = 0; i < 40; i++)
+    {
+      seed = seed * 1103515245u + 12345u;
+      strings.push_back(rand_str(str_chars, sizeof(str_chars) - 1,
+       (seed >> 16) % 16));
+    }
+
+    for(j = 0; j < strings.size(); j++)
+    {
+      for(i = 0; i < patterns.size(); i++)
+      {
+        const std::string &str = strings[j];
+        const std::string &pat = patterns[(i * 7 + j) % patterns.size()];
+        bool exact_case = (i + j) & 1;
+
+        bool expected = wildcard_reference(str, pat, exact_case);
+
+        ASSERTEQ(wildcard_match(str, pat, exact_case), expected,
+         "'%s' '%s' %d", str.c_str(), pat.c_str(), exact_case);
+        ASSERTEQ(wildcard_match(str, pat, !exact_case),
+         wildcard_reference(str, pat, !exact_case),
+         "'%s' '%s' %d", str.c_str(), pat.c_str(), !exact_case);
+        matches += expected;
+      }
+    }
+    ASSERT(matches > 100, "%zu", matches);
+  }
+}
@@ -23,15 +23,24 @@
  */
 
 #include "Unit.hpp"
+#include "UnitWorld.hpp"
 
-#include "../src/world.h"
+#include "../src/counter.h"
+#include "../src/extmem.h"
+#include "../src/str.h"
 #include "../src/world_format.h"
 #include "../src/io/memfile.h"
+#include "../src/io/vio.h"
 #include "../src/io/zip.h"
 
 #include "../src/network/Scoped.hpp"
 
+#include <algorithm>
 #include <limits.h>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 /**
  * world.c functions.
@@ -74,7 +83,7 @@ UNITTEST(Magic)
     { "M\x02\x5B",  "MZS\x02\x5B",  "2.91",   V291 },
     { "M\x02\x5C",  "MZS\x02\x5C",  "2.92",   V292 },
     { "M\x02\x5D",  "MZS\x02\x5D",  "2.93",   V293 },
-    { "M\x02\x5E",  "MZS\x02\x5E",  "2.94",   0x025E },
+    { "M\x02\x5E",  "MZS\x02\x5E",  "2.94",   V294 },
     { "M\x02\x5F",  "MZS\x02\x5F",  "2.95",   0x025F },
     { "M\x03\x00",  "MZS\x03\x00",  "3.00",   0x0300 },
     { "M\x09\xFF",  "MZS\x09\xFF",  "9.255",  0x09FF },
@@ -218,6 +227,9 @@ UNITTEST(world_assign_file_ids)
       { "spr",      ZIP_M_DEFLATE },  // Save only.
       { "counter",  ZIP_M_DEFLATE },  // Save only.
       { "string",   ZIP_M_DEFLATE },  // Save only.
+      { "ctrbulk",  ZIP_M_DEFLATE },  // Save only (2.94+).
+      { "strbulk",  ZIP_M_DEFLATE },  // Save only (2.94+).
+      { "ctrarr",   ZIP_M_DEFLATE },  // Save only (2.94+).
       { "b00",      ZIP_M_NONE },
       { "b01",      ZIP_M_NONE },
       { "b01bid",   ZIP_M_DEFLATE },
@@ -306,6 +318,9 @@ UNITTEST(world_assign_file_ids)
       { "spr",      FILE_ID_WORLD_SPRITES,        0,  0 },
       { "counter",  FILE_ID_WORLD_COUNTERS,       0,  0 },
       { "string",   FILE_ID_WORLD_STRINGS,        0,  0 },
+      { "ctrbulk",  FILE_ID_WORLD_COUNTERS_BULK,  0,  0 },
+      { "strbulk",  FILE_ID_WORLD_STRINGS_BULK,   0,  0 },
+      { "ctrarr",   FILE_ID_WORLD_COUNTER_ARRAYS, 0,  0 },
       { "b00",      FILE_ID_BOARD_INFO,           0,  0 },
       { "b01",      FILE_ID_BOARD_INFO,           1,  0 },
       { "b01bid",   FILE_ID_BOARD_BID,            1,  0 },
@@ -764,3 +779,499 @@ UNITTEST(Properties)
     ASSERTEQ(value, 0x0000, "ident (EOF)");
   }
 }
+
+/**
+ * Loading and saving complete worlds.
+ */
+
+static const char TEST_WORLD[] =
+ "../../testworlds/2.93/009 Reset same board off.mzx";
+static const char TEST_WORLD_SAVE[] = "_world_tmp.mzx";
+static const char TEST_SAVE[] = "_world_tmp.sav";
+
+/**
+ * Find a non-current board in a test world.
+ */
+static int test_world_other_board(struct world *mzx_world)
+{
+  int i;
+  for(i = 0; i < mzx_world->num_boards; i++)
+  {
+    struct board *cur_board = mzx_world->board_list[i];
+    if(cur_board && cur_board != mzx_world->current_board)
+      return i;
+  }
+  FAIL("no other board");
+  return -1;
+}
+
+/**
+ * Read a board file from a world file, and optionally return the raw
+ * (compressed) data of its zip entry as well.
+ */
+static std::vector<uint8_t> read_world_board_file(const char *file,
+ int board_id, const char *suffix, std::vector<uint8_t> *raw)
+{
+  std::vector<uint8_t> data;
+  struct zip_archive *zp;
+  struct memfile mf;
+  char find[16];
+  char name[16];
+  size_t len;
+  vfile *vf;
+
+  snprintf(find, sizeof(find), "b%2.2X%s", board_id, suffix);
+
+  vf = vfopen_unsafe(file, "rb");
+  ASSERT(vf, "%s", file);
+  ASSERTEQ(vfseek(vf, BOARD_NAME_SIZE + 4, SEEK_SET), 0, "%s", file);
+  zp = zip_open_vf_read(vf);
+  ASSERT(zp, "%s", file);
+
+  while(zip_get_next_name(zp, name, sizeof(name)) == ZIP_SUCCESS)
+  {
+    if(strcmp(name, find))
+    {
+      zip_skip_file(zp);
+      continue;
+    }
+
+    if(raw)
+    {
+      ASSERTEQ(zip_get_next_raw_file(zp, &mf), ZIP_SUCCESS, "%s", find);
+      raw->assign(mf.start, mf.end);
+      zip_skip_file(zp);
+      ASSERTEQ(zip_rewind(zp), ZIP_SUCCESS, "%s", find);
+      while(zip_get_next_name(zp, name, sizeof(name)) == ZIP_SUCCESS &&
+       strcmp(name, find))
+        zip_skip_file(zp);
+    }
+
+    ASSERTEQ(zip_get_next_uncompressed_size(zp, &len), ZIP_SUCCESS, "%s", find);
+    data.resize(len);
+    ASSERTEQ(zip_read_file(zp, data.data(), len, nullptr), ZIP_SUCCESS,
+     "%s", find);
+    break;
+  }
+  zip_close(zp, nullptr);
+
+  ASSERT(data.size(), "%s not found in %s", find, file);
+  return data;
+}
+
+UNITTEST(IncrementalSave)
+{
+  std::vector<uint8_t> prev_raw;
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> data;
+  struct board *cur_board;
+  char path[MAX_PATH];
+  uint8_t orig;
+  int board_id;
+
+  unit::world w;
+  w.temp_path(path, TEST_WORLD_SAVE);
+  get_config()->world_incremental_save = true;
+
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+  board_id = test_world_other_board(w.mzx_world);
+  cur_board = w.mzx_world->board_list[board_id];
+
+  // The world was loaded from a different file, so save everything.
+  ASSERTEQ(save_world(w.mzx_world, path, false, MZX_VERSION), 0, "");
+  data = read_world_board_file(path, board_id, "bco", &prev_raw);
+  orig = data[0];
+
+  SECTION(NotRetrieved)
+  {
+    // Change the board behind the save's back: boards that haven't been
+    // retrieved should be copied from the previous save as-is.
+    retrieve_board_from_extram(cur_board);
+    cur_board->level_color[0] ^= 0xFF;
+    store_board_to_extram(cur_board);
+    cur_board->retrieved &= ~BOARD_RETRIEVED_SAVE;
+
+    ASSERTEQ(save_world(w.mzx_world, path, false, MZX_VERSION), 0, "");
+    data = read_world_board_file(path, board_id, "bco", &raw);
+    ASSERTEQ(data[0], orig, "");
+    ASSERTEQ(raw.size(), prev_raw.size(), "");
+    ASSERTMEM(raw.data(), prev_raw.data(), raw.size(), "");
+
+    // The same should work when it's referred to by a relative path.
+    ASSERTEQ(save_world(w.mzx_world, "../../unit/.build/_world_tmp.mzx",
+     false, MZX_VERSION), 0, "");
+    data = read_world_board_file(path, board_id, "bco", nullptr);
+    ASSERTEQ(data[0], orig, "");
+  }
+
+  SECTION(Retrieved)
+  {
+    retrieve_board_from_extram(cur_board);
+    cur_board->level_color[0] ^= 0xFF;
+    store_board_to_extram(cur_board);
+
+    ASSERTEQ(save_world(w.mzx_world, path, false, MZX_VERSION), 0, "");
+    data = read_world_board_file(path, board_id, "bco", nullptr);
+    ASSERTEQ(data[0], (uint8_t)(orig ^ 0xFF), "");
+  }
+
+  SECTION(ModifiedFile)
+  {
+    // The previous save was replaced, so nothing can be copied from it.
+    retrieve_board_from_extram(cur_board);
+    cur_board->level_color[0] ^= 0xFF;
+    store_board_to_extram(cur_board);
+    cur_board->retrieved &= ~BOARD_RETRIEVED_SAVE;
+
+    ASSERTEQ(unlink(path), 0, "");
+    ASSERTEQ(save_world(w.mzx_world, path, false, MZX_VERSION), 0, "");
+    data = read_world_board_file(path, board_id, "bco", nullptr);
+    ASSERTEQ(data[0], (uint8_t)(orig ^ 0xFF), "");
+  }
+}
+
+UNITTEST(Snapshots)
+{
+  struct board *cur_board;
+  boolean faded;
+  int board_id;
+  uint8_t orig;
+  uint8_t orig_current;
+
+  unit::world w;
+  get_config()->world_snapshots = 4;
+
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+  board_id = test_world_other_board(w.mzx_world);
+  cur_board = w.mzx_world->board_list[board_id];
+
+  retrieve_board_from_extram(cur_board);
+  orig = cur_board->level_color[0];
+  store_board_to_extram(cur_board);
+  orig_current = w.mzx_world->current_board->level_color[0];
+
+  ASSERT(!world_snapshot_restore(w.mzx_world, 0, &faded), "no snapshots");
+
+  set_counter(w.mzx_world, "snapshot_test", 1, 0);
+  ASSERT(world_snapshot_take(w.mzx_world), "");
+
+  set_counter(w.mzx_world, "snapshot_test", 2, 0);
+  retrieve_board_from_extram(cur_board);
+  cur_board->level_color[0] ^= 0xFF;
+  store_board_to_extram(cur_board);
+  w.mzx_world->current_board->level_color[0] ^= 0xFF;
+
+  SECTION(Restore)
+  {
+    ASSERT(world_snapshot_restore(w.mzx_world, 0, &faded), "");
+    ASSERTEQ(get_counter(w.mzx_world, "snapshot_test", 0), 1, "");
+    ASSERTEQ(w.mzx_world->current_board->level_color[0], orig_current, "");
+
+    cur_board = w.mzx_world->board_list[board_id];
+    retrieve_board_from_extram(cur_board);
+    ASSERTEQ(cur_board->level_color[0], orig, "");
+    store_board_to_extram(cur_board);
+
+    // Restoring it again should give the same result.
+    set_counter(w.mzx_world, "snapshot_test", 3, 0);
+    ASSERT(world_snapshot_restore(w.mzx_world, 0, &faded), "");
+    ASSERTEQ(get_counter(w.mzx_world, "snapshot_test", 0), 1, "");
+  }
+
+  SECTION(Rewind)
+  {
+    // The second snapshot shares the unchanged boards with the first.
+    ASSERT(world_snapshot_take(w.mzx_world), "");
+    set_counter(w.mzx_world, "snapshot_test", 3, 0);
+
+    ASSERT(world_snapshot_restore(w.mzx_world, 0, &faded), "");
+    ASSERTEQ(get_counter(w.mzx_world, "snapshot_test", 0), 2, "");
+    cur_board = w.mzx_world->board_list[board_id];
+    retrieve_board_from_extram(cur_board);
+    ASSERTEQ(cur_board->level_color[0], (uint8_t)(orig ^ 0xFF), "");
+    store_board_to_extram(cur_board);
+
+    ASSERT(world_snapshot_restore(w.mzx_world, 1, &faded), "");
+    ASSERTEQ(get_counter(w.mzx_world, "snapshot_test", 0), 1, "");
+    ASSERTEQ(w.mzx_world->current_board->level_color[0], orig_current, "");
+    cur_board = w.mzx_world->board_list[board_id];
+    retrieve_board_from_extram(cur_board);
+    ASSERTEQ(cur_board->level_color[0], orig, "");
+    store_board_to_extram(cur_board);
+
+    // Rewinding past the oldest snapshot stays at the oldest snapshot.
+    ASSERT(world_snapshot_restore(w.mzx_world, 1, &faded), "");
+    ASSERTEQ(get_counter(w.mzx_world, "snapshot_test", 0), 1, "");
+  }
+
+  SECTION(Disabled)
+  {
+    world_snapshots_free(w.mzx_world);
+    get_config()->world_snapshots = 0;
+    ASSERT(!world_snapshot_take(w.mzx_world), "");
+    ASSERT(!world_snapshot_restore(w.mzx_world, 0, &faded), "");
+  }
+}
+
+typedef std::vector<std::pair<std::string, int>> counter_values;
+typedef std::vector<std::pair<std::string, std::string>> string_values;
+
+static counter_values get_all_counters(struct world *mzx_world)
+{
+  struct counter_iter iter{};
+  counter_values counters;
+
+  while(next_counter(&(mzx_world->counter_list), &iter))
+  {
+    counters.push_back({ std::string(iter.name, iter.name_length),
+     iter.value });
+  }
+  std::sort(counters.begin(), counters.end());
+  return counters;
+}
+
+static string_values get_all_strings(struct world *mzx_world)
+{
+  struct string_list *string_list = &(mzx_world->string_list);
+  string_values strings;
+  size_t i;
+
+  for(i = 0; i < string_list->num_strings; i++)
+  {
+    struct string *str = string_list->strings[i];
+    strings.push_back({ std::string(str->name, str->name_length),
+     std::string(str->value, str->length) });
+  }
+  std::sort(strings.begin(), strings.end());
+  return strings;
+}
+
+static void set_test_string(struct world *mzx_world, const std::string &name,
+ const std::string &value)
+{
+  char buffer[ROBOT_MAX_TR];
+  struct string src{};
+
+  snprintf(buffer, sizeof(buffer), "%s", name.c_str());
+  src.value = const_cast<char *>(value.data());
+  src.length = value.size();
+  set_string(mzx_world, buffer, &src, nullptr, 0);
+}
+
+/**
+ * Copy a snapshot, replacing the contents of some of the files in it.
+ */
+static std::vector<uint8_t> replace_snapshot_files(
+ const std::vector<uint8_t> &snapshot,
+ const std::vector<std::pair<std::string, std::vector<uint8_t>>> &files)
+{
+  // Savegame header: magic, version, world version, current board.
+  static constexpr size_t HEADER_SIZE = 8;
+  std::vector<uint8_t> file;
+  char name[256];
+  size_t buffer_size = snapshot.size() * 2;
+  void *buffer = malloc(buffer_size);
+  uint64_t final_size;
+
+  struct zip_archive *src = zip_open_mem_read(snapshot.data(), snapshot.size());
+  ASSERT(src, "");
+  ASSERT(buffer, "");
+  memcpy(buffer, snapshot.data(), HEADER_SIZE);
+
+  struct zip_archive *dest = zip_open_mem_write_ext(&buffer, &buffer_size,
+   HEADER_SIZE);
+  ASSERT(dest, "");
+
+  while(zip_get_next_name(src, name, sizeof(name)) == ZIP_SUCCESS)
+  {
+    auto it = std::find_if(files.begin(), files.end(),
+     [&name](const std::pair<std::string, std::vector<uint8_t>> &f)
+     {
+       return f.first == name;
+     });
+
+    if(it != files.end())
+    {
+      ASSERTEQ(zip_skip_file(src), ZIP_SUCCESS, "%s", name);
+      file = it->second;
+    }
+    else
+    {
+      size_t size;
+      ASSERTEQ(zip_get_next_uncompressed_size(src, &size), ZIP_SUCCESS, "");
+      file.resize(size);
+      ASSERTEQ(zip_read_file(src, file.data(), size, nullptr), ZIP_SUCCESS,
+       "%s", name);
+    }
+    ASSERTEQ(zip_write_file(dest, name, file.data(), file.size(), ZIP_M_NONE),
+     ZIP_SUCCESS, "%s", name);
+  }
+  zip_close(src, nullptr);
+  ASSERTEQ(zip_close(dest, &final_size), ZIP_SUCCESS, "");
+
+  std::vector<uint8_t> out((uint8_t *)buffer, (uint8_t *)buffer + final_size);
+  free(buffer);
+  return out;
+}
+
+UNITTEST(BulkCountersStrings)
+{
+  std::vector<uint8_t> snapshot;
+  counter_values counters;
+  string_values strings;
+  std::string max_name(ROBOT_MAX_TR - 1, 'C');
+  std::string long_value;
+  boolean faded;
+  void *data;
+  size_t size;
+  size_t i;
+
+  unit::world w;
+  ASSERT(w.load(TEST_WORLD), "%s", TEST_WORLD);
+
+  for(i = 0; i < 100000; i++)
+    long_value += (char)(i * 7);
+
+  // Names of the minimum and maximum lengths, in mixed case.
+  set_counter(w.mzx_world, "a", 1, 0);
+  set_counter(w.mzx_world, "MixedCase", -2, 0);
+  set_counter(w.mzx_world, max_name.c_str(), INT_MAX, 0);
+  set_test_string(w.mzx_world, "$", "");
+  set_test_string(w.mzx_world, "$MixedCase", "value");
+  set_test_string(w.mzx_world, "$" + max_name.substr(1), long_value);
+  set_test_string(w.mzx_world, "$empty", "");
+
+  counters = get_all_counters(w.mzx_world);
+  strings = get_all_strings(w.mzx_world);
+  ASSERTEQ(get_counter(w.mzx_world, max_name.c_str(), 0), INT_MAX, "");
+
+  ASSERTEQ(save_world_snapshot(w.mzx_world, &data, &size, nullptr, 0), 0, "");
+  snapshot.assign((uint8_t *)data, (uint8_t *)data + size);
+  free(data);
+
+  {
+    // Snapshots are current version saves, so they use the bulk formats.
+    struct zip_archive *zp = zip_open_mem_read(snapshot.data(),
+     snapshot.size());
+    ASSERT(zp, "");
+    ASSERTEQ(zip_find_file(zp, "ctrbulk"), ZIP_SUCCESS, "");
+    ASSERTEQ(zip_find_file(zp, "strbulk"), ZIP_SUCCESS, "");
+    zip_close(zp, nullptr);
+  }
+
+  // Modify the counters and strings so the snapshot has to replace them.
+  set_counter(w.mzx_world, "a", 100, 0);
+  set_counter(w.mzx_world, "new_counter", 100, 0);
+  set_test_string(w.mzx_world, "$", "not empty");
+  set_test_string(w.mzx_world, "$new_string", "value");
+
+  SECTION(RoundTrip)
+  {
+    ASSERT(reload_world_snapshot(w.mzx_world, snapshot.data(),
+     snapshot.size(), &faded), "");
+
+    ASSERT(get_all_counters(w.mzx_world) == counters, "");
+    ASSERT(get_all_strings(w.mzx_world) == strings, "");
+  }
+
+  SECTION(SaveVersions)
+  {
+    // Saves use the bulk formats starting with 2.94. Saves exported for the
+    // previous version use the old formats.
+    static const struct
+    {
+      int version;
+      const char *counters_file;
+      const char *strings_file;
+    } versions[] =
+    {
+      { MZX_VERSION,      "ctrbulk", "strbulk" },
+      { MZX_VERSION_PREV, "counter", "string" },
+    };
+    char path[MAX_PATH];
+    w.temp_path(path, TEST_SAVE);
+
+    counters = get_all_counters(w.mzx_world);
+    strings = get_all_strings(w.mzx_world);
+
+    for(const auto &v : versions)
+    {
+      ASSERTEQ(save_world(w.mzx_world, path, true, v.version), 0, "");
+
+      struct zip_archive *zp = zip_open_file_read(path);
+      ASSERT(zp, "");
+      ASSERTEQ(zip_find_file(zp, v.counters_file), ZIP_SUCCESS, "");
+      ASSERTEQ(zip_find_file(zp, v.strings_file), ZIP_SUCCESS, "");
+      zip_close(zp, nullptr);
+
+      set_counter(w.mzx_world, "a", 12345, 0);
+      set_test_string(w.mzx_world, "$", "modified");
+      ASSERT(reload_savegame(w.mzx_world, path, &faded), "%04x", v.version);
+      ASSERT(get_all_counters(w.mzx_world) == counters, "%04x", v.version);
+      ASSERT(get_all_strings(w.mzx_world) == strings, "%04x", v.version);
+    }
+  }
+
+  SECTION(InvalidCounters)
+  {
+    // Header, values, name lengths, and names.
+    std::vector<uint8_t> too_long = { 1,0,0,0, 0x00,0x02,0,0, 0,0,0,0, 0,0 };
+    std::vector<uint8_t> bad_sum = { 2,0,0,0, 4,0,0,0, 0,0,0,0, 0,0,0,0,
+     1,0, 2,0, 'a','b','c','d' };
+    std::vector<uint8_t> bad_length = { 1,0,0,0, 0xFF,0x01,0,0, 0,0,0,0,
+     0x00,0x02 };
+
+    // One counter with a names block longer than a name can be.
+    too_long.resize(too_long.size() + 0x200, 'x');
+    // A name length that doesn't fit in a name buffer.
+    bad_length.resize(bad_length.size() + 0x1FF, 'x');
+
+    for(const std::vector<uint8_t> &file : { too_long, bad_sum, bad_length })
+    {
+      std::vector<uint8_t> bad = replace_snapshot_files(snapshot,
+       { { "ctrbulk", file } });
+
+      ASSERT(reload_world_snapshot(w.mzx_world, bad.data(), bad.size(),
+       &faded), "");
+      ASSERT(get_all_counters(w.mzx_world).empty(), "");
+      ASSERT(get_all_strings(w.mzx_world) == strings, "");
+    }
+
+    // Fixed, it loads. Empty names can't be created normally, but they're
+    // valid in the file.
+    bad_sum[16] = 0;
+    bad_sum[18] = 4;
+    std::vector<uint8_t> good = replace_snapshot_files(snapshot,
+     { { "ctrbulk", bad_sum } });
+    ASSERT(reload_world_snapshot(w.mzx_world, good.data(), good.size(),
+     &faded), "");
+    ASSERT(get_all_counters(w.mzx_world) ==
+     counter_values({ { "", 0 }, { "abcd", 0 } }), "");
+  }
+
+  SECTION(InvalidStrings)
+  {
+    // The string lengths don't add up to the rest of the file.
+    static const uint8_t invalid[] =
+    {
+      1,0,0,0, 1,0,0,0, 1,0, 5,0,0,0, '$', 'a','b','c','d'
+    };
+    std::vector<uint8_t> file(invalid, invalid + sizeof(invalid));
+
+    std::vector<uint8_t> bad = replace_snapshot_files(snapshot,
+     { { "strbulk", file } });
+
+    ASSERT(reload_world_snapshot(w.mzx_world, bad.data(), bad.size(),
+     &faded), "");
+    ASSERT(get_all_counters(w.mzx_world) == counters, "");
+    ASSERT(get_all_strings(w.mzx_world).empty(), "");
+
+    // Fixed, it loads.
+    file.push_back('e');
+    bad = replace_snapshot_files(snapshot, { { "strbulk", file } });
+    ASSERT(reload_world_snapshot(w.mzx_world, bad.data(), bad.size(),
+     &faded), "");
+    ASSERT(get_all_strings(w.mzx_world) ==
+     string_values({ { "$", "abcde" } }), "");
+  }
+}